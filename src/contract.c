@@ -0,0 +1,989 @@
+/***************************************
+ Contraction hierarchy data type functions and routing.
+
+ Part of the Routino routing software.
+ ******************/ /******************
+ This file Copyright 2008-2013 Andrew M. Bishop
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************/
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "types.h"
+#include "nodes.h"
+#include "segments.h"
+#include "ways.h"
+#include "relations.h"
+
+#include "contract.h"
+
+#include "files.h"
+#include "logging.h"
+#include "functions.h"
+#include "fakes.h"
+#include "query.h"
+#include "results.h"
+
+
+/*+ To help when debugging +*/
+#define DEBUG 0
+
+
+/* Global variables */
+
+/*+ The option not to print any progress information. +*/
+extern int option_quiet;
+
+
+/* Local functions */
+
+static index_t ChNodeIndex(Contraction *contraction,index_t node);
+static index_t ChSegmentEdge(Contraction *contraction,index_t segment);
+
+static int CanContinue(Query *query,Relations *relations,Profile *profile,Node *nodep,index_t node,index_t seg1,index_t seg2,int force_uturn);
+
+static index_t FindChEdge(Contraction *contraction,index_t node1,index_t node2,index_t seg2,score_t score1,score_t score2,int backwards);
+static Result *UnpackEdge(Contraction *contraction,Results *results,Result *result,index_t edge,index_t from);
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Load in a contraction hierarchy from a file.
+
+  Contraction *LoadContraction Returns the contraction hierarchy.
+
+  const char *filename The name of the file to load.
+
+  In slim mode the file is read into memory since it only contains the super-nodes and super-segments.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+Contraction *LoadContraction(const char *filename)
+{
+ Contraction *contraction;
+
+ contraction=(Contraction*)malloc(sizeof(Contraction));
+
+#if !SLIM
+
+ contraction->data=MapFile(filename);
+
+#else
+
+ {
+  off_t size=SizeFile(filename);
+  int fd=SlimMapFile(filename);
+
+  contraction->data=malloc(size);
+
+  SlimFetch(fd,contraction->data,size,0);
+
+  SlimUnmapFile(fd);
+ }
+
+#endif
+
+ /* Copy the ContractionFile header structure from the loaded data */
+
+ contraction->file=*((ContractionFile*)contraction->data);
+
+ /* Set the pointers in the Contraction structure. */
+
+ contraction->nodes   =(ChNode*) ((char*)contraction->data+sizeof(ContractionFile));
+ contraction->edgelist=(index_t*)(contraction->nodes+contraction->file.number+1);
+ contraction->edges   =(ChEdge*) (contraction->edgelist+contraction->file.lnumber);
+
+ return(contraction);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Destroy the contraction hierarchy.
+
+  Contraction *contraction The contraction hierarchy to destroy.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+void DestroyContraction(Contraction *contraction)
+{
+#if !SLIM
+
+ contraction->data=UnmapFile(contraction->data);
+
+#else
+
+ free(contraction->data);
+
+#endif
+
+ free(contraction);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Check if the contraction hierarchy was created with the same profile and type of route.
+
+  int ContractionMatchesProfile Returns true if the contraction hierarchy can be used.
+
+  Contraction *contraction The contraction hierarchy.
+
+  Profile *profile The profile (after UpdateProfile() has been called).
+
+  int quickest Set for the quickest route.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+int ContractionMatchesProfile(Contraction *contraction,Profile *profile,int quickest)
+{
+ ChProfile chprofile;
+
+ SetChProfile(&chprofile,profile,quickest);
+
+ return(!memcmp(&chprofile,&contraction->file.profile,sizeof(ChProfile)));
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Find the optimum route between two nodes where the start and end are a set of pre/post-routed super-nodes
+  using the contraction hierarchy of the super-nodes.
+
+  Results *FindMiddleRouteContracted Returns a set of results (the same as FindMiddleRoute()).
+
+  Query *query The query containing the routing options and the fake nodes and segments.
+
+  Nodes *nodes The set of nodes to use.
+
+  Segments *segments The set of segments to use.
+
+  Ways *ways The set of ways to use.
+
+  Relations *relations The set of relations to use.
+
+  Profile *profile The profile containing the transport type, speeds and allowed highways.
+
+  Contraction *contraction The contraction hierarchy for the profile and type of route.
+
+  Results *begin The initial portion of the route.
+
+  Results *end The final portion of the route.
+
+  The forward search is keyed by the node and the super-segment used to arrive at it, the backward search is
+  keyed by the node and the super-segment used to leave it; both only follow edges towards nodes that were
+  contracted later (or that are in the core). The shortcuts are unpacked into super-segments at the end.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+Results *FindMiddleRouteContracted(Query *query,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,
+                                   Contraction *contraction,Results *begin,Results *end)
+{
+ Results *results,*forward,*back;
+ Queue   *queue,*backqueue;
+ Result  *finish_result,*start_result=NULL,**seeds;
+ Result  *meet_result=NULL,*meet_backresult=NULL,*meet_endresult=NULL;
+ score_t meet_score=INF_SCORE;
+ index_t start_ch=NO_NODE;
+ Result  *result1,*result2,*result3,*result4;
+ int     force_uturn=0,forward_done=0,backward_done=0,backwards=1,nseeds=0;
+
+#if DEBUG
+ printf("  FindMiddleRouteContracted(...,[begin has %d nodes],[end has %d nodes] finish_node=%"Pindex_t " )\n",begin->number,end->number,end->finish_node);
+#endif
+
+#if !DEBUG
+ if(!option_quiet)
+    printf_first("Routing: Super-Nodes checked = 0");
+#endif
+
+ /* Create the list of backward results and insert the super-nodes before the final part of the route
+    (the node at the other end of each super-segment, leaving by that super-segment). */
+
+ back=NewResultsList(20);
+ backqueue=NewQueueList(12);
+
+ result3=FirstResult(end);
+
+ while(result3)
+   {
+    if(!IsFakeNode(result3->node) && !IsFakeSegment(result3->segment) &&
+       IsSuperNode(LookupNode(nodes,result3->node,3)) && IsSuperSegment(LookupSegment(segments,result3->segment,1)))
+      {
+       Node *nodep=LookupNode(nodes,result3->node,3);
+       index_t edge=ChSegmentEdge(contraction,result3->segment);
+       index_t node=ChNodeIndex(contraction,result3->node);
+       ChEdge *edgep;
+       index_t x;
+       score_t score;
+
+       /* mode of transport must be allowed through the node unless it is the final node */
+       if(edge==NO_SEGMENT || node==NO_NODE || (result3->node!=end->finish_node && !(nodep->allow&profile->allow)))
+          goto endseed;
+
+       edgep=&contraction->edges[edge];
+
+       x=ChOtherNode(edgep,node);
+
+       if(ChScoreFrom(edgep,x)==INF_SCORE)
+          goto endseed;
+
+       score=ChScoreFrom(edgep,x)+result3->score;
+
+       result2=FindResult(back,x,result3->segment);
+
+       if(!result2)
+          result2=InsertResult(back,x,result3->segment);
+       else if(score>=result2->score)
+          goto endseed;
+
+       result2->prev=result3; /* the final part of the route */
+       result2->next=NULL;
+       result2->score=score;
+
+       InsertInQueue(backqueue,result2,score);
+      }
+
+   endseed:
+
+    result3=NextResult(end,result3);
+   }
+
+ /* Create the list of results (using database nodes) and the list for the forward search (using contraction nodes) */
+
+ results=NewResultsList(20);
+
+ forward=NewResultsList(20);
+ queue=NewQueueList(12);
+
+ results->start_node=begin->start_node;
+ results->prev_segment=begin->prev_segment;
+
+ if(begin->number==1)
+   {
+    if(begin->prev_segment==NO_SEGMENT)
+       results->prev_segment=NO_SEGMENT;
+    else
+      {
+       index_t superseg=FindSuperSegment(query,nodes,segments,ways,relations,begin->start_node,begin->prev_segment);
+
+       results->prev_segment=superseg;
+      }
+   }
+
+ result1=InsertResult(results,results->start_node,results->prev_segment);
+
+ /* Check for barrier at start waypoint - must perform U-turn */
+
+ if(begin->number==1 && results->prev_segment!=NO_SEGMENT)
+   {
+    Node *startp=LookupNode(nodes,result1->node,1);
+
+    if(!(startp->allow&profile->allow))
+       force_uturn=1;
+   }
+
+ if(!IsFakeNode(results->start_node))
+    start_ch=ChNodeIndex(contraction,results->start_node);
+
+ /* Insert the finish points of the beginning part of the path into the queue,
+    translating the segments into super-segments (these need not be edges in the contraction hierarchy). */
+
+ seeds=(Result**)malloc((begin->number+1)*sizeof(Result*));
+
+ result3=FirstResult(begin);
+
+ while(result3)
+   {
+    if((results->start_node!=result3->node || results->prev_segment!=result3->segment) &&
+       !IsFakeNode(result3->node) && IsSuperNode(LookupNode(nodes,result3->node,5)))
+      {
+       Result *result5=result1;
+       index_t superseg=FindSuperSegment(query,nodes,segments,ways,relations,result3->node,result3->segment);
+       index_t node=ChNodeIndex(contraction,result3->node);
+
+       if(node==NO_NODE)
+          goto endbegin;
+
+       if(superseg!=result3->segment)
+         {
+          result5=InsertResult(results,result3->node,result3->segment);
+
+          result5->prev=result1;
+         }
+
+       if(!FindResult(forward,node,superseg))
+         {
+          result2=InsertResult(forward,node,superseg);
+          result2->next=result5; /* the initial part of the route */
+
+          result2->score=result3->score;
+
+          InsertInQueue(queue,result2,result3->score);
+
+          seeds[nseeds++]=result2;
+
+          if((result4=FindResult(end,result3->node,superseg)))
+            {
+             if((result2->score+result4->score)<meet_score)
+               {
+                meet_score=result2->score+result4->score;
+                meet_result=result2;
+                meet_backresult=NULL;
+                meet_endresult=result4;
+               }
+            }
+         }
+      }
+
+   endbegin:
+
+    result3=NextResult(begin,result3);
+   }
+
+ if(begin->number==1 && start_ch!=NO_NODE)
+   {
+    start_result=InsertResult(forward,start_ch,results->prev_segment);
+    start_result->next=result1;
+
+    InsertInQueue(queue,start_result,0);
+
+    seeds[nseeds++]=start_result;
+   }
+
+ /* Check if the forward search starts where the backward search starts */
+
+ for(result2=FirstResult(forward);result2;result2=NextResult(forward,result2))
+   {
+    index_t node=result2->node;
+    index_t node_db=contraction->nodes[node].node;
+    Node *nodep=LookupNode(nodes,node_db,1);
+    index_t i;
+
+    for(i=contraction->nodes[node].firstedge;i<contraction->nodes[node+1].firstedge;i++)
+       if(contraction->edgelist[i]<contraction->file.snumber)
+         {
+          index_t seg2=contraction->edges[contraction->edgelist[i]].seg1;
+
+          if((result3=FindResult(back,node,seg2)) &&
+             CanContinue(query,relations,profile,nodep,node_db,result2->segment,seg2,force_uturn && node==start_ch))
+             if((result2->score+result3->score)<meet_score)
+               {
+                meet_score=result2->score+result3->score;
+                meet_result=result2;
+                meet_backresult=result3;
+                meet_endresult=NULL;
+               }
+         }
+   }
+
+ /* Loop across all nodes in both queues taking one from each in turn */
+
+ while(!forward_done || !backward_done)
+   {
+    Node *node1p,*node2p;
+    index_t node1,node1_db,node2,node2_db,seg1,seg2,i;
+    ChEdge *edgep;
+    score_t cumulative_score;
+
+    backwards=!backwards;
+
+    if(backwards && backward_done)
+       backwards=0;
+    else if(!backwards && forward_done)
+       backwards=1;
+
+    if(backwards)
+      {
+       result1=PopFromQueue(backqueue);
+
+       if(!result1 || result1->score>=meet_score)
+         {
+          backward_done=1;
+          continue;
+         }
+      }
+    else
+      {
+       result1=PopFromQueue(queue);
+
+       if(!result1 || result1->score>=meet_score)
+         {
+          forward_done=1;
+          continue;
+         }
+      }
+
+    node1=result1->node;
+    seg1=result1->segment;
+
+    node1_db=contraction->nodes[node1].node;
+
+    node1p=LookupNode(nodes,node1_db,1); /* node1 cannot be a fake node (must be a super-node) */
+
+    if(backwards)
+       goto backward;
+
+    /* The forward search leaves node1 by an edge towards a higher ranked node */
+
+    for(i=contraction->nodes[node1].firstedge;i<contraction->nodes[node1+1].firstedge;i++)
+      {
+       index_t j;
+
+       edgep=&contraction->edges[contraction->edgelist[i]];
+
+       node2=ChOtherNode(edgep,node1);
+
+       if(!ChUpwards(contraction->nodes[node1].rank,contraction->nodes[node2].rank))
+          continue;
+
+       if(ChScoreFrom(edgep,node1)==INF_SCORE)
+          continue;
+
+       if(!CanContinue(query,relations,profile,node1p,node1_db,seg1,ChLeaveSegment(edgep,node1),force_uturn && node1==start_ch))
+          continue;
+
+       node2_db=contraction->nodes[node2].node;
+
+       node2p=LookupNode(nodes,node2_db,2); /* node2 cannot be a fake node (must be a super-node) */
+
+       /* mode of transport must be allowed through node2 unless it is the final node */
+       if(node2_db!=end->finish_node && !(node2p->allow&profile->allow))
+          continue;
+
+       cumulative_score=result1->score+ChScoreFrom(edgep,node1);
+
+       /* score must be better than current best score */
+       if(cumulative_score>=meet_score)
+          continue;
+
+       seg2=ChArriveSegment(edgep,node2);
+
+       result2=FindResult(forward,node2,seg2);
+
+       if(!result2) /* New end node/segment pair */
+         {
+          result2=InsertResult(forward,node2,seg2);
+          result2->prev=result1;
+          result2->score=cumulative_score;
+         }
+       else if(cumulative_score<result2->score) /* New end node/segment pair is better */
+         {
+          result2->prev=result1;
+          result2->score=cumulative_score;
+         }
+       else
+          continue;
+
+       /* the final part of the route is not extended */
+       if((result3=FindResult(end,node2_db,seg2)))
+         {
+          if((result2->score+result3->score)<meet_score)
+            {
+             meet_score=result2->score+result3->score;
+             meet_result=result2;
+             meet_backresult=NULL;
+             meet_endresult=result3;
+            }
+
+          continue;
+         }
+
+       InsertInQueue(queue,result2,cumulative_score);
+
+       /* check if the backward search has reached this node leaving by a compatible super-segment */
+
+       for(j=contraction->nodes[node2].firstedge;j<contraction->nodes[node2+1].firstedge;j++)
+          if(contraction->edgelist[j]<contraction->file.snumber)
+            {
+             index_t seg3=contraction->edges[contraction->edgelist[j]].seg1;
+
+             if((result3=FindResult(back,node2,seg3)) &&
+                CanContinue(query,relations,profile,node2p,node2_db,seg2,seg3,force_uturn && node2==start_ch))
+                if((result2->score+result3->score)<meet_score)
+                  {
+                   meet_score=result2->score+result3->score;
+                   meet_result=result2;
+                   meet_backresult=result3;
+                   meet_endresult=NULL;
+                  }
+            }
+
+#if !DEBUG
+       if(!option_quiet && !((forward->number+back->number)%1000))
+          printf_middle("Routing: Super-Nodes checked = %d",forward->number+back->number);
+#endif
+      }
+
+    continue;
+
+    /* The backward search arrives at node1 by an edge from a higher ranked node */
+
+   backward:
+
+    /* mode of transport must be allowed through node1 unless it is the final node */
+    if(node1_db!=end->finish_node && !(node1p->allow&profile->allow))
+       continue;
+
+    for(i=contraction->nodes[node1].firstedge;i<contraction->nodes[node1+1].firstedge;i++)
+      {
+       index_t j,seg3;
+
+       edgep=&contraction->edges[contraction->edgelist[i]];
+
+       node2=ChOtherNode(edgep,node1);
+
+       if(!ChUpwards(contraction->nodes[node1].rank,contraction->nodes[node2].rank))
+          continue;
+
+       if(ChScoreFrom(edgep,node2)==INF_SCORE)
+          continue;
+
+       seg3=ChArriveSegment(edgep,node1);
+
+       if(!CanContinue(query,relations,profile,node1p,node1_db,seg3,seg1,force_uturn && node1==start_ch))
+          continue;
+
+       /* the final part of the route is not extended */
+       if(FindResult(end,node1_db,seg3))
+          continue;
+
+       cumulative_score=result1->score+ChScoreFrom(edgep,node2);
+
+       /* score must be better than current best score */
+       if(cumulative_score>=meet_score)
+          continue;
+
+       seg2=ChLeaveSegment(edgep,node2);
+
+       result2=FindResult(back,node2,seg2);
+
+       if(!result2) /* New start node/segment pair */
+         {
+          result2=InsertResult(back,node2,seg2);
+          result2->next=result1; /* working backwards */
+          result2->score=cumulative_score;
+         }
+       else if(cumulative_score<result2->score) /* New start node/segment pair is better */
+         {
+          result2->prev=NULL;
+          result2->next=result1; /* working backwards */
+          result2->score=cumulative_score;
+         }
+       else
+          continue;
+
+       InsertInQueue(backqueue,result2,cumulative_score);
+
+       /* check if the forward search has reached this node arriving by a compatible super-segment */
+
+       node2_db=contraction->nodes[node2].node;
+
+       node2p=LookupNode(nodes,node2_db,2); /* node2 cannot be a fake node (must be a super-node) */
+
+       for(j=contraction->nodes[node2].firstedge;j<contraction->nodes[node2+1].firstedge+nseeds;j++)
+         {
+          if(j<contraction->nodes[node2+1].firstedge)
+            {
+             index_t seg4;
+
+             if(contraction->edgelist[j]>=contraction->file.snumber)
+                continue;
+
+             seg4=contraction->edges[contraction->edgelist[j]].seg1;
+
+             if(!(result3=FindResult(forward,node2,seg4)))
+                continue;
+
+             if(FindResult(end,node2_db,seg4))
+                continue;
+            }
+          else if(seeds[j-contraction->nodes[node2+1].firstedge]->node==node2)
+             result3=seeds[j-contraction->nodes[node2+1].firstedge];
+          else
+             continue;
+
+          if(CanContinue(query,relations,profile,node2p,node2_db,result3->segment,seg2,force_uturn && node2==start_ch))
+             if((result3->score+result2->score)<meet_score)
+               {
+                meet_score=result3->score+result2->score;
+                meet_result=result3;
+                meet_backresult=result2;
+                meet_endresult=NULL;
+               }
+         }
+
+#if !DEBUG
+       if(!option_quiet && !((forward->number+back->number)%1000))
+          printf_middle("Routing: Super-Nodes checked = %d",forward->number+back->number);
+#endif
+      }
+   }
+
+#if !DEBUG
+ if(!option_quiet)
+    printf_last("Routing: Super-Nodes checked = %d",forward->number+back->number);
+#endif
+
+ FreeQueueList(queue);
+ FreeQueueList(backqueue);
+
+ free(seeds);
+
+ /* Check it worked */
+
+ if(!meet_result)
+   {
+#if DEBUG
+    printf("    Failed\n");
+#endif
+
+    FreeResultsList(results);
+    FreeResultsList(forward);
+    FreeResultsList(back);
+    return(NULL);
+   }
+
+ /* Unpack the forward search from the start to the meeting point */
+
+ {
+  Result **chain;
+  int nchain=0,n;
+
+  for(result2=meet_result;result2;result2=result2->prev)
+     nchain++;
+
+  chain=(Result**)malloc(nchain*sizeof(Result*));
+
+  for(n=nchain-1,result2=meet_result;result2;result2=result2->prev,n--)
+     chain[n]=result2;
+
+  if(chain[0]==start_result)
+     finish_result=start_result->next;
+  else
+    {
+     index_t node_db=contraction->nodes[chain[0]->node].node;
+
+     finish_result=FindResult(results,node_db,chain[0]->segment);
+
+     if(!finish_result)
+        finish_result=InsertResult(results,node_db,chain[0]->segment);
+
+     finish_result->prev=chain[0]->next;
+     finish_result->score=chain[0]->score;
+    }
+
+  for(n=1;n<nchain;n++)
+    {
+     index_t edge=FindChEdge(contraction,chain[n-1]->node,chain[n]->node,chain[n]->segment,chain[n-1]->score,chain[n]->score,0);
+
+     finish_result=UnpackEdge(contraction,results,finish_result,edge,chain[n-1]->node);
+    }
+
+  free(chain);
+ }
+
+ /* Unpack the backward search from the meeting point to the final part of the route */
+
+ if(meet_backresult)
+   {
+    for(result3=meet_backresult;result3->next;result3=result3->next)
+      {
+       index_t edge=FindChEdge(contraction,result3->node,result3->next->node,result3->segment,result3->score,result3->next->score,1);
+
+       finish_result=UnpackEdge(contraction,results,finish_result,edge,result3->node);
+      }
+
+    finish_result=UnpackEdge(contraction,results,finish_result,ChSegmentEdge(contraction,result3->segment),result3->node);
+
+    meet_endresult=result3->prev;
+   }
+
+ FreeResultsList(forward);
+ FreeResultsList(back);
+
+ /* Finish off the end part of the route */
+
+ if(finish_result->node!=end->finish_node)
+   {
+    result3=InsertResult(results,end->finish_node,NO_SEGMENT);
+
+    result3->prev=finish_result;
+    result3->score=finish_result->score+meet_endresult->score;
+
+    finish_result=result3;
+   }
+
+ FixForwardRoute(results,finish_result);
+
+#if DEBUG
+ Result *r=FindResult(results,results->start_node,results->prev_segment);
+
+ while(r)
+   {
+    printf("    node=%"Pindex_t" segment=%"Pindex_t" score=%f\n",r->node,r->segment,r->score);
+
+    r=r->next;
+   }
+#endif
+
+ return(results);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Find the contraction hierarchy node for a super-node.
+
+  index_t ChNodeIndex Returns the index of the contraction hierarchy node (or NO_NODE if there is none).
+
+  Contraction *contraction The contraction hierarchy.
+
+  index_t node The super-node in the database.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static index_t ChNodeIndex(Contraction *contraction,index_t node)
+{
+ index_t start=0;
+ index_t end=contraction->file.number;
+ index_t mid;
+
+ /* Binary search - search key exact match only is required.
+  *
+  *  # <- start  |  Check mid and move start or end if it doesn't match
+  *  #           |
+  *  #           |  Since an exact match is wanted we can set end=mid-1
+  *  # <- mid    |  or start=mid+1 because we know that mid doesn't match.
+  *  #           |
+  *  #           |  Eventually either end=start or end=start+1 and one of
+  *  # <- end    |  start or end is the wanted one.
+  */
+
+ while(start<end)
+   {
+    mid=start+(end-start)/2;
+
+    if(contraction->nodes[mid].node<node)
+       start=mid+1;
+    else
+       end=mid;
+   }
+
+ if(start<contraction->file.number && contraction->nodes[start].node==node)
+    return(start);
+
+ return(NO_NODE);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Find the contraction hierarchy edge for a super-segment.
+
+  index_t ChSegmentEdge Returns the index of the edge (or NO_SEGMENT if there is none).
+
+  Contraction *contraction The contraction hierarchy.
+
+  index_t segment The super-segment in the database.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static index_t ChSegmentEdge(Contraction *contraction,index_t segment)
+{
+ index_t start=0;
+ index_t end=contraction->file.snumber;
+ index_t mid;
+
+ while(start<end)
+   {
+    mid=start+(end-start)/2;
+
+    if(contraction->edges[mid].seg1<segment)
+       start=mid+1;
+    else
+       end=mid;
+   }
+
+ if(start<contraction->file.snumber && contraction->edges[start].seg1==segment)
+    return(start);
+
+ return(NO_SEGMENT);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Check if a route can continue from one super-segment to another at a super-node (the same checks as FindMiddleRoute()).
+
+  int CanContinue Returns true if the route can continue.
+
+  Query *query The query containing the fake segments.
+
+  Relations *relations The set of relations to use.
+
+  Profile *profile The profile containing the transport type.
+
+  Node *nodep The super-node.
+
+  index_t node The index of the super-node in the database.
+
+  index_t seg1 The segment used to arrive at the node (or NO_SEGMENT).
+
+  index_t seg2 The super-segment used to leave the node.
+
+  int force_uturn Set if the route must perform a U-turn at this node.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int CanContinue(Query *query,Relations *relations,Profile *profile,Node *nodep,index_t node,index_t seg1,index_t seg2,int force_uturn)
+{
+ /* must perform U-turn in special cases */
+ if(force_uturn)
+   {
+    if(seg2!=seg1)
+       return(0);
+   }
+ else
+    /* must not perform U-turn */
+    if(seg1==seg2)
+       return(0);
+
+ /* must obey turn relations */
+ if(profile->turns && IsTurnRestrictedNode(nodep))
+   {
+    index_t seg1r,turnrelation;
+
+    if(IsFakeSegment(seg1))
+       seg1r=IndexRealSegment(query,seg1);
+    else
+       seg1r=seg1;
+
+    turnrelation=FindFirstTurnRelation2(relations,node,seg1r);
+
+    if(turnrelation!=NO_RELATION && !IsTurnAllowed(relations,turnrelation,node,seg1r,seg2,profile->allow))
+       return(0);
+   }
+
+ return(1);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Find the edge that was used by the search between two results.
+
+  index_t FindChEdge Returns the index of the edge.
+
+  Contraction *contraction The contraction hierarchy.
+
+  index_t node1 The node at the start of the edge.
+
+  index_t node2 The node at the end of the edge.
+
+  index_t seg2 The super-segment used to arrive at node2 (forwards) or leave node1 (backwards).
+
+  score_t score1 The score of the result at node1.
+
+  score_t score2 The score of the result at node2.
+
+  int backwards Set for the backward search (scores decrease along the route).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static index_t FindChEdge(Contraction *contraction,index_t node1,index_t node2,index_t seg2,score_t score1,score_t score2,int backwards)
+{
+ index_t i,best=NO_SEGMENT;
+ score_t best_error=INF_SCORE;
+
+ for(i=contraction->nodes[node1].firstedge;i<contraction->nodes[node1+1].firstedge;i++)
+   {
+    index_t edge=contraction->edgelist[i];
+    ChEdge *edgep=&contraction->edges[edge];
+    score_t score,error;
+
+    if(ChOtherNode(edgep,node1)!=node2)
+       continue;
+
+    if(backwards)
+      {
+       if(ChLeaveSegment(edgep,node1)!=seg2)
+          continue;
+
+       score=score2+ChScoreFrom(edgep,node1);
+       error=score-score1;
+      }
+    else
+      {
+       if(ChArriveSegment(edgep,node2)!=seg2)
+          continue;
+
+       score=score1+ChScoreFrom(edgep,node1);
+       error=score-score2;
+      }
+
+    if(error<0)
+       error=-error;
+
+    if(error<best_error)
+      {
+       best_error=error;
+       best=edge;
+      }
+   }
+
+ return(best);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Unpack an edge into super-segments and append them to the results.
+
+  Result *UnpackEdge Returns the last result that was added.
+
+  Contraction *contraction The contraction hierarchy.
+
+  Results *results The results to append to.
+
+  Result *result The result at the start of the edge.
+
+  index_t edge The edge to unpack.
+
+  index_t from The contraction hierarchy node to start from.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static Result *UnpackEdge(Contraction *contraction,Results *results,Result *result,index_t edge,index_t from)
+{
+ ChEdge *edgep=&contraction->edges[edge];
+
+ if(edge<contraction->file.snumber)
+   {
+    index_t to=ChOtherNode(edgep,from);
+    index_t node=contraction->nodes[to].node;
+    Result *result2;
+
+    result2=FindResult(results,node,edgep->seg1);
+
+    if(!result2)
+       result2=InsertResult(results,node,edgep->seg1);
+
+    result2->prev=result;
+    result2->score=result->score+ChScoreFrom(edgep,from);
+
+    return(result2);
+   }
+ else if(edgep->node1==from)
+   {
+    index_t middle=ChOtherNode(&contraction->edges[edgep->child1],from);
+
+    result=UnpackEdge(contraction,results,result,edgep->child1,from);
+
+    return(UnpackEdge(contraction,results,result,edgep->child2,middle));
+   }
+ else
+   {
+    index_t middle=ChOtherNode(&contraction->edges[edgep->child2],from);
+
+    result=UnpackEdge(contraction,results,result,edgep->child2,from);
+
+    return(UnpackEdge(contraction,results,result,edgep->child1,middle));
+   }
+}
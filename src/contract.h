@@ -0,0 +1,216 @@
+/***************************************
+ A header file for the contraction hierarchy of the super-nodes.
+
+ Part of the Routino routing software.
+ ******************/ /******************
+ This file Copyright 2008-2013 Andrew M. Bishop
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************/
+
+
+#ifndef CONTRACT_H
+#define CONTRACT_H    /*+ To stop multiple inclusions. +*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "types.h"
+
+#include "files.h"
+#include "profiles.h"
+#include "results.h"
+
+
+/* Constants */
+
+/*+ The rank of the nodes that are not contracted (turn restrictions, barriers and loops). +*/
+#define CH_CORE ((index_t)~0)
+
+
+/* Data structures */
+
+/*+ A structure containing a single edge of the contraction hierarchy (a super-segment or a shortcut). +*/
+typedef struct _ChEdge
+{
+ index_t  node1;                /*+ The contraction hierarchy node at the start of the edge. +*/
+ index_t  node2;                /*+ The contraction hierarchy node at the end of the edge. +*/
+
+ index_t  seg1;                 /*+ The super-segment at the node1 end of the edge. +*/
+ index_t  seg2;                 /*+ The super-segment at the node2 end of the edge. +*/
+
+ index_t  child1;               /*+ The edge at the node1 end of a shortcut (or NO_SEGMENT for a super-segment). +*/
+ index_t  child2;               /*+ The edge at the node2 end of a shortcut (or NO_SEGMENT for a super-segment). +*/
+
+ score_t  score12;              /*+ The score from node1 to node2 (or INF_SCORE if not allowed). +*/
+ score_t  score21;              /*+ The score from node2 to node1 (or INF_SCORE if not allowed). +*/
+}
+ ChEdge;
+
+
+/*+ A structure containing a single node of the contraction hierarchy. +*/
+typedef struct _ChNode
+{
+ index_t  node;                 /*+ The index of the super-node in the database. +*/
+ index_t  rank;                 /*+ The order in which the node was contracted (or CH_CORE). +*/
+ index_t  firstedge;            /*+ The position of the first edge for this node in the list of edges. +*/
+}
+ ChNode;
+
+
+/*+ A structure containing the parts of the profile that the scores depend on. +*/
+typedef struct _ChProfile
+{
+ int          quickest;                  /*+ Set if the scores are for the quickest route. +*/
+
+ transports_t allow;                     /*+ The type of transport expressed as a bitmask. +*/
+
+ score_t      highway[Highway_Count];    /*+ The preference for travel on the highway. +*/
+ speed_t      speed[Highway_Count];      /*+ The maximum speed on each type of highway. +*/
+
+ score_t      props_yes[Property_Count]; /*+ The preference for ways with this attribute. +*/
+ score_t      props_no [Property_Count]; /*+ The preference for ways without this attribute. +*/
+
+ int          oneway;                    /*+ A flag to indicate if one-way restrictions apply. +*/
+ int          turns;                     /*+ A flag to indicate if turn restrictions apply. +*/
+
+ weight_t     weight;                    /*+ The minimum weight of the route. +*/
+
+ height_t     height;                    /*+ The minimum height of vehicles on the route. +*/
+ width_t      width;                     /*+ The minimum width of vehicles on the route. +*/
+ length_t     length;                    /*+ The minimum length of vehicles on the route. +*/
+}
+ ChProfile;
+
+
+/*+ A structure containing the header from the file. +*/
+typedef struct _ContractionFile
+{
+ index_t   number;              /*+ The number of nodes (super-nodes). +*/
+ index_t   enumber;             /*+ The number of edges (super-segments and shortcuts). +*/
+ index_t   snumber;             /*+ The number of edges that are super-segments (first, in segment order). +*/
+ index_t   lnumber;             /*+ The number of entries in the list of edges for the nodes. +*/
+
+ ChProfile profile;             /*+ The profile used to calculate the scores. +*/
+}
+ ContractionFile;
+
+
+/*+ A structure containing a contraction hierarchy. +*/
+typedef struct _Contraction
+{
+ ContractionFile file;          /*+ The header data from the file. +*/
+
+ void    *data;                 /*+ The memory mapped data in the file (or a copy of it in slim mode). +*/
+
+ ChNode  *nodes;                /*+ A pointer to the array of nodes (with one extra at the end). +*/
+ index_t *edgelist;             /*+ A pointer to the list of edges for each node. +*/
+ ChEdge  *edges;                /*+ A pointer to the array of edges. +*/
+}
+ Contraction;
+
+
+/* Functions in contract.c */
+
+Contraction *LoadContraction(const char *filename);
+
+void DestroyContraction(Contraction *contraction);
+
+int ContractionMatchesProfile(Contraction *contraction,Profile *profile,int quickest);
+
+Results *FindMiddleRouteContracted(Query *query,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,
+                                   Contraction *contraction,Results *begin,Results *end);
+
+
+/* Macros and inline functions */
+
+/*+ Return the other node of an edge that is not the specified node. +*/
+#define ChOtherNode(xxx,yyy)      ((xxx)->node1==(yyy)?(xxx)->node2:(xxx)->node1)
+
+/*+ Return the score for an edge when starting from the specified node. +*/
+#define ChScoreFrom(xxx,yyy)      ((xxx)->node1==(yyy)?(xxx)->score12:(xxx)->score21)
+
+/*+ Return the super-segment used to leave the specified node along an edge. +*/
+#define ChLeaveSegment(xxx,yyy)   ((xxx)->node1==(yyy)?(xxx)->seg1:(xxx)->seg2)
+
+/*+ Return the super-segment used to arrive at the specified node along an edge. +*/
+#define ChArriveSegment(xxx,yyy)  ((xxx)->node2==(yyy)?(xxx)->seg2:(xxx)->seg1)
+
+/*+ Return true if the search can follow an edge from a node of rank xxx to one of rank yyy. +*/
+#define ChUpwards(xxx,yyy)        ((yyy)>(xxx) || ((xxx)==CH_CORE && (yyy)==CH_CORE))
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Copy the parts of a profile that the contraction hierarchy scores depend on.
+
+  ChProfile *chprofile The profile information to fill in.
+
+  Profile *profile The profile (after UpdateProfile() has been called).
+
+  int quickest Set if the scores are for the quickest route.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static inline void SetChProfile(ChProfile *chprofile,Profile *profile,int quickest)
+{
+ memset(chprofile,0,sizeof(ChProfile));
+
+ chprofile->quickest=quickest;
+ chprofile->allow=profile->allow;
+
+ memcpy(chprofile->highway,profile->highway,sizeof(profile->highway));
+ memcpy(chprofile->speed,profile->speed,sizeof(profile->speed));
+ memcpy(chprofile->props_yes,profile->props_yes,sizeof(profile->props_yes));
+ memcpy(chprofile->props_no,profile->props_no,sizeof(profile->props_no));
+
+ chprofile->oneway=profile->oneway;
+ chprofile->turns=profile->turns;
+ chprofile->weight=profile->weight;
+ chprofile->height=profile->height;
+ chprofile->width=profile->width;
+ chprofile->length=profile->length;
+}
+
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Return the name of the file containing the contraction hierarchy for a profile.
+
+  char *ContractionFileName Returns a pointer to memory allocated to the filename.
+
+  const char *dirname The directory name.
+
+  const char *prefix The file name prefix.
+
+  const char *profilename The name of the profile.
+
+  int quickest Set for the file for the quickest route.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static inline char *ContractionFileName(const char *dirname,const char *prefix,const char *profilename,int quickest)
+{
+ char *name=(char*)malloc(strlen(profilename)+sizeof("ch--shortest.mem"));
+ char *filename;
+
+ sprintf(name,"ch-%s-%s.mem",profilename,quickest?"quickest":"shortest");
+
+ filename=FileName(dirname,prefix,name);
+
+ free(name);
+
+ return(filename);
+}
+
+
+#endif /* CONTRACT_H */
@@ -0,0 +1,1098 @@
+/***************************************
+ Contraction hierarchy creation for the super-nodes.
+
+ Part of the Routino routing software.
+ ******************/ /******************
+ This file Copyright 2008-2013 Andrew M. Bishop
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************/
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "types.h"
+#include "nodes.h"
+#include "segments.h"
+#include "ways.h"
+#include "relations.h"
+
+#include "contract.h"
+#include "contractx.h"
+
+#include "files.h"
+#include "logging.h"
+#include "results.h"
+
+
+/* Constants */
+
+/*+ The node can still be contracted. +*/
+#define CH_ACTIVE     0
+
+/*+ The node has been contracted. +*/
+#define CH_CONTRACTED 1
+
+/*+ The node is part of the core and is never contracted. +*/
+#define CH_FIXED      2
+
+/*+ The maximum number of node/segment pairs that a witness search will settle. +*/
+#define CH_WITNESS_LIMIT 500
+
+/*+ The maximum number of shortcuts that contracting a node may add (otherwise the node is left in the core). +*/
+#define CH_MAX_SHORTCUTS 32
+
+/*+ The increment for the number of edges allocated for a node. +*/
+#define CH_EDGE_INCREMENT 8
+
+
+/* Local data types */
+
+/*+ A node of the contraction hierarchy while it is being created. +*/
+typedef struct _ChNodeX
+{
+ index_t       node;            /*+ The index of the super-node in the database. +*/
+ index_t       rank;            /*+ The order in which the node was contracted (or CH_CORE). +*/
+
+ transports_t  allow;           /*+ The types of transport that are allowed through the node. +*/
+ uint8_t       restricted;      /*+ Set if turn restrictions apply at the node. +*/
+ uint8_t       state;           /*+ Whether the node is active, contracted or fixed. +*/
+
+ index_t       ncontracted;     /*+ The number of neighbouring nodes that have been contracted. +*/
+
+ index_t       nsegments;       /*+ The number of edges that are super-segments (these are first). +*/
+ index_t       nedges;          /*+ The number of edges. +*/
+ index_t       nalloc;          /*+ The number of allocated edges. +*/
+ index_t      *edges;           /*+ The edges that start or finish at this node. +*/
+}
+ ChNodeX;
+
+/*+ The data used while creating the contraction hierarchy. +*/
+typedef struct _ContractX
+{
+ Nodes        *nodes;           /*+ The set of nodes. +*/
+ Segments     *segments;        /*+ The set of segments. +*/
+ Ways         *ways;            /*+ The set of ways. +*/
+ Relations    *relations;       /*+ The set of relations. +*/
+
+ Profile      *profile;         /*+ The profile to use. +*/
+
+ index_t       number;          /*+ The number of nodes. +*/
+ ChNodeX      *chnodes;         /*+ The nodes. +*/
+
+ index_t       enumber;         /*+ The number of edges. +*/
+ index_t       snumber;         /*+ The number of edges that are super-segments. +*/
+ index_t       ealloc;          /*+ The number of allocated edges. +*/
+ ChEdge       *edges;           /*+ The edges. +*/
+
+ index_t       nheap;           /*+ The number of nodes in the heap. +*/
+ index_t      *heap;            /*+ The heap of nodes to contract. +*/
+ int          *priority;        /*+ The priority of each node in the heap. +*/
+}
+ ContractX;
+
+
+/* Local functions */
+
+static void CreateContraction(ContractX *cx,int quickest);
+static int  ContractNode(ContractX *cx,index_t v,int add);
+static Results *WitnessSearch(ContractX *cx,index_t u,index_t a,index_t v,score_t limit);
+static int  IsCompatible(ContractX *cx,index_t x,index_t seg1,index_t seg2);
+static int  IsWitnessed(ContractX *cx,Results *witness,index_t w,index_t segment,score_t score);
+static void AddShortcut(ContractX *cx,index_t u,index_t w,index_t e1,index_t e2,score_t score);
+static index_t AppendEdge(ContractX *cx,ChEdge *edge);
+static void AddNodeEdge(ContractX *cx,index_t x,index_t e);
+static void SaveContraction(ContractX *cx,const char *filename,int quickest);
+
+static int  NodePriority(ContractX *cx,index_t v);
+
+static void HeapPush(ContractX *cx,index_t v,int priority);
+static index_t HeapPop(ContractX *cx);
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Create the contraction hierarchies of the super-nodes for a profile (one for the shortest route and one for
+  the quickest route) using the database files that have already been written.
+
+  const char *dirname The directory name of the database.
+
+  const char *prefix The file name prefix of the database.
+
+  Profile *profile The profile to use.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+void ContractSuperNodes(const char *dirname,const char *prefix,Profile *profile)
+{
+ ContractX cx;
+ int quickest;
+
+ /* Load in the database */
+
+ cx.nodes    =LoadNodeList    (FileName(dirname,prefix,"nodes.mem"));
+ cx.segments =LoadSegmentList (FileName(dirname,prefix,"segments.mem"));
+ cx.ways     =LoadWayList     (FileName(dirname,prefix,"ways.mem"));
+ cx.relations=LoadRelationList(FileName(dirname,prefix,"relations.mem"));
+
+ cx.profile=profile;
+
+ if(UpdateProfile(profile,cx.ways))
+   {
+    fprintf(stderr,"Error: Profile '%s' is invalid or not compatible with database.\n",profile->name);
+    exit(EXIT_FAILURE);
+   }
+
+ for(quickest=0;quickest<=1;quickest++)
+   {
+    char *filename=ContractionFileName(dirname,prefix,profile->name,quickest);
+
+    CreateContraction(&cx,quickest);
+
+    SaveContraction(&cx,filename,quickest);
+
+    free(filename);
+   }
+
+ DestroyNodeList(cx.nodes);
+ DestroySegmentList(cx.segments);
+ DestroyWayList(cx.ways);
+ DestroyRelationList(cx.relations);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Create the contraction hierarchy for one of the route types.
+
+  ContractX *cx The contraction hierarchy data.
+
+  int quickest Set if the scores are for the quickest route.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void CreateContraction(ContractX *cx,int quickest)
+{
+ index_t i,rank=0,nfixed=0,nshortcuts;
+
+ /* Print the start message */
+
+ printf_first("Contracting Super-Nodes (%s %s): Nodes=0 Shortcuts=0",cx->profile->name,quickest?"quickest":"shortest");
+
+ /* Find the super-nodes */
+
+ cx->number=0;
+
+ for(i=0;i<cx->nodes->file.number;i++)
+    if(IsSuperNode(LookupNode(cx->nodes,i,1)))
+       cx->number++;
+
+ cx->chnodes=(ChNodeX*)calloc(cx->number,sizeof(ChNodeX));
+
+ logassert(cx->chnodes,"Failed to allocate memory (try using slim mode?)"); /* Check calloc() worked */
+
+ cx->number=0;
+
+ for(i=0;i<cx->nodes->file.number;i++)
+   {
+    Node *nodep=LookupNode(cx->nodes,i,1);
+
+    if(IsSuperNode(nodep))
+      {
+       ChNodeX *chnodex=&cx->chnodes[cx->number++];
+
+       chnodex->node=i;
+       chnodex->rank=CH_CORE;
+       chnodex->allow=nodep->allow;
+       chnodex->restricted=(cx->profile->turns && IsTurnRestrictedNode(nodep));
+
+       if(chnodex->restricted || !(nodep->allow&cx->profile->allow))
+          chnodex->state=CH_FIXED;
+       else
+          chnodex->state=CH_ACTIVE;
+      }
+   }
+
+ /* Create the edges for the super-segments (in segment order) */
+
+ cx->enumber=0;
+ cx->ealloc=1024;
+ cx->edges=(ChEdge*)malloc(cx->ealloc*sizeof(ChEdge));
+
+ for(i=0;i<cx->segments->file.number;i++)
+   {
+    Segment *segmentp=LookupSegment(cx->segments,i,1);
+    ChEdge edge;
+    index_t segmentnodes[2],n;
+
+    if(!IsSuperSegment(segmentp))
+       continue;
+
+    segmentnodes[0]=segmentp->node1;
+    segmentnodes[1]=segmentp->node2;
+
+    /* Find the nodes in the contraction hierarchy (a binary search) */
+
+    for(n=0;n<2;n++)
+      {
+       index_t start=0,end=cx->number-1,mid;
+
+       while(start<end)
+         {
+          mid=start+(end-start)/2;
+
+          if(cx->chnodes[mid].node<segmentnodes[n])
+             start=mid+1;
+          else
+             end=mid;
+         }
+
+       logassert(cx->chnodes[start].node==segmentnodes[n],"Super-segment does not join two super-nodes"); /* Super-segments only join super-nodes */
+
+       if(n==0)
+          edge.node1=start;
+       else
+          edge.node2=start;
+      }
+
+    edge.seg1=i;
+    edge.seg2=i;
+
+    edge.child1=NO_SEGMENT;
+    edge.child2=NO_SEGMENT;
+
+    edge.score12=SuperSegmentScore(cx->ways,cx->profile,segmentp,segmentp->node1,quickest);
+    edge.score21=SuperSegmentScore(cx->ways,cx->profile,segmentp,segmentp->node2,quickest);
+
+    AppendEdge(cx,&edge);
+
+    /* Nodes with loops are part of the core */
+
+    if(edge.node1==edge.node2)
+       cx->chnodes[edge.node1].state=CH_FIXED;
+   }
+
+ cx->snumber=cx->enumber;
+
+ for(i=0;i<cx->number;i++)
+    cx->chnodes[i].nsegments=cx->chnodes[i].nedges;
+
+ /* Order the nodes by the number of shortcuts that contracting them would add */
+
+ cx->nheap=0;
+ cx->heap=(index_t*)malloc(cx->number*sizeof(index_t));
+ cx->priority=(int*)malloc(cx->number*sizeof(int));
+
+ for(i=0;i<cx->number;i++)
+    if(cx->chnodes[i].state==CH_ACTIVE)
+       HeapPush(cx,i,NodePriority(cx,i));
+    else
+       nfixed++;
+
+ /* Contract the nodes in order */
+
+ while(cx->nheap>0)
+   {
+    index_t v=HeapPop(cx);
+    int priority;
+    index_t j;
+
+    /* Nodes that have gained a loop since they were queued are part of the core */
+
+    if(cx->chnodes[v].state!=CH_ACTIVE)
+      {
+       nfixed++;
+       continue;
+      }
+
+    priority=NodePriority(cx,v);
+
+    /* Lazy update of the priority */
+
+    if(cx->nheap>0 && priority>cx->priority[0])
+      {
+       HeapPush(cx,v,priority);
+       continue;
+      }
+
+    if(ContractNode(cx,v,0)>CH_MAX_SHORTCUTS)
+      {
+       cx->chnodes[v].state=CH_FIXED;
+       nfixed++;
+       continue;
+      }
+
+    ContractNode(cx,v,1);
+
+    cx->chnodes[v].state=CH_CONTRACTED;
+    cx->chnodes[v].rank=rank++;
+
+    for(j=0;j<cx->chnodes[v].nedges;j++)
+      {
+       ChEdge *edge=&cx->edges[cx->chnodes[v].edges[j]];
+
+       cx->chnodes[ChOtherNode(edge,v)].ncontracted++;
+      }
+
+    if(!(rank%1000))
+       printf_middle("Contracting Super-Nodes (%s %s): Nodes=%"Pindex_t" Shortcuts=%"Pindex_t,
+                     cx->profile->name,quickest?"quickest":"shortest",rank,cx->enumber-cx->snumber);
+   }
+
+ free(cx->heap);
+ free(cx->priority);
+
+ nshortcuts=cx->enumber-cx->snumber;
+
+ /* Print the final message */
+
+ printf_last("Contracted Super-Nodes (%s %s): Nodes=%"Pindex_t" Core=%"Pindex_t" Shortcuts=%"Pindex_t,
+             cx->profile->name,quickest?"quickest":"shortest",rank,nfixed,nshortcuts);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Contract a node by adding the shortcuts that are needed between its active neighbours.
+
+  int ContractNode Returns the number of shortcuts that are (or would be) added.
+
+  ContractX *cx The contraction hierarchy data.
+
+  index_t v The node to contract.
+
+  int add Set to add the shortcuts, otherwise they are only counted.
+
+  A shortcut from node u to node w via node v is not needed if for every segment that can be used to arrive at
+  node u (before the shortcut) there is another route that arrives at node w no later and allows the route to
+  continue from node w in every direction that the route via node v allows.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int ContractNode(ContractX *cx,index_t v,int add)
+{
+ ChNodeX *chnodev=&cx->chnodes[v];
+ index_t *inedges,*outedges;
+ index_t nin=0,nout=0,i,j,k;
+ int count=0;
+ uint8_t *needed;
+
+ inedges =(index_t*)malloc(chnodev->nedges*sizeof(index_t));
+ outedges=(index_t*)malloc(chnodev->nedges*sizeof(index_t));
+
+ /* Find the edges into and out of the node from active nodes */
+
+ for(i=0;i<chnodev->nedges;i++)
+   {
+    index_t e=chnodev->edges[i];
+    ChEdge *edge=&cx->edges[e];
+    index_t x=ChOtherNode(edge,v);
+
+    if(x==v || cx->chnodes[x].state==CH_CONTRACTED)
+       continue;
+
+    if(ChScoreFrom(edge,x)!=INF_SCORE)
+       inedges[nin++]=e;
+
+    if(ChScoreFrom(edge,v)!=INF_SCORE)
+       outedges[nout++]=e;
+   }
+
+ needed=(uint8_t*)malloc(nin*nout+1);
+
+ memset(needed,0,nin*nout+1);
+
+ /* Search from each of the neighbouring nodes in turn */
+
+ for(i=0;i<nin;i++)
+   {
+    ChEdge *edge1=&cx->edges[inedges[i]];
+    index_t u=ChOtherNode(edge1,v);
+    ChNodeX *chnodeu=&cx->chnodes[u];
+    index_t s;
+
+    /* Only search once from each node */
+
+    for(j=0;j<i;j++)
+       if(ChOtherNode(&cx->edges[inedges[j]],v)==u)
+          break;
+
+    if(j<i)
+       continue;
+
+    /* Nodes that cannot be passed through are only used at the start or finish, keep all routes */
+
+    if(!(chnodeu->allow&cx->profile->allow))
+      {
+       for(j=i;j<nin;j++)
+          if(ChOtherNode(&cx->edges[inedges[j]],v)==u)
+             for(k=0;k<nout;k++)
+                if(ChArriveSegment(&cx->edges[inedges[j]],v)!=ChLeaveSegment(&cx->edges[outedges[k]],v))
+                   needed[j*nout+k]=1;
+
+       continue;
+      }
+
+    /* Search from node u for each of the segments that can be used to arrive at it (and for a route starting there) */
+
+    for(s=0;s<=chnodeu->nsegments;s++)
+      {
+       index_t a=(s<chnodeu->nsegments)?cx->edges[chnodeu->edges[s]].seg1:NO_SEGMENT;
+       score_t limit=0;
+       int valid=0;
+       Results *witness;
+
+       for(j=i;j<nin;j++)
+         {
+          ChEdge *edgej=&cx->edges[inedges[j]];
+
+          if(ChOtherNode(edgej,v)!=u)
+             continue;
+
+          if(!IsCompatible(cx,u,a,ChLeaveSegment(edgej,u)))
+             continue;
+
+          for(k=0;k<nout;k++)
+            {
+             ChEdge *edgek=&cx->edges[outedges[k]];
+             score_t score;
+
+             if(ChArriveSegment(edgej,v)==ChLeaveSegment(edgek,v))
+                continue;
+
+             score=ChScoreFrom(edgej,u)+ChScoreFrom(edgek,v);
+
+             if(score>limit)
+                limit=score;
+
+             valid=1;
+            }
+         }
+
+       if(!valid)
+          continue;
+
+       witness=WitnessSearch(cx,u,a,v,limit);
+
+       for(j=i;j<nin;j++)
+         {
+          ChEdge *edgej=&cx->edges[inedges[j]];
+
+          if(ChOtherNode(edgej,v)!=u)
+             continue;
+
+          if(!IsCompatible(cx,u,a,ChLeaveSegment(edgej,u)))
+             continue;
+
+          for(k=0;k<nout;k++)
+            {
+             ChEdge *edgek=&cx->edges[outedges[k]];
+             index_t w=ChOtherNode(edgek,v);
+             score_t score;
+
+             if(needed[j*nout+k])
+                continue;
+
+             if(ChArriveSegment(edgej,v)==ChLeaveSegment(edgek,v))
+                continue;
+
+             score=ChScoreFrom(edgej,u)+ChScoreFrom(edgek,v);
+
+             if(!IsWitnessed(cx,witness,w,ChArriveSegment(edgek,w),score))
+                needed[j*nout+k]=1;
+            }
+         }
+
+       FreeResultsList(witness);
+      }
+   }
+
+ /* Add the shortcuts */
+
+ for(j=0;j<nin;j++)
+    for(k=0;k<nout;k++)
+       if(needed[j*nout+k])
+         {
+          count++;
+
+          if(add)
+            {
+             ChEdge *edgej=&cx->edges[inedges[j]];
+             ChEdge *edgek=&cx->edges[outedges[k]];
+             index_t u=ChOtherNode(edgej,v);
+             index_t w=ChOtherNode(edgek,v);
+
+             AddShortcut(cx,u,w,inedges[j],outedges[k],ChScoreFrom(edgej,u)+ChScoreFrom(edgek,v));
+            }
+         }
+
+ free(needed);
+ free(inedges);
+ free(outedges);
+
+ return(count);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Search for the routes from a node (arriving by a segment) without passing through a node that is
+  being contracted or has already been contracted.
+
+  Results *WitnessSearch Returns the results of the search.
+
+  ContractX *cx The contraction hierarchy data.
+
+  index_t u The node to start from.
+
+  index_t a The super-segment used to arrive at the start node.
+
+  index_t v The node that is being contracted.
+
+  score_t limit The maximum score to search to.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static Results *WitnessSearch(ContractX *cx,index_t u,index_t a,index_t v,score_t limit)
+{
+ Results *results;
+ Queue *queue;
+ Result *result1,*result2;
+ int settled=0;
+
+ results=NewResultsList(8);
+ queue=NewQueueList(8);
+
+ result1=InsertResult(results,u,a);
+
+ InsertInQueue(queue,result1,0);
+
+ while((result1=PopFromQueue(queue)))
+   {
+    index_t x=result1->node,i;
+    ChNodeX *chnodex=&cx->chnodes[x];
+
+    if(result1->score>limit || ++settled>CH_WITNESS_LIMIT)
+       break;
+
+    /* mode of transport must be allowed through the node */
+    if(x!=u && !(chnodex->allow&cx->profile->allow))
+       continue;
+
+    for(i=0;i<chnodex->nedges;i++)
+      {
+       ChEdge *edge=&cx->edges[chnodex->edges[i]];
+       index_t y=ChOtherNode(edge,x),seg2;
+       score_t score;
+
+       if(y==v || cx->chnodes[y].state==CH_CONTRACTED)
+          continue;
+
+       if(ChScoreFrom(edge,x)==INF_SCORE)
+          continue;
+
+       if(!IsCompatible(cx,x,result1->segment,ChLeaveSegment(edge,x)))
+          continue;
+
+       score=result1->score+ChScoreFrom(edge,x);
+
+       if(score>limit)
+          continue;
+
+       seg2=ChArriveSegment(edge,y);
+
+       result2=FindResult(results,y,seg2);
+
+       if(!result2)
+         {
+          result2=InsertResult(results,y,seg2);
+          result2->score=score;
+         }
+       else if(score<result2->score)
+          result2->score=score;
+       else
+          continue;
+
+       InsertInQueue(queue,result2,score);
+      }
+   }
+
+ FreeQueueList(queue);
+
+ return(results);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Check if a route can continue from one super-segment to another at a node.
+
+  int IsCompatible Returns true if the route can continue.
+
+  ContractX *cx The contraction hierarchy data.
+
+  index_t x The node.
+
+  index_t seg1 The super-segment used to arrive at the node (or NO_SEGMENT).
+
+  index_t seg2 The super-segment used to leave the node.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int IsCompatible(ContractX *cx,index_t x,index_t seg1,index_t seg2)
+{
+ if(seg1==NO_SEGMENT)
+    return(1);
+
+ /* must not perform U-turn */
+ if(seg1==seg2)
+    return(0);
+
+ /* must obey turn relations */
+ if(cx->chnodes[x].restricted)
+   {
+    index_t turnrelation=FindFirstTurnRelation2(cx->relations,cx->chnodes[x].node,seg1);
+
+    if(turnrelation!=NO_RELATION && !IsTurnAllowed(cx->relations,turnrelation,cx->chnodes[x].node,seg1,seg2,cx->profile->allow))
+       return(0);
+   }
+
+ return(1);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Check if a witness search has found a route to a node that is as good as one arriving by a particular segment.
+
+  int IsWitnessed Returns true if there is a route that is as good.
+
+  ContractX *cx The contraction hierarchy data.
+
+  Results *witness The results of the witness search.
+
+  index_t w The node that is reached.
+
+  index_t segment The super-segment used to arrive at the node.
+
+  score_t score The score of the route to be replaced.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int IsWitnessed(ContractX *cx,Results *witness,index_t w,index_t segment,score_t score)
+{
+ ChNodeX *chnodew=&cx->chnodes[w];
+ index_t g,t;
+
+ /* Every direction that the route can continue in must be reachable by a witness */
+
+ for(g=0;g<chnodew->nsegments;g++)
+   {
+    index_t seg2=cx->edges[chnodew->edges[g]].seg1;
+    int found=0;
+
+    if(!IsCompatible(cx,w,segment,seg2))
+       continue;
+
+    for(t=0;t<chnodew->nsegments;t++)
+      {
+       index_t seg1=cx->edges[chnodew->edges[t]].seg1;
+       Result *result=FindResult(witness,w,seg1);
+
+       if(result && result->score<=score && IsCompatible(cx,w,seg1,seg2))
+         {
+          found=1;
+          break;
+         }
+      }
+
+    if(!found)
+       return(0);
+   }
+
+ return(1);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Add a shortcut between two nodes (unless there is already one that is as good).
+
+  ContractX *cx The contraction hierarchy data.
+
+  index_t u The node at the start of the shortcut.
+
+  index_t w The node at the end of the shortcut.
+
+  index_t e1 The edge from node u to the node being contracted.
+
+  index_t e2 The edge from the node being contracted to node w.
+
+  score_t score The score of the shortcut.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void AddShortcut(ContractX *cx,index_t u,index_t w,index_t e1,index_t e2,score_t score)
+{
+ ChNodeX *chnodeu=&cx->chnodes[u];
+ index_t seg1=ChLeaveSegment(&cx->edges[e1],u);
+ index_t seg2=ChArriveSegment(&cx->edges[e2],w);
+ ChEdge edge;
+ index_t i;
+
+ for(i=0;i<chnodeu->nedges;i++)
+   {
+    ChEdge *edgep=&cx->edges[chnodeu->edges[i]];
+
+    if(ChOtherNode(edgep,u)!=w || ChLeaveSegment(edgep,u)!=seg1 || ChArriveSegment(edgep,w)!=seg2)
+       continue;
+
+    if(ChScoreFrom(edgep,u)<=score)
+       return;
+
+    if(edgep->child1!=NO_SEGMENT && edgep->node1==u)
+      {
+       edgep->child1=e1;
+       edgep->child2=e2;
+       edgep->score12=score;
+       return;
+      }
+   }
+
+ edge.node1=u;
+ edge.node2=w;
+
+ edge.seg1=seg1;
+ edge.seg2=seg2;
+
+ edge.child1=e1;
+ edge.child2=e2;
+
+ edge.score12=score;
+ edge.score21=INF_SCORE;
+
+ AppendEdge(cx,&edge);
+
+ /* Nodes with loops are part of the core */
+
+ if(u==w && chnodeu->state==CH_ACTIVE)
+    chnodeu->state=CH_FIXED;
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Append an edge to the list of edges and to the nodes at each end.
+
+  index_t AppendEdge Returns the index of the edge.
+
+  ContractX *cx The contraction hierarchy data.
+
+  ChEdge *edge The edge to append.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static index_t AppendEdge(ContractX *cx,ChEdge *edge)
+{
+ index_t e=cx->enumber;
+
+ if(cx->enumber==cx->ealloc)
+   {
+    cx->ealloc*=2;
+    cx->edges=(ChEdge*)realloc((void*)cx->edges,cx->ealloc*sizeof(ChEdge));
+
+    logassert(cx->edges,"Failed to reallocate memory (try using slim mode?)"); /* Check realloc() worked */
+   }
+
+ cx->edges[cx->enumber++]=*edge;
+
+ AddNodeEdge(cx,edge->node1,e);
+
+ if(edge->node2!=edge->node1)
+    AddNodeEdge(cx,edge->node2,e);
+
+ return(e);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Add an edge to the list of edges for a node.
+
+  ContractX *cx The contraction hierarchy data.
+
+  index_t x The node.
+
+  index_t e The edge.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void AddNodeEdge(ContractX *cx,index_t x,index_t e)
+{
+ ChNodeX *chnodex=&cx->chnodes[x];
+
+ if(chnodex->nedges==chnodex->nalloc)
+   {
+    chnodex->nalloc+=CH_EDGE_INCREMENT;
+    chnodex->edges=(index_t*)realloc((void*)chnodex->edges,chnodex->nalloc*sizeof(index_t));
+
+    logassert(chnodex->edges,"Failed to reallocate memory (try using slim mode?)"); /* Check realloc() worked */
+   }
+
+ chnodex->edges[chnodex->nedges++]=e;
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Save the contraction hierarchy to a file and free the memory.
+
+  ContractX *cx The contraction hierarchy data.
+
+  const char *filename The name of the file to save.
+
+  int quickest Set if the scores are for the quickest route.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void SaveContraction(ContractX *cx,const char *filename,int quickest)
+{
+ ContractionFile contractionfile;
+ index_t i,firstedge=0;
+ int fd;
+
+ /* Print the start message */
+
+ printf_first("Writing Contraction: Nodes=0");
+
+ /* Write out the header structure */
+
+ contractionfile.number =cx->number;
+ contractionfile.enumber=cx->enumber;
+ contractionfile.snumber=cx->snumber;
+ contractionfile.lnumber=0;
+
+ for(i=0;i<cx->number;i++)
+    contractionfile.lnumber+=cx->chnodes[i].nedges;
+
+ SetChProfile(&contractionfile.profile,cx->profile,quickest);
+
+ fd=OpenFileBufferedNew(filename);
+
+ WriteFileBuffered(fd,&contractionfile,sizeof(ContractionFile));
+
+ /* Write out the nodes (with one extra at the end) */
+
+ for(i=0;i<=cx->number;i++)
+   {
+    ChNode chnode;
+
+    if(i<cx->number)
+      {
+       chnode.node=cx->chnodes[i].node;
+       chnode.rank=cx->chnodes[i].rank;
+      }
+    else
+      {
+       chnode.node=NO_NODE;
+       chnode.rank=CH_CORE;
+      }
+
+    chnode.firstedge=firstedge;
+
+    WriteFileBuffered(fd,&chnode,sizeof(ChNode));
+
+    if(i<cx->number)
+       firstedge+=cx->chnodes[i].nedges;
+
+    if(!((i+1)%10000))
+       printf_middle("Writing Contraction: Nodes=%"Pindex_t,i+1);
+   }
+
+ /* Write out the list of edges for each node */
+
+ for(i=0;i<cx->number;i++)
+   {
+    WriteFileBuffered(fd,cx->chnodes[i].edges,cx->chnodes[i].nedges*sizeof(index_t));
+
+    free(cx->chnodes[i].edges);
+   }
+
+ /* Write out the edges */
+
+ WriteFileBuffered(fd,cx->edges,cx->enumber*sizeof(ChEdge));
+
+ CloseFileBuffered(fd);
+
+ /* Free the memory */
+
+ free(cx->chnodes);
+ free(cx->edges);
+
+ /* Print the final message */
+
+ printf_last("Wrote Contraction: Nodes=%"Pindex_t" Edges=%"Pindex_t,cx->number,cx->enumber);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Calculate the score for travelling along a super-segment from one of the nodes (the same as the router).
+
+  score_t SuperSegmentScore Returns the score (or INF_SCORE if the segment cannot be used in this direction).
+
+  Ways *ways The set of ways to use.
+
+  Profile *profile The profile (after UpdateProfile() has been called).
+
+  Segment *segmentp The super-segment.
+
+  index_t node The node to start from.
+
+  int quickest Set if the score is for the quickest route.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+score_t SuperSegmentScore(Ways *ways,Profile *profile,Segment *segmentp,index_t node,int quickest)
+{
+ Way *wayp;
+ score_t segment_pref;
+ speed_t speedresult=0;
+ int i;
+
+ wayp=LookupWay(ways,segmentp->way,1);
+
+ /* must obey one-way restrictions (unless profile allows) */
+ if(profile->oneway && IsOnewayTo(segmentp,node))
+   {
+    if(profile->allow!=Transports_Bicycle)
+       return(INF_SCORE);
+    if(!(wayp->props & Properties_DoubleSens))
+       return(INF_SCORE);
+   }
+
+ /* mode of transport must be allowed on the highway */
+ if(!(wayp->allow&profile->allow))
+    return(INF_SCORE);
+
+ /* must obey weight restriction (if exists) */
+ if(wayp->weight && wayp->weight<profile->weight)
+    return(INF_SCORE);
+
+ /* must obey height/width/length restriction (if exist) */
+ if((wayp->height && wayp->height<profile->height) ||
+    (wayp->width  && wayp->width <profile->width ) ||
+    (wayp->length && wayp->length<profile->length))
+    return(INF_SCORE);
+
+ segment_pref=profile->highway[HIGHWAY(wayp->type)];
+
+ /* highway preferences must allow this highway */
+ if(segment_pref==0)
+    return(INF_SCORE);
+
+ for(i=1;i<Property_Count;i++)
+    if(ways->file.props & PROPERTIES(i))
+      {
+       if(wayp->props & PROPERTIES(i))
+          segment_pref*=profile->props_yes[i];
+       else
+          segment_pref*=profile->props_no[i];
+      }
+
+ /* profile preferences must allow this highway */
+ if(segment_pref==0)
+    return(INF_SCORE);
+
+ if(quickest==0)
+    return((score_t)DISTANCE(segmentp->distance)/segment_pref);
+ else
+    return((score_t)Duration(node,segmentp,wayp,profile,&speedresult)/segment_pref);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Calculate the priority for contracting a node (lower numbers are contracted first).
+
+  int NodePriority Returns the priority.
+
+  ContractX *cx The contraction hierarchy data.
+
+  index_t v The node.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int NodePriority(ContractX *cx,index_t v)
+{
+ ChNodeX *chnodev=&cx->chnodes[v];
+ int added,removed=0;
+ index_t i;
+
+ added=ContractNode(cx,v,0);
+
+ for(i=0;i<chnodev->nedges;i++)
+    if(cx->chnodes[ChOtherNode(&cx->edges[chnodev->edges[i]],v)].state!=CH_CONTRACTED)
+       removed++;
+
+ return(2*added-removed+(int)chnodev->ncontracted);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Add a node to the heap of nodes to contract.
+
+  ContractX *cx The contraction hierarchy data.
+
+  index_t v The node.
+
+  int priority The priority of the node.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void HeapPush(ContractX *cx,index_t v,int priority)
+{
+ index_t index=cx->nheap++;
+
+ while(index>0)
+   {
+    index_t parent=(index-1)/2;
+
+    if(cx->priority[parent]<=priority)
+       break;
+
+    cx->heap[index]=cx->heap[parent];
+    cx->priority[index]=cx->priority[parent];
+
+    index=parent;
+   }
+
+ cx->heap[index]=v;
+ cx->priority[index]=priority;
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Remove the node with the lowest priority from the heap of nodes to contract.
+
+  index_t HeapPop Returns the node.
+
+  ContractX *cx The contraction hierarchy data.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static index_t HeapPop(ContractX *cx)
+{
+ index_t v=cx->heap[0],last,index=0;
+ int priority;
+
+ last=cx->heap[--cx->nheap];
+ priority=cx->priority[cx->nheap];
+
+ while(2*index+1<cx->nheap)
+   {
+    index_t child=2*index+1;
+
+    if(child+1<cx->nheap && cx->priority[child+1]<cx->priority[child])
+       child++;
+
+    if(priority<=cx->priority[child])
+       break;
+
+    cx->heap[index]=cx->heap[child];
+    cx->priority[index]=cx->priority[child];
+
+    index=child;
+   }
+
+ cx->heap[index]=last;
+ cx->priority[index]=priority;
+
+ return(v);
+}
@@ -0,0 +1,40 @@
+/***************************************
+ A header file for creating the contraction hierarchy of the super-nodes.
+
+ Part of the Routino routing software.
+ ******************/ /******************
+ This file Copyright 2008-2013 Andrew M. Bishop
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************/
+
+
+#ifndef CONTRACTX_H
+#define CONTRACTX_H    /*+ To stop multiple inclusions. +*/
+
+#include "types.h"
+
+#include "segments.h"
+#include "ways.h"
+#include "profiles.h"
+
+
+/* Functions in contractx.c */
+
+void ContractSuperNodes(const char *dirname,const char *prefix,Profile *profile);
+
+score_t SuperSegmentScore(Ways *ways,Profile *profile,Segment *segmentp,index_t node,int quickest);
+
+
+#endif /* CONTRACTX_H */
@@ -0,0 +1,190 @@
+/***************************************
+ Precalculated segment score functions.
+
+ Part of the Routino routing software.
+ ******************/ /******************
+ This file Copyright 2008-2013 Andrew M. Bishop
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************/
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "types.h"
+#include "segments.h"
+#include "ways.h"
+
+#include "costs.h"
+
+#include "logging.h"
+
+
+/* Global variables */
+
+/*+ The option not to print any progress information. +*/
+extern int option_quiet;
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Calculate the score of every segment in both directions for a profile.
+
+  SegmentCosts *CreateSegmentCosts Returns the segment scores.
+
+  Segments *segments The set of segments to use.
+
+  Ways *ways The set of ways to use.
+
+  Profile *profile The profile (after UpdateProfile() has been called).
+
+  int quickest Set for the quickest route.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+SegmentCosts *CreateSegmentCosts(Segments *segments,Ways *ways,Profile *profile,int quickest)
+{
+ SegmentCosts *costs;
+ index_t i;
+
+ if(!option_quiet)
+    printf_first("Calculating Segment Scores: Segments=0");
+
+ costs=(SegmentCosts*)malloc(sizeof(SegmentCosts));
+
+ SetChProfile(&costs->profile,profile,quickest);
+
+ costs->number=segments->file.number;
+
+ costs->scores=(score_t*)malloc(2*(size_t)costs->number*sizeof(score_t));
+
+ logassert(costs->scores,"Failed to allocate memory (try using slim mode?)"); /* Check malloc() worked */
+
+ for(i=0;i<costs->number;i++)
+   {
+    Segment *segmentp=LookupSegment(segments,i,1);
+
+    costs->scores[2*i  ]=SegmentScore(ways,profile,segmentp,segmentp->node1,quickest);
+    costs->scores[2*i+1]=SegmentScore(ways,profile,segmentp,segmentp->node2,quickest);
+
+    if(!option_quiet && !((i+1)%10000))
+       printf_middle("Calculating Segment Scores: Segments=%"Pindex_t,i+1);
+   }
+
+ if(!option_quiet)
+    printf_last("Calculated Segment Scores: Segments=%"Pindex_t,costs->number);
+
+ return(costs);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Destroy the segment scores.
+
+  SegmentCosts *costs The segment scores to destroy.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+void DestroySegmentCosts(SegmentCosts *costs)
+{
+ free(costs->scores);
+
+ free(costs);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Check if the segment scores were calculated with the same profile and type of route.
+
+  int SegmentCostsMatchProfile Returns true if the segment scores can be used.
+
+  SegmentCosts *costs The segment scores.
+
+  Profile *profile The profile (after UpdateProfile() has been called).
+
+  int quickest Set for the quickest route.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+int SegmentCostsMatchProfile(SegmentCosts *costs,Profile *profile,int quickest)
+{
+ ChProfile chprofile;
+
+ SetChProfile(&chprofile,profile,quickest);
+
+ return(!memcmp(&chprofile,&costs->profile,sizeof(ChProfile)));
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Calculate the score for travelling along a segment from one of the nodes (the same as the router
+  apart from the one-way, turn and node checks).
+
+  score_t SegmentScore Returns the score (or INF_SCORE if the way cannot be used).
+
+  Ways *ways The set of ways to use.
+
+  Profile *profile The profile (after UpdateProfile() has been called).
+
+  Segment *segmentp The segment.
+
+  index_t node The node to start from.
+
+  int quickest Set if the score is for the quickest route.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+score_t SegmentScore(Ways *ways,Profile *profile,Segment *segmentp,index_t node,int quickest)
+{
+ Way *wayp;
+ score_t segment_pref;
+ speed_t speedresult=0;
+ int i;
+
+ wayp=LookupWay(ways,segmentp->way,1);
+
+ /* mode of transport must be allowed on the highway */
+ if(!(wayp->allow&profile->allow))
+    return(INF_SCORE);
+
+ /* must obey weight restriction (if exists) */
+ if(wayp->weight && wayp->weight<profile->weight)
+    return(INF_SCORE);
+
+ /* must obey height/width/length restriction (if exist) */
+ if((wayp->height && wayp->height<profile->height) ||
+    (wayp->width  && wayp->width <profile->width ) ||
+    (wayp->length && wayp->length<profile->length))
+    return(INF_SCORE);
+
+ segment_pref=profile->highway[HIGHWAY(wayp->type)];
+
+ /* highway preferences must allow this highway */
+ if(segment_pref==0)
+    return(INF_SCORE);
+
+ for(i=1;i<Property_Count;i++)
+    if(ways->file.props & PROPERTIES(i))
+      {
+       if(wayp->props & PROPERTIES(i))
+          segment_pref*=profile->props_yes[i];
+       else
+          segment_pref*=profile->props_no[i];
+      }
+
+ /* profile preferences must allow this highway */
+ if(segment_pref==0)
+    return(INF_SCORE);
+
+ if(quickest==0)
+    return((score_t)DISTANCE(segmentp->distance)/segment_pref);
+ else
+    return((score_t)Duration(node,segmentp,wayp,profile,&speedresult)/segment_pref);
+}
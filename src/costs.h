@@ -0,0 +1,63 @@
+/***************************************
+ A header file for the precalculated segment scores for a profile.
+
+ Part of the Routino routing software.
+ ******************/ /******************
+ This file Copyright 2008-2013 Andrew M. Bishop
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************/
+
+
+#ifndef COSTS_H
+#define COSTS_H    /*+ To stop multiple inclusions. +*/
+
+#include "types.h"
+
+#include "contract.h"
+#include "profiles.h"
+
+
+/* Data structures */
+
+/*+ A structure containing the score of each segment in each direction for one profile. +*/
+struct _SegmentCosts
+{
+ ChProfile profile;             /*+ The profile used to calculate the scores. +*/
+
+ index_t   number;              /*+ The number of segments. +*/
+
+ score_t  *scores;              /*+ The scores from node1 and from node2 of each segment (INF_SCORE if the
+                                    highway, its properties or its limits are not allowed by the profile). +*/
+};
+
+
+/* Functions in costs.c */
+
+SegmentCosts *CreateSegmentCosts(Segments *segments,Ways *ways,Profile *profile,int quickest);
+
+void DestroySegmentCosts(SegmentCosts *costs);
+
+int SegmentCostsMatchProfile(SegmentCosts *costs,Profile *profile,int quickest);
+
+score_t SegmentScore(Ways *ways,Profile *profile,Segment *segmentp,index_t node,int quickest);
+
+
+/* Macros and inline functions */
+
+/*+ Return the score for travelling along the segment with the specified index from the specified node. +*/
+#define SegmentCostFrom(xxx,yyy,zzz,www) ((xxx)->scores[2*(yyy)+((zzz)->node1!=(www))])
+
+
+#endif /* COSTS_H */
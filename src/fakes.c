@@ -25,25 +25,13 @@
 #include "segments.h"
 
 #include "fakes.h"
+#include "query.h"
 
 
 /*+ The minimum distance along a segment from a node to insert a fake node. (in km). +*/
 #define MINSEGMENT 0.005
 
 
-/*+ A set of fake segments to allow start/finish in the middle of a segment. +*/
-static Segment fake_segments[4*NWAYPOINTS+1];
-
-/*+ A set of pointers to the real segments underlying the fake segments. +*/
-static index_t real_segments[4*NWAYPOINTS+1];
-
-/*+ A set of fake node latitudes and longitudes. +*/
-static double fake_lon[NWAYPOINTS+1],fake_lat[NWAYPOINTS+1];
-
-/*+ The previous waypoint. +*/
-static int prevpoint=0;
-
-
 /*++++++++++++++++++++++++++++++++++++++
   Create a pair of fake segments corresponding to the given segment split in two
   (and will create an extra two fake segments if adjacent waypoints are on the
@@ -51,6 +39,8 @@ static int prevpoint=0;
 
   index_t CreateFakes Returns the fake node index (or a real one in special cases).
 
+  Query *query The query containing the fake nodes and segments.
+
   Nodes *nodes The set of nodes to use.
 
   Segments *segments The set of segments to use.
@@ -68,42 +58,43 @@ static int prevpoint=0;
   distance_t dist2 The distance to the second node.
   ++++++++++++++++++++++++++++++++++++++*/
 
-index_t CreateFakes(Nodes *nodes,Segments *segments,int point,Segment *segmentp,index_t node1,index_t node2,distance_t dist1,distance_t dist2)
+index_t CreateFakes(Query *query,Nodes *nodes,Segments *segments,int point,Segment *segmentp,index_t node1,index_t node2,distance_t dist1,distance_t dist2)
 {
  index_t fakenode;
  double lat1,lon1,lat2,lon2;
+ elevation_t ele1,ele2;
 
  /* Initialise the segments to fake values */
 
- fake_segments[4*point-4].node1=NO_NODE;
- fake_segments[4*point-4].node2=NO_NODE;
+ query->fake_segments[4*point-4].node1=NO_NODE;
+ query->fake_segments[4*point-4].node2=NO_NODE;
 
- fake_segments[4*point-3].node1=NO_NODE;
- fake_segments[4*point-3].node2=NO_NODE;
+ query->fake_segments[4*point-3].node1=NO_NODE;
+ query->fake_segments[4*point-3].node2=NO_NODE;
 
- fake_segments[4*point-2].node1=NO_NODE;
- fake_segments[4*point-2].node2=NO_NODE;
+ query->fake_segments[4*point-2].node1=NO_NODE;
+ query->fake_segments[4*point-2].node2=NO_NODE;
 
- fake_segments[4*point-1].node1=NO_NODE;
- fake_segments[4*point-1].node2=NO_NODE;
+ query->fake_segments[4*point-1].node1=NO_NODE;
+ query->fake_segments[4*point-1].node2=NO_NODE;
 
  /* Check if we are actually close enough to an existing node */
 
  if(dist1<=km_to_distance(MINSEGMENT) && dist2>km_to_distance(MINSEGMENT))
    {
-    prevpoint=point;
+    query->prevpoint=point;
     return(node1);
    }
 
  if(dist2<=km_to_distance(MINSEGMENT) && dist1>km_to_distance(MINSEGMENT))
    {
-    prevpoint=point;
+    query->prevpoint=point;
     return(node2);
    }
 
  if(dist1<=km_to_distance(MINSEGMENT) && dist2<=km_to_distance(MINSEGMENT))
    {
-    prevpoint=point;
+    query->prevpoint=point;
 
     if(dist1<dist2)
        return(node1);
@@ -123,10 +114,18 @@ index_t CreateFakes(Nodes *nodes,Segments *segments,int point,Segment *segmentp,
  else if(lat1<-3 && lat2>3)
     lat1+=2*M_PI;
 
- fake_lat[point]=lat1+(lat2-lat1)*(double)dist1/(double)(dist1+dist2); /* (dist1+dist2) must be > 0 */
- fake_lon[point]=lon1+(lon2-lon1)*(double)dist1/(double)(dist1+dist2); /* (dist1+dist2) must be > 0 */
+ query->fake_lat[point]=lat1+(lat2-lat1)*(double)dist1/(double)(dist1+dist2); /* (dist1+dist2) must be > 0 */
+ query->fake_lon[point]=lon1+(lon2-lon1)*(double)dist1/(double)(dist1+dist2); /* (dist1+dist2) must be > 0 */
+
+ if(query->fake_lat[point]>M_PI) query->fake_lat[point]-=2*M_PI;
+
+ ele1=GetElevation(nodes,node1);
+ ele2=GetElevation(nodes,node2);
 
- if(fake_lat[point]>M_PI) fake_lat[point]-=2*M_PI;
+ if(ele1==NO_ELEVATION || ele2==NO_ELEVATION)
+    query->fake_elevation[point]=NO_ELEVATION;
+ else
+    query->fake_elevation[point]=ele1+(elevation_t)floor((ele2-ele1)*(double)dist1/(double)(dist1+dist2)+0.5);
 
  /*
   *    node1  fakenode                         node2
@@ -149,55 +148,55 @@ index_t CreateFakes(Nodes *nodes,Segments *segments,int point,Segment *segmentp,
 
  /* Create the first fake segment */
 
- fake_segments[4*point-4]=*segmentp;
+ query->fake_segments[4*point-4]=*segmentp;
 
- fake_segments[4*point-4].node2=fakenode;
+ query->fake_segments[4*point-4].node2=fakenode;
 
- fake_segments[4*point-4].distance=DISTANCE(dist1)|DISTFLAG(segmentp->distance);
+ query->fake_segments[4*point-4].distance=DISTANCE(dist1)|DISTFLAG(segmentp->distance);
 
- real_segments[4*point-4]=IndexSegment(segments,segmentp);
+ query->real_segments[4*point-4]=IndexSegment(segments,segmentp);
 
  /* Create the second fake segment */
 
- fake_segments[4*point-3]=*segmentp;
+ query->fake_segments[4*point-3]=*segmentp;
 
- fake_segments[4*point-3].node1=fakenode;
+ query->fake_segments[4*point-3].node1=fakenode;
 
- fake_segments[4*point-3].distance=DISTANCE(dist2)|DISTFLAG(segmentp->distance);
+ query->fake_segments[4*point-3].distance=DISTANCE(dist2)|DISTFLAG(segmentp->distance);
 
- real_segments[4*point-3]=IndexSegment(segments,segmentp);
+ query->real_segments[4*point-3]=IndexSegment(segments,segmentp);
 
  /* Create a third fake segment to join adjacent points if both are fake and on the same real segment */
 
- if(prevpoint>0 && fake_segments[4*prevpoint-4].node1==node1 && fake_segments[4*prevpoint-3].node2==node2)
+ if(query->prevpoint>0 && query->fake_segments[4*query->prevpoint-4].node1==node1 && query->fake_segments[4*query->prevpoint-3].node2==node2)
    {
-    if(DISTANCE(dist1)>DISTANCE(fake_segments[4*prevpoint-4].distance)) /* point is further from node1 than prevpoint */
+    if(DISTANCE(dist1)>DISTANCE(query->fake_segments[4*query->prevpoint-4].distance)) /* point is further from node1 than prevpoint */
       {
-       fake_segments[4*point-2]=fake_segments[4*prevpoint-3];
+       query->fake_segments[4*point-2]=query->fake_segments[4*query->prevpoint-3];
 
-       fake_segments[4*point-2].node2=fakenode;
+       query->fake_segments[4*point-2].node2=fakenode;
 
-       fake_segments[4*point-2].distance=(DISTANCE(dist1)-DISTANCE(fake_segments[4*prevpoint-4].distance))|DISTFLAG(segmentp->distance);
+       query->fake_segments[4*point-2].distance=(DISTANCE(dist1)-DISTANCE(query->fake_segments[4*query->prevpoint-4].distance))|DISTFLAG(segmentp->distance);
       }
     else
       {
-       fake_segments[4*point-2]=fake_segments[4*prevpoint-4];
+       query->fake_segments[4*point-2]=query->fake_segments[4*query->prevpoint-4];
 
-       fake_segments[4*point-2].node1=fakenode;
+       query->fake_segments[4*point-2].node1=fakenode;
 
-       fake_segments[4*point-2].distance=(DISTANCE(fake_segments[4*prevpoint-4].distance)-DISTANCE(dist1))|DISTFLAG(segmentp->distance);
+       query->fake_segments[4*point-2].distance=(DISTANCE(query->fake_segments[4*query->prevpoint-4].distance)-DISTANCE(dist1))|DISTFLAG(segmentp->distance);
       }
 
-    real_segments[4*point-2]=IndexSegment(segments,segmentp);
+    query->real_segments[4*point-2]=IndexSegment(segments,segmentp);
 
-    fake_segments[4*prevpoint-1]=fake_segments[4*point-2];
+    query->fake_segments[4*query->prevpoint-1]=query->fake_segments[4*point-2];
 
-    real_segments[4*prevpoint-1]=real_segments[4*point-2];
+    query->real_segments[4*query->prevpoint-1]=query->real_segments[4*point-2];
    }
 
  /* Return the fake node */
 
- prevpoint=point;
+ query->prevpoint=point;
 
  return(fakenode);
 }
@@ -206,6 +205,8 @@ index_t CreateFakes(Nodes *nodes,Segments *segments,int point,Segment *segmentp,
 /*++++++++++++++++++++++++++++++++++++++
   Lookup the latitude and longitude of a fake node.
 
+  Query *query The query containing the fake nodes and segments.
+
   index_t fakenode The fake node to lookup.
 
   double *latitude Returns the latitude
@@ -213,12 +214,30 @@ index_t CreateFakes(Nodes *nodes,Segments *segments,int point,Segment *segmentp,
   double *longitude Returns the longitude.
   ++++++++++++++++++++++++++++++++++++++*/
 
-void GetFakeLatLong(index_t fakenode, double *latitude,double *longitude)
+void GetFakeLatLong(Query *query,index_t fakenode, double *latitude,double *longitude)
 {
  index_t whichnode=fakenode-NODE_FAKE;
 
- *latitude =fake_lat[whichnode];
- *longitude=fake_lon[whichnode];
+ *latitude =query->fake_lat[whichnode];
+ *longitude=query->fake_lon[whichnode];
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Lookup the elevation of a fake node.
+
+  elevation_t GetFakeElevation Returns the elevation (or NO_ELEVATION if unknown).
+
+  Query *query The query containing the fake nodes and segments.
+
+  index_t fakenode The fake node to lookup.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+elevation_t GetFakeElevation(Query *query,index_t fakenode)
+{
+ index_t whichnode=fakenode-NODE_FAKE;
+
+ return(query->fake_elevation[whichnode]);
 }
 
 
@@ -227,14 +246,16 @@ void GetFakeLatLong(index_t fakenode, double *latitude,double *longitude)
 
   Segment *FirstFakeSegment Returns a pointer to the first fake segment.
 
+  Query *query The query containing the fake nodes and segments.
+
   index_t fakenode The fake node to lookup.
   ++++++++++++++++++++++++++++++++++++++*/
 
-Segment *FirstFakeSegment(index_t fakenode)
+Segment *FirstFakeSegment(Query *query,index_t fakenode)
 {
  index_t whichnode=fakenode-NODE_FAKE;
 
- return(&fake_segments[4*whichnode-4]);
+ return(&query->fake_segments[4*whichnode-4]);
 }
 
 
@@ -243,26 +264,28 @@ Segment *FirstFakeSegment(index_t fakenode)
 
   Segment *NextFakeSegment Returns a pointer to the next fake segment.
 
+  Query *query The query containing the fake nodes and segments.
+
   Segment *fakesegmentp The first fake segment.
 
   index_t fakenode The node to lookup.
   ++++++++++++++++++++++++++++++++++++++*/
 
-Segment *NextFakeSegment(Segment *fakesegmentp,index_t fakenode)
+Segment *NextFakeSegment(Query *query,Segment *fakesegmentp,index_t fakenode)
 {
  index_t whichnode=fakenode-NODE_FAKE;
 
- if(fakesegmentp==&fake_segments[4*whichnode-4])
-    return(&fake_segments[4*whichnode-3]);
+ if(fakesegmentp==&query->fake_segments[4*whichnode-4])
+    return(&query->fake_segments[4*whichnode-3]);
 
- if(fakesegmentp==&fake_segments[4*whichnode-3] && fake_segments[4*whichnode-2].node1!=NO_NODE)
-    return(&fake_segments[4*whichnode-2]);
+ if(fakesegmentp==&query->fake_segments[4*whichnode-3] && query->fake_segments[4*whichnode-2].node1!=NO_NODE)
+    return(&query->fake_segments[4*whichnode-2]);
 
- if(fakesegmentp==&fake_segments[4*whichnode-3] && fake_segments[4*whichnode-1].node1!=NO_NODE)
-    return(&fake_segments[4*whichnode-1]);
+ if(fakesegmentp==&query->fake_segments[4*whichnode-3] && query->fake_segments[4*whichnode-1].node1!=NO_NODE)
+    return(&query->fake_segments[4*whichnode-1]);
 
- if(fakesegmentp==&fake_segments[4*whichnode-2] && fake_segments[4*whichnode-1].node1!=NO_NODE)
-    return(&fake_segments[4*whichnode-1]);
+ if(fakesegmentp==&query->fake_segments[4*whichnode-2] && query->fake_segments[4*whichnode-1].node1!=NO_NODE)
+    return(&query->fake_segments[4*whichnode-1]);
 
  return(NULL);
 }
@@ -273,20 +296,22 @@ Segment *NextFakeSegment(Segment *fakesegmentp,index_t fakenode)
 
   Segment *ExtraFakeSegment Returns a segment between the two specified nodes if it exists.
 
+  Query *query The query containing the fake nodes and segments.
+
   index_t realnode The real node.
 
   index_t fakenode The fake node.
   ++++++++++++++++++++++++++++++++++++++*/
 
-Segment *ExtraFakeSegment(index_t realnode,index_t fakenode)
+Segment *ExtraFakeSegment(Query *query,index_t realnode,index_t fakenode)
 {
  index_t whichnode=fakenode-NODE_FAKE;
 
- if(fake_segments[4*whichnode-4].node1==realnode || fake_segments[4*whichnode-4].node2==realnode)
-    return(&fake_segments[4*whichnode-4]);
+ if(query->fake_segments[4*whichnode-4].node1==realnode || query->fake_segments[4*whichnode-4].node2==realnode)
+    return(&query->fake_segments[4*whichnode-4]);
 
- if(fake_segments[4*whichnode-3].node1==realnode || fake_segments[4*whichnode-3].node2==realnode)
-    return(&fake_segments[4*whichnode-3]);
+ if(query->fake_segments[4*whichnode-3].node1==realnode || query->fake_segments[4*whichnode-3].node2==realnode)
+    return(&query->fake_segments[4*whichnode-3]);
 
  return(NULL);
 }
@@ -297,14 +322,16 @@ Segment *ExtraFakeSegment(index_t realnode,index_t fakenode)
 
   Segment *LookupFakeSegment Returns a pointer to the fake segment.
 
+  Query *query The query containing the fake nodes and segments.
+
   index_t fakesegment The index of the fake segment.
   ++++++++++++++++++++++++++++++++++++++*/
 
-Segment *LookupFakeSegment(index_t fakesegment)
+Segment *LookupFakeSegment(Query *query,index_t fakesegment)
 {
  index_t whichsegment=fakesegment-SEGMENT_FAKE;
 
- return(&fake_segments[whichsegment]);
+ return(&query->fake_segments[whichsegment]);
 }
 
 
@@ -313,12 +340,14 @@ Segment *LookupFakeSegment(index_t fakesegment)
 
   index_t IndexFakeSegment Returns the fake segment.
 
+  Query *query The query containing the fake nodes and segments.
+
   Segment *fakesegmentp The fake segment to look for.
   ++++++++++++++++++++++++++++++++++++++*/
 
-index_t IndexFakeSegment(Segment *fakesegmentp)
+index_t IndexFakeSegment(Query *query,Segment *fakesegmentp)
 {
- index_t whichsegment=fakesegmentp-&fake_segments[0];
+ index_t whichsegment=fakesegmentp-&query->fake_segments[0];
 
  return(whichsegment+SEGMENT_FAKE);
 }
@@ -329,14 +358,16 @@ index_t IndexFakeSegment(Segment *fakesegmentp)
 
   index_t IndexRealSegment Returns the index of the real segment.
 
+  Query *query The query containing the fake nodes and segments.
+
   index_t fakesegment The index of the fake segment.
   ++++++++++++++++++++++++++++++++++++++*/
 
-index_t IndexRealSegment(index_t fakesegment)
+index_t IndexRealSegment(Query *query,index_t fakesegment)
 {
  index_t whichsegment=fakesegment-SEGMENT_FAKE;
 
- return(real_segments[whichsegment]);
+ return(query->real_segments[whichsegment]);
 }
 
 
@@ -345,20 +376,22 @@ index_t IndexRealSegment(index_t fakesegment)
 
   int IsFakeUTurn Returns true for a U-turn.
 
+  Query *query The query containing the fake nodes and segments.
+
   index_t fakesegment1 The first fake segment.
 
   index_t fakesegment2 The second fake segment.
   ++++++++++++++++++++++++++++++++++++++*/
 
-int IsFakeUTurn(index_t fakesegment1,index_t fakesegment2)
+int IsFakeUTurn(Query *query,index_t fakesegment1,index_t fakesegment2)
 {
  index_t whichsegment1=fakesegment1-SEGMENT_FAKE;
  index_t whichsegment2=fakesegment2-SEGMENT_FAKE;
 
- if(fake_segments[whichsegment1].node1==fake_segments[whichsegment2].node1)
+ if(query->fake_segments[whichsegment1].node1==query->fake_segments[whichsegment2].node1)
     return(1);
 
- if(fake_segments[whichsegment1].node2==fake_segments[whichsegment2].node2)
+ if(query->fake_segments[whichsegment1].node2==query->fake_segments[whichsegment2].node2)
     return(1);
 
  return(0);
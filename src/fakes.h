@@ -37,18 +37,20 @@
 
 /* Functions in fakes.c */
 
-index_t CreateFakes(Nodes *nodes,Segments *segments,int point,Segment *segmentp,index_t node1,index_t node2,distance_t dist1,distance_t dist2);
+index_t CreateFakes(Query *query,Nodes *nodes,Segments *segments,int point,Segment *segmentp,index_t node1,index_t node2,distance_t dist1,distance_t dist2);
 
-void GetFakeLatLong(index_t fakenode, double *latitude,double *longitude);
+void GetFakeLatLong(Query *query,index_t fakenode, double *latitude,double *longitude);
 
-Segment *FirstFakeSegment(index_t fakenode);
-Segment *NextFakeSegment(Segment *fakesegmentp,index_t fakenode);
-Segment *ExtraFakeSegment(index_t realnode,index_t fakenode);
+elevation_t GetFakeElevation(Query *query,index_t fakenode);
 
-Segment *LookupFakeSegment(index_t index);
-index_t IndexFakeSegment(Segment *fakesegmentp);
-index_t IndexRealSegment(index_t fakesegment);
+Segment *FirstFakeSegment(Query *query,index_t fakenode);
+Segment *NextFakeSegment(Query *query,Segment *fakesegmentp,index_t fakenode);
+Segment *ExtraFakeSegment(Query *query,index_t realnode,index_t fakenode);
 
-int IsFakeUTurn(index_t fakesegment1,index_t fakesegment2);
+Segment *LookupFakeSegment(Query *query,index_t index);
+index_t IndexFakeSegment(Query *query,Segment *fakesegmentp);
+index_t IndexRealSegment(Query *query,index_t fakesegment);
+
+int IsFakeUTurn(Query *query,index_t fakesegment1,index_t fakesegment2);
 
 #endif /* FAKES_H */
@@ -250,6 +250,7 @@ int main(int argc,char** argv)
     printf("\n");
 
     printf("sizeof(Node) =%9lu Bytes\n",(unsigned long)sizeof(Node));
+    printf("sizeof(elevation_t)=%3lu Bytes\n",(unsigned long)sizeof(elevation_t));
     printf("Number       =%9"Pindex_t"\n",OSMNodes->file.number);
     printf("Number(super)=%9"Pindex_t"\n",OSMNodes->file.snumber);
     printf("\n");
@@ -502,6 +503,8 @@ static void print_node(Nodes *nodes,index_t item)
  printf("  firstseg=%"Pindex_t"\n",nodep->firstseg);
  printf("  latoffset=%d lonoffset=%d (latitude=%.6f longitude=%.6f)\n",nodep->latoffset,nodep->lonoffset,radians_to_degrees(latitude),radians_to_degrees(longitude));
  printf("  allow=%02x (%s)\n",nodep->allow,AllowedNameList(nodep->allow));
+ if(GetElevation(nodes,item)!=NO_ELEVATION)
+    printf("  elevation=%d (%.1f m)\n",GetElevation(nodes,item),elevation_to_metres(GetElevation(nodes,item)));
  if(IsSuperNode(nodep))
     printf("  Super-Node\n");
  if(nodep->flags & NODE_MINIRNDBT)
@@ -526,6 +529,7 @@ static void print_segment(Segments *segments,index_t item)
  printf("  next2=%"Pindex_t"\n",segmentp->next2);
  printf("  way=%"Pindex_t"\n",segmentp->way);
  printf("  distance=%d (%.3f km)\n",DISTANCE(segmentp->distance),distance_to_km(DISTANCE(segmentp->distance)));
+ printf("  ascent=%.1f%% descent=%.1f%%\n",gradient_to_pourcent(segmentp->percentascent),gradient_to_pourcent(segmentp->percentdescent));
  if(IsSuperSegment(segmentp) && IsNormalSegment(segmentp))
     printf("  Super-Segment AND normal Segment\n");
  else if(IsSuperSegment(segmentp) && !IsNormalSegment(segmentp))
@@ -905,7 +909,7 @@ static void print_turn_relation_osm(Relations *relations,index_t item,Segments *
  Segment *segmentp_from=LookupSegment(segments,relationp->from,1);
  Segment *segmentp_to  =LookupSegment(segments,relationp->to  ,2);
 
- double angle=TurnAngle(nodes,segmentp_from,segmentp_to,relationp->via);
+ double angle=TurnAngle(NULL,nodes,segmentp_from,segmentp_to,relationp->via);
 
  char *restriction;
 
@@ -1077,7 +1081,7 @@ static void print_turn_relation_visualiser(Relations *relations,index_t item,Seg
  Segment *segmentp_from=LookupSegment(segments,relationp->from,1);
  Segment *segmentp_to  =LookupSegment(segments,relationp->to  ,2);
 
- double angle=TurnAngle(nodes,segmentp_from,segmentp_to,relationp->via);
+ double angle=TurnAngle(NULL,nodes,segmentp_from,segmentp_to,relationp->via);
 
  char *restriction;
 
@@ -20,9 +20,14 @@
  ***************************************/
 
 
+#if defined(USE_IO_URING) && USE_IO_URING
+#define _DEFAULT_SOURCE         /* For the syscall() function */
+#endif
+
 #include <unistd.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdint.h>
 #include <string.h>
 #include <fcntl.h>
 #include <errno.h>
@@ -30,6 +35,15 @@
 #include <sys/mman.h>
 #include <sys/types.h>
 
+#if defined(USE_PTHREADS) && USE_PTHREADS
+#include <pthread.h>
+#endif
+
+#if defined(USE_IO_URING) && USE_IO_URING
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+
 #include "files.h"
 
 
@@ -49,28 +63,145 @@ static struct mmapinfo *mappedfiles;
 static int nmappedfiles=0;
 
 
+/*+ The size of the first read after opening or seeking (increases while reading sequentially). +*/
 #define BUFFLEN 4096
 
+/*+ The size of each of the two blocks of data in a file buffer. +*/
+#define BLOCKLEN 262144
+
+/*+ The size of a buffer for a compressed block of data (the worst case compressed length plus the headers). +*/
+#define ZBLOCKLEN (BLOCKLEN+BLOCKLEN/255+32)
+
+/*+ The marker at the start of a file of compressed blocks. +*/
+#define ZMAGIC "\x89RZB\r\n\x1a\n"
+
+/*+ The number of bits in the hash table used to find matches when compressing. +*/
+#define ZHASHBITS 13
+
+/*+ The methods of reading and writing the blocks of data in the background. +*/
+#define FILEIO_SYNC   0         /*+ No background I/O (done immediately). +*/
+#define FILEIO_THREAD 1         /*+ A thread for each file. +*/
+#define FILEIO_URING  2         /*+ The Linux io_uring interface. +*/
+
+/*+ The number of file buffer pointers in each part of the list and the maximum number of parts. +*/
+#define FILEBUFFER_PART  1024
+#define FILEBUFFER_PARTS 4096
+
 /*+ A structure to contain the list of file buffers. +*/
 struct filebuffer
 {
  int    fd;                     /*+ The file descriptor used when it was opened. +*/
- char   buffer[BUFFLEN];        /*+ The data buffer. +*/
+ char  *buffer;                 /*+ The data buffer being filled by writing or emptied by reading. +*/
+ char  *spare;                  /*+ The spare data buffer being written or read in the background. +*/
  size_t pointer;                /*+ The read/write pointer for the file buffer. +*/
  size_t length;                 /*+ The read pointer for the file buffer. +*/
  int    reading;                /*+ A flag to indicate if the file is for reading. +*/
+
+ int    readahead;              /*+ A flag to indicate that the file is being read sequentially. +*/
+ size_t readsize;               /*+ The amount of data to read into the next block. +*/
+
+ int     pending;               /*+ A flag to indicate that the spare buffer is being read or written. +*/
+ int     io_write;              /*+ A flag to indicate that the background operation is a write. +*/
+ char   *io_buffer;             /*+ The buffer for the background operation. +*/
+ size_t  io_length;             /*+ The length of the background operation. +*/
+ ssize_t io_result;             /*+ The result of the background operation. +*/
+ int     io_done;               /*+ A flag to indicate that the background operation has finished. +*/
+
+ int     compressed;            /*+ A flag to indicate that the file contains compressed blocks. +*/
+ int     zmagic;                /*+ A flag to indicate that the marker has been written at the start of the file. +*/
+ char   *zbuffer;               /*+ The buffer for the compressed block being written or decompressed. +*/
+ size_t  zlength;               /*+ The compressed length of the next block to read (0 at the end of the file). +*/
+ size_t  ulength;               /*+ The uncompressed length of the next block to read. +*/
+
+#if defined(USE_PTHREADS) && USE_PTHREADS
+ pthread_t       thread;        /*+ The thread that performs the background operations. +*/
+ int             running;       /*+ A flag to indicate that the thread has been started. +*/
+ int             queued;        /*+ A flag to indicate that there is an operation for the thread. +*/
+ int             stop;          /*+ A flag to tell the thread to stop. +*/
+ pthread_mutex_t mutex;         /*+ The mutex to protect the thread flags. +*/
+ pthread_cond_t  cond;          /*+ The condition to signal changes to the thread flags. +*/
+#endif
 };
 
-/*+ The list of file buffers. +*/
-static struct filebuffer **filebuffers=NULL;
+/*+ The list of file buffers, in parts that are allocated when needed and never moved or freed
+    so that a thread can look up its own file buffer without the lock. +*/
+static struct filebuffer **filebuffers[FILEBUFFER_PARTS];
+
+/*+ The method used for reading and writing blocks of data in the background. +*/
+static int filebackend=-1;
+
+/*+ The amount of data written to and read from compressed files before compression and after decompression. +*/
+static uint64_t zstats_uncompressed=0;
+
+/*+ The amount of data written to and read from compressed files on disk. +*/
+static uint64_t zstats_compressed=0;
+
+/*+ A flag to indicate that temporary files are to be compressed. +*/
+int option_tmpcompress=0;
+
+#if defined(USE_PTHREADS) && USE_PTHREADS
+
+/*+ The mutex to protect the list of file buffers (and the io_uring). +*/
+static pthread_mutex_t filebuffers_mutex = PTHREAD_MUTEX_INITIALIZER;
 
-/*+ The number of allocated file buffer pointers. +*/
-static int nfilebuffers=0;
+/*+ The mutex to protect the list of memory mapped files. +*/
+static pthread_mutex_t mappedfiles_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+#endif
+
+#if defined(USE_IO_URING) && USE_IO_URING
+
+/*+ The number of entries in the io_uring submission queue. +*/
+#define URING_ENTRIES 64
+
+/*+ A structure to contain the io_uring submission and completion queues. +*/
+static struct
+{
+ int                  fd;       /*+ The file descriptor of the io_uring. +*/
+
+ unsigned            *sq_tail;  /*+ The tail of the submission queue. +*/
+ unsigned            *sq_mask;  /*+ The mask for indexes in the submission queue. +*/
+ unsigned            *sq_array; /*+ The array of submission queue entry indexes. +*/
+ struct io_uring_sqe *sqes;     /*+ The submission queue entries. +*/
+
+ unsigned            *cq_head;  /*+ The head of the completion queue. +*/
+ unsigned            *cq_tail;  /*+ The tail of the completion queue. +*/
+ unsigned            *cq_mask;  /*+ The mask for indexes in the completion queue. +*/
+ struct io_uring_cqe *cqes;     /*+ The completion queue entries. +*/
+}
+ uring;
+
+#endif
 
 
 /* Local functions */
 
 static void CreateFileBuffer(int fd,int read_write);
+static inline struct filebuffer *get_filebuffer(int fd);
+
+static int RefillFileBuffer(struct filebuffer *filebuffer);
+static int WriteFileBlock(struct filebuffer *filebuffer);
+static int FlushFileBuffer(struct filebuffer *filebuffer);
+
+static size_t CompressFileBlock(struct filebuffer *filebuffer);
+static int DecompressFileBlock(struct filebuffer *filebuffer);
+
+static size_t CompressBlock(const char *in,size_t length,char *out);
+static int DecompressBlock(const char *in,size_t length,char *out,size_t outlength);
+
+static void StartFileIO(struct filebuffer *filebuffer,int writing,char *buffer,size_t length);
+static ssize_t FinishFileIO(struct filebuffer *filebuffer);
+static ssize_t DoFileIO(int fd,int writing,char *buffer,size_t length);
+
+#if defined(USE_PTHREADS) && USE_PTHREADS
+static void *FileIOThread(struct filebuffer *filebuffer);
+#endif
+
+#if defined(USE_IO_URING) && USE_IO_URING
+static int InitFileUring(void);
+static void SubmitFileUring(struct filebuffer *filebuffer);
+static void WaitFileUring(struct filebuffer *filebuffer);
+#endif
 
 
 /*++++++++++++++++++++++++++++++++++++++
@@ -144,6 +275,10 @@ void *MapFile(const char *filename)
 
  /* Store the information about the mapped file */
 
+#if defined(USE_PTHREADS) && USE_PTHREADS
+ pthread_mutex_lock(&mappedfiles_mutex);
+#endif
+
  mappedfiles=(struct mmapinfo*)realloc((void*)mappedfiles,(nmappedfiles+1)*sizeof(struct mmapinfo));
 
  mappedfiles[nmappedfiles].filename=filename;
@@ -153,6 +288,10 @@ void *MapFile(const char *filename)
 
  nmappedfiles++;
 
+#if defined(USE_PTHREADS) && USE_PTHREADS
+ pthread_mutex_unlock(&mappedfiles_mutex);
+#endif
+
  return(address);
 }
 
@@ -206,6 +345,10 @@ void *MapFileWriteable(const char *filename)
 
  /* Store the information about the mapped file */
 
+#if defined(USE_PTHREADS) && USE_PTHREADS
+ pthread_mutex_lock(&mappedfiles_mutex);
+#endif
+
  mappedfiles=(struct mmapinfo*)realloc((void*)mappedfiles,(nmappedfiles+1)*sizeof(struct mmapinfo));
 
  mappedfiles[nmappedfiles].filename=filename;
@@ -215,6 +358,10 @@ void *MapFileWriteable(const char *filename)
 
  nmappedfiles++;
 
+#if defined(USE_PTHREADS) && USE_PTHREADS
+ pthread_mutex_unlock(&mappedfiles_mutex);
+#endif
+
  return(address);
 }
 
@@ -230,6 +377,11 @@ void *MapFileWriteable(const char *filename)
 void *UnmapFile(const void *address)
 {
  int i;
+ struct mmapinfo mappedfile;
+
+#if defined(USE_PTHREADS) && USE_PTHREADS
+ pthread_mutex_lock(&mappedfiles_mutex);
+#endif
 
  for(i=0;i<nmappedfiles;i++)
     if(mappedfiles[i].address==address)
@@ -241,13 +393,7 @@ void *UnmapFile(const void *address)
     exit(EXIT_FAILURE);
    }
 
- /* Close the file */
-
- close(mappedfiles[i].fd);
-
- /* Unmap the file */
-
- munmap(mappedfiles[i].address,mappedfiles[i].length);
+ mappedfile=mappedfiles[i];
 
  /* Shuffle the list of files */
 
@@ -256,6 +402,18 @@ void *UnmapFile(const void *address)
  if(nmappedfiles>i)
     memmove(&mappedfiles[i],&mappedfiles[i+1],(nmappedfiles-i)*sizeof(struct mmapinfo));
 
+#if defined(USE_PTHREADS) && USE_PTHREADS
+ pthread_mutex_unlock(&mappedfiles_mutex);
+#endif
+
+ /* Close the file */
+
+ close(mappedfile.fd);
+
+ /* Unmap the file */
+
+ munmap(mappedfile.address,mappedfile.length);
+
  return(NULL);
 }
 
@@ -360,6 +518,36 @@ int OpenFileBufferedNew(const char *filename)
 }
 
 
+/*++++++++++++++++++++++++++++++++++++++
+  Open a new temporary file on disk for writing (with buffering and compression if selected).
+  The file can only be read back sequentially using ReOpenFileBuffered(), ReadFileBuffered(),
+  ReadFileBufferedPartial() and SkipFileBuffered().
+
+  int OpenFileBufferedNewTemporary Returns the file descriptor if OK or exits in case of an error.
+
+  const char *filename The name of the file to create.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+int OpenFileBufferedNewTemporary(const char *filename)
+{
+ int fd=OpenFileBufferedNew(filename);
+
+ if(option_tmpcompress)
+   {
+    struct filebuffer *filebuffer=get_filebuffer(fd);
+
+    filebuffer->compressed=1;
+
+    filebuffer->zbuffer=(char*)malloc(ZBLOCKLEN);
+    filebuffer->spare=(char*)malloc(ZBLOCKLEN);
+
+    logassert(filebuffer->zbuffer && filebuffer->spare,"Failed to allocate memory"); /* Check malloc() worked */
+   }
+
+ return(fd);
+}
+
+
 /*++++++++++++++++++++++++++++++++++++++
   Open a new or existing file on disk for appending (with buffering).
 
@@ -399,6 +587,7 @@ int OpenFileBufferedAppend(const char *filename)
 int ReOpenFileBuffered(const char *filename)
 {
  int fd;
+ unsigned char header[16];
 
  /* Open the file */
 
@@ -412,6 +601,39 @@ int ReOpenFileBuffered(const char *filename)
 
  CreateFileBuffer(fd,1);
 
+#if defined(POSIX_FADV_SEQUENTIAL)
+ posix_fadvise(fd,0,0,POSIX_FADV_SEQUENTIAL);
+#endif
+
+ /* Check for a file of compressed blocks and start reading the first one */
+
+ if(option_tmpcompress && pread(fd,header,16,0)==16 && !memcmp(header,ZMAGIC,8))
+   {
+    struct filebuffer *filebuffer=get_filebuffer(fd);
+
+    filebuffer->compressed=1;
+
+    filebuffer->zbuffer=(char*)malloc(ZBLOCKLEN);
+    filebuffer->spare=(char*)malloc(ZBLOCKLEN);
+
+    logassert(filebuffer->zbuffer && filebuffer->spare,"Failed to allocate memory"); /* Check malloc() worked */
+
+    filebuffer->zlength=(uint32_t)(header[ 8]|(header[ 9]<<8)|(header[10]<<16)|((uint32_t)header[11]<<24));
+    filebuffer->ulength=(uint32_t)(header[12]|(header[13]<<8)|(header[14]<<16)|((uint32_t)header[15]<<24));
+
+    logassert(filebuffer->ulength<=BLOCKLEN && filebuffer->zlength<=filebuffer->ulength,"Compressed file is corrupt - report a bug");
+
+    __atomic_add_fetch(&zstats_compressed,16,__ATOMIC_RELAXED);
+
+    if(lseek(fd,16,SEEK_SET)!=16)
+      {
+       fprintf(stderr,"Cannot seek in file '%s' [%s].\n",filename,strerror(errno));
+       exit(EXIT_FAILURE);
+      }
+
+    StartFileIO(filebuffer,0,filebuffer->spare,filebuffer->zlength+8);
+   }
+
  return(fd);
 }
 
@@ -430,33 +652,40 @@ int ReOpenFileBuffered(const char *filename)
 
 int WriteFileBuffered(int fd,const void *address,size_t length)
 {
+ struct filebuffer *filebuffer;
+
  logassert(fd!=-1,"File descriptor is in error - report a bug");
 
- logassert(fd<nfilebuffers && filebuffers[fd],"File descriptor has no buffer - report a bug");
+ filebuffer=get_filebuffer(fd);
 
- logassert(!filebuffers[fd]->reading,"File descriptor was not opened for writing - report a bug");
+ logassert(filebuffer,"File descriptor has no buffer - report a bug");
 
- /* Write the data */
+ logassert(!filebuffer->reading,"File descriptor was not opened for writing - report a bug");
 
- if((filebuffers[fd]->pointer+length)>BUFFLEN)
+ /* Write the data, each full block is written in the background */
+
+ while(length>0)
    {
-    if(write(fd,filebuffers[fd]->buffer,filebuffers[fd]->pointer)!=(ssize_t)filebuffers[fd]->pointer)
-       return(-1);
+    size_t space=BLOCKLEN-filebuffer->pointer;
 
-    filebuffers[fd]->pointer=0;
-   }
+    if(space==0)
+      {
+       if(WriteFileBlock(filebuffer))
+          return(-1);
 
- if(length>=BUFFLEN)
-   {
-    if(write(fd,address,length)!=(ssize_t)length)
-       return(-1);
+       continue;
+      }
 
-    return(0);
-   }
+    if(space>length)
+       space=length;
+
+    memcpy(filebuffer->buffer+filebuffer->pointer,address,space);
 
- memcpy(filebuffers[fd]->buffer+filebuffers[fd]->pointer,address,length);
+    filebuffer->pointer+=space;
 
- filebuffers[fd]->pointer+=length;
+    address+=space;
+    length-=space;
+   }
 
  return(0);
 }
@@ -476,54 +705,94 @@ int WriteFileBuffered(int fd,const void *address,size_t length)
 
 int ReadFileBuffered(int fd,void *address,size_t length)
 {
+ struct filebuffer *filebuffer;
+
  logassert(fd!=-1,"File descriptor is in error - report a bug");
 
- logassert(fd<nfilebuffers && filebuffers[fd],"File descriptor has no buffer - report a bug");
+ filebuffer=get_filebuffer(fd);
 
- logassert(filebuffers[fd]->reading,"File descriptor was not opened for reading - report a bug");
+ logassert(filebuffer,"File descriptor has no buffer - report a bug");
 
- /* Read the data */
+ logassert(filebuffer->reading,"File descriptor was not opened for reading - report a bug");
 
- if((filebuffers[fd]->pointer+length)>filebuffers[fd]->length)
-    if(filebuffers[fd]->pointer<filebuffers[fd]->length)
-      {
-       memcpy(address,filebuffers[fd]->buffer+filebuffers[fd]->pointer,filebuffers[fd]->length-filebuffers[fd]->pointer);
+ /* Read the data, the next block is read in the background */
+
+ while(length>0)
+   {
+    size_t available=filebuffer->length-filebuffer->pointer;
 
-       address+=filebuffers[fd]->length-filebuffers[fd]->pointer;
-       length-=filebuffers[fd]->length-filebuffers[fd]->pointer;
+    if(available==0)
+      {
+       if(RefillFileBuffer(filebuffer))
+          return(-1);
 
-       filebuffers[fd]->pointer=0;
-       filebuffers[fd]->length=0;
+       continue;
       }
 
- if(length>=BUFFLEN)
-   {
-    if(read(fd,address,length)!=(ssize_t)length)
-       return(-1);
+    if(available>length)
+       available=length;
 
-    return(0);
+    memcpy(address,filebuffer->buffer+filebuffer->pointer,available);
+
+    filebuffer->pointer+=available;
+
+    address+=available;
+    length-=available;
    }
 
- if(filebuffers[fd]->pointer==filebuffers[fd]->length)
+ return(0);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Read up to a maximum amount of data from a file descriptor (via a buffer).
+
+  size_t ReadFileBufferedPartial Returns the amount of data read (less than requested only at
+  the end of the file or in case of an error).
+
+  int fd The file descriptor to read from.
+
+  void *address The address the data is to be read into.
+
+  size_t length The maximum length of data to read.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+size_t ReadFileBufferedPartial(int fd,void *address,size_t length)
+{
+ struct filebuffer *filebuffer;
+ size_t total=0;
+
+ logassert(fd!=-1,"File descriptor is in error - report a bug");
+
+ filebuffer=get_filebuffer(fd);
+
+ logassert(filebuffer,"File descriptor has no buffer - report a bug");
+
+ logassert(filebuffer->reading,"File descriptor was not opened for reading - report a bug");
+
+ while(total<length)
    {
-    ssize_t len=read(fd,filebuffers[fd]->buffer,BUFFLEN);
+    size_t available=filebuffer->length-filebuffer->pointer;
 
-    if(len<=0)
-       return(-1);
+    if(available==0)
+      {
+       if(RefillFileBuffer(filebuffer))
+          break;
 
+       continue;
+      }
 
-    filebuffers[fd]->length=len;
-    filebuffers[fd]->pointer=0;
-   }
+    if(available>length-total)
+       available=length-total;
 
- if(filebuffers[fd]->length==0)
-    return(-1);
+    memcpy(address+total,filebuffer->buffer+filebuffer->pointer,available);
 
- memcpy(address,filebuffers[fd]->buffer+filebuffers[fd]->pointer,length);
+    filebuffer->pointer+=available;
 
- filebuffers[fd]->pointer+=length;
+    total+=available;
+   }
 
- return(0);
+ return(total);
 }
 
 
@@ -539,18 +808,36 @@ int ReadFileBuffered(int fd,void *address,size_t length)
 
 int SeekFileBuffered(int fd,off_t position)
 {
+ struct filebuffer *filebuffer;
+
  logassert(fd!=-1,"File descriptor is in error - report a bug");
 
- logassert(fd<nfilebuffers && filebuffers[fd],"File descriptor has no buffer - report a bug");
+ filebuffer=get_filebuffer(fd);
+
+ logassert(filebuffer,"File descriptor has no buffer - report a bug");
+
+ logassert(!filebuffer->compressed,"Cannot seek within a compressed file - report a bug");
 
  /* Seek the data - doesn't need to be highly optimised */
 
- if(!filebuffers[fd]->reading)
-    if(write(fd,filebuffers[fd]->buffer,filebuffers[fd]->pointer)!=(ssize_t)filebuffers[fd]->pointer)
+ if(!filebuffer->reading)
+   {
+    if(FlushFileBuffer(filebuffer))
        return(-1);
+   }
+ else
+   {
+    if(filebuffer->pending)
+       FinishFileIO(filebuffer);
+
+    filebuffer->pointer=0;
+    filebuffer->length=0;
 
- filebuffers[fd]->pointer=0;
- filebuffers[fd]->length=0;
+    /* The access may be random so only read a small amount until it appears sequential */
+
+    filebuffer->readahead=0;
+    filebuffer->readsize=BUFFLEN;
+   }
 
  if(lseek(fd,position,SEEK_SET)!=position)
     return(-1);
@@ -571,26 +858,78 @@ int SeekFileBuffered(int fd,off_t position)
 
 int SkipFileBuffered(int fd,off_t skip)
 {
+ struct filebuffer *filebuffer;
+
  logassert(fd!=-1,"File descriptor is in error - report a bug");
 
- logassert(fd<nfilebuffers && filebuffers[fd],"File descriptor has no buffer - report a bug");
+ filebuffer=get_filebuffer(fd);
+
+ logassert(filebuffer,"File descriptor has no buffer - report a bug");
 
- logassert(filebuffers[fd]->reading,"File descriptor was not opened for reading - report a bug");
+ logassert(filebuffer->reading,"File descriptor was not opened for reading - report a bug");
 
  /* Skip the data - needs to be optimised */
 
- if((filebuffers[fd]->pointer+skip)>filebuffers[fd]->length)
+ if((filebuffer->pointer+skip)<=filebuffer->length)
+   {
+    filebuffer->pointer+=skip;
+
+    return(0);
+   }
+
+ skip-=filebuffer->length-filebuffer->pointer;
+
+ filebuffer->pointer=0;
+ filebuffer->length=0;
+
+ /* Skip by reading the blocks of a compressed file */
+
+ if(filebuffer->compressed)
    {
-    skip-=filebuffers[fd]->length-filebuffers[fd]->pointer;
+    while(skip>0)
+      {
+       if(RefillFileBuffer(filebuffer))
+          return(-1);
+
+       if((size_t)skip<=filebuffer->length)
+         {
+          filebuffer->pointer=skip;
 
-    filebuffers[fd]->pointer=0;
-    filebuffers[fd]->length=0;
+          return(0);
+         }
+
+       skip-=filebuffer->length;
+      }
+
+    return(0);
+   }
+
+ /* Skip within the block being read in the background or else the file */
+
+ if(filebuffer->pending)
+   {
+    ssize_t len=FinishFileIO(filebuffer);
+    char *temp=filebuffer->buffer;
 
-    if(lseek(fd,skip,SEEK_CUR)==-1)
+    if(len<0)
        return(-1);
+
+    filebuffer->buffer=filebuffer->spare;
+    filebuffer->spare=temp;
+
+    if(skip<len)
+      {
+       filebuffer->pointer=skip;
+       filebuffer->length=len;
+
+       return(0);
+      }
+
+    skip-=len;
    }
- else
-    filebuffers[fd]->pointer+=skip;
+
+ if(lseek(fd,skip,SEEK_CUR)==-1)
+    return(-1);
 
  return(0);
 }
@@ -647,16 +986,60 @@ int ExistsFile(const char *filename)
 
 int CloseFileBuffered(int fd)
 {
- logassert(fd<nfilebuffers && filebuffers[fd],"File descriptor has no buffer - report a bug");
+ struct filebuffer *filebuffer;
+
+ filebuffer=get_filebuffer(fd);
+
+ logassert(filebuffer,"File descriptor has no buffer - report a bug");
+
+ if(!filebuffer->reading)
+    FlushFileBuffer(filebuffer);
+ else if(filebuffer->pending)
+    FinishFileIO(filebuffer);
+
+#if defined(USE_PTHREADS) && USE_PTHREADS
+
+ if(filebuffer->running)
+   {
+    pthread_mutex_lock(&filebuffer->mutex);
+
+    filebuffer->stop=1;
 
- if(!filebuffers[fd]->reading)
-    write(fd,filebuffers[fd]->buffer,filebuffers[fd]->pointer);
+    pthread_cond_broadcast(&filebuffer->cond);
+
+    pthread_mutex_unlock(&filebuffer->mutex);
+
+    pthread_join(filebuffer->thread,NULL);
+   }
+
+ pthread_mutex_destroy(&filebuffer->mutex);
+ pthread_cond_destroy(&filebuffer->cond);
+
+#endif
+
+ /* Remove the buffer from the list before closing (another thread could then re-use the file descriptor) */
+
+#if defined(USE_PTHREADS) && USE_PTHREADS
+ pthread_mutex_lock(&filebuffers_mutex);
+#endif
+
+ filebuffers[fd/FILEBUFFER_PART][fd%FILEBUFFER_PART]=NULL;
+
+#if defined(USE_PTHREADS) && USE_PTHREADS
+ pthread_mutex_unlock(&filebuffers_mutex);
+#endif
 
  close(fd);
 
- free(filebuffers[fd]);
+ free(filebuffer->buffer);
+
+ if(filebuffer->spare)
+    free(filebuffer->spare);
 
- filebuffers[fd]=NULL;
+ if(filebuffer->zbuffer)
+    free(filebuffer->zbuffer);
+
+ free(filebuffer);
 
  return(-1);
 }
@@ -734,6 +1117,45 @@ int RenameFile(const char *oldfilename,const char *newfilename)
 }
 
 
+/*++++++++++++++++++++++++++++++++++++++
+  Get the amount of data written to and read from compressed temporary files.
+
+  uint64_t *uncompressed Returns the amount of data before compression and after decompression.
+
+  uint64_t *compressed Returns the amount of data written to and read from the disk.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+void CompressedFileStatistics(uint64_t *uncompressed,uint64_t *compressed)
+{
+ *uncompressed=__atomic_load_n(&zstats_uncompressed,__ATOMIC_RELAXED);
+ *compressed=__atomic_load_n(&zstats_compressed,__ATOMIC_RELAXED);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Find the file buffer for a file descriptor (without the lock, the parts of the list are never moved).
+
+  struct filebuffer *get_filebuffer Returns the file buffer or NULL if there is none.
+
+  int fd The file descriptor.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static inline struct filebuffer *get_filebuffer(int fd)
+{
+ struct filebuffer **part;
+
+ if(fd<0 || fd>=FILEBUFFER_PART*FILEBUFFER_PARTS)
+    return(NULL);
+
+ part=__atomic_load_n(&filebuffers[fd/FILEBUFFER_PART],__ATOMIC_ACQUIRE);
+
+ if(!part)
+    return(NULL);
+
+ return(part[fd%FILEBUFFER_PART]);
+}
+
+
 /*++++++++++++++++++++++++++++++++++++++
   Create a file buffer.
 
@@ -744,22 +1166,884 @@ int RenameFile(const char *oldfilename,const char *newfilename)
 
 static void CreateFileBuffer(int fd,int read_write)
 {
- if(nfilebuffers<=fd)
+ struct filebuffer *filebuffer=NULL;
+
+ if(read_write)
    {
-    int i;
+    filebuffer=(struct filebuffer*)calloc(sizeof(struct filebuffer),1);
+
+    logassert(filebuffer,"Failed to allocate memory"); /* Check calloc() worked */
+
+    filebuffer->fd=fd;
+
+    filebuffer->buffer=(char*)malloc(BLOCKLEN);
+
+    logassert(filebuffer->buffer,"Failed to allocate memory"); /* Check malloc() worked */
 
-    filebuffers=(struct filebuffer**)realloc((void*)filebuffers,(fd+1)*sizeof(struct filebuffer*));
+    filebuffer->reading=(read_write==1);
 
-    for(i=nfilebuffers;i<=fd;i++)
-       filebuffers[i]=NULL;
+    filebuffer->readahead=1;
+    filebuffer->readsize=BLOCKLEN;
 
-    nfilebuffers=fd+1;
+#if defined(USE_PTHREADS) && USE_PTHREADS
+    pthread_mutex_init(&filebuffer->mutex,NULL);
+    pthread_cond_init(&filebuffer->cond,NULL);
+#endif
    }
 
- if(read_write)
+#if defined(USE_PTHREADS) && USE_PTHREADS
+ pthread_mutex_lock(&filebuffers_mutex);
+#endif
+
+ /* Choose the method for background I/O the first time */
+
+ if(filebackend==-1)
+   {
+#if defined(USE_IO_URING) && USE_IO_URING
+    if(InitFileUring())
+       filebackend=FILEIO_URING;
+    else
+#endif
+#if defined(USE_PTHREADS) && USE_PTHREADS
+       filebackend=FILEIO_THREAD;
+#else
+       filebackend=FILEIO_SYNC;
+#endif
+   }
+
+ /* Add the part of the list for this file descriptor if needed (published for the lookups without the lock) */
+
+ logassert(fd>=0 && fd<FILEBUFFER_PART*FILEBUFFER_PARTS,"Too many open files for the file buffer list - report a bug");
+
+ if(!filebuffers[fd/FILEBUFFER_PART])
    {
-    filebuffers[fd]=(struct filebuffer*)calloc(sizeof(struct filebuffer),1);
+    struct filebuffer **part=(struct filebuffer**)calloc(FILEBUFFER_PART,sizeof(struct filebuffer*));
 
-    filebuffers[fd]->reading=(read_write==1);
+    logassert(part,"Failed to allocate memory"); /* Check calloc() worked */
+
+    __atomic_store_n(&filebuffers[fd/FILEBUFFER_PART],part,__ATOMIC_RELEASE);
    }
+
+ filebuffers[fd/FILEBUFFER_PART][fd%FILEBUFFER_PART]=filebuffer;
+
+#if defined(USE_PTHREADS) && USE_PTHREADS
+ pthread_mutex_unlock(&filebuffers_mutex);
+#endif
 }
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Refill the buffer of a file being read using the block read in the background (if there is one).
+
+  int RefillFileBuffer Returns 0 if OK or something else at the end of the file or an error.
+
+  struct filebuffer *filebuffer The file buffer.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int RefillFileBuffer(struct filebuffer *filebuffer)
+{
+ ssize_t len;
+
+ if(filebuffer->compressed)
+    return(DecompressFileBlock(filebuffer));
+
+ if(filebuffer->pending)
+   {
+    char *temp=filebuffer->buffer;
+
+    len=FinishFileIO(filebuffer);
+
+    filebuffer->buffer=filebuffer->spare;
+    filebuffer->spare=temp;
+   }
+ else
+    len=DoFileIO(filebuffer->fd,0,filebuffer->buffer,filebuffer->readsize);
+
+ filebuffer->pointer=0;
+ filebuffer->length=0;
+
+ if(len<=0)
+    return(-1);
+
+ filebuffer->length=len;
+
+ /* Start reading the next block if the file is being read sequentially, increasing the size each time */
+
+ if(filebuffer->readahead)
+   {
+    if(filebuffer->readsize<BLOCKLEN)
+       filebuffer->readsize*=2;
+
+    if(!filebuffer->spare)
+      {
+       filebuffer->spare=(char*)malloc(BLOCKLEN);
+
+       logassert(filebuffer->spare,"Failed to allocate memory"); /* Check malloc() worked */
+      }
+
+    StartFileIO(filebuffer,0,filebuffer->spare,filebuffer->readsize);
+   }
+ else
+    filebuffer->readahead=1;
+
+ return(0);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Start writing the full buffer of a file in the background and switch to the spare buffer.
+
+  int WriteFileBlock Returns 0 if OK or something else in case of an error.
+
+  struct filebuffer *filebuffer The file buffer.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int WriteFileBlock(struct filebuffer *filebuffer)
+{
+ char *temp=filebuffer->buffer;
+
+ /* Compress the block while the previous one is written and then write it from the spare buffer */
+
+ if(filebuffer->compressed)
+   {
+    size_t length=CompressFileBlock(filebuffer);
+
+    if(filebuffer->pending)
+       if(FinishFileIO(filebuffer)<0)
+          return(-1);
+
+    temp=filebuffer->zbuffer;
+    filebuffer->zbuffer=filebuffer->spare;
+    filebuffer->spare=temp;
+
+    StartFileIO(filebuffer,1,filebuffer->spare,length);
+
+    filebuffer->pointer=0;
+
+    return(0);
+   }
+
+ if(filebuffer->pending)
+    if(FinishFileIO(filebuffer)<0)
+       return(-1);
+
+ if(!filebuffer->spare)
+   {
+    filebuffer->spare=(char*)malloc(BLOCKLEN);
+
+    logassert(filebuffer->spare,"Failed to allocate memory"); /* Check malloc() worked */
+   }
+
+ filebuffer->buffer=filebuffer->spare;
+ filebuffer->spare=temp;
+
+ StartFileIO(filebuffer,1,filebuffer->spare,filebuffer->pointer);
+
+ filebuffer->pointer=0;
+
+ return(0);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Write all of the buffered data for a file (waiting for any background write to finish).
+
+  int FlushFileBuffer Returns 0 if OK or something else in case of an error.
+
+  struct filebuffer *filebuffer The file buffer.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int FlushFileBuffer(struct filebuffer *filebuffer)
+{
+ int retval=0;
+
+ if(filebuffer->pending)
+    if(FinishFileIO(filebuffer)<0)
+       retval=-1;
+
+ if(filebuffer->pointer)
+   {
+    if(filebuffer->compressed)
+      {
+       size_t length=CompressFileBlock(filebuffer);
+
+       if(DoFileIO(filebuffer->fd,1,filebuffer->zbuffer,length)!=(ssize_t)length)
+          retval=-1;
+      }
+    else
+       if(DoFileIO(filebuffer->fd,1,filebuffer->buffer,filebuffer->pointer)!=(ssize_t)filebuffer->pointer)
+          retval=-1;
+   }
+
+ filebuffer->pointer=0;
+
+ return(retval);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Start reading or writing a block of data in the background (only one at a time for each file).
+
+  struct filebuffer *filebuffer The file buffer.
+
+  int writing A flag set to 1 for writing or 0 for reading.
+
+  char *buffer The data to write or the buffer to read into.
+
+  size_t length The amount of data to write or read.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void StartFileIO(struct filebuffer *filebuffer,int writing,char *buffer,size_t length)
+{
+ filebuffer->pending=1;
+
+ filebuffer->io_write=writing;
+ filebuffer->io_buffer=buffer;
+ filebuffer->io_length=length;
+ filebuffer->io_done=0;
+
+#if defined(USE_IO_URING) && USE_IO_URING
+
+ if(filebackend==FILEIO_URING)
+   {
+    SubmitFileUring(filebuffer);
+    return;
+   }
+
+#endif
+
+#if defined(USE_PTHREADS) && USE_PTHREADS
+
+ if(filebackend==FILEIO_THREAD)
+   {
+    pthread_mutex_lock(&filebuffer->mutex);
+
+    if(!filebuffer->running)
+      {
+       pthread_create(&filebuffer->thread,NULL,(void* (*)(void*))FileIOThread,filebuffer);
+       filebuffer->running=1;
+      }
+
+    filebuffer->queued=1;
+
+    pthread_cond_broadcast(&filebuffer->cond);
+
+    pthread_mutex_unlock(&filebuffer->mutex);
+
+    return;
+   }
+
+#endif
+
+ filebuffer->io_result=DoFileIO(filebuffer->fd,writing,buffer,length);
+ filebuffer->io_done=1;
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Wait for the background read or write of a block of data to finish.
+
+  ssize_t FinishFileIO Returns the amount of data read or written or a negative value for an error.
+
+  struct filebuffer *filebuffer The file buffer.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static ssize_t FinishFileIO(struct filebuffer *filebuffer)
+{
+#if defined(USE_IO_URING) && USE_IO_URING
+
+ if(filebackend==FILEIO_URING)
+    WaitFileUring(filebuffer);
+
+#endif
+
+#if defined(USE_PTHREADS) && USE_PTHREADS
+
+ if(filebackend==FILEIO_THREAD)
+   {
+    pthread_mutex_lock(&filebuffer->mutex);
+
+    while(!filebuffer->io_done)
+       pthread_cond_wait(&filebuffer->cond,&filebuffer->mutex);
+
+    pthread_mutex_unlock(&filebuffer->mutex);
+   }
+
+#endif
+
+ filebuffer->pending=0;
+
+ /* Finish a partial write (or a partial read of a compressed block, which must be complete) */
+
+ if((filebuffer->io_write || filebuffer->compressed) && filebuffer->io_result>=0)
+    while((size_t)filebuffer->io_result<filebuffer->io_length)
+      {
+       ssize_t len=DoFileIO(filebuffer->fd,filebuffer->io_write,filebuffer->io_buffer+filebuffer->io_result,filebuffer->io_length-filebuffer->io_result);
+
+       if(len<0)
+          filebuffer->io_result=len;
+       else
+          filebuffer->io_result+=len;
+
+       if(len<=0)
+          break;
+      }
+
+ return(filebuffer->io_result);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Read or write a block of data immediately.
+
+  ssize_t DoFileIO Returns the amount of data read or written or a negative value for an error.
+
+  int fd The file descriptor.
+
+  int writing A flag set to 1 for writing (all of the data) or 0 for reading (up to the length).
+
+  char *buffer The data to write or the buffer to read into.
+
+  size_t length The amount of data to write or read.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static ssize_t DoFileIO(int fd,int writing,char *buffer,size_t length)
+{
+ size_t done=0;
+
+ while(done<length)
+   {
+    ssize_t len;
+
+    if(writing)
+       len=write(fd,buffer+done,length-done);
+    else
+       len=read(fd,buffer+done,length-done);
+
+    if(len<0 && errno==EINTR)
+       continue;
+
+    if(len<0)
+       return(len);
+
+    if(len==0)
+       break;
+
+    done+=len;
+
+    if(!writing)
+       break;
+   }
+
+ return(done);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Compress the data in the buffer of a file into the compressed block buffer (with the headers).
+
+  size_t CompressFileBlock Returns the amount of data to write.
+
+  struct filebuffer *filebuffer The file buffer.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static size_t CompressFileBlock(struct filebuffer *filebuffer)
+{
+ unsigned char *header=(unsigned char*)filebuffer->zbuffer;
+ size_t zlength,ulength=filebuffer->pointer,length;
+
+ /* The marker is written before the first block so that an empty file stays empty */
+
+ if(!filebuffer->zmagic)
+   {
+    memcpy(header,ZMAGIC,8);
+    header+=8;
+
+    filebuffer->zmagic=1;
+   }
+
+ zlength=CompressBlock(filebuffer->buffer,ulength,(char*)header+8);
+
+ /* Store the block uncompressed if it doesn't get any smaller */
+
+ if(zlength>=ulength)
+   {
+    memcpy(header+8,filebuffer->buffer,ulength);
+    zlength=ulength;
+   }
+
+ header[0]=zlength&0xff; header[1]=(zlength>>8)&0xff; header[2]=(zlength>>16)&0xff; header[3]=(zlength>>24)&0xff;
+ header[4]=ulength&0xff; header[5]=(ulength>>8)&0xff; header[6]=(ulength>>16)&0xff; header[7]=(ulength>>24)&0xff;
+
+ length=(char*)header+8+zlength-filebuffer->zbuffer;
+
+ __atomic_add_fetch(&zstats_uncompressed,ulength,__ATOMIC_RELAXED);
+ __atomic_add_fetch(&zstats_compressed,length,__ATOMIC_RELAXED);
+
+ return(length);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Refill the buffer of a compressed file being read by decompressing the block read in the
+  background (the block is read with the header of the next block which is then started).
+
+  int DecompressFileBlock Returns 0 if OK or something else at the end of the file or an error.
+
+  struct filebuffer *filebuffer The file buffer.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int DecompressFileBlock(struct filebuffer *filebuffer)
+{
+ size_t zlength=filebuffer->zlength,ulength=filebuffer->ulength;
+ unsigned char *header;
+ ssize_t len;
+ char *temp;
+
+ filebuffer->pointer=0;
+ filebuffer->length=0;
+
+ if(!filebuffer->pending)
+    return(-1);
+
+ len=FinishFileIO(filebuffer);
+
+ temp=filebuffer->zbuffer;
+ filebuffer->zbuffer=filebuffer->spare;
+ filebuffer->spare=temp;
+
+ if(len<0)
+    return(-1);
+
+ logassert((size_t)len>=zlength,"Compressed file is truncated - report a bug");
+
+ if(zlength==ulength)
+    memcpy(filebuffer->buffer,filebuffer->zbuffer,ulength);
+ else
+    logassert(!DecompressBlock(filebuffer->zbuffer,zlength,filebuffer->buffer,ulength),"Compressed file is corrupt - report a bug");
+
+ filebuffer->length=ulength;
+
+ __atomic_add_fetch(&zstats_uncompressed,ulength,__ATOMIC_RELAXED);
+ __atomic_add_fetch(&zstats_compressed,len,__ATOMIC_RELAXED);
+
+ /* Start reading the next block if there is one */
+
+ if((size_t)len<zlength+8)
+   {
+    filebuffer->zlength=0;
+    filebuffer->ulength=0;
+
+    return(0);
+   }
+
+ header=(unsigned char*)filebuffer->zbuffer+zlength;
+
+ filebuffer->zlength=(uint32_t)(header[0]|(header[1]<<8)|(header[2]<<16)|((uint32_t)header[3]<<24));
+ filebuffer->ulength=(uint32_t)(header[4]|(header[5]<<8)|(header[6]<<16)|((uint32_t)header[7]<<24));
+
+ logassert(filebuffer->ulength<=BLOCKLEN && filebuffer->zlength<=filebuffer->ulength,"Compressed file is corrupt - report a bug");
+
+ StartFileIO(filebuffer,0,filebuffer->spare,filebuffer->zlength+8);
+
+ return(0);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Compress a block of data using a fast LZ77 method (in the style of LZ4).
+
+  size_t CompressBlock Returns the length of the compressed data.
+
+  const char *in The data to compress.
+
+  size_t length The length of the data to compress.
+
+  char *out The buffer for the compressed data (at least length+length/255+16 bytes).
+
+  The data is a sequence of tokens, each one contains the number of literal bytes (high 4 bits)
+  and the length of the match minus 4 (low 4 bits) with a value of 15 meaning that more bytes
+  follow (each one added until one is not 255).  The literal bytes follow and then a two byte
+  offset back to the match.  The final token has only literal bytes.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static size_t CompressBlock(const char *in,size_t length,char *out)
+{
+ const unsigned char *start=(const unsigned char*)in,*end=start+length;
+ const unsigned char *ip=start,*anchor=start;
+ unsigned char *op=(unsigned char*)out;
+ uint32_t table[1<<ZHASHBITS];
+ size_t literals;
+
+ memset(table,0,sizeof(table));
+
+ if(length>=16)
+   {
+    const unsigned char *limit=end-5; /* The last bytes are always literals */
+
+    while(ip+4<=limit)
+      {
+       uint32_t sequence,hash,candidate,position=(uint32_t)(ip-start)+1;
+
+       memcpy(&sequence,ip,4);
+
+       hash=(sequence*2654435761U)>>(32-ZHASHBITS);
+
+       candidate=table[hash];
+       table[hash]=position;
+
+       if(candidate && (position-candidate)<=65535 && !memcmp(start+candidate-1,ip,4))
+         {
+          const unsigned char *ref=start+candidate-1;
+          size_t match=4,offset=ip-ref;
+          unsigned char *token=op++;
+
+          while(ip+match<limit && ref[match]==ip[match])
+             match++;
+
+          literals=ip-anchor;
+
+          *token=((literals>=15?15:literals)<<4)|(match-4>=15?15:match-4);
+
+          if(literals>=15)
+            {
+             size_t n=literals-15;
+
+             for(;n>=255;n-=255)
+                *op++=255;
+
+             *op++=n;
+            }
+
+          memcpy(op,anchor,literals);
+          op+=literals;
+
+          *op++=offset&0xff;
+          *op++=offset>>8;
+
+          if(match-4>=15)
+            {
+             size_t n=match-4-15;
+
+             for(;n>=255;n-=255)
+                *op++=255;
+
+             *op++=n;
+            }
+
+          ip+=match;
+          anchor=ip;
+         }
+       else
+          ip+=1+((ip-anchor)>>6); /* Move faster through data that doesn't compress */
+      }
+   }
+
+ /* The final literals */
+
+ literals=end-anchor;
+
+ *op++=(literals>=15?15:literals)<<4;
+
+ if(literals>=15)
+   {
+    size_t n=literals-15;
+
+    for(;n>=255;n-=255)
+       *op++=255;
+
+    *op++=n;
+   }
+
+ memcpy(op,anchor,literals);
+ op+=literals;
+
+ return(op-(unsigned char*)out);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Decompress a block of data compressed by CompressBlock().
+
+  int DecompressBlock Returns 0 if OK or something else if the data is corrupt.
+
+  const char *in The compressed data.
+
+  size_t length The length of the compressed data.
+
+  char *out The buffer for the decompressed data.
+
+  size_t outlength The length of the decompressed data.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int DecompressBlock(const char *in,size_t length,char *out,size_t outlength)
+{
+ const unsigned char *ip=(const unsigned char*)in,*iend=ip+length;
+ unsigned char *op=(unsigned char*)out,*oend=op+outlength;
+
+ while(ip<iend)
+   {
+    unsigned char token=*ip++;
+    size_t literals=token>>4,match=token&15,offset;
+
+    if(literals==15)
+      {
+       unsigned char n;
+
+       do
+         {
+          if(ip>=iend)
+             return(1);
+
+          n=*ip++;
+          literals+=n;
+         }
+       while(n==255);
+      }
+
+    if(literals>(size_t)(iend-ip) || literals>(size_t)(oend-op))
+       return(1);
+
+    memcpy(op,ip,literals);
+    op+=literals;
+    ip+=literals;
+
+    if(ip==iend)
+       break;
+
+    if(iend-ip<2)
+       return(1);
+
+    offset=ip[0]|(ip[1]<<8);
+    ip+=2;
+
+    if(match==15)
+      {
+       unsigned char n;
+
+       do
+         {
+          if(ip>=iend)
+             return(1);
+
+          n=*ip++;
+          match+=n;
+         }
+       while(n==255);
+      }
+
+    match+=4;
+
+    if(offset==0 || offset>(size_t)(op-(unsigned char*)out) || match>(size_t)(oend-op))
+       return(1);
+
+    if(offset>=match)
+       memcpy(op,op-offset,match);
+    else
+      {
+       const unsigned char *ref=op-offset;
+       size_t i;
+
+       for(i=0;i<match;i++)
+          op[i]=ref[i];
+      }
+
+    op+=match;
+   }
+
+ return(op!=oend);
+}
+
+
+#if defined(USE_PTHREADS) && USE_PTHREADS
+
+/*++++++++++++++++++++++++++++++++++++++
+  The thread that reads or writes the blocks of data for one file in the background.
+
+  void *FileIOThread Returns NULL (required to return void*).
+
+  struct filebuffer *filebuffer The file buffer.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void *FileIOThread(struct filebuffer *filebuffer)
+{
+ pthread_mutex_lock(&filebuffer->mutex);
+
+ while(1)
+   {
+    ssize_t len;
+
+    while(!filebuffer->queued && !filebuffer->stop)
+       pthread_cond_wait(&filebuffer->cond,&filebuffer->mutex);
+
+    if(!filebuffer->queued)
+       break;
+
+    pthread_mutex_unlock(&filebuffer->mutex);
+
+    len=DoFileIO(filebuffer->fd,filebuffer->io_write,filebuffer->io_buffer,filebuffer->io_length);
+
+    pthread_mutex_lock(&filebuffer->mutex);
+
+    filebuffer->io_result=len;
+    filebuffer->io_done=1;
+    filebuffer->queued=0;
+
+    pthread_cond_broadcast(&filebuffer->cond);
+   }
+
+ pthread_mutex_unlock(&filebuffer->mutex);
+
+ return(NULL);
+}
+
+#endif
+
+
+#if defined(USE_IO_URING) && USE_IO_URING
+
+/*++++++++++++++++++++++++++++++++++++++
+  Create the io_uring and map its queues into memory.
+
+  int InitFileUring Returns 1 if the io_uring can be used or 0 if not.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int InitFileUring(void)
+{
+ struct io_uring_params params;
+ void *sq,*cq,*sqes;
+
+ memset(&params,0,sizeof(params));
+
+ uring.fd=syscall(__NR_io_uring_setup,URING_ENTRIES,&params);
+
+ if(uring.fd<0)
+    return(0);
+
+ /* Reading and writing at the current file position is required */
+
+ if(!(params.features&IORING_FEAT_RW_CUR_POS))
+   {
+    close(uring.fd);
+    return(0);
+   }
+
+ sq=mmap(NULL,params.sq_off.array+params.sq_entries*sizeof(unsigned),PROT_READ|PROT_WRITE,MAP_SHARED,uring.fd,IORING_OFF_SQ_RING);
+ cq=mmap(NULL,params.cq_off.cqes+params.cq_entries*sizeof(struct io_uring_cqe),PROT_READ|PROT_WRITE,MAP_SHARED,uring.fd,IORING_OFF_CQ_RING);
+ sqes=mmap(NULL,params.sq_entries*sizeof(struct io_uring_sqe),PROT_READ|PROT_WRITE,MAP_SHARED,uring.fd,IORING_OFF_SQES);
+
+ if(sq==MAP_FAILED || cq==MAP_FAILED || sqes==MAP_FAILED)
+   {
+    close(uring.fd);
+    return(0);
+   }
+
+ uring.sq_tail =(unsigned*)(sq+params.sq_off.tail);
+ uring.sq_mask =(unsigned*)(sq+params.sq_off.ring_mask);
+ uring.sq_array=(unsigned*)(sq+params.sq_off.array);
+ uring.sqes    =(struct io_uring_sqe*)sqes;
+
+ uring.cq_head=(unsigned*)(cq+params.cq_off.head);
+ uring.cq_tail=(unsigned*)(cq+params.cq_off.tail);
+ uring.cq_mask=(unsigned*)(cq+params.cq_off.ring_mask);
+ uring.cqes   =(struct io_uring_cqe*)(cq+params.cq_off.cqes);
+
+ return(1);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Submit the background read or write of a block of data to the io_uring.
+
+  struct filebuffer *filebuffer The file buffer.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void SubmitFileUring(struct filebuffer *filebuffer)
+{
+ struct io_uring_sqe *sqe;
+ unsigned tail,index;
+
+#if defined(USE_PTHREADS) && USE_PTHREADS
+ pthread_mutex_lock(&filebuffers_mutex);
+#endif
+
+ tail=*uring.sq_tail;
+ index=tail&*uring.sq_mask;
+
+ sqe=&uring.sqes[index];
+
+ memset(sqe,0,sizeof(struct io_uring_sqe));
+
+ sqe->opcode=filebuffer->io_write?IORING_OP_WRITE:IORING_OP_READ;
+ sqe->fd=filebuffer->fd;
+ sqe->off=(uint64_t)-1;         /* The current file position */
+ sqe->addr=(uint64_t)(uintptr_t)filebuffer->io_buffer;
+ sqe->len=filebuffer->io_length;
+ sqe->user_data=(uint64_t)(uintptr_t)filebuffer;
+
+ uring.sq_array[index]=index;
+
+ __atomic_store_n(uring.sq_tail,tail+1,__ATOMIC_RELEASE);
+
+ while(syscall(__NR_io_uring_enter,uring.fd,1,0,0,NULL,0)<0)
+    if(errno!=EINTR)
+      {
+       fprintf(stderr,"Cannot submit file I/O to io_uring [%s].\n",strerror(errno));
+       exit(EXIT_FAILURE);
+      }
+
+#if defined(USE_PTHREADS) && USE_PTHREADS
+ pthread_mutex_unlock(&filebuffers_mutex);
+#endif
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Wait for the background read or write of a block of data by the io_uring to finish
+  (storing the results of any other operations that finish first).
+
+  struct filebuffer *filebuffer The file buffer.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void WaitFileUring(struct filebuffer *filebuffer)
+{
+#if defined(USE_PTHREADS) && USE_PTHREADS
+ pthread_mutex_lock(&filebuffers_mutex);
+#endif
+
+ while(!filebuffer->io_done)
+   {
+    unsigned head=*uring.cq_head;
+    unsigned tail=__atomic_load_n(uring.cq_tail,__ATOMIC_ACQUIRE);
+
+    if(head==tail)
+      {
+       if(syscall(__NR_io_uring_enter,uring.fd,0,1,IORING_ENTER_GETEVENTS,NULL,0)<0 && errno!=EINTR)
+         {
+          fprintf(stderr,"Cannot wait for file I/O from io_uring [%s].\n",strerror(errno));
+          exit(EXIT_FAILURE);
+         }
+
+       continue;
+      }
+
+    while(head!=tail)
+      {
+       struct io_uring_cqe *cqe=&uring.cqes[head&*uring.cq_mask];
+       struct filebuffer *done=(struct filebuffer*)(uintptr_t)cqe->user_data;
+
+       done->io_result=cqe->res;
+       done->io_done=1;
+
+       head++;
+      }
+
+    __atomic_store_n(uring.cq_head,head,__ATOMIC_RELEASE);
+   }
+
+#if defined(USE_PTHREADS) && USE_PTHREADS
+ pthread_mutex_unlock(&filebuffers_mutex);
+#endif
+}
+
+#endif
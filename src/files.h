@@ -30,11 +30,17 @@
 
 
 #include <unistd.h>
+#include <stdint.h>
 #include <sys/types.h>
 
 #include "logging.h"
 
 
+/* Variables */
+
+extern int option_tmpcompress;
+
+
 /* Functions in files.c */
 
 char *FileName(const char *dirname,const char *prefix, const char *name);
@@ -50,12 +56,14 @@ int SlimMapFileWriteable(const char *filename);
 int SlimUnmapFile(int fd);
 
 int OpenFileBufferedNew(const char *filename);
+int OpenFileBufferedNewTemporary(const char *filename);
 int OpenFileBufferedAppend(const char *filename);
 
 int ReOpenFileBuffered(const char *filename);
 
 int WriteFileBuffered(int fd,const void *address,size_t length);
 int ReadFileBuffered(int fd,void *address,size_t length);
+size_t ReadFileBufferedPartial(int fd,void *address,size_t length);
 
 int SeekFileBuffered(int fd,off_t position);
 int SkipFileBuffered(int fd,off_t skip);
@@ -73,6 +81,8 @@ int DeleteFile(const char *filename);
 
 int RenameFile(const char *oldfilename,const char *newfilename);
 
+void CompressedFileStatistics(uint64_t *uncompressed,uint64_t *compressed);
+
 /* Functions in files.h */
 
 static inline int SlimReplace(int fd,const void *address,size_t length,off_t position);
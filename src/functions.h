@@ -27,28 +27,33 @@
 
 #include "profiles.h"
 #include "results.h"
+#include "landmarks.h"
 
 
 /* Functions in optimiser.c */
 
-Results *FindNormalRoute(Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,index_t start_node,index_t prev_segment,index_t finish_node);
+Results *FindNormalRoute(Query *query,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,index_t start_node,index_t prev_segment,index_t finish_node);
 
-Results *FindMiddleRoute(Nodes *supernodes,Segments *supersegments,Ways *superways,Relations *relations,Profile *profile,Results *begin,Results *end);
+Results *FindMiddleRoute(Query *query,Nodes *supernodes,Segments *supersegments,Ways *superways,Relations *relations,Profile *profile,Landmarks *landmarks,Results *begin,Results *end);
 
-Results *FindStartRoutes(Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,index_t start_node,index_t prev_segment,index_t finish_node);
+Results *FindMiddleRouteBidirectional(Query *query,Nodes *supernodes,Segments *supersegments,Ways *superways,Relations *relations,Profile *profile,Results *begin,Results *end);
 
-Results *ExtendStartRoutes(Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,Results *begin,index_t finish_node);
+Results *FindStartRoutes(Query *query,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,index_t start_node,index_t prev_segment,index_t finish_node);
 
-Results *FindFinishRoutes(Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,index_t finish_node);
+Results *ExtendStartRoutes(Query *query,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,Results *begin,index_t finish_node);
 
-Results *CombineRoutes(Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,Results *begin,Results *middle);
+Results *FindFinishRoutes(Query *query,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,index_t finish_node);
+
+Results *CombineRoutes(Query *query,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,Results *begin,Results *middle);
+
+index_t FindSuperSegment(Query *query,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,index_t finish_node,index_t finish_segment);
 
 void FixForwardRoute(Results *results,Result *finish_result);
 
 
 /* Functions in output.c */
 
-void PrintRoute(Results **results,int nresults,Nodes *nodes,Segments *segments,Ways *ways,Profile *profile);
+void PrintRoute(Query *query,Results **results,int nresults,Nodes *nodes,Segments *segments,Ways *ways,Profile *profile);
 
 
 #endif /* FUNCTIONS_H */
@@ -0,0 +1,802 @@
+/***************************************
+ Isochrone (reachability within a distance or duration budget) search.
+
+ Part of the Routino routing software.
+ ******************/ /******************
+ This file Copyright 2008-2013 Andrew M. Bishop
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************/
+
+
+#include <stdlib.h>
+#include <math.h>
+
+#include "types.h"
+#include "nodes.h"
+#include "segments.h"
+#include "ways.h"
+#include "relations.h"
+
+#include "functions.h"
+#include "fakes.h"
+#include "query.h"
+#include "results.h"
+#include "isochrone.h"
+
+
+/* Local functions */
+
+static void IsochroneNormal(Query *query,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,
+                            Results *results,Queue *queue,score_t budget,int force_uturn);
+static Results *IsochroneSuper(Query *query,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,
+                               Results *begin,score_t budget);
+static score_t SuperSegmentDuration(Query *query,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,
+                                    Results *durations,index_t node,Segment *segmentp,Way *wayp);
+
+static int sort_by_node_and_score(IsochroneNode *a,IsochroneNode *b);
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Find all of the nodes that can be reached from a start node within a distance or duration budget.
+
+  Results *FindIsochrone Returns the set of results, one for each node and segment combination that was reached.
+
+  Query *query The query containing the routing options and the fake nodes and segments.
+
+  Nodes *nodes The set of nodes to use.
+
+  Segments *segments The set of segments to use.
+
+  Ways *ways The set of ways to use.
+
+  Relations *relations The set of relations to use.
+
+  Profile *profile The profile containing the transport type, speeds and allowed highways.
+
+  index_t start_node The start node.
+
+  index_t prev_segment The previous segment before the start node.
+
+  score_t budget The maximum distance (if query->quickest is 0) or duration (otherwise) to search.
+
+  The scores are the actual distances or durations (including the elevation penalties) and are not weighted by the
+  highway and property preferences which are only used to exclude highways.  The search uses the normal segments
+  from the start node until the first super-nodes, the super-segments between the super-nodes until the budget is
+  reached and finally the normal segments from each of the super-nodes to fill in the nodes between them and the
+  boundary.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+Results *FindIsochrone(Query *query,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,index_t start_node,index_t prev_segment,score_t budget)
+{
+ Results *results,*super;
+ Queue   *queue;
+ Result  *result1,*result2,*result3;
+ int     force_uturn=0;
+
+#if DEBUG
+ printf("  FindIsochrone(...,start_node=%"Pindex_t" prev_segment=%"Pindex_t" budget=%f)\n",start_node,prev_segment,budget);
+#endif
+
+ /* Create the list of results and insert the first node into the queue */
+
+ results=NewResultsList(8);
+ queue=NewQueueList(8);
+
+ results->start_node=start_node;
+ results->prev_segment=prev_segment;
+
+ result1=InsertResult(results,results->start_node,results->prev_segment);
+
+ InsertInQueue(queue,result1,0);
+
+ /* Check for barrier at start waypoint - must perform U-turn */
+
+ if(prev_segment!=NO_SEGMENT && !IsFakeNode(start_node))
+   {
+    Node *startp=LookupNode(nodes,start_node,1);
+
+    if(!(startp->allow&profile->allow))
+       force_uturn=1;
+   }
+
+ /* Search the normal segments as far as the first super-nodes */
+
+ IsochroneNormal(query,nodes,segments,ways,relations,profile,results,queue,budget,force_uturn);
+
+ /* Search the super-segments between the super-nodes */
+
+ super=IsochroneSuper(query,nodes,segments,ways,relations,profile,results,budget);
+
+ /* Search the normal segments from all of the super-nodes that were reached */
+
+ if(super->number>0)
+    result3=FirstResult(super);
+ else
+    result3=NULL;
+
+ while(result3)
+   {
+    result2=FindResult(results,result3->node,result3->segment);
+
+    if(!result2)
+      {
+       result2=InsertResult(results,result3->node,result3->segment);
+
+       result2->score=result3->score;
+      }
+
+    if(result3->score<=result2->score)
+      {
+       result2->score=result3->score;
+
+       InsertInQueue(queue,result2,result2->score);
+      }
+
+    result3=NextResult(super,result3);
+   }
+
+ FreeResultsList(super);
+
+ IsochroneNormal(query,nodes,segments,ways,relations,profile,results,queue,budget,0);
+
+ FreeQueueList(queue);
+
+#if DEBUG
+ printf("    Found %d results\n",results->number);
+#endif
+
+ return(results);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Search along the normal segments from the nodes in the queue without going beyond the budget or through any
+  super-nodes (apart from the ones that are already in the queue).
+
+  Query *query The query containing the routing options and the fake nodes and segments.
+
+  Nodes *nodes The set of nodes to use.
+
+  Segments *segments The set of segments to use.
+
+  Ways *ways The set of ways to use.
+
+  Relations *relations The set of relations to use.
+
+  Profile *profile The profile containing the transport type, speeds and allowed highways.
+
+  Results *results The set of results to update.
+
+  Queue *queue The queue of results to search from.
+
+  score_t budget The maximum distance or duration to search.
+
+  int force_uturn Set if a U-turn must be performed at the start node.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void IsochroneNormal(Query *query,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,
+                            Results *results,Queue *queue,score_t budget,int force_uturn)
+{
+ Result *result1,*result2;
+
+ /* Loop across all nodes in the queue */
+
+ while((result1=PopFromQueue(queue)))
+   {
+    Node *node1p=NULL;
+    Segment *segmentp;
+    index_t node1,seg1,seg1r;
+    index_t turnrelation=NO_RELATION;
+
+    node1=result1->node;
+    seg1=result1->segment;
+
+    if(IsFakeSegment(seg1))
+       seg1r=IndexRealSegment(query,seg1);
+    else
+       seg1r=seg1;
+
+    if(!IsFakeNode(node1))
+       node1p=LookupNode(nodes,node1,1);
+
+    /* lookup if a turn restriction applies */
+    if(profile->turns && node1p && IsTurnRestrictedNode(node1p))
+       turnrelation=FindFirstTurnRelation2(relations,node1,seg1r);
+
+    /* Loop across all segments */
+
+    if(IsFakeNode(node1))
+       segmentp=FirstFakeSegment(query,node1);
+    else
+       segmentp=FirstSegment(segments,node1p,1);
+
+    while(segmentp)
+      {
+       Node *node2p=NULL;
+       Way *wayp;
+       index_t node2,seg2,seg2r;
+       score_t segment_pref,cumulative_score;
+       int i;
+       speed_t speedresult=0;
+
+       node2=OtherNode(segmentp,node1); /* need this here because we use node2 at the end of the loop */
+
+       /* must be a normal segment */
+       if(!IsNormalSegment(segmentp))
+          goto endloop;
+
+       /* must obey one-way restrictions (unless profile allows) */
+       if(profile->oneway && IsOnewayTo(segmentp,node1))
+         {
+          if(profile->allow!=Transports_Bicycle)
+             goto endloop;
+
+          wayp=LookupWay(ways,segmentp->way,1);
+
+          if(!(wayp->props & Properties_DoubleSens))
+             goto endloop;
+         }
+
+       if(IsFakeNode(node1) || IsFakeNode(node2))
+         {
+          seg2 =IndexFakeSegment(query,segmentp);
+          seg2r=IndexRealSegment(query,seg2);
+         }
+       else
+         {
+          seg2 =IndexSegment(segments,segmentp);
+          seg2r=seg2;
+         }
+
+       /* must perform U-turn in special cases */
+       if(node1==results->start_node && force_uturn)
+         {
+          if(seg2r!=result1->segment)
+             goto endloop;
+         }
+       else
+          /* must not perform U-turn (unless profile allows) */
+          if(profile->turns && (seg1==seg2 || seg1==seg2r || seg1r==seg2 || (seg1r==seg2r && IsFakeUTurn(query,seg1,seg2))))
+             goto endloop;
+
+       /* must obey turn relations */
+       if(turnrelation!=NO_RELATION && !IsTurnAllowed(relations,turnrelation,node1,seg1r,seg2r,profile->allow))
+          goto endloop;
+
+       wayp=LookupWay(ways,segmentp->way,1);
+
+       /* mode of transport must be allowed on the highway */
+       if(!(wayp->allow&profile->allow))
+          goto endloop;
+
+       /* must obey weight restriction (if exists) */
+       if(wayp->weight && wayp->weight<profile->weight)
+          goto endloop;
+
+       /* must obey height/width/length restriction (if exists) */
+       if((wayp->height && wayp->height<profile->height) ||
+          (wayp->width  && wayp->width <profile->width ) ||
+          (wayp->length && wayp->length<profile->length))
+          goto endloop;
+
+       segment_pref=profile->highway[HIGHWAY(wayp->type)];
+
+       /* highway preferences must allow this highway */
+       if(segment_pref==0)
+          goto endloop;
+
+       for(i=1;i<Property_Count;i++)
+          if(ways->file.props & PROPERTIES(i))
+            {
+             if(wayp->props & PROPERTIES(i))
+                segment_pref*=profile->props_yes[i];
+             else
+                segment_pref*=profile->props_no[i];
+            }
+
+       /* profile preferences must allow this highway */
+       if(segment_pref==0)
+          goto endloop;
+
+       if(!IsFakeNode(node2))
+          node2p=LookupNode(nodes,node2,2);
+
+       /* mode of transport must be allowed through node2 */
+       if(node2p && !(node2p->allow&profile->allow))
+          goto endloop;
+
+       if(query->quickest==0)
+          cumulative_score=result1->score+(score_t)DISTANCE(segmentp->distance);
+       else
+          cumulative_score=result1->score+(score_t)Duration(node1,segmentp,wayp,profile,&speedresult);
+
+       /* score must be within the budget */
+       if(cumulative_score>budget)
+          goto endloop;
+
+       result2=FindResult(results,node2,seg2);
+
+       if(!result2) /* New end node/segment combination */
+         {
+          result2=InsertResult(results,node2,seg2);
+          result2->prev=result1;
+          result2->score=cumulative_score;
+         }
+       else if(cumulative_score<result2->score) /* New score for end node/segment combination is better */
+         {
+          result2->prev=result1;
+          result2->score=cumulative_score;
+         }
+       else
+          goto endloop;
+
+       if(node2p && !IsSuperNode(node2p))
+          InsertInQueue(queue,result2,result2->score);
+
+      endloop:
+
+       if(IsFakeNode(node1))
+          segmentp=NextFakeSegment(query,segmentp,node1);
+       else if(IsFakeNode(node2))
+          segmentp=NULL; /* cannot call NextSegment() with a fake segment */
+       else
+          segmentp=NextSegment(segments,segmentp,node1);
+      }
+   }
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Search along the super-segments from the super-nodes that were reached from the start node without going beyond
+  the budget.
+
+  Results *IsochroneSuper Returns the set of results for the super-nodes.
+
+  Query *query The query containing the routing options and the fake nodes and segments.
+
+  Nodes *nodes The set of nodes to use.
+
+  Segments *segments The set of segments to use.
+
+  Ways *ways The set of ways to use.
+
+  Relations *relations The set of relations to use.
+
+  Profile *profile The profile containing the transport type, speeds and allowed highways.
+
+  Results *begin The results of the search from the start node to the first super-nodes.
+
+  score_t budget The maximum distance or duration to search.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static Results *IsochroneSuper(Query *query,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,
+                               Results *begin,score_t budget)
+{
+ Results *results,*durations;
+ Queue   *queue;
+ Result  *result1,*result2,*result3;
+
+ /* Create the list of results and insert the super-nodes into the queue,
+    translating the segments into super-segments. */
+
+ results=NewResultsList(20);
+ queue=NewQueueList(12);
+
+ durations=NewResultsList(12);
+
+ results->start_node=begin->start_node;
+ results->prev_segment=begin->prev_segment;
+
+ result3=FirstResult(begin);
+
+ while(result3)
+   {
+    if((begin->start_node!=result3->node || begin->prev_segment!=result3->segment) &&
+       !IsFakeNode(result3->node) && IsSuperNode(LookupNode(nodes,result3->node,5)))
+      {
+       index_t superseg=FindSuperSegment(query,nodes,segments,ways,relations,result3->node,result3->segment);
+
+       result2=FindResult(results,result3->node,superseg);
+
+       if(!result2)
+         {
+          result2=InsertResult(results,result3->node,superseg);
+
+          result2->score=result3->score;
+
+          InsertInQueue(queue,result2,result2->score);
+         }
+       else if(result3->score<result2->score)
+         {
+          result2->score=result3->score;
+
+          InsertInQueue(queue,result2,result2->score);
+         }
+      }
+
+    result3=NextResult(begin,result3);
+   }
+
+ /* Loop across all nodes in the queue */
+
+ while((result1=PopFromQueue(queue)))
+   {
+    Node *node1p;
+    Segment *segmentp;
+    index_t node1,seg1;
+    index_t turnrelation=NO_RELATION;
+
+    node1=result1->node;
+    seg1=result1->segment;
+
+    node1p=LookupNode(nodes,node1,1); /* node1 cannot be a fake node (must be a super-node) */
+
+    /* lookup if a turn restriction applies */
+    if(profile->turns && IsTurnRestrictedNode(node1p)) /* node1 cannot be a fake node (must be a super-node) */
+       turnrelation=FindFirstTurnRelation2(relations,node1,seg1);
+
+    /* Loop across all segments */
+
+    segmentp=FirstSegment(segments,node1p,1); /* node1 cannot be a fake node (must be a super-node) */
+
+    while(segmentp)
+      {
+       Node *node2p;
+       Way *wayp;
+       index_t node2,seg2;
+       score_t segment_pref,cumulative_score;
+       int i;
+
+       /* must be a super segment */
+       if(!IsSuperSegment(segmentp))
+          goto endloop;
+
+       /* must obey one-way restrictions (unless profile allows) */
+       if(profile->oneway && IsOnewayTo(segmentp,node1))
+         {
+          if(profile->allow!=Transports_Bicycle)
+             goto endloop;
+
+          wayp=LookupWay(ways,segmentp->way,1);
+
+          if(!(wayp->props & Properties_DoubleSens))
+             goto endloop;
+         }
+
+       seg2=IndexSegment(segments,segmentp); /* segment cannot be a fake segment (must be a super-segment) */
+
+       /* must not perform U-turn */
+       if(seg1==seg2) /* No fake segments, applies to all profiles */
+          goto endloop;
+
+       /* must obey turn relations */
+       if(turnrelation!=NO_RELATION && !IsTurnAllowed(relations,turnrelation,node1,seg1,seg2,profile->allow))
+          goto endloop;
+
+       wayp=LookupWay(ways,segmentp->way,1);
+
+       /* mode of transport must be allowed on the highway */
+       if(!(wayp->allow&profile->allow))
+          goto endloop;
+
+       /* must obey weight restriction (if exists) */
+       if(wayp->weight && wayp->weight<profile->weight)
+          goto endloop;
+
+       /* must obey height/width/length restriction (if exist) */
+       if((wayp->height && wayp->height<profile->height) ||
+          (wayp->width  && wayp->width <profile->width ) ||
+          (wayp->length && wayp->length<profile->length))
+          goto endloop;
+
+       segment_pref=profile->highway[HIGHWAY(wayp->type)];
+
+       /* highway preferences must allow this highway */
+       if(segment_pref==0)
+          goto endloop;
+
+       for(i=1;i<Property_Count;i++)
+          if(ways->file.props & PROPERTIES(i))
+            {
+             if(wayp->props & PROPERTIES(i))
+                segment_pref*=profile->props_yes[i];
+             else
+                segment_pref*=profile->props_no[i];
+            }
+
+       /* profile preferences must allow this highway */
+       if(segment_pref==0)
+          goto endloop;
+
+       node2=OtherNode(segmentp,node1);
+
+       node2p=LookupNode(nodes,node2,2); /* node2 cannot be a fake node (must be a super-node) */
+
+       /* mode of transport must be allowed through node2 */
+       if(!(node2p->allow&profile->allow))
+          goto endloop;
+
+       if(query->quickest==0)
+          cumulative_score=result1->score+(score_t)DISTANCE(segmentp->distance);
+       else
+         {
+          cumulative_score=result1->score+SuperSegmentDuration(query,nodes,segments,ways,relations,profile,durations,node1,segmentp,wayp);
+
+          segmentp=LookupSegment(segments,seg2,1); /* the slim version caches segments so it may have been replaced */
+         }
+
+       /* score must be within the budget */
+       if(cumulative_score>budget)
+          goto endloop;
+
+       result2=FindResult(results,node2,seg2);
+
+       if(!result2) /* New end node/segment pair */
+         {
+          result2=InsertResult(results,node2,seg2);
+          result2->prev=result1;
+          result2->score=cumulative_score;
+         }
+       else if(cumulative_score<result2->score) /* New end node/segment pair is better */
+         {
+          result2->prev=result1;
+          result2->score=cumulative_score;
+         }
+       else
+          goto endloop;
+
+       InsertInQueue(queue,result2,result2->score);
+
+      endloop:
+
+       segmentp=NextSegment(segments,segmentp,node1); /* node1 cannot be a fake node (must be a super-node) */
+      }
+   }
+
+ FreeQueueList(queue);
+
+ FreeResultsList(durations);
+
+ return(results);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Find the duration along a super-segment by adding up the normal segments between its super-nodes (the gradients
+  stored in a super-segment are the largest ones along it so it cannot be used directly).
+
+  score_t SuperSegmentDuration Returns the duration.
+
+  Query *query The query containing the routing options and the fake nodes and segments.
+
+  Nodes *nodes The set of nodes to use.
+
+  Segments *segments The set of segments to use.
+
+  Ways *ways The set of ways to use.
+
+  Relations *relations The set of relations to use.
+
+  Profile *profile The profile containing the transport type, speeds and allowed highways.
+
+  Results *durations The durations that have already been found for each super-node and super-segment pair.
+
+  index_t node The super-node that the super-segment is followed from.
+
+  Segment *segmentp The super-segment.
+
+  Way *wayp The way that the super-segment belongs to.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static score_t SuperSegmentDuration(Query *query,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,
+                                    Results *durations,index_t node,Segment *segmentp,Way *wayp)
+{
+ Results *route;
+ Result *result;
+ index_t segment;
+ speed_t speedresult=0;
+
+ if(IsNormalSegment(segmentp))
+    return((score_t)Duration(node,segmentp,wayp,profile,&speedresult));
+
+ segment=IndexSegment(segments,segmentp); /* segment cannot be a fake segment (must be a super-segment) */
+
+ if((result=FindResult(durations,node,segment)))
+    return(result->score);
+
+ result=InsertResult(durations,node,segment);
+
+ route=FindNormalRoute(query,nodes,segments,ways,relations,profile,node,NO_SEGMENT,OtherNode(segmentp,node));
+
+ if(route)
+   {
+    Result *result2=FindResult(route,node,NO_SEGMENT);
+
+    for(result2=result2->next;result2;result2=result2->next)
+      {
+       Segment *segment2p;
+
+       if(IsFakeSegment(result2->segment))
+          segment2p=LookupFakeSegment(query,result2->segment);
+       else
+          segment2p=LookupSegment(segments,result2->segment,1);
+
+       result->score+=(score_t)Duration(result2->prev->node,segment2p,LookupWay(ways,segment2p->way,2),profile,&speedresult);
+      }
+
+    FreeResultsList(route);
+   }
+ else
+    result->score=(score_t)Duration(node,segmentp,wayp,profile,&speedresult);
+
+ return(result->score);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Make a list of the real nodes that were reached with the best score for each one.
+
+  int IsochroneNodes Returns the number of nodes.
+
+  Results *results The set of results from FindIsochrone().
+
+  IsochroneNode **isonodes Returns the allocated list of nodes sorted by node index.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+int IsochroneNodes(Results *results,IsochroneNode **isonodes)
+{
+ Result *result;
+ int i,n=0;
+
+ *isonodes=(IsochroneNode*)malloc((results->number+1)*sizeof(IsochroneNode));
+
+ result=FirstResult(results);
+
+ while(result)
+   {
+    if(!IsFakeNode(result->node))
+      {
+       (*isonodes)[n].node=result->node;
+       (*isonodes)[n].score=result->score;
+       n++;
+      }
+
+    result=NextResult(results,result);
+   }
+
+ qsort(*isonodes,n,sizeof(IsochroneNode),(int (*)(const void*,const void*))sort_by_node_and_score);
+
+ /* Keep only the first (best) entry for each node */
+
+ for(i=1;i<n;i++)
+    if((*isonodes)[i].node==(*isonodes)[i-1].node)
+       break;
+
+ if(i<n)
+   {
+    int j=i;
+
+    for(;i<n;i++)
+       if((*isonodes)[i].node!=(*isonodes)[j-1].node)
+          (*isonodes)[j++]=(*isonodes)[i];
+
+    n=j;
+   }
+
+ return(n);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Calculate a star-shaped (concave) hull around the nodes that were reached, the furthest node in each of a set of
+  equal sectors around the start point, in order of direction.
+
+  int IsochroneHull Returns the number of points in the hull.
+
+  Query *query The query containing the fake nodes.
+
+  Nodes *nodes The set of nodes to use.
+
+  index_t start_node The start node.
+
+  IsochroneNode *isonodes The nodes that were reached.
+
+  int nisonodes The number of nodes that were reached.
+
+  double *hull_lat Returns the latitudes of the points of the hull (ISOCHRONE_SECTORS entries).
+
+  double *hull_lon Returns the longitudes of the points of the hull (ISOCHRONE_SECTORS entries).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+int IsochroneHull(Query *query,Nodes *nodes,index_t start_node,IsochroneNode *isonodes,int nisonodes,double *hull_lat,double *hull_lon)
+{
+ double radius[ISOCHRONE_SECTORS];
+ double sector_lat[ISOCHRONE_SECTORS],sector_lon[ISOCHRONE_SECTORS];
+ double start_lat,start_lon,coslat;
+ int i,n=0;
+
+ if(IsFakeNode(start_node))
+    GetFakeLatLong(query,start_node,&start_lat,&start_lon);
+ else
+    GetLatLong(nodes,start_node,NULL,&start_lat,&start_lon);
+
+ coslat=cos(start_lat);
+
+ for(i=0;i<ISOCHRONE_SECTORS;i++)
+    radius[i]=-1;
+
+ for(i=0;i<nisonodes;i++)
+   {
+    double lat,lon,x,y,r;
+    int sector;
+
+    GetLatLong(nodes,isonodes[i].node,NULL,&lat,&lon);
+
+    x=(lon-start_lon)*coslat;
+    y=lat-start_lat;
+
+    r=x*x+y*y;
+
+    if(r==0)
+       continue;
+
+    sector=(int)((atan2(y,x)+M_PI)*ISOCHRONE_SECTORS/(2*M_PI));
+
+    if(sector>=ISOCHRONE_SECTORS)
+       sector=ISOCHRONE_SECTORS-1;
+
+    if(r>radius[sector])
+      {
+       radius[sector]=r;
+       sector_lat[sector]=lat;
+       sector_lon[sector]=lon;
+      }
+   }
+
+ for(i=0;i<ISOCHRONE_SECTORS;i++)
+    if(radius[i]>0)
+      {
+       hull_lat[n]=sector_lat[i];
+       hull_lon[n]=sector_lon[i];
+       n++;
+      }
+
+ return(n);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Sort the isochrone nodes by node index and then by score.
+
+  int sort_by_node_and_score Returns the comparison of the node and score fields.
+
+  IsochroneNode *a The first node.
+
+  IsochroneNode *b The second node.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int sort_by_node_and_score(IsochroneNode *a,IsochroneNode *b)
+{
+ if(a->node<b->node)
+    return(-1);
+ else if(a->node>b->node)
+    return(1);
+ else if(a->score<b->score)
+    return(-1);
+ else if(a->score>b->score)
+    return(1);
+ else
+    return(0);
+}
@@ -0,0 +1,58 @@
+/***************************************
+ Header file for the isochrone (reachability within a budget) search.
+
+ Part of the Routino routing software.
+ ******************/ /******************
+ This file Copyright 2008-2013 Andrew M. Bishop
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************/
+
+
+#ifndef ISOCHRONE_H
+#define ISOCHRONE_H    /*+ To stop multiple inclusions. +*/
+
+#include "types.h"
+
+#include "profiles.h"
+#include "results.h"
+
+
+/* Constants */
+
+/*+ The number of sectors around the start point used to make the hull. +*/
+#define ISOCHRONE_SECTORS 72
+
+
+/* Data structures */
+
+/*+ A node that can be reached within the budget. +*/
+typedef struct _IsochroneNode
+{
+ index_t  node;                 /*+ The node. +*/
+ score_t  score;                /*+ The best distance or duration to reach the node. +*/
+}
+ IsochroneNode;
+
+
+/* Functions in isochrone.c */
+
+Results *FindIsochrone(Query *query,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,index_t start_node,index_t prev_segment,score_t budget);
+
+int IsochroneNodes(Results *results,IsochroneNode **isonodes);
+
+int IsochroneHull(Query *query,Nodes *nodes,index_t start_node,IsochroneNode *isonodes,int nisonodes,double *hull_lat,double *hull_lon);
+
+
+#endif /* ISOCHRONE_H */
@@ -0,0 +1,279 @@
+/***************************************
+ Landmark distance data type functions.
+
+ Part of the Routino routing software.
+ ******************/ /******************
+ This file Copyright 2008-2013 Andrew M. Bishop
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************/
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "types.h"
+
+#include "landmarks.h"
+
+#include "files.h"
+#include "results.h"
+
+
+/* Constants */
+
+/*+ The fraction of the scores that is allowed for rounding errors when combining them. +*/
+#define LANDMARK_ROUNDING 1.0E-5
+
+
+/* Local functions */
+
+static index_t LandmarksNodeIndex(Landmarks *landmarks,index_t node);
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Load in the landmark distances from a file.
+
+  Landmarks *LoadLandmarks Returns the landmark distances.
+
+  const char *filename The name of the file to load.
+
+  In slim mode the file is read into memory since it only contains the super-nodes.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+Landmarks *LoadLandmarks(const char *filename)
+{
+ Landmarks *landmarks;
+
+ landmarks=(Landmarks*)malloc(sizeof(Landmarks));
+
+#if !SLIM
+
+ landmarks->data=MapFile(filename);
+
+#else
+
+ {
+  off_t size=SizeFile(filename);
+  int fd=SlimMapFile(filename);
+
+  landmarks->data=malloc(size);
+
+  SlimFetch(fd,landmarks->data,size,0);
+
+  SlimUnmapFile(fd);
+ }
+
+#endif
+
+ /* Copy the LandmarksFile header structure from the loaded data */
+
+ landmarks->file=*((LandmarksFile*)landmarks->data);
+
+ /* Set the pointers in the Landmarks structure. */
+
+ landmarks->nodes    =(index_t*)((char*)landmarks->data+sizeof(LandmarksFile));
+ landmarks->landmarks=landmarks->nodes+landmarks->file.number;
+ landmarks->scores   =(score_t*)(landmarks->landmarks+landmarks->file.lnumber);
+
+ return(landmarks);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Destroy the landmark distances.
+
+  Landmarks *landmarks The landmark distances to destroy.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+void DestroyLandmarks(Landmarks *landmarks)
+{
+#if !SLIM
+
+ landmarks->data=UnmapFile(landmarks->data);
+
+#else
+
+ free(landmarks->data);
+
+#endif
+
+ free(landmarks);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Check if the landmark distances were created with the same profile and type of route.
+
+  int LandmarksMatchProfile Returns true if the landmark distances can be used.
+
+  Landmarks *landmarks The landmark distances.
+
+  Profile *profile The profile (after UpdateProfile() has been called).
+
+  int quickest Set for the quickest route.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+int LandmarksMatchProfile(Landmarks *landmarks,Profile *profile,int quickest)
+{
+ ChProfile chprofile;
+
+ if(landmarks->file.lnumber>LANDMARK_NUMBER)
+    return(0);
+
+ SetChProfile(&chprofile,profile,quickest);
+
+ return(!memcmp(&chprofile,&landmarks->file.profile,sizeof(ChProfile)));
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Calculate the scores between each landmark and the final part of the route.
+
+  Landmarks *landmarks The landmark distances.
+
+  Results *end The final portion of the route.
+
+  score_t *fromlandmark Returns the lowest score from each landmark to the finish node (via the super-nodes
+                        in the final part of the route).
+
+  score_t *tolandmark Returns the highest score to each landmark from any of these super-nodes, less the
+                      score from that super-node to the finish node (or INF_SCORE if one of them cannot
+                      reach the landmark).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+void LandmarksFinishScores(Landmarks *landmarks,Results *end,score_t *fromlandmark,score_t *tolandmark)
+{
+ Result *result;
+ index_t l;
+
+ for(l=0;l<landmarks->file.lnumber;l++)
+   {
+    fromlandmark[l]=INF_SCORE;
+    tolandmark[l]=-INF_SCORE;
+   }
+
+ for(result=FirstResult(end);result;result=NextResult(end,result))
+   {
+    index_t node=LandmarksNodeIndex(landmarks,result->node);
+
+    if(node==NO_NODE)
+       continue;
+
+    for(l=0;l<landmarks->file.lnumber;l++)
+      {
+       score_t from=LandmarkScoreFrom(landmarks,node,l);
+       score_t to  =LandmarkScoreTo  (landmarks,node,l);
+
+       if(from<INF_SCORE && (from+result->score)<fromlandmark[l])
+          fromlandmark[l]=from+result->score;
+
+       if(to==INF_SCORE)
+          tolandmark[l]=INF_SCORE;
+       else if(tolandmark[l]<INF_SCORE && (to-result->score)>tolandmark[l])
+          tolandmark[l]=to-result->score;
+      }
+   }
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Calculate the lowest possible score from a super-node to the finish node using the triangle inequality.
+
+  score_t LandmarksPotential Returns the lowest possible score (or INF_SCORE if the finish cannot be reached).
+
+  Landmarks *landmarks The landmark distances.
+
+  index_t node The super-node.
+
+  score_t *fromlandmark The scores from each landmark to the finish from LandmarksFinishScores().
+
+  score_t *tolandmark The scores to each landmark from the finish from LandmarksFinishScores().
+  ++++++++++++++++++++++++++++++++++++++*/
+
+score_t LandmarksPotential(Landmarks *landmarks,index_t node,score_t *fromlandmark,score_t *tolandmark)
+{
+ score_t potential=0;
+ index_t l;
+
+ node=LandmarksNodeIndex(landmarks,node);
+
+ if(node==NO_NODE)
+    return(0);
+
+ for(l=0;l<landmarks->file.lnumber;l++)
+   {
+    score_t from=LandmarkScoreFrom(landmarks,node,l);
+    score_t to  =LandmarkScoreTo  (landmarks,node,l);
+    score_t bound;
+
+    /* landmark -> node -> finish is not shorter than landmark -> finish */
+
+    if(fromlandmark[l]<INF_SCORE && from<INF_SCORE)
+      {
+       bound=fromlandmark[l]-from-(fromlandmark[l]+from)*LANDMARK_ROUNDING;
+
+       if(bound>potential)
+          potential=bound;
+      }
+
+    /* node -> finish -> landmark is not shorter than node -> landmark */
+
+    if(tolandmark[l]>-INF_SCORE && tolandmark[l]<INF_SCORE)
+      {
+       if(to==INF_SCORE)
+          return(INF_SCORE);
+
+       bound=to-tolandmark[l]-(to+(tolandmark[l]<0?-tolandmark[l]:tolandmark[l]))*LANDMARK_ROUNDING;
+
+       if(bound>potential)
+          potential=bound;
+      }
+   }
+
+ return(potential);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Find the index of a super-node in the landmark distances.
+
+  index_t LandmarksNodeIndex Returns the index of the node (or NO_NODE if it is not a super-node).
+
+  Landmarks *landmarks The landmark distances.
+
+  index_t node The node in the database.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static index_t LandmarksNodeIndex(Landmarks *landmarks,index_t node)
+{
+ index_t start=0;
+ index_t end=landmarks->file.number;
+ index_t mid;
+
+ while(start<end)
+   {
+    mid=start+(end-start)/2;
+
+    if(landmarks->nodes[mid]<node)
+       start=mid+1;
+    else
+       end=mid;
+   }
+
+ if(start<landmarks->file.number && landmarks->nodes[start]==node)
+    return(start);
+
+ return(NO_NODE);
+}
@@ -0,0 +1,122 @@
+/***************************************
+ A header file for the landmark distances of the super-nodes.
+
+ Part of the Routino routing software.
+ ******************/ /******************
+ This file Copyright 2008-2013 Andrew M. Bishop
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************/
+
+
+#ifndef LANDMARKS_H
+#define LANDMARKS_H    /*+ To stop multiple inclusions. +*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "types.h"
+
+#include "contract.h"
+#include "files.h"
+#include "profiles.h"
+#include "results.h"
+
+
+/* Constants */
+
+/*+ The maximum number of landmarks that are selected. +*/
+#define LANDMARK_NUMBER 16
+
+
+/* Data structures */
+
+/*+ A structure containing the header from the file. +*/
+typedef struct _LandmarksFile
+{
+ index_t   number;              /*+ The number of nodes (super-nodes). +*/
+ index_t   lnumber;             /*+ The number of landmarks. +*/
+
+ ChProfile profile;             /*+ The profile used to calculate the scores. +*/
+}
+ LandmarksFile;
+
+
+/*+ A structure containing the landmark distances. +*/
+typedef struct _Landmarks
+{
+ LandmarksFile file;            /*+ The header data from the file. +*/
+
+ void    *data;                 /*+ The memory mapped data in the file (or a copy of it in slim mode). +*/
+
+ index_t *nodes;                /*+ A pointer to the array of super-nodes (in database order). +*/
+ index_t *landmarks;            /*+ A pointer to the array of landmark super-nodes. +*/
+ score_t *scores;               /*+ A pointer to the scores from and to each landmark for each node. +*/
+}
+ Landmarks;
+
+
+/* Functions in landmarks.c */
+
+Landmarks *LoadLandmarks(const char *filename);
+
+void DestroyLandmarks(Landmarks *landmarks);
+
+int LandmarksMatchProfile(Landmarks *landmarks,Profile *profile,int quickest);
+
+void LandmarksFinishScores(Landmarks *landmarks,Results *end,score_t *fromlandmark,score_t *tolandmark);
+
+score_t LandmarksPotential(Landmarks *landmarks,index_t node,score_t *fromlandmark,score_t *tolandmark);
+
+
+/* Macros and inline functions */
+
+/*+ Return the score from a landmark to the node with the specified index. +*/
+#define LandmarkScoreFrom(xxx,yyy,zzz)  ((xxx)->scores[(2*(yyy))*(xxx)->file.lnumber+(zzz)])
+
+/*+ Return the score to a landmark from the node with the specified index. +*/
+#define LandmarkScoreTo(xxx,yyy,zzz)    ((xxx)->scores[(2*(yyy)+1)*(xxx)->file.lnumber+(zzz)])
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Return the name of the file containing the landmark distances for a profile.
+
+  char *LandmarksFileName Returns a pointer to memory allocated to the filename.
+
+  const char *dirname The directory name.
+
+  const char *prefix The file name prefix.
+
+  const char *profilename The name of the profile.
+
+  int quickest Set for the file for the quickest route.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static inline char *LandmarksFileName(const char *dirname,const char *prefix,const char *profilename,int quickest)
+{
+ char *name=(char*)malloc(strlen(profilename)+sizeof("lm--shortest.mem"));
+ char *filename;
+
+ sprintf(name,"lm-%s-%s.mem",profilename,quickest?"quickest":"shortest");
+
+ filename=FileName(dirname,prefix,name);
+
+ free(name);
+
+ return(filename);
+}
+
+
+#endif /* LANDMARKS_H */
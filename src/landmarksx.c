@@ -0,0 +1,564 @@
+/***************************************
+ Landmark distance creation for the super-nodes.
+
+ Part of the Routino routing software.
+ ******************/ /******************
+ This file Copyright 2008-2013 Andrew M. Bishop
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************/
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "types.h"
+#include "nodes.h"
+#include "segments.h"
+#include "ways.h"
+
+#include "landmarks.h"
+#include "landmarksx.h"
+#include "contractx.h"
+
+#include "files.h"
+#include "logging.h"
+
+
+/* Local data types */
+
+/*+ An entry in the priority queue for the searches. +*/
+typedef struct _HeapEntry
+{
+ score_t  score;                /*+ The score to the node. +*/
+ index_t  node;                 /*+ The node. +*/
+}
+ HeapEntry;
+
+/*+ The data used while creating the landmark distances. +*/
+typedef struct _LandmarksX
+{
+ Nodes        *nodes;           /*+ The set of nodes. +*/
+ Segments     *segments;        /*+ The set of segments. +*/
+ Ways         *ways;            /*+ The set of ways. +*/
+
+ Profile      *profile;         /*+ The profile to use. +*/
+
+ index_t       number;          /*+ The number of nodes (super-nodes). +*/
+ index_t      *supernodes;      /*+ The index of each super-node in the database. +*/
+
+ index_t      *firstedge;       /*+ The first edge of each node (with one extra at the end). +*/
+ index_t      *edgenode;        /*+ The node at the other end of each edge. +*/
+ score_t      *edgeout;         /*+ The score for leaving the node along each edge. +*/
+ score_t      *edgein;          /*+ The score for arriving at the node along each edge. +*/
+
+ index_t       lnumber;         /*+ The number of landmarks. +*/
+ index_t       landmarks[LANDMARK_NUMBER]; /*+ The landmarks. +*/
+
+ score_t      *from[LANDMARK_NUMBER]; /*+ The scores from each landmark to each node. +*/
+ score_t      *to[LANDMARK_NUMBER];   /*+ The scores to each landmark from each node. +*/
+
+ index_t       nheap;           /*+ The number of entries in the heap. +*/
+ index_t       nalloc;          /*+ The number of allocated entries in the heap. +*/
+ HeapEntry    *heap;            /*+ The heap for the searches. +*/
+}
+ LandmarksX;
+
+
+/* Local functions */
+
+static void CreateLandmarkEdges(LandmarksX *lx,int quickest);
+static void SelectLandmarks(LandmarksX *lx,int quickest);
+static void SaveLandmarks(LandmarksX *lx,const char *filename,int quickest);
+
+static void SearchFromNode(LandmarksX *lx,index_t node,score_t *scores,int backwards);
+static index_t SuperNodeIndex(LandmarksX *lx,index_t node);
+
+static void HeapPush(LandmarksX *lx,index_t node,score_t score);
+static index_t HeapPop(LandmarksX *lx,score_t *score);
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Create the landmark distances of the super-nodes for a profile (one set for the shortest route and one for
+  the quickest route) using the database files that have already been written.
+
+  const char *dirname The directory name of the database.
+
+  const char *prefix The file name prefix of the database.
+
+  Profile *profile The profile to use.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+void CreateLandmarks(const char *dirname,const char *prefix,Profile *profile)
+{
+ LandmarksX lx;
+ index_t i;
+ int quickest;
+
+ /* Load in the database */
+
+ lx.nodes   =LoadNodeList   (FileName(dirname,prefix,"nodes.mem"));
+ lx.segments=LoadSegmentList(FileName(dirname,prefix,"segments.mem"));
+ lx.ways    =LoadWayList    (FileName(dirname,prefix,"ways.mem"));
+
+ lx.profile=profile;
+
+ if(UpdateProfile(profile,lx.ways))
+   {
+    fprintf(stderr,"Error: Profile '%s' is invalid or not compatible with database.\n",profile->name);
+    exit(EXIT_FAILURE);
+   }
+
+ /* Find the super-nodes */
+
+ lx.number=0;
+
+ for(i=0;i<lx.nodes->file.number;i++)
+    if(IsSuperNode(LookupNode(lx.nodes,i,1)))
+       lx.number++;
+
+ lx.supernodes=(index_t*)malloc(lx.number*sizeof(index_t));
+
+ logassert(lx.supernodes,"Failed to allocate memory (try using slim mode?)"); /* Check malloc() worked */
+
+ lx.number=0;
+
+ for(i=0;i<lx.nodes->file.number;i++)
+    if(IsSuperNode(LookupNode(lx.nodes,i,1)))
+       lx.supernodes[lx.number++]=i;
+
+ lx.nalloc=1024;
+ lx.heap=(HeapEntry*)malloc(lx.nalloc*sizeof(HeapEntry));
+
+ for(i=0;i<LANDMARK_NUMBER;i++)
+   {
+    lx.from[i]=(score_t*)malloc(lx.number*sizeof(score_t));
+    lx.to[i]  =(score_t*)malloc(lx.number*sizeof(score_t));
+
+    logassert(lx.from[i] && lx.to[i],"Failed to allocate memory (try using slim mode?)"); /* Check malloc() worked */
+   }
+
+ for(quickest=0;quickest<=1;quickest++)
+   {
+    char *filename=LandmarksFileName(dirname,prefix,profile->name,quickest);
+
+    CreateLandmarkEdges(&lx,quickest);
+
+    SelectLandmarks(&lx,quickest);
+
+    SaveLandmarks(&lx,filename,quickest);
+
+    free(lx.firstedge);
+    free(lx.edgenode);
+    free(lx.edgeout);
+    free(lx.edgein);
+
+    free(filename);
+   }
+
+ /* Free the memory */
+
+ for(i=0;i<LANDMARK_NUMBER;i++)
+   {
+    free(lx.from[i]);
+    free(lx.to[i]);
+   }
+
+ free(lx.heap);
+ free(lx.supernodes);
+
+ DestroyNodeList(lx.nodes);
+ DestroySegmentList(lx.segments);
+ DestroyWayList(lx.ways);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Create the list of edges (super-segments) for each super-node with the scores in each direction.
+
+  LandmarksX *lx The landmark data.
+
+  int quickest Set if the scores are for the quickest route.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void CreateLandmarkEdges(LandmarksX *lx,int quickest)
+{
+ index_t i,nedges=0;
+ index_t *position;
+
+ lx->firstedge=(index_t*)calloc(lx->number+1,sizeof(index_t));
+
+ logassert(lx->firstedge,"Failed to allocate memory (try using slim mode?)"); /* Check calloc() worked */
+
+ /* Count the super-segments at each super-node (loops are not needed) */
+
+ for(i=0;i<lx->segments->file.number;i++)
+   {
+    Segment *segmentp=LookupSegment(lx->segments,i,1);
+
+    if(!IsSuperSegment(segmentp) || segmentp->node1==segmentp->node2)
+       continue;
+
+    lx->firstedge[SuperNodeIndex(lx,segmentp->node1)+1]++;
+    lx->firstedge[SuperNodeIndex(lx,segmentp->node2)+1]++;
+
+    nedges+=2;
+   }
+
+ for(i=0;i<lx->number;i++)
+    lx->firstedge[i+1]+=lx->firstedge[i];
+
+ lx->edgenode=(index_t*)malloc(nedges*sizeof(index_t));
+ lx->edgeout =(score_t*)malloc(nedges*sizeof(score_t));
+ lx->edgein  =(score_t*)malloc(nedges*sizeof(score_t));
+
+ position=(index_t*)malloc(lx->number*sizeof(index_t));
+
+ logassert(lx->edgenode && lx->edgeout && lx->edgein && position,"Failed to allocate memory (try using slim mode?)"); /* Check malloc() worked */
+
+ memcpy(position,lx->firstedge,lx->number*sizeof(index_t));
+
+ /* Fill in the edges with the scores in each direction */
+
+ for(i=0;i<lx->segments->file.number;i++)
+   {
+    Segment *segmentp=LookupSegment(lx->segments,i,1);
+    index_t node1,node2,e;
+    score_t score12,score21;
+
+    if(!IsSuperSegment(segmentp) || segmentp->node1==segmentp->node2)
+       continue;
+
+    node1=SuperNodeIndex(lx,segmentp->node1);
+    node2=SuperNodeIndex(lx,segmentp->node2);
+
+    score12=SuperSegmentScore(lx->ways,lx->profile,segmentp,segmentp->node1,quickest);
+    score21=SuperSegmentScore(lx->ways,lx->profile,segmentp,segmentp->node2,quickest);
+
+    e=position[node1]++;
+
+    lx->edgenode[e]=node2;
+    lx->edgeout[e]=score12;
+    lx->edgein[e] =score21;
+
+    e=position[node2]++;
+
+    lx->edgenode[e]=node1;
+    lx->edgeout[e]=score21;
+    lx->edgein[e] =score12;
+   }
+
+ free(position);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Select the landmarks and calculate the scores from and to them.
+
+  LandmarksX *lx The landmark data.
+
+  int quickest Set if the scores are for the quickest route.
+
+  Each landmark is the node that is furthest (there and back) from all of the landmarks already selected,
+  the first one is the node that is furthest from the first super-node.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void SelectLandmarks(LandmarksX *lx,int quickest)
+{
+ score_t *mindist;
+ index_t i,next=NO_NODE;
+
+ /* Print the start message */
+
+ printf_first("Creating Landmarks (%s %s): Landmarks=0",lx->profile->name,quickest?"quickest":"shortest");
+
+ lx->lnumber=0;
+
+ if(lx->number==0)
+    goto finished;
+
+ mindist=(score_t*)malloc(lx->number*sizeof(score_t));
+
+ /* Find the first landmark */
+
+ SearchFromNode(lx,0,lx->from[0],0);
+
+ for(i=0;i<lx->number;i++)
+    if(lx->from[0][i]<INF_SCORE && (next==NO_NODE || lx->from[0][i]>lx->from[0][next]))
+       next=i;
+
+ for(i=0;i<lx->number;i++)
+    mindist[i]=INF_SCORE;
+
+ /* Find the remaining landmarks */
+
+ while(next!=NO_NODE)
+   {
+    index_t l=lx->lnumber++;
+
+    lx->landmarks[l]=next;
+
+    SearchFromNode(lx,next,lx->from[l],0);
+    SearchFromNode(lx,next,lx->to[l],1);
+
+    printf_middle("Creating Landmarks (%s %s): Landmarks=%"Pindex_t,lx->profile->name,quickest?"quickest":"shortest",lx->lnumber);
+
+    if(lx->lnumber==LANDMARK_NUMBER)
+       break;
+
+    next=NO_NODE;
+
+    for(i=0;i<lx->number;i++)
+      {
+       if(lx->from[l][i]<INF_SCORE && lx->to[l][i]<INF_SCORE && (lx->from[l][i]+lx->to[l][i])<mindist[i])
+          mindist[i]=lx->from[l][i]+lx->to[l][i];
+
+       if(mindist[i]<INF_SCORE && mindist[i]>0 && (next==NO_NODE || mindist[i]>mindist[next]))
+          next=i;
+      }
+   }
+
+ free(mindist);
+
+ finished:
+
+ /* Print the final message */
+
+ printf_last("Created Landmarks (%s %s): Nodes=%"Pindex_t" Landmarks=%"Pindex_t,
+             lx->profile->name,quickest?"quickest":"shortest",lx->number,lx->lnumber);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Save the landmark distances to a file.
+
+  LandmarksX *lx The landmark data.
+
+  const char *filename The name of the file to save.
+
+  int quickest Set if the scores are for the quickest route.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void SaveLandmarks(LandmarksX *lx,const char *filename,int quickest)
+{
+ LandmarksFile landmarksfile;
+ index_t i,l;
+ int fd;
+
+ /* Print the start message */
+
+ printf_first("Writing Landmarks: Nodes=0");
+
+ /* Write out the header structure */
+
+ landmarksfile.number =lx->number;
+ landmarksfile.lnumber=lx->lnumber;
+
+ SetChProfile(&landmarksfile.profile,lx->profile,quickest);
+
+ fd=OpenFileBufferedNew(filename);
+
+ WriteFileBuffered(fd,&landmarksfile,sizeof(LandmarksFile));
+
+ /* Write out the nodes and the landmarks */
+
+ WriteFileBuffered(fd,lx->supernodes,lx->number*sizeof(index_t));
+
+ for(l=0;l<lx->lnumber;l++)
+    WriteFileBuffered(fd,&lx->supernodes[lx->landmarks[l]],sizeof(index_t));
+
+ /* Write out the scores (all of the landmarks for each node together) */
+
+ for(i=0;i<lx->number;i++)
+   {
+    for(l=0;l<lx->lnumber;l++)
+       WriteFileBuffered(fd,&lx->from[l][i],sizeof(score_t));
+
+    for(l=0;l<lx->lnumber;l++)
+       WriteFileBuffered(fd,&lx->to[l][i],sizeof(score_t));
+
+    if(!((i+1)%10000))
+       printf_middle("Writing Landmarks: Nodes=%"Pindex_t,i+1);
+   }
+
+ CloseFileBuffered(fd);
+
+ /* Print the final message */
+
+ printf_last("Wrote Landmarks: Nodes=%"Pindex_t" Landmarks=%"Pindex_t,lx->number,lx->lnumber);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Calculate the lowest scores from a node to all other nodes (or to a node from all other nodes). Turn
+  restrictions and barriers are ignored so that the scores are never higher than the router would find.
+
+  LandmarksX *lx The landmark data.
+
+  index_t node The node to start from.
+
+  score_t *scores Returns the scores for each node.
+
+  int backwards Set to calculate the scores to the node instead of from the node.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void SearchFromNode(LandmarksX *lx,index_t node,score_t *scores,int backwards)
+{
+ index_t i,x;
+ score_t score;
+
+ for(i=0;i<lx->number;i++)
+    scores[i]=INF_SCORE;
+
+ scores[node]=0;
+
+ lx->nheap=0;
+
+ HeapPush(lx,node,0);
+
+ while((x=HeapPop(lx,&score))!=NO_NODE)
+   {
+    if(score>scores[x])
+       continue;
+
+    for(i=lx->firstedge[x];i<lx->firstedge[x+1];i++)
+      {
+       index_t y=lx->edgenode[i];
+       score_t segment_score=backwards?lx->edgein[i]:lx->edgeout[i];
+
+       if(segment_score==INF_SCORE)
+          continue;
+
+       if((score+segment_score)<scores[y])
+         {
+          scores[y]=score+segment_score;
+
+          HeapPush(lx,y,scores[y]);
+         }
+      }
+   }
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Find the index of a super-node in the list of super-nodes.
+
+  index_t SuperNodeIndex Returns the index of the super-node.
+
+  LandmarksX *lx The landmark data.
+
+  index_t node The super-node in the database.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static index_t SuperNodeIndex(LandmarksX *lx,index_t node)
+{
+ index_t start=0,end=lx->number-1,mid;
+
+ while(start<end)
+   {
+    mid=start+(end-start)/2;
+
+    if(lx->supernodes[mid]<node)
+       start=mid+1;
+    else
+       end=mid;
+   }
+
+ logassert(lx->supernodes[start]==node,"Super-segment does not join two super-nodes"); /* Super-segments only join super-nodes */
+
+ return(start);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Add a node to the heap (a node may be in the heap more than once, the later ones are ignored).
+
+  LandmarksX *lx The landmark data.
+
+  index_t node The node.
+
+  score_t score The score to the node.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void HeapPush(LandmarksX *lx,index_t node,score_t score)
+{
+ index_t i;
+
+ if(lx->nheap==lx->nalloc)
+   {
+    lx->nalloc*=2;
+    lx->heap=(HeapEntry*)realloc((void*)lx->heap,lx->nalloc*sizeof(HeapEntry));
+
+    logassert(lx->heap,"Failed to reallocate memory (try using slim mode?)"); /* Check realloc() worked */
+   }
+
+ i=lx->nheap++;
+
+ while(i>0)
+   {
+    index_t parent=(i-1)/2;
+
+    if(lx->heap[parent].score<=score)
+       break;
+
+    lx->heap[i]=lx->heap[parent];
+    i=parent;
+   }
+
+ lx->heap[i].score=score;
+ lx->heap[i].node=node;
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Remove the node with the lowest score from the heap.
+
+  index_t HeapPop Returns the node (or NO_NODE if the heap is empty).
+
+  LandmarksX *lx The landmark data.
+
+  score_t *score Returns the score of the node.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static index_t HeapPop(LandmarksX *lx,score_t *score)
+{
+ HeapEntry last;
+ index_t node,i=0;
+
+ if(lx->nheap==0)
+    return(NO_NODE);
+
+ node=lx->heap[0].node;
+ *score=lx->heap[0].score;
+
+ last=lx->heap[--lx->nheap];
+
+ while(2*i+1<lx->nheap)
+   {
+    index_t child=2*i+1;
+
+    if(child+1<lx->nheap && lx->heap[child+1].score<lx->heap[child].score)
+       child++;
+
+    if(last.score<=lx->heap[child].score)
+       break;
+
+    lx->heap[i]=lx->heap[child];
+    i=child;
+   }
+
+ lx->heap[i]=last;
+
+ return(node);
+}
@@ -48,14 +48,27 @@ static void vfprintf_last(FILE *file,const char *format,va_list ap);
 
 /* Local variables */
 
+/*+ A qualifier for the variables that are separate for each thread (in case several are printing). +*/
+#if defined(USE_PTHREADS) && USE_PTHREADS
+#define THREADLOCAL __thread
+#else
+#define THREADLOCAL
+#endif
+
 /*+ The time that program_start() was called. +*/
 static struct timeval program_start_time;
 
 /*+ The time that printf_first() was called. +*/
-static struct timeval function_start_time;
+static THREADLOCAL struct timeval function_start_time;
 
 /*+ The length of the string printed out last time. +*/
-static int printed_length=0;
+static THREADLOCAL int printed_length=0;
+
+/*+ Some extra text to add to the end of the next last message. +*/
+static THREADLOCAL char *last_extra=NULL;
+
+/*+ A flag to indicate that several threads may be printing messages at the same time. +*/
+static int concurrent=0;
 
 
 /*++++++++++++++++++++++++++++++++++++++
@@ -84,6 +97,19 @@ void printf_program_end(void)
 }
 
 
+/*++++++++++++++++++++++++++++++++++++++
+  Select whether several threads may print messages at the same time (if so then only the last
+  message of each overwriting sequence is printed, as a complete line).
+
+  int enable Set to 1 when several threads may print or 0 when only one will.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+void printf_concurrent(int enable)
+{
+ concurrent=enable;
+}
+
+
 /*++++++++++++++++++++++++++++++++++++++
   Print the first message in an overwriting sequence (to stdout).
 
@@ -99,7 +125,7 @@ void printf_first(const char *format, ...)
  if(option_logtime)
     gettimeofday(&function_start_time,NULL);
 
- if(option_loggable)
+ if(option_loggable || concurrent)
     return;
 
  va_start(ap,format);
@@ -122,7 +148,7 @@ void printf_middle(const char *format, ...)
 {
  va_list ap;
 
- if(option_loggable)
+ if(option_loggable || concurrent)
     return;
 
  va_start(ap,format);
@@ -153,6 +179,36 @@ void printf_last(const char *format, ...)
 }
 
 
+/*++++++++++++++++++++++++++++++++++++++
+  Store some extra text to add to the end of the next last message in an overwriting sequence
+  (allows a function to report information without knowing which message it is part of).
+
+  const char *format The format string.
+
+  ... The other arguments.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+void printf_last_extra(const char *format, ...)
+{
+ va_list ap;
+ char extra[256];
+ size_t length=0;
+
+ va_start(ap,format);
+
+ vsnprintf(extra,sizeof(extra),format,ap);
+
+ va_end(ap);
+
+ if(last_extra)
+    length=strlen(last_extra);
+
+ last_extra=(char*)realloc(last_extra,length+strlen(extra)+1);
+
+ strcpy(last_extra+length,extra);
+}
+
+
 /*++++++++++++++++++++++++++++++++++++++
   Print the first message in an overwriting sequence to a specified file.
 
@@ -170,7 +226,7 @@ void fprintf_first(FILE *file,const char *format, ...)
  if(option_logtime)
     gettimeofday(&function_start_time,NULL);
 
- if(option_loggable)
+ if(option_loggable || concurrent)
     return;
 
  va_start(ap,format);
@@ -195,7 +251,7 @@ void fprintf_middle(FILE *file,const char *format, ...)
 {
  va_list ap;
 
- if(option_loggable)
+ if(option_loggable || concurrent)
     return;
 
  va_start(ap,format);
@@ -301,7 +357,9 @@ static void vfprintf_last(FILE *file,const char *format,va_list ap)
 {
  int retval;
 
- if(!option_loggable)
+ flockfile(file);
+
+ if(!option_loggable && !concurrent)
     fputc('\r',file);
 
  if(option_logtime)
@@ -309,12 +367,23 @@ static void vfprintf_last(FILE *file,const char *format,va_list ap)
 
  retval=vfprintf(file,format,ap);
 
- if(retval>0)
+ if(last_extra)
+   {
+    if(retval>=0)
+       retval+=fprintf(file,"%s",last_extra);
+
+    free(last_extra);
+    last_extra=NULL;
+   }
+
+ if(retval>0 && !concurrent)
     while(retval++<printed_length)
        fputc(' ',file);
 
  fputc('\n',file);
  fflush(file);
+
+ funlockfile(file);
 }
 
 
@@ -54,6 +54,8 @@ extern int option_logtime;
 void printf_program_start(void);
 void printf_program_end(void);
 
+void printf_concurrent(int enable);
+
 
 #ifdef __GNUC__
 
@@ -61,6 +63,8 @@ void printf_first(const char *format, ...) __attribute__ ((format (printf, 1, 2)
 void printf_middle(const char *format, ...) __attribute__ ((format (printf, 1, 2)));
 void printf_last(const char *format, ...) __attribute__ ((format (printf, 1, 2)));
 
+void printf_last_extra(const char *format, ...) __attribute__ ((format (printf, 1, 2)));
+
 void fprintf_first(FILE *file,const char *format, ...) __attribute__ ((format (printf, 2, 3)));
 void fprintf_middle(FILE *file,const char *format, ...) __attribute__ ((format (printf, 2, 3)));
 void fprintf_last(FILE *file,const char *format, ...) __attribute__ ((format (printf, 2, 3)));
@@ -71,6 +75,8 @@ void printf_first(const char *format, ...);
 void printf_middle(const char *format, ...);
 void printf_last(const char *format, ...);
 
+void printf_last_extra(const char *format, ...);
+
 void fprintf_first(FILE *file,const char *format, ...);
 void fprintf_middle(FILE *file,const char *format, ...);
 void fprintf_last(FILE *file,const char *format, ...);
@@ -0,0 +1,1345 @@
+/***************************************
+ Many-to-many route matrix calculation.
+
+ Part of the Routino routing software.
+ ******************/ /******************
+ This file Copyright 2008-2013 Andrew M. Bishop
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************/
+
+
+#include <stdlib.h>
+
+#include "types.h"
+#include "nodes.h"
+#include "segments.h"
+#include "ways.h"
+#include "relations.h"
+
+#include "functions.h"
+#include "fakes.h"
+#include "query.h"
+#include "results.h"
+#include "matrix.h"
+
+
+/* Constants */
+
+/*+ An undefined bucket entry. +*/
+#define NO_BUCKET (uint32_t)(~0)
+
+/*+ The hash function for a node and segment pair (the same as the one for results). +*/
+#define HASH_NODE_SEGMENT(node,segment) ((node)^(segment<<4))
+
+
+/* Local data types */
+
+/*+ An entry in the buckets, the score from a super-node reached by a super-segment to one of the targets. +*/
+typedef struct _Bucket
+{
+ index_t   node;                /*+ The super-node. +*/
+ index_t   segment;             /*+ The super-segment used to arrive at the super-node. +*/
+
+ uint32_t  target;              /*+ The target that the score leads to. +*/
+ score_t   score;               /*+ The best score from the super-node to the target. +*/
+
+ Result   *result;              /*+ The result in the backward search from the target. +*/
+
+ uint32_t  hashnext;            /*+ The next entry in the same hash bin. +*/
+}
+ Bucket;
+
+/*+ The buckets for all of the targets, indexed by node and segment. +*/
+typedef struct _Buckets
+{
+ uint32_t  nbins;               /*+ The number of bins in the hash table. +*/
+ uint32_t  mask;                /*+ A bit mask to select the bottom log2(nbins) bits. +*/
+
+ uint32_t *bins;                /*+ The first entry in each hash bin. +*/
+
+ uint32_t  number;              /*+ The number of entries. +*/
+ uint32_t  nalloc;              /*+ The number of allocated entries. +*/
+
+ Bucket   *data;                /*+ The entries. +*/
+}
+ Buckets;
+
+/*+ A node at or next to a target, used to find the targets that might be reached without a super-route. +*/
+typedef struct _Anchor
+{
+ index_t   node;                /*+ The node. +*/
+ uint32_t  target;              /*+ The target. +*/
+}
+ Anchor;
+
+/*+ One step of a matrix route, used to follow the route forwards from the source. +*/
+typedef struct _Step
+{
+ index_t   node;                /*+ The node that the segment is followed from. +*/
+ index_t   segment;             /*+ The segment (normal, super or fake). +*/
+}
+ Step;
+
+
+/* Local functions */
+
+static Buckets *NewBuckets(uint8_t log2bins);
+static void FreeBuckets(Buckets *buckets);
+static void AddBucket(Buckets *buckets,index_t node,index_t segment,uint32_t target,score_t score,Result *result);
+
+static Anchor *AddAnchor(Anchor *anchors,int *nanchors,index_t node,uint32_t target);
+static Step *AddStep(Step *steps,int *nsteps,index_t node,index_t segment);
+
+static index_t MatrixPointNode(Query *query,Nodes *nodes,Segments *segments,int point,MatrixPoint *matrixpoint);
+
+static Results *FindBackwardSuperRoutes(Query *query,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,Results *end);
+static Results *FindForwardSuperRoutes(Query *query,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,Results *begin,
+                                       Buckets *buckets,Results **ends,index_t *finish_nodes,index_t *sorted_finish_nodes,int nfinish,int nreachable,
+                                       score_t *best_score,Result **best_result,uint32_t *best_bucket);
+static int FindDirectRoute(Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,int quickest,
+                           MatrixPoint *source,MatrixPoint *target,distance_t *distance,duration_t *duration);
+
+static int RouteTotals(Query *query,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,
+                       index_t start_node,index_t finish_node,index_t *prev_segment,distance_t *distance,duration_t *duration);
+static void SegmentTotals(Query *query,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,
+                          index_t node,index_t segment,index_t *prev_segment,distance_t *distance,duration_t *duration);
+
+static int sort_by_node(const void *a,const void *b);
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Calculate the distance and duration of the optimum route from each of a set of sources to each of a set of targets.
+
+  The final part of the route to every target is found (working backwards) as far as the super-nodes and then
+  extended backwards across the whole super-node graph; the score from each super-node/super-segment pair is
+  stored in a bucket for each target. The initial part of the route from each source is found as far as the
+  super-nodes and extended forwards across the super-node graph checking the buckets at each super-node. Sources
+  and targets that are close enough that the route might not use any super-nodes are checked separately in the
+  same way as the router does.
+
+  Nodes *nodes The set of nodes to use.
+
+  Segments *segments The set of segments to use.
+
+  Ways *ways The set of ways to use.
+
+  Relations *relations The set of relations to use.
+
+  Profile *profile The profile containing the transport type, speeds and allowed highways.
+
+  int quickest Set to calculate the quickest routes instead of the shortest.
+
+  MatrixPoint *sources The source points.
+
+  int nsources The number of source points.
+
+  MatrixPoint *targets The target points.
+
+  int ntargets The number of target points.
+
+  distance_t *distances Returns the distances (nsources rows of ntargets) or INF_DISTANCE if there is no route.
+
+  duration_t *durations Returns the durations (nsources rows of ntargets).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+void CalculateMatrix(Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,int quickest,
+                     MatrixPoint *sources,int nsources,MatrixPoint *targets,int ntargets,
+                     distance_t *distances,duration_t *durations)
+{
+ Query **queries;
+ Results **ends,**backs;
+ Buckets *buckets;
+ Anchor *anchors;
+ Step *steps=NULL;
+ index_t *finish_nodes,*sorted_finish_nodes;
+ score_t *best_score;
+ Result **best_result;
+ uint32_t *best_bucket;
+ char *near;
+ int nanchors=0,nreachable=0;
+ int s,t;
+
+ for(s=0;s<nsources;s++)
+    for(t=0;t<ntargets;t++)
+      {
+       distances[s*ntargets+t]=INF_DISTANCE;
+       durations[s*ntargets+t]=0;
+      }
+
+ queries     =(Query**)  malloc(ntargets*sizeof(Query*));
+ ends        =(Results**)malloc(ntargets*sizeof(Results*));
+ backs       =(Results**)malloc(ntargets*sizeof(Results*));
+ anchors     =NULL;
+ finish_nodes=(index_t*) malloc(ntargets*sizeof(index_t));
+
+ sorted_finish_nodes=(index_t*)malloc(ntargets*sizeof(index_t));
+
+ best_score =(score_t*) malloc(ntargets*sizeof(score_t));
+ best_result=(Result**) malloc(ntargets*sizeof(Result*));
+ best_bucket=(uint32_t*)malloc(ntargets*sizeof(uint32_t));
+ near       =(char*)    malloc(ntargets*sizeof(char));
+
+ buckets=NewBuckets(12);
+
+ /* Find the routes from the super-nodes to each target and store them in the buckets */
+
+ for(t=0;t<ntargets;t++)
+   {
+    Result *result;
+
+    queries[t]=NewQuery(quickest);
+
+    finish_nodes[t]=MatrixPointNode(queries[t],nodes,segments,1,&targets[t]);
+    sorted_finish_nodes[t]=finish_nodes[t];
+
+    ends[t]=NULL;
+    backs[t]=NULL;
+
+    if(finish_nodes[t]==NO_NODE)
+       continue;
+
+    /* The target can be reached directly from the nodes at the ends of its segment (or the node and its neighbours) */
+
+    if(IsFakeNode(finish_nodes[t]))
+      {
+       anchors=AddAnchor(anchors,&nanchors,targets[t].node1,t);
+       anchors=AddAnchor(anchors,&nanchors,targets[t].node2,t);
+      }
+    else
+      {
+       Segment *segmentp=FirstSegment(segments,LookupNode(nodes,finish_nodes[t],1),1);
+
+       anchors=AddAnchor(anchors,&nanchors,finish_nodes[t],t);
+
+       while(segmentp)
+         {
+          if(IsNormalSegment(segmentp))
+             anchors=AddAnchor(anchors,&nanchors,OtherNode(segmentp,finish_nodes[t]),t);
+
+          segmentp=NextSegment(segments,segmentp,finish_nodes[t]);
+         }
+      }
+
+    ends[t]=FindFinishRoutes(queries[t],nodes,segments,ways,relations,profile,finish_nodes[t]);
+
+    if(!ends[t])
+       continue;
+
+    backs[t]=FindBackwardSuperRoutes(queries[t],nodes,segments,ways,relations,profile,ends[t]);
+
+    nreachable++;
+
+    result=FirstResult(backs[t]);
+
+    while(result)
+      {
+       AddBucket(buckets,result->node,result->segment,t,result->score,result);
+
+       result=NextResult(backs[t],result);
+      }
+   }
+
+ qsort(anchors,nanchors,sizeof(Anchor),(int (*)(const void*,const void*))sort_by_node);
+ qsort(sorted_finish_nodes,ntargets,sizeof(index_t),(int (*)(const void*,const void*))sort_by_node);
+
+ /* Find the routes from each source to the super-nodes and check the buckets */
+
+ for(s=0;s<nsources;s++)
+   {
+    Query *query;
+    Results *begin,*forward=NULL;
+    index_t start_node;
+
+    query=NewQuery(quickest);
+
+    start_node=MatrixPointNode(query,nodes,segments,1,&sources[s]);
+
+    if(start_node==NO_NODE)
+      {
+       FreeQuery(query);
+       continue;
+      }
+
+    for(t=0;t<ntargets;t++)
+      {
+       best_score[t]=INF_SCORE;
+       best_result[t]=NULL;
+       best_bucket[t]=NO_BUCKET;
+       near[t]=0;
+      }
+
+    begin=FindStartRoutes(query,nodes,segments,ways,relations,profile,start_node,NO_SEGMENT,NO_NODE);
+
+    if(begin)
+      {
+       Result *result=FirstResult(begin);
+
+       /* Mark the targets that are next to the nodes found without passing through a super-node */
+
+       while(result)
+         {
+          if(!IsFakeNode(result->node))
+            {
+             int start=0,end=nanchors;
+
+             while(start<end)
+               {
+                int mid=(start+end)/2;
+
+                if(anchors[mid].node<result->node)
+                   start=mid+1;
+                else
+                   end=mid;
+               }
+
+             while(start<nanchors && anchors[start].node==result->node)
+                near[anchors[start++].target]=1;
+            }
+
+          result=NextResult(begin,result);
+         }
+
+       forward=FindForwardSuperRoutes(query,nodes,segments,ways,relations,profile,begin,
+                                      buckets,ends,finish_nodes,sorted_finish_nodes,ntargets,nreachable,
+                                      best_score,best_result,best_bucket);
+      }
+    else
+      {
+       /* No super-nodes can be reached so any route must be a direct one */
+
+       for(t=0;t<ntargets;t++)
+          near[t]=1;
+      }
+
+    /* Fill in the results for this source */
+
+    for(t=0;t<ntargets;t++)
+      {
+       distance_t distance=0;
+       duration_t duration=0;
+
+       if(finish_nodes[t]==NO_NODE)
+          continue;
+
+       if(near[t] && FindDirectRoute(nodes,segments,ways,relations,profile,quickest,&sources[s],&targets[t],&distance,&duration))
+         {
+          distances[s*ntargets+t]=distance;
+          durations[s*ntargets+t]=duration;
+         }
+       else if(best_result[t])
+         {
+          Result *result;
+          index_t prev_segment=NO_SEGMENT;
+          int nsteps=0,i;
+
+          /* The part of the route from the source to the super-node (found backwards) */
+
+          result=best_result[t];
+
+          while(result->prev)
+            {
+             steps=AddStep(steps,&nsteps,result->prev->node,result->segment);
+
+             result=result->prev;
+            }
+
+          if((result=result->next))
+             while(result->prev)
+               {
+                steps=AddStep(steps,&nsteps,result->prev->node,result->segment);
+
+                result=result->prev;
+               }
+
+          for(i=0;i<nsteps/2;i++)
+            {
+             Step temp=steps[i];
+             steps[i]=steps[nsteps-1-i];
+             steps[nsteps-1-i]=temp;
+            }
+
+          /* The part of the route across the super-nodes as far as the start of the final part */
+
+          result=buckets->data[best_bucket[t]].result;
+
+          while(result->next)
+            {
+             steps=AddStep(steps,&nsteps,result->node,result->next->segment);
+
+             result=result->next;
+            }
+
+          /* Add up the segments from the source (the previous segment is needed for the turn restrictions) */
+
+          for(i=0;i<nsteps;i++)
+             SegmentTotals(query,nodes,segments,ways,relations,profile,steps[i].node,steps[i].segment,&prev_segment,&distance,&duration);
+
+          /* The final part of the route is found again from the super-node in the same way as the router does */
+
+          if(IsFakeSegment(prev_segment))
+             prev_segment=IndexRealSegment(query,prev_segment);
+
+          if(result->node!=finish_nodes[t] &&
+             !RouteTotals(queries[t],nodes,segments,ways,relations,profile,result->node,finish_nodes[t],&prev_segment,&distance,&duration))
+             for(result=result->prev;result->next;result=result->next)
+                SegmentTotals(queries[t],nodes,segments,ways,relations,profile,result->node,result->next->segment,&prev_segment,&distance,&duration);
+
+          distances[s*ntargets+t]=distance;
+          durations[s*ntargets+t]=duration;
+         }
+      }
+
+    if(forward)
+       FreeResultsList(forward);
+
+    if(begin)
+       FreeResultsList(begin);
+
+    FreeQuery(query);
+   }
+
+ /* Free the memory */
+
+ for(t=0;t<ntargets;t++)
+   {
+    if(backs[t])
+       FreeResultsList(backs[t]);
+
+    if(ends[t])
+       FreeResultsList(ends[t]);
+
+    FreeQuery(queries[t]);
+   }
+
+ FreeBuckets(buckets);
+
+ free(queries);
+ free(ends);
+ free(backs);
+ if(anchors)
+    free(anchors);
+ if(steps)
+    free(steps);
+ free(finish_nodes);
+ free(sorted_finish_nodes);
+
+ free(best_score);
+ free(best_result);
+ free(best_bucket);
+ free(near);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Find the routes from every super-node to a specific node (by working backwards across the super-node graph from
+  the super-nodes at the start of the final part of the route).
+
+  Results *FindBackwardSuperRoutes Returns a set of results.
+
+  Query *query The query containing the routing options and the fake nodes and segments.
+
+  Nodes *nodes The set of nodes to use.
+
+  Segments *segments The set of segments to use.
+
+  Ways *ways The set of ways to use.
+
+  Relations *relations The set of relations to use.
+
+  Profile *profile The profile containing the transport type, speeds and allowed highways.
+
+  Results *end The final part of the route.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static Results *FindBackwardSuperRoutes(Query *query,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,Results *end)
+{
+ Results *results;
+ Queue   *queue;
+ Result  *result1,*result2,*result3;
+
+ /* Create the list of results and insert the super-nodes at the start of the final part of the route into the queue */
+
+ results=NewResultsList(16);
+ queue=NewQueueList(12);
+
+ results->finish_node=end->finish_node;
+
+ result3=FirstResult(end);
+
+ while(result3)
+   {
+    if(!IsFakeNode(result3->node) && !IsFakeSegment(result3->segment) &&
+       IsSuperNode(LookupNode(nodes,result3->node,1)) && IsSuperSegment(LookupSegment(segments,result3->segment,1)))
+      {
+       result2=InsertResult(results,result3->node,result3->segment);
+
+       result2->prev=result3; /* the final part of the route */
+       result2->score=result3->score;
+
+       InsertInQueue(queue,result2,result2->score);
+      }
+
+    result3=NextResult(end,result3);
+   }
+
+ /* Loop across all nodes in the queue */
+
+ while((result1=PopFromQueue(queue)))
+   {
+    Node *node1p,*node2p;
+    Segment *segmentp;
+    Way *wayp;
+    index_t node1,node2,seg1;
+    score_t segment_pref,segment_score,cumulative_score;
+    speed_t speedresult=0;
+    int i,turns;
+
+    node1=result1->node;
+    seg1=result1->segment;
+
+    /* The segment used to arrive at node1 is followed backwards to node2 */
+
+    segmentp=LookupSegment(segments,seg1,1); /* segment cannot be a fake segment (must be a super-segment) */
+
+    node2=OtherNode(segmentp,node1);
+
+    wayp=LookupWay(ways,segmentp->way,1);
+
+    /* must obey one-way restrictions (unless profile allows) */
+    if(profile->oneway && IsOnewayTo(segmentp,node2)) /* working backwards => disallow oneway *to* node2 */
+      {
+       if(profile->allow!=Transports_Bicycle)
+          continue;
+       if(!(wayp->props & Properties_DoubleSens))
+          continue;
+      }
+
+    /* mode of transport must be allowed on the highway */
+    if(!(wayp->allow&profile->allow))
+       continue;
+
+    /* must obey weight restriction (if exists) */
+    if(wayp->weight && wayp->weight<profile->weight)
+       continue;
+
+    /* must obey height/width/length restriction (if exist) */
+    if((wayp->height && wayp->height<profile->height) ||
+       (wayp->width  && wayp->width <profile->width ) ||
+       (wayp->length && wayp->length<profile->length))
+       continue;
+
+    segment_pref=profile->highway[HIGHWAY(wayp->type)];
+
+    /* highway preferences must allow this highway */
+    if(segment_pref==0)
+       continue;
+
+    for(i=1;i<Property_Count;i++)
+       if(ways->file.props & PROPERTIES(i))
+         {
+          if(wayp->props & PROPERTIES(i))
+             segment_pref*=profile->props_yes[i];
+          else
+             segment_pref*=profile->props_no[i];
+         }
+
+    /* profile preferences must allow this highway */
+    if(segment_pref==0)
+       continue;
+
+    node1p=LookupNode(nodes,node1,1); /* node1 cannot be a fake node (must be a super-node) */
+
+    /* mode of transport must be allowed through node1 unless it is the final node */
+    if(node1!=end->finish_node && !(node1p->allow&profile->allow))
+       continue;
+
+    if(query->quickest==0)
+       segment_score=(score_t)DISTANCE(segmentp->distance)/segment_pref;
+    else
+       segment_score=(score_t)Duration(node2,segmentp,wayp,profile,&speedresult)/segment_pref;
+
+    cumulative_score=result1->score+segment_score;
+
+    /* Loop across all super-segments that can be used to arrive at node2 */
+
+    node2p=LookupNode(nodes,node2,2); /* node2 cannot be a fake node (must be a super-node) */
+
+    turns=profile->turns && IsTurnRestrictedNode(node2p);
+
+    segmentp=FirstSegment(segments,node2p,1);
+
+    while(segmentp)
+      {
+       index_t seg2;
+
+       /* must be a super segment */
+       if(!IsSuperSegment(segmentp))
+          goto endloop;
+
+       seg2=IndexSegment(segments,segmentp); /* segment cannot be a fake segment (must be a super-segment) */
+
+       /* must not perform U-turn */
+       if(seg2==seg1)
+          goto endloop;
+
+       /* must obey turn relations */
+       if(turns)
+         {
+          index_t turnrelation=FindFirstTurnRelation2(relations,node2,seg2);
+
+          if(turnrelation!=NO_RELATION && !IsTurnAllowed(relations,turnrelation,node2,seg2,seg1,profile->allow))
+             goto endloop;
+         }
+
+       result2=FindResult(results,node2,seg2);
+
+       if(!result2) /* New start node/segment pair */
+         {
+          result2=InsertResult(results,node2,seg2);
+          result2->next=result1; /* working backwards */
+          result2->score=cumulative_score;
+         }
+       else if(result2->prev) /* The final part of the route starts here (the router goes no further) */
+          goto endloop;
+       else if(cumulative_score<result2->score) /* New start node/segment pair is better */
+         {
+          result2->next=result1; /* working backwards */
+          result2->score=cumulative_score;
+         }
+       else
+          goto endloop;
+
+       InsertInQueue(queue,result2,result2->score);
+
+      endloop:
+
+       segmentp=NextSegment(segments,segmentp,node2); /* node2 cannot be a fake node (must be a super-node) */
+      }
+
+    /* A route can also start at node2 if it is the start waypoint */
+
+    result2=FindResult(results,node2,NO_SEGMENT);
+
+    if(!result2)
+      {
+       result2=InsertResult(results,node2,NO_SEGMENT);
+       result2->next=result1; /* working backwards */
+       result2->score=cumulative_score;
+      }
+    else if(cumulative_score<result2->score)
+      {
+       result2->next=result1; /* working backwards */
+       result2->score=cumulative_score;
+      }
+   }
+
+ FreeQueueList(queue);
+
+ return(results);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Find the routes from a specific node to every super-node (working forwards across the super-node graph from
+  the super-nodes at the end of the initial part of the route) and check them against the buckets.
+
+  Results *FindForwardSuperRoutes Returns a set of results.
+
+  Query *query The query containing the routing options and the fake nodes and segments.
+
+  Nodes *nodes The set of nodes to use.
+
+  Segments *segments The set of segments to use.
+
+  Ways *ways The set of ways to use.
+
+  Relations *relations The set of relations to use.
+
+  Profile *profile The profile containing the transport type, speeds and allowed highways.
+
+  Results *begin The initial part of the route.
+
+  Buckets *buckets The buckets containing the scores to the targets.
+
+  Results **ends The final parts of the routes to the targets.
+
+  index_t *finish_nodes The target nodes (in target order).
+
+  index_t *sorted_finish_nodes The target nodes (in node order).
+
+  int nfinish The number of target nodes.
+
+  int nreachable The number of targets that have entries in the buckets.
+
+  score_t *best_score Returns the best score for each target.
+
+  Result **best_result Returns the result at which the best route for each target leaves this search.
+
+  uint32_t *best_bucket Returns the bucket at which the best route for each target joins the backward search.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static Results *FindForwardSuperRoutes(Query *query,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,Results *begin,
+                                       Buckets *buckets,Results **ends,index_t *finish_nodes,index_t *sorted_finish_nodes,int nfinish,int nreachable,
+                                       score_t *best_score,Result **best_result,uint32_t *best_bucket)
+{
+ Results *results;
+ Queue   *queue;
+ Result  *result1,*result2,*result3;
+ score_t bound_score=INF_SCORE;
+ int     nfound=0;
+
+ /* Create the list of results and insert the finish points of the beginning part of the path into the queue,
+    translating the segments into super-segments. */
+
+ results=NewResultsList(16);
+ queue=NewQueueList(12);
+
+ results->start_node=begin->start_node;
+ results->prev_segment=NO_SEGMENT;
+
+ result1=InsertResult(results,results->start_node,results->prev_segment);
+
+ result3=FirstResult(begin);
+
+ while(result3)
+   {
+    if((results->start_node!=result3->node || results->prev_segment!=result3->segment) &&
+       !IsFakeNode(result3->node) && IsSuperNode(LookupNode(nodes,result3->node,5)))
+      {
+       index_t superseg=FindSuperSegment(query,nodes,segments,ways,relations,result3->node,result3->segment);
+
+       result2=FindResult(results,result3->node,superseg);
+
+       if(!result2)
+         {
+          result2=InsertResult(results,result3->node,superseg);
+          result2->next=result3; /* the initial part of the route */
+          result2->score=result3->score;
+
+          InsertInQueue(queue,result2,result2->score);
+         }
+       else if(result3->score<result2->score)
+         {
+          result2->next=result3; /* the initial part of the route */
+          result2->score=result3->score;
+
+          InsertInQueue(queue,result2,result2->score);
+         }
+      }
+
+    result3=NextResult(begin,result3);
+   }
+
+ if(begin->number==1)
+    InsertInQueue(queue,result1,0);
+
+ /* Loop across all nodes in the queue */
+
+ while((result1=PopFromQueue(queue)))
+   {
+    Node *node1p;
+    Segment *segmentp;
+    index_t node1,seg1;
+    index_t turnrelation=NO_RELATION;
+    uint32_t bucket;
+    int barrier;
+
+    /* no better route to any target is possible */
+    if(result1->score>=bound_score)
+       break;
+
+    node1=result1->node;
+    seg1=result1->segment;
+
+    node1p=LookupNode(nodes,node1,1); /* node1 cannot be a fake node (must be a super-node) */
+
+    /* a node that does not allow the mode of transport can only be reached if it is a target */
+    barrier=(node1!=results->start_node && !(node1p->allow&profile->allow));
+
+    /* check the buckets for the targets that can be reached from here */
+
+    for(bucket=buckets->bins[HASH_NODE_SEGMENT(node1,seg1)&buckets->mask];bucket!=NO_BUCKET;bucket=buckets->data[bucket].hashnext)
+       if(buckets->data[bucket].node==node1 && buckets->data[bucket].segment==seg1 &&
+          (!barrier || finish_nodes[buckets->data[bucket].target]==node1))
+         {
+          uint32_t target=buckets->data[bucket].target;
+          score_t score=result1->score+buckets->data[bucket].score;
+
+          if(score>=best_score[target])
+             continue;
+
+          /* the router does not go past a super-node where the final part of the route can start */
+
+          for(result3=result1->prev;result3 && result3->prev;result3=result3->prev)
+             if(FindResult(ends[target],result3->node,result3->segment))
+                break;
+
+          if(!result3 || !result3->prev)
+            {
+             if(best_score[target]==INF_SCORE)
+                nfound++;
+
+             best_score[target]=score;
+             best_result[target]=result1;
+             best_bucket[target]=bucket;
+
+             /* once every target has been found the search can stop at the worst of them */
+
+             if(nfound==nreachable)
+               {
+                int t;
+
+                bound_score=0;
+
+                for(t=0;t<nfinish;t++)
+                   if(best_score[t]!=INF_SCORE && best_score[t]>bound_score)
+                      bound_score=best_score[t];
+               }
+            }
+         }
+
+    /* the route cannot continue through a target node that does not allow the mode of transport */
+    if(barrier)
+       continue;
+
+    /* lookup if a turn restriction applies */
+    if(profile->turns && IsTurnRestrictedNode(node1p)) /* node1 cannot be a fake node (must be a super-node) */
+       turnrelation=FindFirstTurnRelation2(relations,node1,seg1);
+
+    /* Loop across all segments */
+
+    segmentp=FirstSegment(segments,node1p,1); /* node1 cannot be a fake node (must be a super-node) */
+
+    while(segmentp)
+      {
+       Node *node2p;
+       Way *wayp;
+       index_t node2,seg2;
+       score_t segment_pref,segment_score,cumulative_score;
+       int i;
+       speed_t speedresult=0;
+
+       /* must be a super segment */
+       if(!IsSuperSegment(segmentp))
+          goto endloop;
+
+       wayp=LookupWay(ways,segmentp->way,1);
+
+       /* must obey one-way restrictions (unless profile allows) */
+       if(profile->oneway && IsOnewayTo(segmentp,node1))
+         {
+          if(profile->allow!=Transports_Bicycle)
+             goto endloop;
+          if(!(wayp->props & Properties_DoubleSens))
+             goto endloop;
+         }
+
+       seg2=IndexSegment(segments,segmentp); /* segment cannot be a fake segment (must be a super-segment) */
+
+       /* must not perform U-turn */
+       if(seg1==seg2)
+          goto endloop;
+
+       /* must obey turn relations */
+       if(turnrelation!=NO_RELATION && !IsTurnAllowed(relations,turnrelation,node1,seg1,seg2,profile->allow))
+          goto endloop;
+
+       /* mode of transport must be allowed on the highway */
+       if(!(wayp->allow&profile->allow))
+          goto endloop;
+
+       /* must obey weight restriction (if exists) */
+       if(wayp->weight && wayp->weight<profile->weight)
+          goto endloop;
+
+       /* must obey height/width/length restriction (if exist) */
+       if((wayp->height && wayp->height<profile->height) ||
+          (wayp->width  && wayp->width <profile->width ) ||
+          (wayp->length && wayp->length<profile->length))
+          goto endloop;
+
+       segment_pref=profile->highway[HIGHWAY(wayp->type)];
+
+       /* highway preferences must allow this highway */
+       if(segment_pref==0)
+          goto endloop;
+
+       for(i=1;i<Property_Count;i++)
+          if(ways->file.props & PROPERTIES(i))
+            {
+             if(wayp->props & PROPERTIES(i))
+                segment_pref*=profile->props_yes[i];
+             else
+                segment_pref*=profile->props_no[i];
+            }
+
+       /* profile preferences must allow this highway */
+       if(segment_pref==0)
+          goto endloop;
+
+       node2=OtherNode(segmentp,node1);
+
+       node2p=LookupNode(nodes,node2,2); /* node2 cannot be a fake node (must be a super-node) */
+
+       /* mode of transport must be allowed through node2 unless it is a final node */
+       if(!(node2p->allow&profile->allow))
+         {
+          int start=0,end=nfinish;
+
+          while(start<end)
+            {
+             int mid=(start+end)/2;
+
+             if(sorted_finish_nodes[mid]<node2)
+                start=mid+1;
+             else
+                end=mid;
+            }
+
+          if(start==nfinish || sorted_finish_nodes[start]!=node2)
+             goto endloop;
+         }
+
+       if(query->quickest==0)
+          segment_score=(score_t)DISTANCE(segmentp->distance)/segment_pref;
+       else
+          segment_score=(score_t)Duration(node1,segmentp,wayp,profile,&speedresult)/segment_pref;
+
+       cumulative_score=result1->score+segment_score;
+
+       /* score must be better than the worst of the best scores */
+       if(cumulative_score>=bound_score)
+          goto endloop;
+
+       result2=FindResult(results,node2,seg2);
+
+       if(!result2) /* New end node/segment pair */
+         {
+          result2=InsertResult(results,node2,seg2);
+          result2->prev=result1;
+          result2->score=cumulative_score;
+         }
+       else if(cumulative_score<result2->score) /* New end node/segment pair is better */
+         {
+          result2->prev=result1;
+          result2->score=cumulative_score;
+         }
+       else
+          goto endloop;
+
+       InsertInQueue(queue,result2,result2->score);
+
+      endloop:
+
+       segmentp=NextSegment(segments,segmentp,node1); /* node1 cannot be a fake node (must be a super-node) */
+      }
+   }
+
+ FreeQueueList(queue);
+
+ return(results);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Find a route between a source and a target that are close together (in the same way as the router does when
+  the finish point is found before any super-nodes).
+
+  int FindDirectRoute Returns 1 if a direct route was found.
+
+  Nodes *nodes The set of nodes to use.
+
+  Segments *segments The set of segments to use.
+
+  Ways *ways The set of ways to use.
+
+  Relations *relations The set of relations to use.
+
+  Profile *profile The profile containing the transport type, speeds and allowed highways.
+
+  int quickest Set to calculate the quickest route instead of the shortest.
+
+  MatrixPoint *source The source point.
+
+  MatrixPoint *target The target point.
+
+  distance_t *distance Returns the distance of the route.
+
+  duration_t *duration Returns the duration of the route.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int FindDirectRoute(Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,int quickest,
+                           MatrixPoint *source,MatrixPoint *target,distance_t *distance,duration_t *duration)
+{
+ Query *query;
+ Results *results;
+ index_t start_node,finish_node;
+ int found=0;
+
+ query=NewQuery(quickest);
+
+ start_node =MatrixPointNode(query,nodes,segments,1,source);
+ finish_node=MatrixPointNode(query,nodes,segments,2,target);
+
+ if(start_node==finish_node)
+   {
+    FreeQuery(query);
+
+    *distance=0;
+    *duration=0;
+
+    return(1);
+   }
+
+ results=FindStartRoutes(query,nodes,segments,ways,relations,profile,start_node,NO_SEGMENT,finish_node);
+
+ if(results && results->finish_node!=NO_NODE)
+   {
+    Result *result;
+    index_t prev_segment=NO_SEGMENT;
+
+    results=ExtendStartRoutes(query,nodes,segments,ways,relations,profile,results,finish_node);
+
+    result=FindResult(results,results->start_node,results->prev_segment);
+
+    for(result=result->next;result;result=result->next)
+       SegmentTotals(query,nodes,segments,ways,relations,profile,result->prev->node,result->segment,&prev_segment,distance,duration);
+
+    found=1;
+   }
+
+ if(results)
+    FreeResultsList(results);
+
+ FreeQuery(query);
+
+ return(found);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Find the node for a matrix point, creating the fake node and segments if needed.
+
+  index_t MatrixPointNode Returns the node index (real or fake) or NO_NODE if there is none.
+
+  Query *query The query to contain the fake nodes and segments.
+
+  Nodes *nodes The set of nodes to use.
+
+  Segments *segments The set of segments to use.
+
+  int point Which of the waypoints in the query this is.
+
+  MatrixPoint *matrixpoint The matrix point.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static index_t MatrixPointNode(Query *query,Nodes *nodes,Segments *segments,int point,MatrixPoint *matrixpoint)
+{
+ if(matrixpoint->segment==NO_SEGMENT)
+    return(matrixpoint->node);
+
+ return(CreateFakes(query,nodes,segments,point,LookupSegment(segments,matrixpoint->segment,1),
+                    matrixpoint->node1,matrixpoint->node2,matrixpoint->dist1,matrixpoint->dist2));
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Add a node to the list of nodes next to the targets.
+
+  Anchor *AddAnchor Returns the (possibly reallocated) list of anchors.
+
+  Anchor *anchors The list of anchors.
+
+  int *nanchors The number of anchors (updated).
+
+  index_t node The node.
+
+  uint32_t target The target that it is next to.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static Anchor *AddAnchor(Anchor *anchors,int *nanchors,index_t node,uint32_t target)
+{
+ if(!(*nanchors%256))
+    anchors=(Anchor*)realloc((void*)anchors,(*nanchors+256)*sizeof(Anchor));
+
+ anchors[*nanchors].node=node;
+ anchors[*nanchors].target=target;
+
+ (*nanchors)++;
+
+ return(anchors);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Add a step to the list of steps of a route.
+
+  Step *AddStep Returns the (possibly reallocated) list of steps.
+
+  Step *steps The list of steps.
+
+  int *nsteps The number of steps (updated).
+
+  index_t node The node that the segment is followed from.
+
+  index_t segment The segment.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static Step *AddStep(Step *steps,int *nsteps,index_t node,index_t segment)
+{
+ if(!(*nsteps%256))
+    steps=(Step*)realloc((void*)steps,(*nsteps+256)*sizeof(Step));
+
+ steps[*nsteps].node=node;
+ steps[*nsteps].segment=segment;
+
+ (*nsteps)++;
+
+ return(steps);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Add the distance and duration of the optimum route between two nodes to the totals (in the same way as the router
+  does for each super-segment of a route and for the final part of it).
+
+  int RouteTotals Returns 1 if a route was found.
+
+  Query *query The query containing the fake nodes and segments.
+
+  Nodes *nodes The set of nodes to use.
+
+  Segments *segments The set of segments to use.
+
+  Ways *ways The set of ways to use.
+
+  Relations *relations The set of relations to use.
+
+  Profile *profile The profile containing the transport type, speeds and allowed highways.
+
+  index_t start_node The start node.
+
+  index_t finish_node The finish node.
+
+  index_t *prev_segment The previous normal segment of the route (updated).
+
+  distance_t *distance The total distance to add to.
+
+  duration_t *duration The total duration to add to.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int RouteTotals(Query *query,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,
+                       index_t start_node,index_t finish_node,index_t *prev_segment,distance_t *distance,duration_t *duration)
+{
+ Results *results;
+ Result *result;
+
+ results=FindNormalRoute(query,nodes,segments,ways,relations,profile,start_node,*prev_segment,finish_node);
+
+ if(!results)
+    return(0);
+
+ result=FindResult(results,start_node,*prev_segment);
+
+ for(result=result->next;result;result=result->next)
+    SegmentTotals(query,nodes,segments,ways,relations,profile,result->prev->node,result->segment,prev_segment,distance,duration);
+
+ FreeResultsList(results);
+
+ return(1);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Add the distance and duration of a segment to the totals.
+
+  Query *query The query containing the fake nodes and segments.
+
+  Nodes *nodes The set of nodes to use.
+
+  Segments *segments The set of segments to use.
+
+  Ways *ways The set of ways to use.
+
+  Relations *relations The set of relations to use.
+
+  Profile *profile The profile containing the transport type, speeds and allowed highways.
+
+  index_t node The node that the segment is followed from.
+
+  index_t segment The segment (real, super or fake).
+
+  index_t *prev_segment The previous normal segment of the route (updated).
+
+  distance_t *distance The total distance to add to.
+
+  duration_t *duration The total duration to add to.
+
+  The gradients stored in a super-segment are the largest ones along it so its duration is found by adding up the
+  normal segments between its super-nodes in the same way as the router does when it prints a route.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void SegmentTotals(Query *query,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,
+                          index_t node,index_t segment,index_t *prev_segment,distance_t *distance,duration_t *duration)
+{
+ Segment *segmentp;
+ Way *wayp;
+ speed_t speedresult=0;
+
+ if(IsFakeSegment(segment))
+    segmentp=LookupFakeSegment(query,segment);
+ else
+    segmentp=LookupSegment(segments,segment,1);
+
+ if(!IsFakeSegment(segment) && !IsNormalSegment(segmentp) &&
+    RouteTotals(query,nodes,segments,ways,relations,profile,node,OtherNode(segmentp,node),prev_segment,distance,duration))
+    return;
+
+ wayp=LookupWay(ways,segmentp->way,1);
+
+ *distance+=DISTANCE(segmentp->distance);
+ *duration+=Duration(node,segmentp,wayp,profile,&speedresult);
+
+ *prev_segment=segment;
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Allocate a new set of buckets.
+
+  Buckets *NewBuckets Returns the buckets.
+
+  uint8_t log2bins The base 2 logarithm of the initial number of bins in the hash table.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static Buckets *NewBuckets(uint8_t log2bins)
+{
+ Buckets *buckets;
+ uint32_t i;
+
+ buckets=(Buckets*)malloc(sizeof(Buckets));
+
+ buckets->nbins=1<<log2bins;
+ buckets->mask=buckets->nbins-1;
+
+ buckets->bins=(uint32_t*)malloc(buckets->nbins*sizeof(uint32_t));
+
+ for(i=0;i<buckets->nbins;i++)
+    buckets->bins[i]=NO_BUCKET;
+
+ buckets->number=0;
+ buckets->nalloc=buckets->nbins;
+
+ buckets->data=(Bucket*)malloc(buckets->nalloc*sizeof(Bucket));
+
+ return(buckets);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Free a set of buckets.
+
+  Buckets *buckets The buckets to free.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void FreeBuckets(Buckets *buckets)
+{
+ free(buckets->bins);
+ free(buckets->data);
+
+ free(buckets);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Add an entry to the buckets (the hash table is doubled in size when it gets full).
+
+  Buckets *buckets The buckets to add to.
+
+  index_t node The super-node.
+
+  index_t segment The super-segment used to arrive at the super-node.
+
+  uint32_t target The target.
+
+  score_t score The score from the super-node to the target.
+
+  Result *result The result in the backward search from the target.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void AddBucket(Buckets *buckets,index_t node,index_t segment,uint32_t target,score_t score,Result *result)
+{
+ uint32_t bin;
+
+ if(buckets->number==buckets->nalloc)
+   {
+    uint32_t i;
+
+    buckets->nalloc<<=1;
+    buckets->data=(Bucket*)realloc((void*)buckets->data,buckets->nalloc*sizeof(Bucket));
+
+    buckets->nbins<<=1;
+    buckets->mask=buckets->nbins-1;
+    buckets->bins=(uint32_t*)realloc((void*)buckets->bins,buckets->nbins*sizeof(uint32_t));
+
+    for(i=0;i<buckets->nbins;i++)
+       buckets->bins[i]=NO_BUCKET;
+
+    for(i=0;i<buckets->number;i++)
+      {
+       bin=HASH_NODE_SEGMENT(buckets->data[i].node,buckets->data[i].segment)&buckets->mask;
+
+       buckets->data[i].hashnext=buckets->bins[bin];
+       buckets->bins[bin]=i;
+      }
+   }
+
+ bin=HASH_NODE_SEGMENT(node,segment)&buckets->mask;
+
+ buckets->data[buckets->number].node=node;
+ buckets->data[buckets->number].segment=segment;
+ buckets->data[buckets->number].target=target;
+ buckets->data[buckets->number].score=score;
+ buckets->data[buckets->number].result=result;
+
+ buckets->data[buckets->number].hashnext=buckets->bins[bin];
+ buckets->bins[bin]=buckets->number;
+
+ buckets->number++;
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Sort the anchors or target nodes into node order.
+
+  int sort_by_node Returns the comparison of the node fields.
+
+  const void *a The first anchor or node.
+
+  const void *b The second anchor or node.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int sort_by_node(const void *a,const void *b)
+{
+ index_t a_node=*(const index_t*)a;
+ index_t b_node=*(const index_t*)b;
+
+ if(a_node<b_node)
+    return(-1);
+ else if(a_node>b_node)
+    return(1);
+ else
+    return(0);
+}
@@ -0,0 +1,54 @@
+/***************************************
+ Header file for the many-to-many route matrix.
+
+ Part of the Routino routing software.
+ ******************/ /******************
+ This file Copyright 2008-2013 Andrew M. Bishop
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************/
+
+
+#ifndef MATRIX_H
+#define MATRIX_H    /*+ To stop multiple inclusions. +*/
+
+#include "types.h"
+
+#include "profiles.h"
+
+
+/* Data structures */
+
+/*+ A source or target point for the matrix. +*/
+typedef struct _MatrixPoint
+{
+ index_t    node;               /*+ The node closest to the point (or NO_NODE if on a segment or none found). +*/
+
+ index_t    segment;            /*+ The segment closest to the point (or NO_SEGMENT if at a node). +*/
+ index_t    node1;              /*+ The first node at the end of the segment. +*/
+ index_t    node2;              /*+ The second node at the end of the segment. +*/
+ distance_t dist1;              /*+ The distance along the segment to the first node. +*/
+ distance_t dist2;              /*+ The distance along the segment to the second node. +*/
+}
+ MatrixPoint;
+
+
+/* Functions in matrix.c */
+
+void CalculateMatrix(Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,int quickest,
+                     MatrixPoint *sources,int nsources,MatrixPoint *targets,int ntargets,
+                     distance_t *distances,duration_t *durations);
+
+
+#endif /* MATRIX_H */
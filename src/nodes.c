@@ -20,6 +20,7 @@
  ***************************************/
 
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
 
@@ -35,6 +36,7 @@
 /* Local functions */
 
 static int valid_segment_for_profile(Ways *ways,Segment *segmentp,Profile *profile);
+static void check_nodes_version(Nodes *nodes,const char *filename);
 
 
 /*++++++++++++++++++++++++++++++++++++++
@@ -62,11 +64,15 @@ Nodes *LoadNodeList(const char *filename)
 
  nodes->file=*((NodesFile*)nodes->data);
 
+ check_nodes_version(nodes,filename);
+
  /* Set the pointers in the Nodes structure. */
 
  nodes->offsets=(index_t*)(nodes->data+sizeof(NodesFile));
  nodes->nodes  =(Node*   )(nodes->data+sizeof(NodesFile)+(nodes->file.latbins*nodes->file.lonbins+1)*sizeof(index_t));
 
+ nodes->elevations=(elevation_t*)(nodes->nodes+nodes->file.number);
+
 #else
 
  nodes->fd=SlimMapFile(filename);
@@ -75,6 +81,8 @@ Nodes *LoadNodeList(const char *filename)
 
  SlimFetch(nodes->fd,&nodes->file,sizeof(NodesFile),0);
 
+ check_nodes_version(nodes,filename);
+
  sizeoffsets=(nodes->file.latbins*nodes->file.lonbins+1)*sizeof(index_t);
 
  nodes->offsets=(index_t*)malloc(sizeoffsets);
@@ -83,6 +91,8 @@ Nodes *LoadNodeList(const char *filename)
 
  nodes->nodesoffset=sizeof(NodesFile)+sizeoffsets;
 
+ nodes->elevationsoffset=nodes->nodesoffset+(off_t)nodes->file.number*sizeof(Node);
+
  nodes->cache=NewNodeCache();
 
 #endif
@@ -91,6 +101,33 @@ Nodes *LoadNodeList(const char *filename)
 }
 
 
+/*++++++++++++++++++++++++++++++++++++++
+  Check that the nodes file has the current format (it has the elevation of each node after the nodes).
+
+  Nodes *nodes The node list with the header copied from the file.
+
+  const char *filename The name of the file.
+
+  A file from before the version was stored has the number of nodes where the version is now so the size of the
+  file is checked against the header as well.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void check_nodes_version(Nodes *nodes,const char *filename)
+{
+ off_t size;
+
+ size=(off_t)sizeof(NodesFile)+((off_t)nodes->file.latbins*(off_t)nodes->file.lonbins+1)*(off_t)sizeof(index_t)+
+      (off_t)nodes->file.number*(off_t)(sizeof(Node)+sizeof(elevation_t));
+
+ if(nodes->file.version!=NODES_FILE_VERSION || SizeFile(filename)!=size)
+   {
+    fprintf(stderr,"The nodes file '%s' does not have format version %d (run planetsplitter again).\n",
+            filename,NODES_FILE_VERSION);
+    exit(EXIT_FAILURE);
+   }
+}
+
+
 /*++++++++++++++++++++++++++++++++++++++
   Destroy the node list.
 
@@ -117,6 +154,51 @@ void DestroyNodeList(Nodes *nodes)
 }
 
 
+/*++++++++++++++++++++++++++++++++++++++
+  Create a copy of a node list that shares the loaded data but has its own cache so that
+  each copy can be used by a different thread.
+
+  Nodes *DuplicateNodeList Returns the new node list.
+
+  Nodes *nodes The node list to copy.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+Nodes *DuplicateNodeList(Nodes *nodes)
+{
+ Nodes *newnodes;
+
+ newnodes=(Nodes*)malloc(sizeof(Nodes));
+
+ *newnodes=*nodes;
+
+#if SLIM
+
+ newnodes->cache=NewNodeCache();
+
+#endif
+
+ return(newnodes);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Destroy a copy of a node list created by DuplicateNodeList() (the shared data is kept).
+
+  Nodes *nodes The node list copy to destroy.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+void DestroyDuplicateNodeList(Nodes *nodes)
+{
+#if SLIM
+
+ DeleteNodeCache(nodes->cache);
+
+#endif
+
+ free(nodes);
+}
+
+
 /*++++++++++++++++++++++++++++++++++++++
   Find the closest node given its latitude, longitude and the profile of the
   mode of transport that must be able to move to/from this node.
@@ -615,3 +697,31 @@ void GetLatLong(Nodes *nodes,index_t index,Node *nodep,double *latitude,double *
  *latitude =latlong_to_radians(bin_to_latlong(nodes->file.latzero+latbin)+off_to_latlong(nodep->latoffset));
  *longitude=latlong_to_radians(bin_to_latlong(nodes->file.lonzero+lonbin)+off_to_latlong(nodep->lonoffset));
 }
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Get the elevation associated with a node.
+
+  elevation_t GetElevation Returns the elevation (or NO_ELEVATION if unknown).
+
+  Nodes *nodes The set of nodes to use.
+
+  index_t index The node index.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+elevation_t GetElevation(Nodes *nodes,index_t index)
+{
+#if !SLIM
+
+ return(nodes->elevations[index]);
+
+#else
+
+ elevation_t elevation;
+
+ SlimFetch(nodes->fd,&elevation,sizeof(elevation_t),nodes->elevationsoffset+(off_t)index*sizeof(elevation_t));
+
+ return(elevation);
+
+#endif
+}
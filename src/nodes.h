@@ -33,6 +33,12 @@
 #include "profiles.h"
 
 
+/* Constants */
+
+/*+ The version of the nodes file format (changed when the Node structure or the data after it changes). +*/
+#define NODES_FILE_VERSION 2
+
+
 /* Data structures */
 
 
@@ -52,6 +58,8 @@ struct _Node
 /*+ A structure containing the header from the file. +*/
 typedef struct _NodesFile
 {
+ uint32_t version;              /*+ The version of the file format. +*/
+
  index_t  number;               /*+ The number of nodes in total. +*/
  index_t  snumber;              /*+ The number of super-nodes. +*/
 
@@ -77,6 +85,8 @@ struct _Nodes
 
  Node     *nodes;               /*+ A pointer to the array of nodes in the file. +*/
 
+ elevation_t *elevations;       /*+ A pointer to the array of node elevations in the file. +*/
+
 #else
 
  int       fd;                  /*+ The file descriptor for the file. +*/
@@ -85,6 +95,8 @@ struct _Nodes
 
  off_t     nodesoffset;         /*+ The offset of the nodes within the file. +*/
 
+ off_t     elevationsoffset;    /*+ The offset of the node elevations within the file. +*/
+
  Node      cached[6];           /*+ Some cached nodes read from the file in slim mode. +*/
 
  NodeCache *cache;              /*+ A RAM cache of nodes read from the file. +*/
@@ -99,6 +111,10 @@ Nodes *LoadNodeList(const char *filename);
 
 void DestroyNodeList(Nodes *nodes);
 
+Nodes *DuplicateNodeList(Nodes *nodes);
+
+void DestroyDuplicateNodeList(Nodes *nodes);
+
 index_t FindClosestNode(Nodes *nodes,Segments *segments,Ways *ways,double latitude,double longitude,
                         distance_t distance,Profile *profile,distance_t *bestdist);
 
@@ -108,6 +124,8 @@ index_t FindClosestSegment(Nodes *nodes,Segments *segments,Ways *ways,double lat
 
 void GetLatLong(Nodes *nodes,index_t index,Node *nodep,double *latitude,double *longitude);
 
+elevation_t GetElevation(Nodes *nodes,index_t index);
+
 
 /* Macros and inline functions */
 
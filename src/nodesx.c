@@ -20,6 +20,7 @@
  ***************************************/
 
 
+#include <math.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -35,6 +36,8 @@
 #include "logging.h"
 #include "sorting.h"
 
+#include "srtmHgtReader.h"
+
 
 /* Global variables */
 
@@ -50,10 +53,12 @@ static latlong_t lat_min,lat_max,lon_min,lon_max;
 /* Local functions */
 
 static int sort_by_id(NodeX *a,NodeX *b);
+static uint64_t key_by_id(NodeX *nodex);
 static int deduplicate_and_index_by_id(NodeX *nodex,index_t index);
 
 static int update_id(NodeX *nodex,index_t index);
 static int sort_by_lat_long(NodeX *a,NodeX *b);
+static uint64_t key_by_lat_long(NodeX *nodex);
 static int index_by_lat_long(NodeX *nodex,index_t index);
 
 
@@ -75,8 +80,8 @@ NodesX *NewNodeList(int append,int readonly)
 
  logassert(nodesx,"Failed to allocate memory (try using slim mode?)"); /* Check calloc() worked */
 
- nodesx->filename    =(char*)malloc(strlen(option_tmpdirname)+32);
- nodesx->filename_tmp=(char*)malloc(strlen(option_tmpdirname)+32);
+ nodesx->filename    =(char*)malloc(strlen(option_tmpdirname)+48);
+ nodesx->filename_tmp=(char*)malloc(strlen(option_tmpdirname)+48);
 
  sprintf(nodesx->filename    ,"%s/nodesx.parsed.mem",option_tmpdirname);
  sprintf(nodesx->filename_tmp,"%s/nodesx.%p.tmp"    ,option_tmpdirname,(void*)nodesx);
@@ -96,7 +101,7 @@ NodesX *NewNodeList(int append,int readonly)
  if(append)
     nodesx->fd=OpenFileBufferedAppend(nodesx->filename_tmp);
  else if(!readonly)
-    nodesx->fd=OpenFileBufferedNew(nodesx->filename_tmp);
+    nodesx->fd=OpenFileBufferedNewTemporary(nodesx->filename_tmp);
  else
     nodesx->fd=-1;
 
@@ -171,6 +176,7 @@ void AppendNodeList(NodesX *nodesx,node_t id,double latitude,double longitude,tr
  nodex.longitude=radians_to_latlong(longitude);
  nodex.allow=allow;
  nodex.flags=flags;
+ nodex.elevation=NO_ELEVATION;
 
  WriteFileBuffered(nodesx->fd,&nodex,sizeof(NodeX));
 
@@ -287,9 +293,10 @@ void SortNodeList(NodesX *nodesx)
 
  sortnodesx=nodesx;
 
- nodesx->number=filesort_fixed(nodesx->fd,fd,sizeof(NodeX),NULL,
-                                                           (int (*)(const void*,const void*))sort_by_id,
-                                                           (int (*)(void*,index_t))deduplicate_and_index_by_id);
+ nodesx->number=filesort_fixed_key(nodesx->fd,fd,sizeof(NodeX),NULL,
+                                                               (uint64_t (*)(const void*))key_by_id,
+                                                               (int (*)(const void*,const void*))sort_by_id,
+                                                               (int (*)(void*,index_t))deduplicate_and_index_by_id);
 
  nodesx->knumber=nodesx->number;
 
@@ -328,6 +335,20 @@ static int sort_by_id(NodeX *a,NodeX *b)
 }
 
 
+/*++++++++++++++++++++++++++++++++++++++
+  Calculate the key for sorting the nodes into id order.
+
+  uint64_t key_by_id Returns the sort key (the id field).
+
+  NodeX *nodex The extended node.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static uint64_t key_by_id(NodeX *nodex)
+{
+ return(nodex->id);
+}
+
+
 /*++++++++++++++++++++++++++++++++++++++
   Create the index of identifiers and discard duplicate nodes.
 
@@ -483,6 +504,75 @@ void RemoveNonHighwayNodes(NodesX *nodesx,WaysX *waysx,int keep)
 }
 
 
+/*++++++++++++++++++++++++++++++++++++++
+  Calculate the elevation of each node from the SRTM data.
+
+  NodesX *nodesx The set of nodes to modify.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+void CalculateNodeElevations(NodesX *nodesx)
+{
+ TSrtmCache *cache;
+ NodeX nodex;
+ index_t total=0;
+ int fd;
+ int srtmloads,srtmevictions;
+
+ /* Print the start message */
+
+ printf_first("Calculating Node Elevations: Nodes=0");
+
+ cache=srtmNewCache();
+
+ /* Re-open the file read-only and a new file writeable */
+
+ nodesx->fd=ReOpenFileBuffered(nodesx->filename_tmp);
+
+ DeleteFile(nodesx->filename_tmp);
+
+ fd=OpenFileBufferedNew(nodesx->filename_tmp);
+
+ /* Modify the on-disk image */
+
+ while(!ReadFileBuffered(nodesx->fd,&nodex,sizeof(NodeX)))
+   {
+    double elevation=srtmGetElevation(cache,radians_to_degrees(latlong_to_radians(nodex.latitude)),
+                                            radians_to_degrees(latlong_to_radians(nodex.longitude)));
+
+    if(elevation==SRTM_VOID)
+       nodex.elevation=NO_ELEVATION;
+    else if(elevation<elevation_to_metres(NO_ELEVATION+1))
+       nodex.elevation=NO_ELEVATION+1;
+    else if(elevation>elevation_to_metres(INT16_MAX))
+       nodex.elevation=INT16_MAX;
+    else
+       nodex.elevation=metres_to_elevation(elevation);
+
+    WriteFileBuffered(fd,&nodex,sizeof(NodeX));
+
+    total++;
+
+    if(!(total%10000))
+       printf_middle("Calculating Node Elevations: Nodes=%"Pindex_t,total);
+   }
+
+ /* Close the files */
+
+ nodesx->fd=CloseFileBuffered(nodesx->fd);
+ CloseFileBuffered(fd);
+
+ /* Release the elevation data */
+
+ srtmGetStatistics(cache,&srtmloads,&srtmevictions);
+
+ srtmClose(cache);
+
+ /* Print the final message */
+
+ printf_last("Calculated Node Elevations: Nodes=%"Pindex_t" SRTM Tiles Loaded=%d Evicted=%d",total,srtmloads,srtmevictions);
+}
+
+
 /*++++++++++++++++++++++++++++++++++++++
   Remove any nodes that have been pruned.
 
@@ -599,9 +689,10 @@ void SortNodeListGeographically(NodesX *nodesx)
 
  sortnodesx=nodesx;
 
- filesort_fixed(nodesx->fd,fd,sizeof(NodeX),(int (*)(void*,index_t))update_id,
-                                            (int (*)(const void*,const void*))sort_by_lat_long,
-                                            (int (*)(void*,index_t))index_by_lat_long);
+ filesort_fixed_key(nodesx->fd,fd,sizeof(NodeX),(int (*)(void*,index_t))update_id,
+                                                (uint64_t (*)(const void*))key_by_lat_long,
+                                                (int (*)(const void*,const void*))sort_by_lat_long,
+                                                (int (*)(void*,index_t))index_by_lat_long);
 
  /* Close the files */
 
@@ -703,6 +794,27 @@ static int sort_by_lat_long(NodeX *a,NodeX *b)
 }
 
 
+/*++++++++++++++++++++++++++++++++++++++
+  Calculate the key for sorting the nodes geographically (the same order as sort_by_lat_long()).
+
+  uint64_t key_by_lat_long Returns the sort key (longitude bin, latitude bin, longitude offset,
+                           latitude offset).
+
+  NodeX *nodex The extended node.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static uint64_t key_by_lat_long(NodeX *nodex)
+{
+ ll_bin_t lon_bin=latlong_to_bin(nodex->longitude);
+ ll_bin_t lat_bin=latlong_to_bin(nodex->latitude);
+ ll_off_t lon_off=latlong_to_off(nodex->longitude);
+ ll_off_t lat_off=latlong_to_off(nodex->latitude);
+
+ return(((uint64_t)(uint16_t)(lon_bin^0x8000)<<48)|((uint64_t)(uint16_t)(lat_bin^0x8000)<<32)|
+        ((uint64_t)lon_off<<16)|lat_off);
+}
+
+
 /*++++++++++++++++++++++++++++++++++++++
   Create the index between the sorted and unsorted nodes.
 
@@ -812,6 +924,21 @@ void SaveNodeList(NodesX *nodesx,const char *filename,SegmentsX *segmentsx)
 
  nodesx->fd=CloseFileBuffered(nodesx->fd);
 
+ /* Write out the node elevations (after all of the nodes) */
+
+ nodesx->fd=ReOpenFileBuffered(nodesx->filename_tmp);
+
+ for(i=0;i<nodesx->number;i++)
+   {
+    NodeX nodex;
+
+    ReadFileBuffered(nodesx->fd,&nodex,sizeof(NodeX));
+
+    WriteFileBuffered(fd,&nodex.elevation,sizeof(elevation_t));
+   }
+
+ nodesx->fd=CloseFileBuffered(nodesx->fd);
+
  /* Finish off the offset indexing and write them out */
 
  maxlatlonbins=nodesx->latbins*nodesx->lonbins;
@@ -826,6 +953,8 @@ void SaveNodeList(NodesX *nodesx,const char *filename,SegmentsX *segmentsx)
 
  /* Write out the header structure */
 
+ nodesfile.version=NODES_FILE_VERSION;
+
  nodesfile.number=nodesx->number;
  nodesfile.snumber=super_number;
 
@@ -47,6 +47,8 @@ struct _NodeX
 
  transports_t allow;            /*+ The node allowed traffic. +*/
  nodeflags_t  flags;            /*+ The node flags. +*/
+
+ elevation_t  elevation;        /*+ The node elevation. +*/
 };
 
 /*+ A structure containing a set of nodes (memory format). +*/
@@ -103,6 +105,8 @@ void SortNodeList(NodesX *nodesx);
 
 void RemoveNonHighwayNodes(NodesX *nodesx,WaysX *waysx,int keep);
 
+void CalculateNodeElevations(NodesX *nodesx);
+
 void RemovePrunedNodes(NodesX *nodesx,SegmentsX *segmentsx);
 
 void SortNodeListGeographically(NodesX *nodesx);
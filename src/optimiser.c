@@ -26,9 +26,12 @@
 #include "ways.h"
 #include "relations.h"
 
+#include "costs.h"
+
 #include "logging.h"
 #include "functions.h"
 #include "fakes.h"
+#include "query.h"
 #include "results.h"
 
 
@@ -41,21 +44,22 @@
 /*+ The option not to print any progress information. +*/
 extern int option_quiet;
 
-/*+ The option to calculate the quickest route insted of the shortest. +*/
-extern int option_quickest;
-
 
 /* Local functions */
 
-static index_t FindSuperSegment(Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,index_t finish_node,index_t finish_segment);
 static Results *FindSuperRoute(Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,index_t start_node,index_t finish_node);
 
+static score_t PotentialScore(Query *query,Profile *profile,double lat1,double lon1,double lat2,double lon2);
+static score_t AveragePotential(Query *query,Profile *profile,double lat,double lon,double target_lat,double target_lon,double source_lat,double source_lon,score_t offset_score);
+
 
 /*++++++++++++++++++++++++++++++++++++++
   Find the optimum route between two nodes not passing through a super-node.
 
   Results *FindNormalRoute Returns a set of results.
 
+  Query *query The query containing the routing options and the fake nodes and segments.
+
   Nodes *nodes The set of nodes to use.
 
   Segments *segments The set of segments to use.
@@ -73,7 +77,7 @@ static Results *FindSuperRoute(Nodes *nodes,Segments *segments,Ways *ways,Relati
   index_t finish_node The finish node.
   ++++++++++++++++++++++++++++++++++++++*/
 
-Results *FindNormalRoute(Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,index_t start_node,index_t prev_segment,index_t finish_node)
+Results *FindNormalRoute(Query *query,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,index_t start_node,index_t prev_segment,index_t finish_node)
 {
  Results *results;
  Queue   *queue;
@@ -93,7 +97,7 @@ Results *FindNormalRoute(Nodes *nodes,Segments *segments,Ways *ways,Relations *r
  finish_result=NULL;
 
  if(IsFakeNode(finish_node))
-    GetFakeLatLong(finish_node,&finish_lat,&finish_lon);
+    GetFakeLatLong(query,finish_node,&finish_lat,&finish_lon);
  else
     GetLatLong(nodes,finish_node,NULL,&finish_lat,&finish_lon);
 
@@ -136,7 +140,7 @@ Results *FindNormalRoute(Nodes *nodes,Segments *segments,Ways *ways,Relations *r
     seg1=result1->segment;
 
     if(IsFakeSegment(seg1))
-       seg1r=IndexRealSegment(seg1);
+       seg1r=IndexRealSegment(query,seg1);
     else
        seg1r=seg1;
 
@@ -150,7 +154,7 @@ Results *FindNormalRoute(Nodes *nodes,Segments *segments,Ways *ways,Relations *r
     /* Loop across all segments */
 
     if(IsFakeNode(node1))
-       segmentp=FirstFakeSegment(node1);
+       segmentp=FirstFakeSegment(query,node1);
     else
        segmentp=FirstSegment(segments,node1p,1);
 
@@ -159,9 +163,7 @@ Results *FindNormalRoute(Nodes *nodes,Segments *segments,Ways *ways,Relations *r
        Node *node2p=NULL;
        Way *wayp;
        index_t node2,seg2,seg2r;
-       score_t segment_pref,segment_score,cumulative_score;
-       int i;
-       speed_t speedresult=0;
+       score_t segment_score,cumulative_score;
 
        node2=OtherNode(segmentp,node1); /* need this here because we use node2 at the end of the loop */
 
@@ -178,13 +180,15 @@ Results *FindNormalRoute(Nodes *nodes,Segments *segments,Ways *ways,Relations *r
 
 		  if (!(wayp->props & Properties_DoubleSens))
             goto endloop;
+#if DEBUG
           printf("  FindNormalRoute(...,start_node=%"Pindex_t" prev_segment=%"Pindex_t" finish_node=%"Pindex_t") props=%d  DoubleSens=%d \n",start_node,prev_segment,finish_node,wayp->props, Properties_DoubleSens);
+#endif
 		 }
 
        if(IsFakeNode(node1) || IsFakeNode(node2))
          {
-          seg2 =IndexFakeSegment(segmentp);
-          seg2r=IndexRealSegment(seg2);
+          seg2 =IndexFakeSegment(query,segmentp);
+          seg2r=IndexRealSegment(query,seg2);
          }
        else
          {
@@ -200,7 +204,7 @@ Results *FindNormalRoute(Nodes *nodes,Segments *segments,Ways *ways,Relations *r
          }
        else
           /* must not perform U-turn (unless profile allows) */
-          if(profile->turns && (seg1==seg2 || seg1==seg2r || seg1r==seg2 || (seg1r==seg2r && IsFakeUTurn(seg1,seg2))))
+          if(profile->turns && (seg1==seg2 || seg1==seg2r || seg1r==seg2 || (seg1r==seg2r && IsFakeUTurn(query,seg1,seg2))))
              goto endloop;
 
        /* must obey turn relations */
@@ -214,49 +218,18 @@ Results *FindNormalRoute(Nodes *nodes,Segments *segments,Ways *ways,Relations *r
        if(node2!=finish_node && node2p && IsSuperNode(node2p))
           goto endloop;
 
-       wayp=LookupWay(ways,segmentp->way,1);
-
-       /* mode of transport must be allowed on the highway */
-       if(!(wayp->allow&profile->allow))
-          goto endloop;
-
-       /* must obey weight restriction (if exists) */
-       if(wayp->weight && wayp->weight<profile->weight)
-          goto endloop;
-
-       /* must obey height/width/length restriction (if exist) */
-       if((wayp->height && wayp->height<profile->height) ||
-          (wayp->width  && wayp->width <profile->width ) ||
-          (wayp->length && wayp->length<profile->length))
-          goto endloop;
-
-       segment_pref=profile->highway[HIGHWAY(wayp->type)];
-
-       /* highway preferences must allow this highway */
-       if(segment_pref==0)
-          goto endloop;
-
-       for(i=1;i<Property_Count;i++)
-          if(ways->file.props & PROPERTIES(i))
-            {
-             if(wayp->props & PROPERTIES(i))
-                segment_pref*=profile->props_yes[i];
-             else
-                segment_pref*=profile->props_no[i];
-            }
-
-       /* profile preferences must allow this highway */
-       if(segment_pref==0)
-          goto endloop;
-
        /* mode of transport must be allowed through node2 unless it is the final node */
        if(node2p && node2!=finish_node && !(node2p->allow&profile->allow))
           goto endloop;
 
-       if(option_quickest==0)
-          segment_score=(score_t)DISTANCE(segmentp->distance)/segment_pref;
+       if(query->costs && !IsFakeSegment(seg2))
+          segment_score=SegmentCostFrom(query->costs,seg2,segmentp,node1);
        else
-          segment_score=(score_t)Duration(node1,segmentp,wayp,profile,&speedresult)/segment_pref;
+          segment_score=SegmentScore(ways,profile,segmentp,node1,query->quickest);
+
+       /* highway, profile preferences and limits must allow this segment */
+       if(segment_score==INF_SCORE)
+          goto endloop;
 
        cumulative_score=result1->score+segment_score;
 
@@ -292,7 +265,7 @@ Results *FindNormalRoute(Nodes *nodes,Segments *segments,Ways *ways,Relations *r
       endloop:
 
        if(IsFakeNode(node1))
-          segmentp=NextFakeSegment(segmentp,node1);
+          segmentp=NextFakeSegment(query,segmentp,node1);
        else if(IsFakeNode(node2))
           segmentp=NULL; /* cannot call NextSegment() with a fake segment */
        else
@@ -300,7 +273,7 @@ Results *FindNormalRoute(Nodes *nodes,Segments *segments,Ways *ways,Relations *r
           segmentp=NextSegment(segments,segmentp,node1);
 
           if(!segmentp && IsFakeNode(finish_node))
-             segmentp=ExtraFakeSegment(node1,finish_node);
+             segmentp=ExtraFakeSegment(query,node1,finish_node);
          }
       }
    }
@@ -341,6 +314,8 @@ Results *FindNormalRoute(Nodes *nodes,Segments *segments,Ways *ways,Relations *r
 
   Results *FindMiddleRoute Returns a set of results.
 
+  Query *query The query containing the routing options and the fake nodes and segments.
+
   Nodes *nodes The set of nodes to use.
 
   Segments *segments The set of segments to use.
@@ -351,18 +326,24 @@ Results *FindNormalRoute(Nodes *nodes,Segments *segments,Ways *ways,Relations *r
 
   Profile *profile The profile containing the transport type, speeds and allowed highways.
 
+  Landmarks *landmarks The landmark distances for the profile and type of route (or NULL if there are none).
+
   Results *begin The initial portion of the route.
 
   Results *end The final portion of the route.
+
+  The A* potential is the larger of the lower bound from the straight line distance to the finish node and
+  (if there are landmark distances) the lower bound from the landmarks.
   ++++++++++++++++++++++++++++++++++++++*/
 
-Results *FindMiddleRoute(Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,Results *begin,Results *end)
+Results *FindMiddleRoute(Query *query,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,Landmarks *landmarks,Results *begin,Results *end)
 {
  Results *results;
  Queue   *queue;
  Result  *finish_result;
  score_t finish_score;
  double  finish_lat,finish_lon;
+ score_t fromlandmark[LANDMARK_NUMBER],tolandmark[LANDMARK_NUMBER];
  Result  *result1,*result2,*result3,*result4;
  int     force_uturn=0;
 
@@ -381,10 +362,13 @@ Results *FindMiddleRoute(Nodes *nodes,Segments *segments,Ways *ways,Relations *r
  finish_result=NULL;
 
  if(IsFakeNode(end->finish_node))
-    GetFakeLatLong(end->finish_node,&finish_lat,&finish_lon);
+    GetFakeLatLong(query,end->finish_node,&finish_lat,&finish_lon);
  else
     GetLatLong(nodes,end->finish_node,NULL,&finish_lat,&finish_lon);
 
+ if(landmarks)
+    LandmarksFinishScores(landmarks,end,fromlandmark,tolandmark);
+
  /* Create the list of results and insert the first node into the queue */
 
  results=NewResultsList(20);
@@ -399,7 +383,7 @@ Results *FindMiddleRoute(Nodes *nodes,Segments *segments,Ways *ways,Relations *r
        results->prev_segment=NO_SEGMENT;
     else
       {
-       index_t superseg=FindSuperSegment(nodes,segments,ways,relations,begin->start_node,begin->prev_segment);
+       index_t superseg=FindSuperSegment(query,nodes,segments,ways,relations,begin->start_node,begin->prev_segment);
 
        results->prev_segment=superseg;
       }
@@ -418,7 +402,7 @@ Results *FindMiddleRoute(Nodes *nodes,Segments *segments,Ways *ways,Relations *r
        !IsFakeNode(result3->node) && IsSuperNode(LookupNode(nodes,result3->node,5)))
       {
        Result *result5=result1;
-       index_t superseg=FindSuperSegment(nodes,segments,ways,relations,result3->node,result3->segment);
+       index_t superseg=FindSuperSegment(query,nodes,segments,ways,relations,result3->node,result3->segment);
 
        if(superseg!=result3->segment)
          {
@@ -469,7 +453,7 @@ Results *FindMiddleRoute(Nodes *nodes,Segments *segments,Ways *ways,Relations *r
    {
     Node *node1p;
     Segment *segmentp;
-    index_t node1,seg1;
+    index_t node1,seg1,seg1r;
     index_t turnrelation=NO_RELATION;
 
 #if DEBUG
@@ -485,9 +469,14 @@ Results *FindMiddleRoute(Nodes *nodes,Segments *segments,Ways *ways,Relations *r
 
     node1p=LookupNode(nodes,node1,1); /* node1 cannot be a fake node (must be a super-node) */
 
+    if(IsFakeSegment(seg1))
+       seg1r=IndexRealSegment(query,seg1);
+    else
+       seg1r=seg1;
+
     /* lookup if a turn restriction applies */
     if(profile->turns && IsTurnRestrictedNode(node1p)) /* node1 cannot be a fake node (must be a super-node) */
-       turnrelation=FindFirstTurnRelation2(relations,node1,seg1);
+       turnrelation=FindFirstTurnRelation2(relations,node1,seg1r);
 
     /* Loop across all segments */
 
@@ -498,9 +487,7 @@ Results *FindMiddleRoute(Nodes *nodes,Segments *segments,Ways *ways,Relations *r
        Node *node2p;
        Way *wayp;
        index_t node2,seg2;
-       score_t segment_pref,segment_score,cumulative_score;
-       int i;
-       speed_t speedresult=0;
+       score_t segment_score,cumulative_score;
        
        /* must be a super segment */
        if(!IsSuperSegment(segmentp))
@@ -533,42 +520,7 @@ Results *FindMiddleRoute(Nodes *nodes,Segments *segments,Ways *ways,Relations *r
              goto endloop;
 
        /* must obey turn relations */
-       if(turnrelation!=NO_RELATION && !IsTurnAllowed(relations,turnrelation,node1,seg1,seg2,profile->allow))
-          goto endloop;
-
-       wayp=LookupWay(ways,segmentp->way,1);
-
-       /* mode of transport must be allowed on the highway */
-       if(!(wayp->allow&profile->allow))
-          goto endloop;
-
-       /* must obey weight restriction (if exists) */
-       if(wayp->weight && wayp->weight<profile->weight)
-          goto endloop;
-
-       /* must obey height/width/length restriction (if exist) */
-       if((wayp->height && wayp->height<profile->height) ||
-          (wayp->width  && wayp->width <profile->width ) ||
-          (wayp->length && wayp->length<profile->length))
-          goto endloop;
-
-       segment_pref=profile->highway[HIGHWAY(wayp->type)];
-
-       /* highway preferences must allow this highway */
-       if(segment_pref==0)
-          goto endloop;
-
-       for(i=1;i<Property_Count;i++)
-          if(ways->file.props & PROPERTIES(i))
-            {
-             if(wayp->props & PROPERTIES(i))
-                segment_pref*=profile->props_yes[i];
-             else
-                segment_pref*=profile->props_no[i];
-            }
-
-       /* profile preferences must allow this highway */
-       if(segment_pref==0)
+       if(turnrelation!=NO_RELATION && !IsTurnAllowed(relations,turnrelation,node1,seg1r,seg2,profile->allow))
           goto endloop;
 
        node2=OtherNode(segmentp,node1);
@@ -579,14 +531,18 @@ Results *FindMiddleRoute(Nodes *nodes,Segments *segments,Ways *ways,Relations *r
        if(node2!=end->finish_node && !(node2p->allow&profile->allow))
           goto endloop;
 
-       if(option_quickest==0)
-          segment_score=(score_t)DISTANCE(segmentp->distance)/segment_pref;
+       if(query->costs && !IsFakeSegment(seg2))
+          segment_score=SegmentCostFrom(query->costs,seg2,segmentp,node1);
        else
-          segment_score=(score_t)Duration(node1,segmentp,wayp,profile, &speedresult)/segment_pref;
+          segment_score=SegmentScore(ways,profile,segmentp,node1,query->quickest);
+
+       /* highway, profile preferences and limits must allow this segment */
+       if(segment_score==INF_SCORE)
+          goto endloop;
 
        cumulative_score=result1->score+segment_score;
 #if DEBUG
-   printf("BTestsok   node1=%"Pindex_t" node2=%"Pindex_t" seg2=%"Pindex_t" dist=%08x segment_pref=%f segment_score=%f cumulative_score=%f finish_score=%f\n",node1,node2,seg2,DISTANCE(segmentp->distance),segment_pref,segment_score,cumulative_score,finish_score);
+   printf("BTestsok   node1=%"Pindex_t" node2=%"Pindex_t" seg2=%"Pindex_t" dist=%08x segment_score=%f cumulative_score=%f finish_score=%f\n",node1,node2,seg2,DISTANCE(segmentp->distance),segment_score,cumulative_score,finish_score);
 #endif
        /* score must be better than current best score */
        if(cumulative_score>=finish_score)
@@ -640,10 +596,20 @@ Results *FindMiddleRoute(Nodes *nodes,Segments *segments,Ways *ways,Relations *r
 
           direct=Distance(lat,lon,finish_lat,finish_lon);
 
-          if(option_quickest==0)
-             potential_score=result2->score+(score_t)direct/profile->max_pref;
+          if(query->quickest==0)
+             potential_score=(score_t)direct/profile->max_pref;
           else
-             potential_score=result2->score+(score_t)distance_speed_to_duration(direct,profile->max_speed)/profile->max_pref;
+             potential_score=(score_t)distance_speed_to_duration(direct,profile->max_speed)/profile->max_pref;
+
+          if(landmarks)
+            {
+             score_t landmark_score=LandmarksPotential(landmarks,node2,fromlandmark,tolandmark);
+
+             if(landmark_score>potential_score)
+                potential_score=landmark_score;
+            }
+
+          potential_score+=result2->score;
 #if DEBUG
    printf("Cpot    result2->node=%"Pindex_t "seg=%"Pindex_t" potential_score=%f <? finish_score=%f\n",result2->node,result2->segment,potential_score,finish_score);
 #endif
@@ -711,11 +677,644 @@ Results *FindMiddleRoute(Nodes *nodes,Segments *segments,Ways *ways,Relations *r
 }
 
 
+/*++++++++++++++++++++++++++++++++++++++
+  Find the optimum route between two nodes where the start and end are a set of pre/post-routed super-nodes
+  by searching forwards from the start and backwards from the finish at the same time.
+
+  Results *FindMiddleRouteBidirectional Returns a set of results (the same as FindMiddleRoute()).
+
+  Query *query The query containing the routing options and the fake nodes and segments.
+
+  Nodes *nodes The set of nodes to use.
+
+  Segments *segments The set of segments to use.
+
+  Ways *ways The set of ways to use.
+
+  Relations *relations The set of relations to use.
+
+  Profile *profile The profile containing the transport type, speeds and allowed highways.
+
+  Results *begin The initial portion of the route.
+
+  Results *end The final portion of the route.
+
+  Both searches use the average of the forward and backward potentials so that the queue keys of the two
+  searches add up to the same value for every route; the search stops when the sum of the last keys taken from
+  each queue is no better than the best route found where the two searches meet.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+Results *FindMiddleRouteBidirectional(Query *query,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,Results *begin,Results *end)
+{
+ Results *results,*back;
+ Queue   *queue,*backqueue;
+ Result  *finish_result,*start_result;
+ Result  *meet_result=NULL,*meet_backresult=NULL;
+ score_t meet_score,offset_score,last_score=0,last_backscore=0;
+ double  start_lat,start_lon,finish_lat,finish_lon;
+ Result  *result1,*result2,*result3,*result4;
+ int     force_uturn=0,start_meets=0,backwards=1;
+
+#if DEBUG
+ printf("  FindMiddleRouteBidirectional(...,[begin has %d nodes],[end has %d nodes] finish_node=%"Pindex_t " )\n",begin->number,end->number,end->finish_node);
+#endif
+
+#if !DEBUG
+ if(!option_quiet)
+    printf_first("Routing: Super-Nodes checked = 0");
+#endif
+
+ /* Set up the start and finish conditions */
+
+ meet_score=INF_SCORE;
+
+ if(IsFakeNode(begin->start_node))
+    GetFakeLatLong(query,begin->start_node,&start_lat,&start_lon);
+ else
+    GetLatLong(nodes,begin->start_node,NULL,&start_lat,&start_lon);
+
+ if(IsFakeNode(end->finish_node))
+    GetFakeLatLong(query,end->finish_node,&finish_lat,&finish_lon);
+ else
+    GetLatLong(nodes,end->finish_node,NULL,&finish_lat,&finish_lon);
+
+ offset_score=PotentialScore(query,profile,start_lat,start_lon,finish_lat,finish_lon);
+
+ /* Create the list of backward results and insert the super-nodes at the start of the final part of the route */
+
+ back=NewResultsList(20);
+ backqueue=NewQueueList(12);
+
+ back->finish_node=end->finish_node;
+
+ result3=FirstResult(end);
+
+ while(result3)
+   {
+    if(!IsFakeNode(result3->node) && !IsFakeSegment(result3->segment) &&
+       IsSuperNode(LookupNode(nodes,result3->node,5)) && IsSuperSegment(LookupSegment(segments,result3->segment,1)))
+      {
+       double lat,lon;
+
+       result2=InsertResult(back,result3->node,result3->segment);
+
+       result2->prev=result3; /* the final part of the route */
+       result2->score=result3->score;
+
+       GetLatLong(nodes,result3->node,NULL,&lat,&lon); /* node cannot be a fake node (must be a super-node) */
+
+       InsertInQueue(backqueue,result2,result2->score+AveragePotential(query,profile,lat,lon,start_lat,start_lon,finish_lat,finish_lon,offset_score));
+      }
+
+    result3=NextResult(end,result3);
+   }
+
+ /* Create the list of forward results and insert the first node into the queue */
+
+ results=NewResultsList(20);
+ queue=NewQueueList(12);
+
+ results->start_node=begin->start_node;
+ results->prev_segment=begin->prev_segment;
+
+ if(begin->number==1)
+   {
+    if(begin->prev_segment==NO_SEGMENT)
+       results->prev_segment=NO_SEGMENT;
+    else
+      {
+       index_t superseg=FindSuperSegment(query,nodes,segments,ways,relations,begin->start_node,begin->prev_segment);
+
+       results->prev_segment=superseg;
+      }
+   }
+
+ result1=InsertResult(results,results->start_node,results->prev_segment);
+
+ start_result=result1;
+
+ /* Insert the finish points of the beginning part of the path into the queue,
+    translating the segments into super-segments. */
+
+ result3=FirstResult(begin);
+
+ while(result3)
+   {
+    if((results->start_node!=result3->node || results->prev_segment!=result3->segment) &&
+       !IsFakeNode(result3->node) && IsSuperNode(LookupNode(nodes,result3->node,5)))
+      {
+       Result *result5=result1;
+       index_t superseg=FindSuperSegment(query,nodes,segments,ways,relations,result3->node,result3->segment);
+
+       if(superseg!=result3->segment)
+         {
+          result5=InsertResult(results,result3->node,result3->segment);
+
+          result5->prev=result1;
+         }
+
+       if(!FindResult(results,result3->node,superseg))
+         {
+          double lat,lon;
+
+          result2=InsertResult(results,result3->node,superseg);
+          result2->prev=result5;
+
+          result2->score=result3->score;
+
+          if((result4=FindResult(back,result2->node,result2->segment)))
+            {
+             if((result2->score+result4->score)<meet_score)
+               {
+                meet_score=result2->score+result4->score;
+                meet_result=result2;
+                meet_backresult=result4;
+               }
+            }
+
+          if(!FindResult(end,result2->node,result2->segment))
+            {
+             GetLatLong(nodes,result2->node,NULL,&lat,&lon); /* node cannot be a fake node (must be a super-node) */
+
+             InsertInQueue(queue,result2,result2->score+AveragePotential(query,profile,lat,lon,finish_lat,finish_lon,start_lat,start_lon,offset_score));
+            }
+         }
+      }
+
+    result3=NextResult(begin,result3);
+   }
+
+ /* Check for barrier at start waypoint - must perform U-turn */
+
+ if(begin->number==1 && results->prev_segment!=NO_SEGMENT)
+   {
+    Node *startp=LookupNode(nodes,result1->node,1);
+
+    if(!(startp->allow&profile->allow))
+       force_uturn=1;
+   }
+
+ /* The start node can only meet the backward search if the route can continue from it in any direction */
+
+ if(begin->number==1)
+   {
+    InsertInQueue(queue,result1,offset_score);
+
+    start_meets=!force_uturn;
+
+    if(start_meets && (result4=FindResult(back,result1->node,result1->segment)) && result4->score<meet_score)
+      {
+       meet_score=result4->score;
+       meet_result=result1;
+       meet_backresult=result4;
+      }
+   }
+
+ /* Loop across all nodes in both queues taking one from each in turn */
+
+ while(1)
+   {
+    Node *node1p,*node2p;
+    Segment *segmentp;
+    index_t node1,node2,seg1,seg1r;
+    index_t turnrelation=NO_RELATION;
+    double lat,lon;
+
+    backwards=!backwards;
+
+    if(backwards)
+      {
+       if(!(result1=PopFromQueue(backqueue)))
+         {
+          backwards=0;
+          result1=PopFromQueue(queue);
+         }
+      }
+    else
+      {
+       if(!(result1=PopFromQueue(queue)))
+         {
+          backwards=1;
+          result1=PopFromQueue(backqueue);
+         }
+      }
+
+    if(!result1)
+       break;
+
+    node1=result1->node;
+    seg1=result1->segment;
+
+    node1p=LookupNode(nodes,node1,1); /* node1 cannot be a fake node (must be a super-node) */
+
+    GetLatLong(nodes,node1,node1p,&lat,&lon); /* node1 cannot be a fake node (must be a super-node) */
+
+    /* The searches have met with the best route if the last keys are no better than it */
+
+    if(backwards)
+       last_backscore=result1->score+AveragePotential(query,profile,lat,lon,start_lat,start_lon,finish_lat,finish_lon,offset_score);
+    else
+       last_score=result1->score+AveragePotential(query,profile,lat,lon,finish_lat,finish_lon,start_lat,start_lon,offset_score);
+
+    if((last_score+last_backscore)>=(meet_score+offset_score))
+       break;
+
+    if(backwards)
+       goto backward;
+
+    /* score must be better than current best score */
+    if((result1->score+PotentialScore(query,profile,lat,lon,finish_lat,finish_lon))>=meet_score)
+       continue;
+
+    if(IsFakeSegment(seg1))
+       seg1r=IndexRealSegment(query,seg1);
+    else
+       seg1r=seg1;
+
+    /* lookup if a turn restriction applies */
+    if(profile->turns && IsTurnRestrictedNode(node1p)) /* node1 cannot be a fake node (must be a super-node) */
+       turnrelation=FindFirstTurnRelation2(relations,node1,seg1r);
+
+    /* Loop across all segments */
+
+    segmentp=FirstSegment(segments,node1p,1); /* node1 cannot be a fake node (must be a super-node) */
+
+    while(segmentp)
+      {
+       Way *wayp;
+       index_t seg2;
+       score_t segment_score,cumulative_score;
+
+       /* must be a super segment */
+       if(!IsSuperSegment(segmentp))
+          goto endloop;
+
+       /* must obey one-way restrictions (unless profile allows) */
+       if(profile->oneway && IsOnewayTo(segmentp,node1))
+         {
+          if(profile->allow!=Transports_Bicycle)
+             goto endloop;
+          wayp=LookupWay(ways,segmentp->way,1);
+          if(!(wayp->props & Properties_DoubleSens))
+             goto endloop;
+         }
+
+       seg2=IndexSegment(segments,segmentp); /* segment cannot be a fake segment (must be a super-segment) */
+
+       /* must perform U-turn in special cases */
+       if(force_uturn && node1==results->start_node)
+         {
+          if(seg2!=result1->segment)
+             goto endloop;
+         }
+       else
+          /* must not perform U-turn */
+          if(seg1==seg2) /* No fake segments, applies to all profiles */
+             goto endloop;
+
+       /* must obey turn relations */
+       if(turnrelation!=NO_RELATION && !IsTurnAllowed(relations,turnrelation,node1,seg1r,seg2,profile->allow))
+          goto endloop;
+
+       node2=OtherNode(segmentp,node1);
+
+       node2p=LookupNode(nodes,node2,2); /* node2 cannot be a fake node (must be a super-node) */
+
+       /* mode of transport must be allowed through node2 unless it is the final node */
+       if(node2!=end->finish_node && !(node2p->allow&profile->allow))
+          goto endloop;
+
+       if(query->costs && !IsFakeSegment(seg2))
+          segment_score=SegmentCostFrom(query->costs,seg2,segmentp,node1);
+       else
+          segment_score=SegmentScore(ways,profile,segmentp,node1,query->quickest);
+
+       /* highway, profile preferences and limits must allow this segment */
+       if(segment_score==INF_SCORE)
+          goto endloop;
+
+       cumulative_score=result1->score+segment_score;
+
+       /* score must be better than current best score */
+       if(cumulative_score>=meet_score)
+          goto endloop;
+
+       result2=FindResult(results,node2,seg2);
+
+       if(!result2) /* New end node/segment pair */
+         {
+          result2=InsertResult(results,node2,seg2);
+          result2->prev=result1;
+          result2->score=cumulative_score;
+         }
+       else if(cumulative_score<result2->score) /* New end node/segment pair is better */
+         {
+          result2->prev=result1;
+          result2->score=cumulative_score;
+         }
+       else
+          goto endloop;
+
+       /* check if the backward search has reached this node/segment pair */
+       if((result3=FindResult(back,node2,seg2)))
+         {
+          if((result2->score+result3->score)<meet_score)
+            {
+             meet_score=result2->score+result3->score;
+             meet_result=result2;
+             meet_backresult=result3;
+            }
+         }
+
+       /* the final part of the route is not extended */
+       if(!FindResult(end,node2,seg2))
+         {
+          double lat2,lon2;
+
+          GetLatLong(nodes,node2,node2p,&lat2,&lon2); /* node2 cannot be a fake node (must be a super-node) */
+
+          if((result2->score+PotentialScore(query,profile,lat2,lon2,finish_lat,finish_lon))<meet_score)
+             InsertInQueue(queue,result2,result2->score+AveragePotential(query,profile,lat2,lon2,finish_lat,finish_lon,start_lat,start_lon,offset_score));
+         }
+
+#if !DEBUG
+       if(!option_quiet && !((results->number+back->number)%1000))
+          printf_middle("Routing: Super-Nodes checked = %d",results->number+back->number);
+#endif
+
+      endloop:
+
+       segmentp=NextSegment(segments,segmentp,node1); /* node1 cannot be a fake node (must be a super-node) */
+      }
+
+    continue;
+
+    /* The backward search follows the segment used to arrive at node1 backwards to node2 */
+
+   backward:
+
+    {
+     Way *wayp;
+     score_t segment_score,cumulative_score;
+     int turns;
+
+     /* score must be better than current best score */
+     if((result1->score+PotentialScore(query,profile,lat,lon,start_lat,start_lon))>=meet_score)
+        continue;
+
+     segmentp=LookupSegment(segments,seg1,1); /* segment cannot be a fake segment (must be a super-segment) */
+
+     node2=OtherNode(segmentp,node1);
+
+     /* must obey one-way restrictions (unless profile allows) */
+     if(profile->oneway && IsOnewayTo(segmentp,node2)) /* working backwards => disallow oneway *to* node2 */
+       {
+        if(profile->allow!=Transports_Bicycle)
+           continue;
+        wayp=LookupWay(ways,segmentp->way,1);
+        if(!(wayp->props & Properties_DoubleSens))
+           continue;
+       }
+
+     /* mode of transport must be allowed through node1 unless it is the final node */
+     if(node1!=end->finish_node && !(node1p->allow&profile->allow))
+        continue;
+
+     if(query->costs && !IsFakeSegment(seg1))
+        segment_score=SegmentCostFrom(query->costs,seg1,segmentp,node2);
+     else
+        segment_score=SegmentScore(ways,profile,segmentp,node2,query->quickest);
+
+     /* highway, profile preferences and limits must allow this segment */
+     if(segment_score==INF_SCORE)
+        continue;
+
+     cumulative_score=result1->score+segment_score;
+
+     /* score must be better than current best score */
+     if(cumulative_score>=meet_score)
+        continue;
+
+     /* Loop across all super-segments that can be used to arrive at node2 */
+
+     node2p=LookupNode(nodes,node2,2); /* node2 cannot be a fake node (must be a super-node) */
+
+     GetLatLong(nodes,node2,node2p,&lat,&lon); /* node2 cannot be a fake node (must be a super-node) */
+
+     turns=profile->turns && IsTurnRestrictedNode(node2p);
+
+     segmentp=FirstSegment(segments,node2p,1); /* node2 cannot be a fake node (must be a super-node) */
+
+     while(segmentp)
+       {
+        index_t seg2;
+
+        /* must be a super segment */
+        if(!IsSuperSegment(segmentp))
+           goto backendloop;
+
+        seg2=IndexSegment(segments,segmentp); /* segment cannot be a fake segment (must be a super-segment) */
+
+        /* must not perform U-turn */
+        if(seg2==seg1)
+           goto backendloop;
+
+        /* must obey turn relations */
+        if(turns)
+          {
+           index_t turnrelation2=FindFirstTurnRelation2(relations,node2,seg2);
+
+           if(turnrelation2!=NO_RELATION && !IsTurnAllowed(relations,turnrelation2,node2,seg2,seg1,profile->allow))
+              goto backendloop;
+          }
+
+        /* the final part of the route is not extended */
+        if(FindResult(end,node2,seg2))
+           goto backendloop;
+
+        result2=FindResult(back,node2,seg2);
+
+        if(!result2) /* New start node/segment pair */
+          {
+           result2=InsertResult(back,node2,seg2);
+           result2->next=result1; /* working backwards */
+           result2->score=cumulative_score;
+          }
+        else if(cumulative_score<result2->score) /* New start node/segment pair is better */
+          {
+           result2->next=result1; /* working backwards */
+           result2->score=cumulative_score;
+          }
+        else
+           goto backendloop;
+
+        /* check if the forward search has reached this node/segment pair */
+        if((result3=FindResult(results,node2,seg2)) && (result3!=start_result || start_meets))
+          {
+           if((result3->score+result2->score)<meet_score)
+             {
+              meet_score=result3->score+result2->score;
+              meet_result=result3;
+              meet_backresult=result2;
+             }
+          }
+
+        if((result2->score+PotentialScore(query,profile,lat,lon,start_lat,start_lon))<meet_score)
+           InsertInQueue(backqueue,result2,result2->score+AveragePotential(query,profile,lat,lon,start_lat,start_lon,finish_lat,finish_lon,offset_score));
+
+#if !DEBUG
+        if(!option_quiet && !((results->number+back->number)%1000))
+           printf_middle("Routing: Super-Nodes checked = %d",results->number+back->number);
+#endif
+
+       backendloop:
+
+        segmentp=NextSegment(segments,segmentp,node2); /* node2 cannot be a fake node (must be a super-node) */
+       }
+    }
+   }
+
+#if !DEBUG
+ if(!option_quiet)
+    printf_last("Routing: Super-Nodes checked = %d",results->number+back->number);
+#endif
+
+ FreeQueueList(queue);
+ FreeQueueList(backqueue);
+
+ /* Check it worked */
+
+ if(!meet_result)
+   {
+#if DEBUG
+    printf("    Failed\n");
+#endif
+
+    FreeResultsList(results);
+    FreeResultsList(back);
+    return(NULL);
+   }
+
+ /* Append the backward search results after the meeting point */
+
+ finish_result=meet_result;
+
+ for(result3=meet_backresult->next;result3;result3=result3->next)
+   {
+    result2=FindResult(results,result3->node,result3->segment);
+
+    if(!result2)
+       result2=InsertResult(results,result3->node,result3->segment);
+
+    result2->prev=finish_result;
+    result2->score=meet_score-result3->score;
+
+    finish_result=result2;
+   }
+
+ FreeResultsList(back);
+
+ /* Finish off the end part of the route */
+
+ if(finish_result->node!=end->finish_node)
+   {
+    result3=InsertResult(results,end->finish_node,NO_SEGMENT);
+
+    result3->prev=finish_result;
+    result3->score=meet_score;
+
+    finish_result=result3;
+   }
+
+ FixForwardRoute(results,finish_result);
+
+#if DEBUG
+ Result *r=FindResult(results,results->start_node,results->prev_segment);
+
+ while(r)
+   {
+    printf("    node=%"Pindex_t" segment=%"Pindex_t" score=%f\n",r->node,r->segment,r->score);
+
+    r=r->next;
+   }
+#endif
+
+ return(results);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Calculate the lowest possible score for a route between two points.
+
+  score_t PotentialScore Returns the score.
+
+  Query *query The query containing the routing options.
+
+  Profile *profile The profile containing the transport type, speeds and allowed highways.
+
+  double lat1 The latitude of the first point.
+
+  double lon1 The longitude of the first point.
+
+  double lat2 The latitude of the second point.
+
+  double lon2 The longitude of the second point.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static score_t PotentialScore(Query *query,Profile *profile,double lat1,double lon1,double lat2,double lon2)
+{
+ distance_t direct=Distance(lat1,lon1,lat2,lon2);
+
+ if(query->quickest==0)
+    return((score_t)direct/profile->max_pref);
+ else
+    return((score_t)distance_speed_to_duration(direct,profile->max_speed)/profile->max_pref);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Calculate the potential used for the queue in one direction of a bidirectional search (the average of the
+  potential towards the target and the negative potential from the source, offset so that it is never negative).
+
+  score_t AveragePotential Returns the potential.
+
+  Query *query The query containing the routing options.
+
+  Profile *profile The profile containing the transport type, speeds and allowed highways.
+
+  double lat The latitude of the node.
+
+  double lon The longitude of the node.
+
+  double target_lat The latitude of the point that this direction is searching towards.
+
+  double target_lon The longitude of the point that this direction is searching towards.
+
+  double source_lat The latitude of the point that this direction started from.
+
+  double source_lon The longitude of the point that this direction started from.
+
+  score_t offset_score The lowest possible score between the source and target.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static score_t AveragePotential(Query *query,Profile *profile,double lat,double lon,double target_lat,double target_lon,double source_lat,double source_lon,score_t offset_score)
+{
+ score_t potential=(PotentialScore(query,profile,lat,lon,target_lat,target_lon)-PotentialScore(query,profile,lat,lon,source_lat,source_lon)+offset_score)/2;
+
+ if(potential<0)
+    return(0);
+ else
+    return(potential);
+}
+
+
 /*++++++++++++++++++++++++++++++++++++++
   Find the super-segment that represents the route that contains a particular segment.
 
   index_t FindSuperSegment Returns the index of the super-segment.
 
+  Query *query The query containing the routing options and the fake nodes and segments.
+
   Nodes *nodes The set of nodes to use.
 
   Segments *segments The set of segments to use.
@@ -729,13 +1328,13 @@ Results *FindMiddleRoute(Nodes *nodes,Segments *segments,Ways *ways,Relations *r
   index_t finish_segment The segment that the route ends with.
   ++++++++++++++++++++++++++++++++++++++*/
 
-static index_t FindSuperSegment(Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,index_t finish_node,index_t finish_segment)
+index_t FindSuperSegment(Query *query,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,index_t finish_node,index_t finish_segment)
 {
  Node *supernodep;
  Segment *supersegmentp;
 
  if(IsFakeSegment(finish_segment))
-    finish_segment=IndexRealSegment(finish_segment);
+    finish_segment=IndexRealSegment(query,finish_segment);
 
  supernodep=LookupNode(nodes,finish_node,5); /* finish_node cannot be a fake node (must be a super-node) */
  supersegmentp=LookupSegment(segments,finish_segment,2); /* finish_segment cannot be a fake segment. */
@@ -852,7 +1451,9 @@ static Results *FindSuperRoute(Nodes *nodes,Segments *segments,Ways *ways,Relati
        /* must obey one-way restrictions */
        if(IsOnewayTo(segmentp,node1))
          {
- printf("    FindSuperRoute(...,start_node=%"Pindex_t" finish_node=%"Pindex_t") IsOnewayTo\n",start_node,finish_node);
+#if DEBUG
+          printf("    FindSuperRoute(...,start_node=%"Pindex_t" finish_node=%"Pindex_t") IsOnewayTo\n",start_node,finish_node);
+#endif
 			 
           goto endloop;
          }
@@ -921,6 +1522,8 @@ static Results *FindSuperRoute(Nodes *nodes,Segments *segments,Ways *ways,Relati
 
   Results *FindStartRoutes Returns a set of results.
 
+  Query *query The query containing the routing options and the fake nodes and segments.
+
   Nodes *nodes The set of nodes to use.
 
   Segments *segments The set of segments to use.
@@ -938,7 +1541,7 @@ static Results *FindSuperRoute(Nodes *nodes,Segments *segments,Ways *ways,Relati
   index_t finish_node The finish node.
   ++++++++++++++++++++++++++++++++++++++*/
 
-Results *FindStartRoutes(Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,index_t start_node,index_t prev_segment,index_t finish_node)
+Results *FindStartRoutes(Query *query,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,index_t start_node,index_t prev_segment,index_t finish_node)
 {
  Results *results;
  Queue   *queue;
@@ -984,7 +1587,7 @@ Results *FindStartRoutes(Nodes *nodes,Segments *segments,Ways *ways,Relations *r
     seg1=result1->segment;
 
     if(IsFakeSegment(seg1))
-       seg1r=IndexRealSegment(seg1);
+       seg1r=IndexRealSegment(query,seg1);
     else
        seg1r=seg1;
 
@@ -998,7 +1601,7 @@ Results *FindStartRoutes(Nodes *nodes,Segments *segments,Ways *ways,Relations *r
     /* Loop across all segments */
 
     if(IsFakeNode(node1))
-       segmentp=FirstFakeSegment(node1);
+       segmentp=FirstFakeSegment(query,node1);
     else
        segmentp=FirstSegment(segments,node1p,1);
 
@@ -1007,9 +1610,7 @@ Results *FindStartRoutes(Nodes *nodes,Segments *segments,Ways *ways,Relations *r
        Node *node2p=NULL;
        Way *wayp;
        index_t node2,seg2,seg2r;
-       score_t segment_pref,segment_score,cumulative_score;
-       int i;
-       speed_t speedresult=0;
+       score_t segment_score,cumulative_score;
 
        node2=OtherNode(segmentp,node1); /* need this here because we use node2 at the end of the loop */
 
@@ -1025,13 +1626,15 @@ Results *FindStartRoutes(Nodes *nodes,Segments *segments,Ways *ways,Relations *r
 		  wayp=LookupWay(ways,segmentp->way,1);
 		  if (!(wayp->props & Properties_DoubleSens))
             goto endloop;
- printf("  FindStartRoutes(...,start_node=%"Pindex_t" prev_segment=%"Pindex_t" finish_node=%"Pindex_t") props=%d DoubleSens=%d\n",start_node,prev_segment,finish_node,wayp->props,Properties_DoubleSens);
+#if DEBUG
+          printf("  FindStartRoutes(...,start_node=%"Pindex_t" prev_segment=%"Pindex_t" finish_node=%"Pindex_t") props=%d DoubleSens=%d\n",start_node,prev_segment,finish_node,wayp->props,Properties_DoubleSens);
+#endif
 		 }
 
        if(IsFakeNode(node1) || IsFakeNode(node2))
          {
-          seg2 =IndexFakeSegment(segmentp);
-          seg2r=IndexRealSegment(seg2);
+          seg2 =IndexFakeSegment(query,segmentp);
+          seg2r=IndexRealSegment(query,seg2);
          }
        else
          {
@@ -1047,48 +1650,13 @@ Results *FindStartRoutes(Nodes *nodes,Segments *segments,Ways *ways,Relations *r
          }
        else
           /* must not perform U-turn (unless profile allows) */
-          if(profile->turns && (seg1==seg2 || seg1==seg2r || seg1r==seg2 || (seg1r==seg2r && IsFakeUTurn(seg1,seg2))))
+          if(profile->turns && (seg1==seg2 || seg1==seg2r || seg1r==seg2 || (seg1r==seg2r && IsFakeUTurn(query,seg1,seg2))))
              goto endloop;
 
        /* must obey turn relations */
        if(turnrelation!=NO_RELATION && !IsTurnAllowed(relations,turnrelation,node1,seg1r,seg2r,profile->allow))
           goto endloop;
 
-       wayp=LookupWay(ways,segmentp->way,1);
-
-       /* mode of transport must be allowed on the highway */
-       if(!(wayp->allow&profile->allow))
-          goto endloop;
-
-       /* must obey weight restriction (if exists) */
-       if(wayp->weight && wayp->weight<profile->weight)
-          goto endloop;
-
-       /* must obey height/width/length restriction (if exists) */
-       if((wayp->height && wayp->height<profile->height) ||
-          (wayp->width  && wayp->width <profile->width ) ||
-          (wayp->length && wayp->length<profile->length))
-          goto endloop;
-
-       segment_pref=profile->highway[HIGHWAY(wayp->type)];
-
-       /* highway preferences must allow this highway */
-       if(segment_pref==0)
-          goto endloop;
-
-       for(i=1;i<Property_Count;i++)
-          if(ways->file.props & PROPERTIES(i))
-            {
-             if(wayp->props & PROPERTIES(i))
-                segment_pref*=profile->props_yes[i];
-             else
-                segment_pref*=profile->props_no[i];
-            }
-
-       /* profile preferences must allow this highway */
-       if(segment_pref==0)
-          goto endloop;
-
        if(!IsFakeNode(node2))
           node2p=LookupNode(nodes,node2,2);
 
@@ -1096,10 +1664,14 @@ Results *FindStartRoutes(Nodes *nodes,Segments *segments,Ways *ways,Relations *r
        if(node2p && node2!=finish_node && !(node2p->allow&profile->allow))
           goto endloop;
 
-       if(option_quickest==0)
-          segment_score=(score_t)DISTANCE(segmentp->distance)/segment_pref;
+       if(query->costs && !IsFakeSegment(seg2))
+          segment_score=SegmentCostFrom(query->costs,seg2,segmentp,node1);
        else
-          segment_score=(score_t)Duration(node1,segmentp,wayp,profile,&speedresult)/segment_pref;
+          segment_score=SegmentScore(ways,profile,segmentp,node1,query->quickest);
+
+       /* highway, profile preferences and limits must allow this segment */
+       if(segment_score==INF_SCORE)
+          goto endloop;
 
        cumulative_score=result1->score+segment_score;
 
@@ -1143,7 +1715,7 @@ Results *FindStartRoutes(Nodes *nodes,Segments *segments,Ways *ways,Relations *r
       endloop:
 
        if(IsFakeNode(node1))
-          segmentp=NextFakeSegment(segmentp,node1);
+          segmentp=NextFakeSegment(query,segmentp,node1);
        else if(IsFakeNode(node2))
           segmentp=NULL; /* cannot call NextSegment() with a fake segment */
        else
@@ -1151,7 +1723,7 @@ Results *FindStartRoutes(Nodes *nodes,Segments *segments,Ways *ways,Relations *r
           segmentp=NextSegment(segments,segmentp,node1);
 
           if(!segmentp && IsFakeNode(finish_node))
-             segmentp=ExtraFakeSegment(node1,finish_node);
+             segmentp=ExtraFakeSegment(query,node1,finish_node);
          }
       }
    }
@@ -1221,6 +1793,8 @@ Results *FindStartRoutes(Nodes *nodes,Segments *segments,Ways *ways,Relations *r
 
   Results *ExtendStartRoutes Returns the set of results that were passed in.
 
+  Query *query The query containing the routing options and the fake nodes and segments.
+
   Nodes *nodes The set of nodes to use.
 
   Segments *segments The set of segments to use.
@@ -1236,7 +1810,7 @@ Results *FindStartRoutes(Nodes *nodes,Segments *segments,Ways *ways,Relations *r
   index_t finish_node The finish node.
   ++++++++++++++++++++++++++++++++++++++*/
 
-Results *ExtendStartRoutes(Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,Results *begin,index_t finish_node)
+Results *ExtendStartRoutes(Query *query,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,Results *begin,index_t finish_node)
 {
  Results *results=begin;
  Queue   *queue;
@@ -1287,7 +1861,7 @@ Results *ExtendStartRoutes(Nodes *nodes,Segments *segments,Ways *ways,Relations
     seg1=result1->segment;
 
     if(IsFakeSegment(seg1))
-       seg1r=IndexRealSegment(seg1);
+       seg1r=IndexRealSegment(query,seg1);
     else
        seg1r=seg1;
 
@@ -1301,7 +1875,7 @@ Results *ExtendStartRoutes(Nodes *nodes,Segments *segments,Ways *ways,Relations
     /* Loop across all segments */
 
     if(IsFakeNode(node1))
-       segmentp=FirstFakeSegment(node1);
+       segmentp=FirstFakeSegment(query,node1);
     else
        segmentp=FirstSegment(segments,node1p,1);
 
@@ -1310,9 +1884,7 @@ Results *ExtendStartRoutes(Nodes *nodes,Segments *segments,Ways *ways,Relations
        Node *node2p=NULL;
        Way *wayp;
        index_t node2,seg2,seg2r;
-       score_t segment_pref,segment_score,cumulative_score;
-       int i;
-       speed_t    speedresult=0;
+       score_t segment_score,cumulative_score;
        
        node2=OtherNode(segmentp,node1); /* need this here because we use node2 at the end of the loop */
 
@@ -1328,13 +1900,15 @@ Results *ExtendStartRoutes(Nodes *nodes,Segments *segments,Ways *ways,Relations
 		  wayp=LookupWay(ways,segmentp->way,1);
 		  if (!(wayp->props & Properties_DoubleSens))
             goto endloop;
-printf("  ExtendStartRoutes(...,[begin has %d nodes],finish_node=%"Pindex_t") props=%d DoubleSens=%d\n",begin->number,finish_node, wayp->props,Properties_DoubleSens);
+#if DEBUG
+          printf("  ExtendStartRoutes(...,[begin has %d nodes],finish_node=%"Pindex_t") props=%d DoubleSens=%d\n",begin->number,finish_node, wayp->props,Properties_DoubleSens);
+#endif
 		 }
 
        if(IsFakeNode(node1) || IsFakeNode(node2))
          {
-          seg2 =IndexFakeSegment(segmentp);
-          seg2r=IndexRealSegment(seg2);
+          seg2 =IndexFakeSegment(query,segmentp);
+          seg2r=IndexRealSegment(query,seg2);
          }
        else
          {
@@ -1343,48 +1917,13 @@ printf("  ExtendStartRoutes(...,[begin has %d nodes],finish_node=%"Pindex_t") pr
          }
 
        /* must not perform U-turn (unless profile allows) */
-       if(profile->turns && (seg1==seg2 || seg1==seg2r || seg1r==seg2 || (seg1r==seg2r && IsFakeUTurn(seg1,seg2))))
+       if(profile->turns && (seg1==seg2 || seg1==seg2r || seg1r==seg2 || (seg1r==seg2r && IsFakeUTurn(query,seg1,seg2))))
           goto endloop;
 
        /* must obey turn relations */
        if(turnrelation!=NO_RELATION && !IsTurnAllowed(relations,turnrelation,node1,seg1r,seg2r,profile->allow))
           goto endloop;
 
-       wayp=LookupWay(ways,segmentp->way,1);
-
-       /* mode of transport must be allowed on the highway */
-       if(!(wayp->allow&profile->allow))
-          goto endloop;
-
-       /* must obey weight restriction (if exists) */
-       if(wayp->weight && wayp->weight<profile->weight)
-          goto endloop;
-
-       /* must obey height/width/length restriction (if exists) */
-       if((wayp->height && wayp->height<profile->height) ||
-          (wayp->width  && wayp->width <profile->width ) ||
-          (wayp->length && wayp->length<profile->length))
-          goto endloop;
-
-       segment_pref=profile->highway[HIGHWAY(wayp->type)];
-
-       /* highway preferences must allow this highway */
-       if(segment_pref==0)
-          goto endloop;
-
-       for(i=1;i<Property_Count;i++)
-          if(ways->file.props & PROPERTIES(i))
-            {
-             if(wayp->props & PROPERTIES(i))
-                segment_pref*=profile->props_yes[i];
-             else
-                segment_pref*=profile->props_no[i];
-            }
-
-       /* profile preferences must allow this highway */
-       if(segment_pref==0)
-          goto endloop;
-
        if(!IsFakeNode(node2))
           node2p=LookupNode(nodes,node2,2);
 
@@ -1392,10 +1931,14 @@ printf("  ExtendStartRoutes(...,[begin has %d nodes],finish_node=%"Pindex_t") pr
        if(node2p && node2!=finish_node && !(node2p->allow&profile->allow))
           goto endloop;
 
-       if(option_quickest==0)
-          segment_score=(score_t)DISTANCE(segmentp->distance)/segment_pref;
+       if(query->costs && !IsFakeSegment(seg2))
+          segment_score=SegmentCostFrom(query->costs,seg2,segmentp,node1);
        else
-          segment_score=(score_t)Duration(node1,segmentp,wayp,profile,&speedresult)/segment_pref;
+          segment_score=SegmentScore(ways,profile,segmentp,node1,query->quickest);
+
+       /* highway, profile preferences and limits must allow this segment */
+       if(segment_score==INF_SCORE)
+          goto endloop;
 
        cumulative_score=result1->score+segment_score;
 
@@ -1433,7 +1976,7 @@ printf("  ExtendStartRoutes(...,[begin has %d nodes],finish_node=%"Pindex_t") pr
       endloop:
 
        if(IsFakeNode(node1))
-          segmentp=NextFakeSegment(segmentp,node1);
+          segmentp=NextFakeSegment(query,segmentp,node1);
        else if(IsFakeNode(node2))
           segmentp=NULL; /* cannot call NextSegment() with a fake segment */
        else
@@ -1441,7 +1984,7 @@ printf("  ExtendStartRoutes(...,[begin has %d nodes],finish_node=%"Pindex_t") pr
           segmentp=NextSegment(segments,segmentp,node1);
 
           if(!segmentp && IsFakeNode(finish_node))
-             segmentp=ExtraFakeSegment(node1,finish_node);
+             segmentp=ExtraFakeSegment(query,node1,finish_node);
          }
       }
    }
@@ -1470,6 +2013,8 @@ printf("  ExtendStartRoutes(...,[begin has %d nodes],finish_node=%"Pindex_t") pr
 
   Results *FindFinishRoutes Returns a set of results.
 
+  Query *query The query containing the routing options and the fake nodes and segments.
+
   Nodes *nodes The set of nodes to use.
 
   Segments *segments The set of segments to use.
@@ -1483,7 +2028,7 @@ printf("  ExtendStartRoutes(...,[begin has %d nodes],finish_node=%"Pindex_t") pr
   index_t finish_node The finishing node.
   ++++++++++++++++++++++++++++++++++++++*/
 
-Results *FindFinishRoutes(Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,index_t finish_node)
+Results *FindFinishRoutes(Query *query,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,index_t finish_node)
 {
  Results *results,*results2;
  Queue   *queue;
@@ -1517,7 +2062,7 @@ Results *FindFinishRoutes(Nodes *nodes,Segments *segments,Ways *ways,Relations *
     seg1=result1->segment;
 
     if(IsFakeSegment(seg1))
-       seg1r=IndexRealSegment(seg1);
+       seg1r=IndexRealSegment(query,seg1);
     else
        seg1r=seg1;
 
@@ -1531,7 +2076,7 @@ Results *FindFinishRoutes(Nodes *nodes,Segments *segments,Ways *ways,Relations *
     /* Loop across all segments */
 
     if(IsFakeNode(node1))
-       segmentp=FirstFakeSegment(node1);
+       segmentp=FirstFakeSegment(query,node1);
     else
        segmentp=FirstSegment(segments,node1p,1);
 
@@ -1540,9 +2085,7 @@ Results *FindFinishRoutes(Nodes *nodes,Segments *segments,Ways *ways,Relations *
        Node *node2p=NULL;
        Way *wayp;
        index_t node2,seg2,seg2r;
-       score_t segment_pref,segment_score,cumulative_score;
-       int i;
-       speed_t  speedresult=0;
+       score_t segment_score,cumulative_score;
        
        /* must be a normal segment unless node1 is a super-node (see below). */
        if((IsFakeNode(node1) || !IsSuperNode(node1p)) && !IsNormalSegment(segmentp))
@@ -1560,15 +2103,17 @@ Results *FindFinishRoutes(Nodes *nodes,Segments *segments,Ways *ways,Relations *
 		  wayp=LookupWay(ways,segmentp->way,1);
 		  if (!(wayp->props & Properties_DoubleSens))
             goto endloop;
-		  printf("  FindFinishRoutes(...,finish_node=%"Pindex_t") props=%d DoubleSens=%d\n",finish_node,wayp->props,Properties_DoubleSens);
+#if DEBUG
+          printf("  FindFinishRoutes(...,finish_node=%"Pindex_t") props=%d DoubleSens=%d\n",finish_node,wayp->props,Properties_DoubleSens);
+#endif
 		 }
 
        node2=OtherNode(segmentp,node1);
 
        if(IsFakeNode(node1) || IsFakeNode(node2))
          {
-          seg2 =IndexFakeSegment(segmentp);
-          seg2r=IndexRealSegment(seg2);
+          seg2 =IndexFakeSegment(query,segmentp);
+          seg2r=IndexRealSegment(query,seg2);
          }
        else
          {
@@ -1577,7 +2122,7 @@ Results *FindFinishRoutes(Nodes *nodes,Segments *segments,Ways *ways,Relations *
          }
 
        /* must not perform U-turn (unless profile allows) */
-       if(profile->turns && (seg1==seg2 || seg1==seg2r || seg1r==seg2 || (seg1r==seg2r && IsFakeUTurn(seg1,seg2))))
+       if(profile->turns && (seg1==seg2 || seg1==seg2r || seg1r==seg2 || (seg1r==seg2r && IsFakeUTurn(query,seg1,seg2))))
           goto endloop;
 
        /* must obey turn relations */
@@ -1589,41 +2134,6 @@ Results *FindFinishRoutes(Nodes *nodes,Segments *segments,Ways *ways,Relations *
              goto endloop;
          }
 
-       wayp=LookupWay(ways,segmentp->way,1);
-
-       /* mode of transport must be allowed on the highway */
-       if(!(wayp->allow&profile->allow))
-          goto endloop;
-
-       /* must obey weight restriction (if exists) */
-       if(wayp->weight && wayp->weight<profile->weight)
-          goto endloop;
-
-       /* must obey height/width/length restriction (if exist) */
-       if((wayp->height && wayp->height<profile->height) ||
-          (wayp->width  && wayp->width <profile->width ) ||
-          (wayp->length && wayp->length<profile->length))
-          goto endloop;
-
-       segment_pref=profile->highway[HIGHWAY(wayp->type)];
-
-       /* highway preferences must allow this highway */
-       if(segment_pref==0)
-          goto endloop;
-
-       for(i=1;i<Property_Count;i++)
-          if(ways->file.props & PROPERTIES(i))
-            {
-             if(wayp->props & PROPERTIES(i))
-                segment_pref*=profile->props_yes[i];
-             else
-                segment_pref*=profile->props_no[i];
-            }
-
-       /* profile preferences must allow this highway */
-       if(segment_pref==0)
-          goto endloop;
-
        if(!IsFakeNode(node2))
           node2p=LookupNode(nodes,node2,2);
 
@@ -1631,10 +2141,14 @@ Results *FindFinishRoutes(Nodes *nodes,Segments *segments,Ways *ways,Relations *
        if(node2p && !(node2p->allow&profile->allow))
           goto endloop;
 
-       if(option_quickest==0)
-          segment_score=(score_t)DISTANCE(segmentp->distance)/segment_pref;
+       if(query->costs && !IsFakeSegment(seg2))
+          segment_score=SegmentCostFrom(query->costs,seg2,segmentp,node2);
        else
-          segment_score=(score_t)Duration(node2,segmentp,wayp,profile,&speedresult)/segment_pref;
+          segment_score=SegmentScore(ways,profile,segmentp,node2,query->quickest);
+
+       /* highway, profile preferences and limits must allow this segment */
+       if(segment_score==INF_SCORE)
+          goto endloop;
 
        cumulative_score=result1->score+segment_score;
 
@@ -1660,7 +2174,7 @@ Results *FindFinishRoutes(Nodes *nodes,Segments *segments,Ways *ways,Relations *
       endloop:
 
        if(IsFakeNode(node1))
-          segmentp=NextFakeSegment(segmentp,node1);
+          segmentp=NextFakeSegment(query,segmentp,node1);
        else
           segmentp=NextSegment(segments,segmentp,node1);
       }
@@ -1756,6 +2270,8 @@ Results *FindFinishRoutes(Nodes *nodes,Segments *segments,Ways *ways,Relations *
 
   Results *CombineRoutes Returns the results from joining the super-nodes.
 
+  Query *query The query containing the routing options and the fake nodes and segments.
+
   Nodes *nodes The set of nodes to use.
 
   Segments *segments The set of segments to use.
@@ -1771,7 +2287,7 @@ Results *FindFinishRoutes(Nodes *nodes,Segments *segments,Ways *ways,Relations *
   Results *middle The set of results from the super-node route.
   ++++++++++++++++++++++++++++++++++++++*/
 
-Results *CombineRoutes(Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,Results *begin,Results *middle)
+Results *CombineRoutes(Query *query,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,Results *begin,Results *middle)
 {
  Result *midres,*comres1;
  Results *combined;
@@ -1834,7 +2350,7 @@ Results *CombineRoutes(Nodes *nodes,Segments *segments,Ways *ways,Relations *rel
 
     if(midres->next)
       {
-       Results *results=FindNormalRoute(nodes,segments,ways,relations,profile,comres1->node,comres1->segment,midres->next->node);
+       Results *results=FindNormalRoute(query,nodes,segments,ways,relations,profile,comres1->node,comres1->segment,midres->next->node);
 
        if(!results)
           return(NULL);
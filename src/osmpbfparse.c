@@ -26,6 +26,10 @@
 #include <stdint.h>
 #include <string.h>
 
+#if defined(USE_PTHREADS) && USE_PTHREADS
+#include <pthread.h>
+#endif
+
 #if defined(USE_GZIP) && USE_GZIP
 #include <zlib.h>
 #endif
@@ -104,6 +108,7 @@
 /* Errors */
 
 #define PBF_EOF                     0
+#define PBF_OK                      1
 
 #define PBF_ERROR_UNEXP_EOF       100
 #define PBF_ERROR_BLOB_HEADER_LEN 101
@@ -119,56 +124,150 @@
 #define PBF_ERROR_UNSUPPORTED     111
 #define PBF_ERROR_TOO_MANY_GROUPS 112
 
+/* The types of decoded element */
+
+#define PBF_NODE                    1
+#define PBF_WAY                     2
+#define PBF_RELATION                3
+
+
+/* Data types */
+
+/*+ A node, way or relation that has been decoded from a PrimitiveBlock. +*/
+typedef struct _pbf_element
+{
+ int      type;                 /*+ The type of element (PBF_NODE, PBF_WAY or PBF_RELATION). +*/
+ int64_t  id;                   /*+ The OSM id of the element. +*/
+ double   latitude;             /*+ The latitude of a node. +*/
+ double   longitude;            /*+ The longitude of a node. +*/
+ uint32_t ntags;                /*+ The number of tags (key/value pairs in the blob tags). +*/
+ uint32_t nrefs;                /*+ The number of way nodes or relation members. +*/
+}
+ pbf_element;
+
+/*+ A relation member that has been decoded from a PrimitiveBlock. +*/
+typedef struct _pbf_member
+{
+ int64_t        id;             /*+ The OSM id of the member. +*/
+ int            type;           /*+ The type of member (0=node, 1=way, 2=relation). +*/
+ unsigned char *role;           /*+ The role of the member (or NULL). +*/
+}
+ pbf_member;
+
+/*+ One blob from the file as it is read, uncompressed, decoded and processed. +*/
+typedef struct _pbf_blob
+{
+ int             state;         /*+ PBF_OK, PBF_EOF or the error state. +*/
+ int             decoded;       /*+ Set when the blob has been decoded and can be processed. +*/
+ uint64_t        byteno;        /*+ The number of bytes read from the file including this blob. +*/
+
+ int             osm_header;    /*+ Set if the blob contains an OSMHeader. +*/
+ int             osm_data;      /*+ Set if the blob contains OSMData. +*/
+
+ unsigned char  *raw;           /*+ The Blob message as read from the file. +*/
+ uint32_t        raw_length;    /*+ The length of the Blob message. +*/
+ uint32_t        raw_allocated; /*+ The allocated size of the Blob message buffer. +*/
+
+ unsigned char  *zbuffer;       /*+ The uncompressed data. +*/
+ uint32_t        zbuffer_allocated; /*+ The allocated size of the uncompressed data buffer. +*/
+
+ unsigned char  *error;         /*+ The unsupported feature for the error message. +*/
+
+ int32_t         granularity;   /*+ The granularity of the latitudes and longitudes. +*/
+ int64_t         lat_offset;    /*+ The offset of the latitudes. +*/
+ int64_t         lon_offset;    /*+ The offset of the longitudes. +*/
+
+ unsigned char **strings;       /*+ The string table (pointers into the uncompressed data). +*/
+ uint32_t       *string_lengths; /*+ The lengths of the strings in the string table. +*/
+ uint32_t        nstrings;      /*+ The number of strings in the string table. +*/
+ uint32_t        strings_allocated; /*+ The allocated size of the string table. +*/
+
+ pbf_element    *elements;      /*+ The decoded nodes, ways and relations. +*/
+ uint32_t        nelements;     /*+ The number of decoded elements. +*/
+ uint32_t        elements_allocated; /*+ The allocated number of decoded elements. +*/
+
+ unsigned char **tags;          /*+ The keys and values of the tags of all elements. +*/
+ uint32_t        ntags;         /*+ The number of keys and values. +*/
+ uint32_t        tags_allocated; /*+ The allocated number of keys and values. +*/
+
+ int64_t        *refs;          /*+ The nodes of all ways. +*/
+ uint32_t        nrefs;         /*+ The number of way nodes. +*/
+ uint32_t        refs_allocated; /*+ The allocated number of way nodes. +*/
+
+ pbf_member     *members;       /*+ The members of all relations. +*/
+ uint32_t        nmembers;      /*+ The number of relation members. +*/
+ uint32_t        members_allocated; /*+ The allocated number of relation members. +*/
+}
+ pbf_blob;
+
+
+/* Global variables */
+
+/*+ The number of threads to use for decoding PBF blobs. +*/
+extern int option_pbf_threads;
+
+/*+ The maximum number of PBF blobs being read, decoded or processed at the same time. +*/
+extern int option_pbf_blobs;
+
 
 /* Parsing variables and functions */
 
 static uint64_t byteno=0;
 static uint64_t nnodes=0,nways=0,nrelations=0;
 
-static uint32_t buffer_allocated,zbuffer_allocated;
-static unsigned char *buffer=NULL,*zbuffer=NULL;
+static uint32_t buffer_allocated;
+static unsigned char *buffer=NULL;
 static unsigned char *buffer_ptr,*buffer_end;
 
-static int string_table_length=0,string_table_allocated=0;
-static unsigned char **string_table=NULL;
-static uint32_t *string_table_string_lengths=NULL;
+#if defined(USE_PTHREADS) && USE_PTHREADS
+
+static pthread_mutex_t blobs_mutex=PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t blobs_cond=PTHREAD_COND_INITIALIZER;
 
-static int32_t granularity=100;
-static int64_t lat_offset=0,lon_offset=0;
+static pbf_blob *blobs;
+static int nblobs;
+static uint64_t blobs_read,blobs_decoding,blobs_processed;
+static int blobs_finished;
+
+#endif
 
 #define LENGTH_32M (32*1024*1024)
 
 
 /*++++++++++++++++++++++++++++++++++++++
-  Refill the data buffer and set the pointers.
+  Refill a data buffer from the file.
 
   int buffer_refill Return 0 if everything is OK or 1 for EOF.
 
   int fd The file descriptor to read from.
 
+  unsigned char **data The buffer to fill (reallocated if needed).
+
+  uint32_t *allocated The allocated size of the buffer.
+
   uint32_t bytes The number of bytes to read.
   ++++++++++++++++++++++++++++++++++++++*/
 
-static inline int buffer_refill(int fd,uint32_t bytes)
+static inline int buffer_refill(int fd,unsigned char **data,uint32_t *allocated,uint32_t bytes)
 {
+ unsigned char *end;
  ssize_t n;
 
- if(bytes>buffer_allocated)
-    buffer=(unsigned char *)realloc(buffer,buffer_allocated=bytes);
+ if(bytes>*allocated)
+    *data=(unsigned char *)realloc(*data,*allocated=bytes);
 
  byteno+=bytes;
 
- buffer_ptr=buffer;
- buffer_end=buffer;
+ end=*data;
 
  do
    {
-    n=read(fd,buffer_end,bytes);
+    n=read(fd,end,bytes);
 
     if(n<=0)
        return(1);
 
-    buffer_end+=n;
+    end+=n;
     bytes-=n;
    }
  while(bytes>0);
@@ -176,25 +275,41 @@ static inline int buffer_refill(int fd,uint32_t bytes)
  return(0);
 }
 
+static int read_blob(int fd,pbf_blob *blob);
+static int decode_blob(pbf_blob *blob);
+static void process_blob(pbf_blob *blob);
+static void report_error(pbf_blob *blob);
+
+static void free_blob(pbf_blob *blob);
+
+#if defined(USE_PTHREADS) && USE_PTHREADS
+static int parse_threaded(int fd);
+static void *read_blobs_thread(int *fd);
+static void *decode_blobs_thread(void *arg);
+#endif
+
 #if defined(USE_GZIP) && USE_GZIP
-static int uncompress_pbf(unsigned char *data,uint32_t compressed,uint32_t uncompressed);
+static int uncompress_pbf(pbf_blob *blob,unsigned char *data,uint32_t compressed,uint32_t uncompressed);
 #endif /* USE_GZIP */
 
-static void process_string_table(unsigned char *data,uint32_t length);
-static void process_primitive_group(unsigned char *data,uint32_t length);
-static void process_nodes(unsigned char *data,uint32_t length);
-static void process_dense_nodes(unsigned char *data,uint32_t length);
-static void process_ways(unsigned char *data,uint32_t length);
-static void process_relations(unsigned char *data,uint32_t length);
+static void decode_string_table(pbf_blob *blob,unsigned char *data,uint32_t length);
+static void decode_primitive_group(pbf_blob *blob,unsigned char *data,uint32_t length);
+static void decode_nodes(pbf_blob *blob,unsigned char *data,uint32_t length);
+static void decode_dense_nodes(pbf_blob *blob,unsigned char *data,uint32_t length);
+static void decode_ways(pbf_blob *blob,unsigned char *data,uint32_t length);
+static void decode_relations(pbf_blob *blob,unsigned char *data,uint32_t length);
+
+static inline pbf_element *new_element(pbf_blob *blob,int type,int64_t id);
+static inline void append_tag(pbf_blob *blob,pbf_element *element,uint32_t key,uint32_t val);
 
 
 /* Macros to simplify the parser (and make it look more like the XML parser) */
 
-#define BEGIN(xx)            do{ state=(xx); goto finish_parsing; } while(0)
+#define BEGIN(xx)            do{ blob->state=(xx); return(xx); } while(0)
 
-#define BUFFER_CHARS_EOF(xx) do{ if(buffer_refill(fd,(xx))) BEGIN(PBF_EOF); } while(0)
+#define BUFFER_CHARS_EOF(xx) do{ if(buffer_refill(fd,&buffer,&buffer_allocated,(xx))) BEGIN(PBF_EOF); buffer_ptr=buffer; buffer_end=buffer+(xx); } while(0)
 
-#define BUFFER_CHARS(xx)     do{ if(buffer_refill(fd,(xx))) BEGIN(PBF_ERROR_UNEXP_EOF); } while(0)
+#define BUFFER_CHARS(xx)     do{ if(buffer_refill(fd,&buffer,&buffer_allocated,(xx))) BEGIN(PBF_ERROR_UNEXP_EOF); buffer_ptr=buffer; buffer_end=buffer+(xx); } while(0)
 
 
 /* PBF decoding */
@@ -202,8 +317,8 @@ static void process_relations(unsigned char *data,uint32_t length);
 #define PBF_FIELD(xx)   (int)(((xx)&0xFFF8)>>3)
 #define PBF_TYPE(xx)    (int)((xx)&0x0007)
 
-#define PBF_LATITUDE(xx)  (double)(1E-9*(granularity*(xx)+lat_offset))
-#define PBF_LONGITUDE(xx) (double)(1E-9*(granularity*(xx)+lon_offset))
+#define PBF_LATITUDE(blob,xx)  (double)(1E-9*((blob)->granularity*(xx)+(blob)->lat_offset))
+#define PBF_LONGITUDE(blob,xx) (double)(1E-9*((blob)->granularity*(xx)+(blob)->lon_offset))
 
 
 /*++++++++++++++++++++++++++++++++++++++
@@ -348,18 +463,22 @@ static inline void pbf_skip(unsigned char **ptr,int type)
 }
 
 
+
 /*++++++++++++++++++++++++++++++++++++++
   Parse the PBF and call the functions for each OSM item as seen.
 
   int ParsePBF Returns 0 if OK or something else in case of an error.
 
   int fd The file descriptor of the file to parse.
+
+  The blobs are read, uncompressed and decoded, then processed in the order that they are in the
+  file. With more than one '--pbf-threads' the blobs are read by one thread and decoded by the
+  others while the previous ones are processed.
   ++++++++++++++++++++++++++++++++++++++*/
 
 int ParsePBF(int fd)
 {
  int state;
- unsigned char *error=NULL;
 
  /* Print the initial message */
 
@@ -369,226 +488,387 @@ int ParsePBF(int fd)
 
  nnodes=0,nways=0,nrelations=0;
 
- string_table_allocated=16384;
- string_table_length=0;
- string_table=(unsigned char **)malloc(string_table_allocated*sizeof(unsigned char *));
- string_table_string_lengths=(uint32_t *)malloc(string_table_allocated*sizeof(uint32_t));
-
- zbuffer_allocated=0;
- zbuffer=NULL;
-
  buffer_allocated=65536;
  buffer=(unsigned char*)malloc(buffer_allocated);
 
- buffer_ptr=buffer_end=buffer;
+#if defined(USE_PTHREADS) && USE_PTHREADS
+
+ if(option_pbf_threads>1)
+    state=parse_threaded(fd);
+ else
+
+#endif
 
- while(1)
    {
-    int32_t blob_header_length=0;
-    int osm_data=0,osm_header=0;
-    int32_t blob_length=0;
-    uint32_t raw_size=0,compressed_size=0,uncompressed_size=0;
-    unsigned char *raw_data=NULL,*zlib_data=NULL;
-    uint32_t length;
-    unsigned char *data;
+    pbf_blob *blob=(pbf_blob*)calloc(1,sizeof(pbf_blob));
 
-    /* ================ Parsing states ================ */
+    logassert(blob,"Failed to allocate memory"); /* Check calloc() worked */
 
+    while(read_blob(fd,blob)==PBF_OK && decode_blob(blob)==PBF_OK)
+       process_blob(blob);
 
-    BUFFER_CHARS_EOF(4);
+    report_error(blob);
 
-    blob_header_length=(256*(256*(256*(int)buffer_ptr[0])+(int)buffer_ptr[1])+(int)buffer_ptr[2])+buffer_ptr[3];
-    buffer_ptr+=4;
+    state=blob->state;
 
-    if(blob_header_length==0 || blob_header_length>LENGTH_32M)
-       BEGIN(PBF_ERROR_BLOB_HEADER_LEN);
+    free_blob(blob);
+    free(blob);
+   }
+
+ /* Free the parser variables */
+
+ free(buffer);
+
+ /* Print the final message */
+
+ printf_last("Read: Bytes=%"PRIu64" Nodes=%"PRIu64" Ways=%"PRIu64" Relations=%"PRIu64,byteno,nnodes,nways,nrelations);
+
+ return(state);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Read the next BlobHeader and Blob messages from the file.
+
+  int read_blob Returns PBF_OK, PBF_EOF or the error state.
+
+  int fd The file descriptor to read from.
+
+  pbf_blob *blob The blob to fill in.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int read_blob(int fd,pbf_blob *blob)
+{
+ int32_t blob_header_length=0;
+ int32_t blob_length=0;
+
+ blob->osm_header=0;
+ blob->osm_data=0;
+
+ BUFFER_CHARS_EOF(4);
 
+ blob_header_length=(256*(256*(256*(int)buffer_ptr[0])+(int)buffer_ptr[1])+(int)buffer_ptr[2])+buffer_ptr[3];
+ buffer_ptr+=4;
 
-    BUFFER_CHARS(blob_header_length);
+ if(blob_header_length==0 || blob_header_length>LENGTH_32M)
+    BEGIN(PBF_ERROR_BLOB_HEADER_LEN);
 
-    osm_header=0;
-    osm_data=0;
 
-    while(buffer_ptr<buffer_end)
+ BUFFER_CHARS(blob_header_length);
+
+ while(buffer_ptr<buffer_end)
+   {
+    int fieldtype=pbf_int32(&buffer_ptr);
+    int field=PBF_FIELD(fieldtype);
+
+    switch(field)
       {
-       int fieldtype=pbf_int32(&buffer_ptr);
+      case PBF_VAL_BLOBHEADER_TYPE: /* string */
+       {
+        uint32_t length=0;
+        unsigned char *type=NULL;
+
+        type=pbf_length_delimited(&buffer_ptr,&length);
+
+        if(length==9 && !strncmp((char*)type,"OSMHeader",9))
+           blob->osm_header=1;
+
+        if(length==7 && !strncmp((char*)type,"OSMData",7))
+           blob->osm_data=1;
+       }
+       break;
+
+      case PBF_VAL_BLOBHEADER_SIZE: /* int32 */
+       blob_length=pbf_int32(&buffer_ptr);
+       break;
+
+      default:
+       pbf_skip(&buffer_ptr,PBF_TYPE(fieldtype));
+      }
+   }
+
+ blob->byteno=byteno;
+
+ if(blob_length==0 || blob_length>LENGTH_32M)
+    BEGIN(PBF_ERROR_BLOB_LEN);
+
+ if(!blob->osm_data && !blob->osm_header)
+    BEGIN(PBF_ERROR_NOT_OSM);
+
+
+ if(buffer_refill(fd,&blob->raw,&blob->raw_allocated,blob_length))
+   {
+    blob->byteno=byteno;
+    BEGIN(PBF_ERROR_UNEXP_EOF);
+   }
+
+ blob->raw_length=blob_length;
+ blob->byteno=byteno;
+
+ BEGIN(PBF_OK);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Uncompress a blob and decode the nodes, ways and relations in it.
+
+  int decode_blob Returns PBF_OK or the error state.
+
+  pbf_blob *blob The blob to decode.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int decode_blob(pbf_blob *blob)
+{
+ uint32_t raw_size=0,compressed_size=0,uncompressed_size=0;
+ unsigned char *raw_data=NULL,*zlib_data=NULL;
+ unsigned char *data_ptr=blob->raw,*data_end=blob->raw+blob->raw_length;
+ uint32_t length;
+ unsigned char *data;
+
+ blob->nstrings=0;
+ blob->nelements=0;
+ blob->ntags=0;
+ blob->nrefs=0;
+ blob->nmembers=0;
+
+ while(data_ptr<data_end)
+   {
+    int fieldtype=pbf_int32(&data_ptr);
+    int field=PBF_FIELD(fieldtype);
+
+    switch(field)
+      {
+      case PBF_VAL_BLOB_RAW_DATA: /* bytes */
+       raw_data=pbf_length_delimited(&data_ptr,&raw_size);
+       break;
+
+      case PBF_VAL_BLOB_RAW_SIZE: /* int32 */
+       uncompressed_size=pbf_int32(&data_ptr);
+       break;
+
+      case PBF_VAL_BLOB_ZLIB_DATA: /* bytes */
+       zlib_data=pbf_length_delimited(&data_ptr,&compressed_size);
+       break;
+
+      default:
+       pbf_skip(&data_ptr,PBF_TYPE(fieldtype));
+      }
+   }
+
+ if(raw_data && zlib_data)
+    BEGIN(PBF_ERROR_BLOB_BOTH);
+
+ if(!raw_data && !zlib_data)
+    BEGIN(PBF_ERROR_BLOB_NEITHER);
+
+ if(zlib_data)
+   {
+#if defined(USE_GZIP) && USE_GZIP
+    int newstate=uncompress_pbf(blob,zlib_data,compressed_size,uncompressed_size);
+
+    if(newstate)
+       BEGIN(newstate);
+
+    data_ptr=blob->zbuffer;
+    data_end=blob->zbuffer+uncompressed_size;
+#else
+    BEGIN(PBF_ERROR_NO_GZIP);
+#endif
+   }
+ else
+   {
+    data_ptr=raw_data;
+    data_end=raw_data+raw_size;
+   }
+
+
+ if(blob->osm_header)
+   {
+    while(data_ptr<data_end)
+      {
+       int fieldtype=pbf_int32(&data_ptr);
        int field=PBF_FIELD(fieldtype);
 
        switch(field)
          {
-         case PBF_VAL_BLOBHEADER_TYPE: /* string */
+         case PBF_VAL_REQUIRED_FEATURES: /* string */
           {
            uint32_t length=0;
-           unsigned char *type=NULL;
-
-           type=pbf_length_delimited(&buffer_ptr,&length);
+           unsigned char *feature=NULL;
 
-           if(length==9 && !strncmp((char*)type,"OSMHeader",9))
-              osm_header=1;
+           feature=pbf_length_delimited(&data_ptr,&length);
 
-           if(length==7 && !strncmp((char*)type,"OSMData",7))
-              osm_data=1;
+           if(strncmp((char*)feature,"OsmSchema-V0.6",14) &&
+              strncmp((char*)feature,"DenseNodes",10))
+             {
+              feature[length]=0;
+              blob->error=feature;
+              BEGIN(PBF_ERROR_UNSUPPORTED);
+             }
           }
           break;
 
-         case PBF_VAL_BLOBHEADER_SIZE: /* int32 */
-          blob_length=pbf_int32(&buffer_ptr);
+         case PBF_VAL_OPTIONAL_FEATURES: /* string */
+          pbf_length_delimited(&data_ptr,NULL);
           break;
 
          default:
-          pbf_skip(&buffer_ptr,PBF_TYPE(fieldtype));
+          pbf_skip(&data_ptr,PBF_TYPE(fieldtype));
          }
       }
+   }
 
-    if(blob_length==0 || blob_length>LENGTH_32M)
-       BEGIN(PBF_ERROR_BLOB_LEN);
-
-    if(!osm_data && !osm_header)
-       BEGIN(PBF_ERROR_NOT_OSM);
 
+ if(blob->osm_data)
+   {
+    unsigned char *primitive_group[8]={NULL};
+    uint32_t primitive_group_length[8]={0};
+    uint32_t nprimitive_groups=0,i;
 
-    BUFFER_CHARS(blob_length);
+    blob->granularity=100;
+    blob->lat_offset=blob->lon_offset=0;
 
-    while(buffer_ptr<buffer_end)
+    while(data_ptr<data_end)
       {
-       int fieldtype=pbf_int32(&buffer_ptr);
+       int fieldtype=pbf_int32(&data_ptr);
        int field=PBF_FIELD(fieldtype);
 
        switch(field)
          {
-         case PBF_VAL_BLOB_RAW_DATA: /* bytes */
-          raw_data=pbf_length_delimited(&buffer_ptr,&raw_size);
+         case PBF_VAL_STRING_TABLE: /* bytes */
+          data=pbf_length_delimited(&data_ptr,&length);
+          decode_string_table(blob,data,length);
+          break;
+
+         case PBF_VAL_PRIMITIVE_GROUP: /* bytes */
+          if(nprimitive_groups==(sizeof(primitive_group)/sizeof(primitive_group[0])))
+             BEGIN(PBF_ERROR_TOO_MANY_GROUPS);
+
+          primitive_group[nprimitive_groups]=pbf_length_delimited(&data_ptr,&primitive_group_length[nprimitive_groups]);
+          nprimitive_groups++;
+          break;
+
+         case PBF_VAL_GRANULARITY: /* int32 */
+          blob->granularity=pbf_int32(&data_ptr);
           break;
 
-         case PBF_VAL_BLOB_RAW_SIZE: /* int32 */
-          uncompressed_size=pbf_int32(&buffer_ptr);
+         case PBF_VAL_LAT_OFFSET: /* int64 */
+          blob->lat_offset=pbf_int64(&data_ptr);
           break;
 
-         case PBF_VAL_BLOB_ZLIB_DATA: /* bytes */
-          zlib_data=pbf_length_delimited(&buffer_ptr,&compressed_size);
+         case PBF_VAL_LON_OFFSET: /* int64 */
+          blob->lon_offset=pbf_int64(&data_ptr);
           break;
 
          default:
-          pbf_skip(&buffer_ptr,PBF_TYPE(fieldtype));
+          pbf_skip(&data_ptr,PBF_TYPE(fieldtype));
          }
       }
 
-    if(raw_data && zlib_data)
-       BEGIN(PBF_ERROR_BLOB_BOTH);
+    /* Fixup the strings (not null terminated in buffer) */
 
-    if(!raw_data && !zlib_data)
-       BEGIN(PBF_ERROR_BLOB_NEITHER);
+    for(i=0;i<blob->nstrings;i++)
+       blob->strings[i][blob->string_lengths[i]]=0;
 
-    if(zlib_data)
-      {
-#if defined(USE_GZIP) && USE_GZIP
-       int newstate=uncompress_pbf(zlib_data,compressed_size,uncompressed_size);
+    for(i=0;i<nprimitive_groups;i++)
+       decode_primitive_group(blob,primitive_group[i],primitive_group_length[i]);
+   }
 
-       if(newstate)
-          BEGIN(newstate);
-#else
-       BEGIN(PBF_ERROR_NO_GZIP);
-#endif
-      }
-    else
-      {
-       buffer_ptr=raw_data;
-       buffer_end=raw_data+raw_size;
-      }
+ BEGIN(PBF_OK);
+}
 
 
-    if(osm_header)
-      {
-       while(buffer_ptr<buffer_end)
-         {
-          int fieldtype=pbf_int32(&buffer_ptr);
-          int field=PBF_FIELD(fieldtype);
+/*++++++++++++++++++++++++++++++++++++++
+  Apply the tagging rules to the decoded nodes, ways and relations of a blob and pass them to the
+  OSM parser.
 
-          switch(field)
-            {
-            case PBF_VAL_REQUIRED_FEATURES: /* string */
-             {
-              uint32_t length=0;
-              unsigned char *feature=NULL;
-
-              feature=pbf_length_delimited(&buffer_ptr,&length);
-
-              if(strncmp((char*)feature,"OsmSchema-V0.6",14) &&
-                 strncmp((char*)feature,"DenseNodes",10))
-                {
-                 feature[length]=0;
-                 error=feature;
-                 BEGIN(PBF_ERROR_UNSUPPORTED);
-                }
-             }
-             break;
+  pbf_blob *blob The decoded blob.
+  ++++++++++++++++++++++++++++++++++++++*/
 
-            case PBF_VAL_OPTIONAL_FEATURES: /* string */
-             pbf_length_delimited(&buffer_ptr,NULL);
-             break;
+static void process_blob(pbf_blob *blob)
+{
+ unsigned char **tags=blob->tags;
+ int64_t *refs=blob->refs;
+ pbf_member *members=blob->members;
+ uint32_t e,i;
 
-            default:
-             pbf_skip(&buffer_ptr,PBF_TYPE(fieldtype));
-            }
-         }
-      }
+ for(e=0;e<blob->nelements;e++)
+   {
+    pbf_element *element=&blob->elements[e];
+    TagList *tags_list=NewTagList(),*result;
+
+    if(element->type==PBF_RELATION)
+       AddRelationRefs(0,0,0,NULL);
 
+    for(i=0;i<element->ntags;i++,tags+=2)
+       AppendTag(tags_list,(char*)tags[0],(char*)tags[1]);
 
-    if(osm_data)
+    switch(element->type)
       {
-       unsigned char *primitive_group[8]={NULL};
-       uint32_t primitive_group_length[8]={0};
-       uint32_t nprimitive_groups=0,i;
+      case PBF_NODE:
+       nnodes++;
 
-       granularity=100;
-       lat_offset=lon_offset=0;
+       if(!(nnodes%10000))
+          printf_middle("Reading: Bytes=%"PRIu64" Nodes=%"PRIu64" Ways=%"PRIu64" Relations=%"PRIu64,blob->byteno,nnodes,nways,nrelations);
 
-       while(buffer_ptr<buffer_end)
-         {
-          int fieldtype=pbf_int32(&buffer_ptr);
-          int field=PBF_FIELD(fieldtype);
-
-          switch(field)
-            {
-            case PBF_VAL_STRING_TABLE: /* bytes */
-             data=pbf_length_delimited(&buffer_ptr,&length);
-             process_string_table(data,length);
-             break;
+       result=ApplyNodeTaggingRules(tags_list,element->id);
 
-            case PBF_VAL_PRIMITIVE_GROUP: /* bytes */
-             primitive_group[nprimitive_groups]=pbf_length_delimited(&buffer_ptr,&primitive_group_length[nprimitive_groups]);
+       ProcessNodeTags(result,element->id,element->latitude,element->longitude,MODE_NORMAL);
+       break;
 
-             if(++nprimitive_groups>(sizeof(primitive_group)/sizeof(primitive_group[0])))
-                BEGIN(PBF_ERROR_TOO_MANY_GROUPS);
-             break;
+      case PBF_WAY:
+       nways++;
 
-            case PBF_VAL_GRANULARITY: /* int32 */
-             granularity=pbf_int32(&buffer_ptr);
-             break;
+       if(!(nways%1000))
+          printf_middle("Reading: Bytes=%"PRIu64" Nodes=%"PRIu64" Ways=%"PRIu64" Relations=%"PRIu64,blob->byteno,nnodes,nways,nrelations);
 
-            case PBF_VAL_LAT_OFFSET: /* int64 */
-             lat_offset=pbf_int64(&buffer_ptr);
-             break;
+       AddWayRefs(0);
 
-            case PBF_VAL_LON_OFFSET: /* int64 */
-             lon_offset=pbf_int64(&buffer_ptr);
-             break;
+       for(i=0;i<element->nrefs;i++)
+          AddWayRefs(*refs++);
 
-            default:
-             pbf_skip(&buffer_ptr,PBF_TYPE(fieldtype));
-            }
-         }
+       result=ApplyWayTaggingRules(tags_list,element->id);
+
+       ProcessWayTags(result,element->id,MODE_NORMAL);
+       break;
+
+      default: /* case PBF_RELATION: */
+       nrelations++;
+
+       if(!(nrelations%1000))
+          printf_middle("Reading: Bytes=%"PRIu64" Nodes=%"PRIu64" Ways=%"PRIu64" Relations=%"PRIu64,blob->byteno,nnodes,nways,nrelations);
 
-       if(nprimitive_groups)
-          for(i=0;i<nprimitive_groups;i++)
-             process_primitive_group(primitive_group[i],primitive_group_length[i]);
+       for(i=0;i<element->nrefs;i++,members++)
+          if(members->type==0)
+             AddRelationRefs(members->id,0,0,(char*)members->role);
+          else if(members->type==1)
+             AddRelationRefs(0,members->id,0,(char*)members->role);
+          else if(members->type==2)
+             AddRelationRefs(0,0,members->id,(char*)members->role);
+
+       result=ApplyRelationTaggingRules(tags_list,element->id);
+
+       ProcessRelationTags(result,element->id,MODE_NORMAL);
+       break;
       }
+
+    DeleteTagList(tags_list);
+    DeleteTagList(result);
    }
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Print the error message for the state of a blob that stopped the parsing.
 
+  pbf_blob *blob The blob.
+  ++++++++++++++++++++++++++++++++++++++*/
 
- finish_parsing:
+static void report_error(pbf_blob *blob)
+{
+ uint64_t byteno=blob->byteno;
 
- switch(state)
+ switch(blob->state)
    {
     /* End of file */
 
@@ -644,46 +924,254 @@ int ParsePBF(int fd)
     break;
 
    case PBF_ERROR_UNSUPPORTED:
-    fprintf(stderr,"PBF Parser: Error at byte %"PRIu64": Unsupported required feature '%s'.\n",byteno,error);
+    fprintf(stderr,"PBF Parser: Error at byte %"PRIu64": Unsupported required feature '%s'.\n",byteno,blob->error);
     break;
 
    case PBF_ERROR_TOO_MANY_GROUPS:
     fprintf(stderr,"PBF Parser: Error at byte %"PRIu64": OsmData message contains too many PrimitiveGroup messages.\n",byteno);
     break;
    }
+}
 
- /* Free the parser variables */
 
- free(string_table);
- free(string_table_string_lengths);
+/*++++++++++++++++++++++++++++++++++++++
+  Free the buffers of a blob.
 
- free(buffer);
- if(zbuffer)
-    free(zbuffer);
+  pbf_blob *blob The blob.
+  ++++++++++++++++++++++++++++++++++++++*/
 
- /* Print the final message */
+static void free_blob(pbf_blob *blob)
+{
+ if(blob->raw)
+    free(blob->raw);
+ if(blob->zbuffer)
+    free(blob->zbuffer);
 
- printf_last("Read: Bytes=%"PRIu64" Nodes=%"PRIu64" Ways=%"PRIu64" Relations=%"PRIu64,byteno,nnodes,nways,nrelations);
+ if(blob->strings)
+   {
+    free(blob->strings);
+    free(blob->string_lengths);
+   }
+
+ if(blob->elements)
+    free(blob->elements);
+ if(blob->tags)
+    free(blob->tags);
+ if(blob->refs)
+    free(blob->refs);
+ if(blob->members)
+    free(blob->members);
+}
+
+
+#if defined(USE_PTHREADS) && USE_PTHREADS
+
+/*++++++++++++++++++++++++++++++++++++++
+  Parse the PBF using one thread to read the blobs and several to decode them while this thread
+  processes them in order.
+
+  int parse_threaded Returns 0 if OK or something else in case of an error.
+
+  int fd The file descriptor of the file to parse.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int parse_threaded(int fd)
+{
+ pthread_t reader,*decoders;
+ int i,state;
+
+ nblobs=option_pbf_blobs;
+
+ blobs=(pbf_blob*)calloc(nblobs,sizeof(pbf_blob));
+ decoders=(pthread_t*)malloc(option_pbf_threads*sizeof(pthread_t));
+
+ logassert(blobs && decoders,"Failed to allocate memory"); /* Check malloc() worked */
+
+ blobs_read=blobs_decoding=blobs_processed=0;
+ blobs_finished=0;
+
+ pthread_create(&reader,NULL,(void* (*)(void*))read_blobs_thread,&fd);
+
+ for(i=0;i<option_pbf_threads;i++)
+    pthread_create(&decoders[i],NULL,decode_blobs_thread,NULL);
+
+ /* Process the blobs in the order that they were read */
+
+ while(1)
+   {
+    pbf_blob *blob=&blobs[blobs_processed%nblobs];
+
+    pthread_mutex_lock(&blobs_mutex);
+
+    while(!blob->decoded)
+       pthread_cond_wait(&blobs_cond,&blobs_mutex);
+
+    pthread_mutex_unlock(&blobs_mutex);
+
+    if(blob->state!=PBF_OK)
+      {
+       report_error(blob);
+       state=blob->state;
+       break;
+      }
+
+    process_blob(blob);
+
+    pthread_mutex_lock(&blobs_mutex);
+
+    blob->decoded=0;
+    blobs_processed++;
+
+    pthread_cond_broadcast(&blobs_cond);
+
+    pthread_mutex_unlock(&blobs_mutex);
+   }
+
+ /* Stop the other threads */
+
+ pthread_mutex_lock(&blobs_mutex);
+
+ blobs_finished=1;
+
+ pthread_cond_broadcast(&blobs_cond);
+
+ pthread_mutex_unlock(&blobs_mutex);
+
+ pthread_join(reader,NULL);
+
+ for(i=0;i<option_pbf_threads;i++)
+    pthread_join(decoders[i],NULL);
+
+ for(i=0;i<nblobs;i++)
+    free_blob(&blobs[i]);
+
+ free(blobs);
+ free(decoders);
 
  return(state);
 }
 
 
 /*++++++++++++++++++++++++++++++++++++++
-  Process a PBF StringTable message.
+  The thread that reads the blobs from the file (until the end of the file or an error).
+
+  void *read_blobs_thread Returns NULL.
+
+  int *fd The file descriptor of the file to read.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void *read_blobs_thread(int *fd)
+{
+ int state;
+
+ do
+   {
+    pbf_blob *blob;
+
+    /* Wait for a blob that has been processed */
+
+    pthread_mutex_lock(&blobs_mutex);
 
-  unsigned char *data The data to process.
+    while(!blobs_finished && blobs_read==blobs_processed+nblobs)
+       pthread_cond_wait(&blobs_cond,&blobs_mutex);
+
+    pthread_mutex_unlock(&blobs_mutex);
+
+    if(blobs_finished)
+       break;
+
+    blob=&blobs[blobs_read%nblobs];
+
+    state=read_blob(*fd,blob);
+
+    /* Pass it on to be decoded (or just processed if there was an error) */
+
+    pthread_mutex_lock(&blobs_mutex);
+
+    if(state!=PBF_OK)
+       blob->decoded=1;
+
+    blobs_read++;
+
+    pthread_cond_broadcast(&blobs_cond);
+
+    pthread_mutex_unlock(&blobs_mutex);
+   }
+ while(state==PBF_OK);
+
+ return(NULL);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  A thread that decodes the blobs that have been read (any number of these can run at once).
+
+  void *decode_blobs_thread Returns NULL.
+
+  void *arg Not used.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void *decode_blobs_thread(void *arg)
+{
+ while(1)
+   {
+    pbf_blob *blob;
+
+    /* Wait for a blob that has been read and not decoded */
+
+    pthread_mutex_lock(&blobs_mutex);
+
+    while(!blobs_finished && (blobs_decoding==blobs_read || blobs[blobs_decoding%nblobs].decoded))
+       pthread_cond_wait(&blobs_cond,&blobs_mutex);
+
+    if(blobs_finished)
+      {
+       pthread_mutex_unlock(&blobs_mutex);
+       break;
+      }
+
+    blob=&blobs[blobs_decoding%nblobs];
+
+    blobs_decoding++;
+
+    pthread_mutex_unlock(&blobs_mutex);
+
+    decode_blob(blob);
+
+    /* Pass it on to be processed */
+
+    pthread_mutex_lock(&blobs_mutex);
+
+    blob->decoded=1;
+
+    pthread_cond_broadcast(&blobs_cond);
+
+    pthread_mutex_unlock(&blobs_mutex);
+   }
+
+ return(NULL);
+}
+
+#endif /* USE_PTHREADS */
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Decode a PBF StringTable message.
+
+  pbf_blob *blob The blob being decoded.
+
+  unsigned char *data The data to decode.
 
   uint32_t length The length of the data.
   ++++++++++++++++++++++++++++++++++++++*/
 
-static void process_string_table(unsigned char *data,uint32_t length)
+static void decode_string_table(pbf_blob *blob,unsigned char *data,uint32_t length)
 {
  unsigned char *end=data+length;
  unsigned char *string;
  uint32_t string_length;
 
- string_table_length=0;
+ blob->nstrings=0;
 
  while(data<end)
    {
@@ -695,17 +1183,19 @@ static void process_string_table(unsigned char *data,uint32_t length)
       case PBF_VAL_STRING:      /* string */
        string=pbf_length_delimited(&data,&string_length);
 
-       if(string_table_length==string_table_allocated)
+       if(blob->nstrings==blob->strings_allocated)
          {
-          string_table_allocated+=8192;
-          string_table=(unsigned char **)realloc(string_table,string_table_allocated*sizeof(unsigned char *));
-          string_table_string_lengths=(uint32_t *)realloc(string_table_string_lengths,string_table_allocated*sizeof(uint32_t));
+          blob->strings_allocated+=8192;
+          blob->strings=(unsigned char **)realloc(blob->strings,blob->strings_allocated*sizeof(unsigned char *));
+          blob->string_lengths=(uint32_t *)realloc(blob->string_lengths,blob->strings_allocated*sizeof(uint32_t));
+
+          logassert(blob->strings && blob->string_lengths,"Failed to allocate memory"); /* Check realloc() worked */
          }
 
-       string_table[string_table_length]=string;
-       string_table_string_lengths[string_table_length]=string_length;
+       blob->strings[blob->nstrings]=string;
+       blob->string_lengths[blob->nstrings]=string_length;
 
-       string_table_length++;
+       blob->nstrings++;
        break;
 
       default:
@@ -716,25 +1206,20 @@ static void process_string_table(unsigned char *data,uint32_t length)
 
 
 /*++++++++++++++++++++++++++++++++++++++
-  Process a PBF PrimitiveGroup message.
+  Decode a PBF PrimitiveGroup message.
 
-  unsigned char *data The data to process.
+  pbf_blob *blob The blob being decoded.
+
+  unsigned char *data The data to decode.
 
   uint32_t length The length of the data.
   ++++++++++++++++++++++++++++++++++++++*/
 
-static void process_primitive_group(unsigned char *data,uint32_t length)
+static void decode_primitive_group(pbf_blob *blob,unsigned char *data,uint32_t length)
 {
  unsigned char *end=data+length;
  unsigned char *subdata;
  uint32_t sublength;
- int i;
-
- /* Fixup the strings (not null terminated in buffer) */
-
- for(i=0;i<string_table_length;i++)
-    string_table[i][string_table_string_lengths[i]]=0;
-
 
  while(data<end)
    {
@@ -745,22 +1230,22 @@ static void process_primitive_group(unsigned char *data,uint32_t length)
       {
       case PBF_VAL_NODES:       /* message */
        subdata=pbf_length_delimited(&data,&sublength);
-       process_nodes(subdata,sublength);
+       decode_nodes(blob,subdata,sublength);
        break;
 
       case PBF_VAL_DENSE_NODES: /* message */
        subdata=pbf_length_delimited(&data,&sublength);
-       process_dense_nodes(subdata,sublength);
+       decode_dense_nodes(blob,subdata,sublength);
        break;
 
       case PBF_VAL_WAYS:        /* message */
        subdata=pbf_length_delimited(&data,&sublength);
-       process_ways(subdata,sublength);
+       decode_ways(blob,subdata,sublength);
        break;
 
       case PBF_VAL_RELATIONS:   /* message */
        subdata=pbf_length_delimited(&data,&sublength);
-       process_relations(subdata,sublength);
+       decode_relations(blob,subdata,sublength);
        break;
 
       default:
@@ -771,14 +1256,16 @@ static void process_primitive_group(unsigned char *data,uint32_t length)
 
 
 /*++++++++++++++++++++++++++++++++++++++
-  Process a PBF Node message.
+  Decode a PBF Node message.
+
+  pbf_blob *blob The blob being decoded.
 
-  unsigned char *data The data to process.
+  unsigned char *data The data to decode.
 
   uint32_t length The length of the data.
   ++++++++++++++++++++++++++++++++++++++*/
 
-static void process_nodes(unsigned char *data,uint32_t length)
+static void decode_nodes(pbf_blob *blob,unsigned char *data,uint32_t length)
 {
  unsigned char *end=data+length;
  int64_t id=0;
@@ -786,7 +1273,7 @@ static void process_nodes(unsigned char *data,uint32_t length)
  unsigned char *keys_end=NULL,*vals_end=NULL;
  uint32_t keylen=0,vallen=0;
  int64_t lat=0,lon=0;
- TagList *tags=NULL,*result=NULL;
+ pbf_element *element;
 
  while(data<end)
    {
@@ -822,14 +1309,12 @@ static void process_nodes(unsigned char *data,uint32_t length)
       }
    }
 
- /* Mangle the data and send it to the OSM parser */
-
- nnodes++;
+ /* Store the decoded node */
 
- if(!(nnodes%10000))
-    printf_middle("Reading: Bytes=%"PRIu64" Nodes=%"PRIu64" Ways=%"PRIu64" Relations=%"PRIu64,byteno,nnodes,nways,nrelations);
+ element=new_element(blob,PBF_NODE,id);
 
- tags=NewTagList();
+ element->latitude =PBF_LATITUDE(blob,lat);
+ element->longitude=PBF_LONGITUDE(blob,lon);
 
  if(keys && vals)
    {
@@ -838,28 +1323,23 @@ static void process_nodes(unsigned char *data,uint32_t length)
        uint32_t key=pbf_int32(&keys);
        uint32_t val=pbf_int32(&vals);
 
-       AppendTag(tags,(char*)string_table[key],(char*)string_table[val]);
+       append_tag(blob,element,key,val);
       }
    }
-
- result=ApplyNodeTaggingRules(tags,id);
-
- ProcessNodeTags(result,id,PBF_LATITUDE(lat),PBF_LONGITUDE(lon),MODE_NORMAL);
-
- DeleteTagList(tags);
- DeleteTagList(result);
 }
 
 
 /*++++++++++++++++++++++++++++++++++++++
-  Process a PBF DenseNode message.
+  Decode a PBF DenseNode message.
 
-  unsigned char *data The data to process.
+  pbf_blob *blob The blob being decoded.
+
+  unsigned char *data The data to decode.
 
   uint32_t length The length of the data.
   ++++++++++++++++++++++++++++++++++++++*/
 
-static void process_dense_nodes(unsigned char *data,uint32_t length)
+static void decode_dense_nodes(pbf_blob *blob,unsigned char *data,uint32_t length)
 {
  unsigned char *end=data+length;
  unsigned char *ids=NULL,*keys_vals=NULL,*lats=NULL,*lons=NULL;
@@ -867,7 +1347,6 @@ static void process_dense_nodes(unsigned char *data,uint32_t length)
  uint32_t idlen=0;
  int64_t id=0;
  int64_t lat=0,lon=0;
- TagList *tags=NULL,*result;
 
  while(data<end)
    {
@@ -902,6 +1381,7 @@ static void process_dense_nodes(unsigned char *data,uint32_t length)
    {
     int64_t delta_id;
     int64_t delta_lat,delta_lon;
+    pbf_element *element;
 
     delta_id=pbf_sint64(&ids);
     delta_lat=pbf_sint64(&lats);
@@ -911,14 +1391,12 @@ static void process_dense_nodes(unsigned char *data,uint32_t length)
     lat+=delta_lat;
     lon+=delta_lon;
 
-    /* Mangle the data and send it to the OSM parser */
-
-    nnodes++;
+    /* Store the decoded node */
 
-    if(!(nnodes%10000))
-       printf_middle("Reading: Bytes=%"PRIu64" Nodes=%"PRIu64" Ways=%"PRIu64" Relations=%"PRIu64,byteno,nnodes,nways,nrelations);
+    element=new_element(blob,PBF_NODE,id);
 
-    tags=NewTagList();
+    element->latitude =PBF_LATITUDE(blob,lat);
+    element->longitude=PBF_LONGITUDE(blob,lon);
 
     if(keys_vals)
       {
@@ -931,29 +1409,24 @@ static void process_dense_nodes(unsigned char *data,uint32_t length)
 
           val=pbf_int32(&keys_vals);
 
-          AppendTag(tags,(char*)string_table[key],(char*)string_table[val]);
+          append_tag(blob,element,key,val);
          }
       }
-
-    result=ApplyNodeTaggingRules(tags,id);
-
-    ProcessNodeTags(result,id,PBF_LATITUDE(lat),PBF_LONGITUDE(lon),MODE_NORMAL);
-
-    DeleteTagList(tags);
-    DeleteTagList(result);
    }
 }
 
 
 /*++++++++++++++++++++++++++++++++++++++
-  Process a PBF Way message.
+  Decode a PBF Way message.
 
-  unsigned char *data The data to process.
+  pbf_blob *blob The blob being decoded.
+
+  unsigned char *data The data to decode.
 
   uint32_t length The length of the data.
   ++++++++++++++++++++++++++++++++++++++*/
 
-static void process_ways(unsigned char *data,uint32_t length)
+static void decode_ways(pbf_blob *blob,unsigned char *data,uint32_t length)
 {
  unsigned char *end=data+length;
  int64_t id=0;
@@ -961,7 +1434,7 @@ static void process_ways(unsigned char *data,uint32_t length)
  unsigned char *keys_end=NULL,*vals_end=NULL,*refs_end=NULL;
  uint32_t keylen=0,vallen=0,reflen=0;
  int64_t ref=0;
- TagList *tags=NULL,*result;
+ pbf_element *element;
 
  while(data<end)
    {
@@ -994,14 +1467,9 @@ static void process_ways(unsigned char *data,uint32_t length)
       }
    }
 
- /* Mangle the data and send it to the OSM parser */
-
- nways++;
-
- if(!(nways%1000))
-    printf_middle("Reading: Bytes=%"PRIu64" Nodes=%"PRIu64" Ways=%"PRIu64" Relations=%"PRIu64,byteno,nnodes,nways,nrelations);
+ /* Store the decoded way */
 
- tags=NewTagList();
+ element=new_element(blob,PBF_WAY,id);
 
  if(keys && vals)
    {
@@ -1010,12 +1478,10 @@ static void process_ways(unsigned char *data,uint32_t length)
        uint32_t key=pbf_int32(&keys);
        uint32_t val=pbf_int32(&vals);
 
-       AppendTag(tags,(char*)string_table[key],(char*)string_table[val]);
+       append_tag(blob,element,key,val);
       }
    }
 
- AddWayRefs(0);
-
  if(refs)
     while(refs<refs_end)
       {
@@ -1028,27 +1494,32 @@ static void process_ways(unsigned char *data,uint32_t length)
        if(ref==0)
           break;
 
-       AddWayRefs(ref);
-      }
+       if(blob->nrefs==blob->refs_allocated)
+         {
+          blob->refs_allocated=blob->refs_allocated?2*blob->refs_allocated:65536;
+          blob->refs=(int64_t*)realloc(blob->refs,blob->refs_allocated*sizeof(int64_t));
 
- result=ApplyWayTaggingRules(tags,id);
+          logassert(blob->refs,"Failed to allocate memory"); /* Check realloc() worked */
+         }
 
- ProcessWayTags(result,id,MODE_NORMAL);
+       blob->refs[blob->nrefs++]=ref;
 
- DeleteTagList(tags);
- DeleteTagList(result);
+       element->nrefs++;
+      }
 }
 
 
 /*++++++++++++++++++++++++++++++++++++++
-  Process a PBF Relation message.
+  Decode a PBF Relation message.
 
-  unsigned char *data The data to process.
+  pbf_blob *blob The blob being decoded.
+
+  unsigned char *data The data to decode.
 
   uint32_t length The length of the data.
   ++++++++++++++++++++++++++++++++++++++*/
 
-static void process_relations(unsigned char *data,uint32_t length)
+static void decode_relations(pbf_blob *blob,unsigned char *data,uint32_t length)
 {
  unsigned char *end=data+length;
  int64_t id=0;
@@ -1056,7 +1527,7 @@ static void process_relations(unsigned char *data,uint32_t length)
  unsigned char *keys_end=NULL,*vals_end=NULL,*memids_end=NULL,*types_end=NULL;
  uint32_t keylen=0,vallen=0,rolelen=0,memidlen=0,typelen=0;
  int64_t memid=0;
- TagList *tags=NULL,*result;
+ pbf_element *element;
 
  while(data<end)
    {
@@ -1098,16 +1569,9 @@ static void process_relations(unsigned char *data,uint32_t length)
       }
    }
 
- /* Mangle the data and send it to the OSM parser */
-
- nrelations++;
-
- if(!(nrelations%1000))
-    printf_middle("Reading: Bytes=%"PRIu64" Nodes=%"PRIu64" Ways=%"PRIu64" Relations=%"PRIu64,byteno,nnodes,nways,nrelations);
+ /* Store the decoded relation */
 
- AddRelationRefs(0,0,0,NULL);
-
- tags=NewTagList();
+ element=new_element(blob,PBF_RELATION,id);
 
  if(keys && vals)
    {
@@ -1116,7 +1580,7 @@ static void process_relations(unsigned char *data,uint32_t length)
        uint32_t key=pbf_int32(&keys);
        uint32_t val=pbf_int32(&vals);
 
-       AppendTag(tags,(char*)string_table[key],(char*)string_table[val]);
+       append_tag(blob,element,key,val);
       }
    }
 
@@ -1124,31 +1588,96 @@ static void process_relations(unsigned char *data,uint32_t length)
     while(memids<memids_end && types<types_end)
       {
        int64_t delta_memid;
-       unsigned char *role=NULL;
-       int type;
+       pbf_member *member;
+
+       if(blob->nmembers==blob->members_allocated)
+         {
+          blob->members_allocated=blob->members_allocated?2*blob->members_allocated:4096;
+          blob->members=(pbf_member*)realloc(blob->members,blob->members_allocated*sizeof(pbf_member));
+
+          logassert(blob->members,"Failed to allocate memory"); /* Check realloc() worked */
+         }
+
+       member=&blob->members[blob->nmembers++];
 
        delta_memid=pbf_sint64(&memids);
-       type=pbf_int32(&types);
+       member->type=pbf_int32(&types);
 
        if(roles)
-          role=string_table[pbf_int32(&roles)];
+          member->role=blob->strings[pbf_int32(&roles)];
+       else
+          member->role=NULL;
 
        memid+=delta_memid;
 
-       if(type==0)
-          AddRelationRefs(memid,0,0,(char*)role);
-       else if(type==1)
-          AddRelationRefs(0,memid,0,(char*)role);
-       else if(type==2)
-          AddRelationRefs(0,0,memid,(char*)role);
+       member->id=memid;
+
+       element->nrefs++;
       }
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Add a new decoded element to a blob.
+
+  pbf_element *new_element Returns a pointer to the element.
+
+  pbf_blob *blob The blob being decoded.
+
+  int type The type of element.
+
+  int64_t id The OSM id of the element.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static inline pbf_element *new_element(pbf_blob *blob,int type,int64_t id)
+{
+ pbf_element *element;
+
+ if(blob->nelements==blob->elements_allocated)
+   {
+    blob->elements_allocated=blob->elements_allocated?2*blob->elements_allocated:8192;
+    blob->elements=(pbf_element*)realloc(blob->elements,blob->elements_allocated*sizeof(pbf_element));
 
- result=ApplyRelationTaggingRules(tags,id);
+    logassert(blob->elements,"Failed to allocate memory"); /* Check realloc() worked */
+   }
+
+ element=&blob->elements[blob->nelements++];
 
- ProcessRelationTags(result,id,MODE_NORMAL);
+ element->type=type;
+ element->id=id;
+ element->ntags=0;
+ element->nrefs=0;
 
- DeleteTagList(tags);
- DeleteTagList(result);
+ return(element);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Add a tag to the most recently decoded element of a blob.
+
+  pbf_blob *blob The blob being decoded.
+
+  pbf_element *element The element.
+
+  uint32_t key The index of the key in the string table.
+
+  uint32_t val The index of the value in the string table.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static inline void append_tag(pbf_blob *blob,pbf_element *element,uint32_t key,uint32_t val)
+{
+ if(blob->ntags==blob->tags_allocated)
+   {
+    blob->tags_allocated=blob->tags_allocated?2*blob->tags_allocated:16384;
+    blob->tags=(unsigned char**)realloc(blob->tags,blob->tags_allocated*sizeof(unsigned char*));
+
+    logassert(blob->tags,"Failed to allocate memory"); /* Check realloc() worked */
+   }
+
+ blob->tags[blob->ntags++]=blob->strings[key];
+ blob->tags[blob->ntags++]=blob->strings[val];
+
+ element->ntags++;
 }
 
 
@@ -1159,6 +1688,8 @@ static void process_relations(unsigned char *data,uint32_t length)
 
   int uncompress_pbf Returns the error state or 0 if OK.
 
+  pbf_blob *blob The blob to uncompress into.
+
   unsigned char *data The data to uncompress.
 
   uint32_t compressed The number of bytes to uncompress.
@@ -1166,12 +1697,12 @@ static void process_relations(unsigned char *data,uint32_t length)
   uint32_t uncompressed The number of bytes expected when uncompressed.
   ++++++++++++++++++++++++++++++++++++++*/
 
-static int uncompress_pbf(unsigned char *data,uint32_t compressed,uint32_t uncompressed)
+static int uncompress_pbf(pbf_blob *blob,unsigned char *data,uint32_t compressed,uint32_t uncompressed)
 {
  z_stream z={0};
 
- if(uncompressed>zbuffer_allocated)
-    zbuffer=(unsigned char *)realloc(zbuffer,zbuffer_allocated=uncompressed);
+ if(uncompressed>blob->zbuffer_allocated)
+    blob->zbuffer=(unsigned char *)realloc(blob->zbuffer,blob->zbuffer_allocated=uncompressed);
 
  if(inflateInit2(&z,15+32)!=Z_OK)
     return(PBF_ERROR_GZIP_INIT);
@@ -1179,7 +1710,7 @@ static int uncompress_pbf(unsigned char *data,uint32_t compressed,uint32_t uncom
  z.next_in=data;
  z.avail_in=compressed;
 
- z.next_out=zbuffer;
+ z.next_out=blob->zbuffer;
  z.avail_out=uncompressed;
 
  if(inflate(&z,Z_FINISH)!=Z_STREAM_END)
@@ -1191,9 +1722,6 @@ static int uncompress_pbf(unsigned char *data,uint32_t compressed,uint32_t uncom
  if(inflateEnd(&z)!=Z_OK)
     return(PBF_ERROR_GZIP_END);
 
- buffer_ptr=zbuffer;
- buffer_end=zbuffer+uncompressed;
-
  return(0);
 }
 
@@ -35,6 +35,7 @@
 
 #include "functions.h"
 #include "fakes.h"
+#include "query.h"
 #include "translations.h"
 #include "results.h"
 #include "xmlparse.h"
@@ -57,9 +58,6 @@
 
 /* Global variables */
 
-/*+ The option to calculate the quickest route insted of the shortest. +*/
-extern int option_quickest;
-
 /*+ The options to select the format of the output. +*/
 extern int option_html,option_gpx_track,option_gpx_route,option_text,option_text_all;
 
@@ -88,6 +86,8 @@ static char junction_other_way[Highway_Count][Highway_Count]=
 /*++++++++++++++++++++++++++++++++++++++
   Print the optimum route between two nodes.
 
+  Query *query The query containing the routing options and the fake nodes and segments.
+
   Results **results The set of results to print (some may be NULL - ignore them).
 
   int nresults The number of results in the list.
@@ -101,7 +101,7 @@ static char junction_other_way[Highway_Count][Highway_Count]=
   Profile *profile The profile containing the transport type, speeds and allowed highways.
   ++++++++++++++++++++++++++++++++++++++*/
 
-void PrintRoute(Results **results,int nresults,Nodes *nodes,Segments *segments,Ways *ways,Profile *profile)
+void PrintRoute(Query *query,Results **results,int nresults,Nodes *nodes,Segments *segments,Ways *ways,Profile *profile)
 {
  FILE *htmlfile=NULL,*gpxtrackfile=NULL,*gpxroutefile=NULL,*textfile=NULL,*textallfile=NULL;
 
@@ -116,7 +116,7 @@ void PrintRoute(Results **results,int nresults,Nodes *nodes,Segments *segments,W
 
  /* Open the files */
 
- if(option_quickest==0)
+ if(query->quickest==0)
    {
     /* Print the result for the shortest route */
 
@@ -183,7 +183,7 @@ void PrintRoute(Results **results,int nresults,Nodes *nodes,Segments *segments,W
        fprintf(htmlfile,"<!-- %s : %s -->\n",translate_xml_copyright_license[0],translate_xml_copyright_license[1]);
     fprintf(htmlfile,"<HEAD>\n");
     fprintf(htmlfile,"<TITLE>");
-    fprintf(htmlfile,translate_html_title,option_quickest?translate_xml_route_quickest:translate_xml_route_shortest);
+    fprintf(htmlfile,translate_html_title,query->quickest?translate_xml_route_quickest:translate_xml_route_shortest);
     fprintf(htmlfile,"</TITLE>\n");
     fprintf(htmlfile,"<META http-equiv=\"Content-Type\" content=\"text/html; charset=UTF-8\">\n");
     fprintf(htmlfile,"<STYLE type=\"text/css\">\n");
@@ -208,7 +208,7 @@ void PrintRoute(Results **results,int nresults,Nodes *nodes,Segments *segments,W
     fprintf(htmlfile,"</HEAD>\n");
     fprintf(htmlfile,"<BODY>\n");
     fprintf(htmlfile,"<H1>");
-    fprintf(htmlfile,translate_html_title,option_quickest?translate_xml_route_quickest:translate_xml_route_shortest);
+    fprintf(htmlfile,translate_html_title,query->quickest?translate_xml_route_quickest:translate_xml_route_shortest);
     fprintf(htmlfile,"</H1>\n");
     fprintf(htmlfile,"<table>\n");
    }
@@ -233,10 +233,10 @@ void PrintRoute(Results **results,int nresults,Nodes *nodes,Segments *segments,W
 
     fprintf(gpxtrackfile,"<trk>\n");
     fprintf(gpxtrackfile,"<name>");
-    fprintf(gpxtrackfile,translate_gpx_name,option_quickest?translate_xml_route_quickest:translate_xml_route_shortest);
+    fprintf(gpxtrackfile,translate_gpx_name,query->quickest?translate_xml_route_quickest:translate_xml_route_shortest);
     fprintf(gpxtrackfile,"</name>\n");
     fprintf(gpxtrackfile,"<desc>");
-    fprintf(gpxtrackfile,translate_gpx_desc,option_quickest?translate_xml_route_quickest:translate_xml_route_shortest);
+    fprintf(gpxtrackfile,translate_gpx_desc,query->quickest?translate_xml_route_quickest:translate_xml_route_shortest);
     fprintf(gpxtrackfile,"</desc>\n");
    }
 
@@ -260,10 +260,10 @@ void PrintRoute(Results **results,int nresults,Nodes *nodes,Segments *segments,W
 
     fprintf(gpxroutefile,"<rte>\n");
     fprintf(gpxroutefile,"<name>");
-    fprintf(gpxroutefile,translate_gpx_name,option_quickest?translate_xml_route_quickest:translate_xml_route_shortest);
+    fprintf(gpxroutefile,translate_gpx_name,query->quickest?translate_xml_route_quickest:translate_xml_route_shortest);
     fprintf(gpxroutefile,"</name>\n");
     fprintf(gpxroutefile,"<desc>");
-    fprintf(gpxroutefile,translate_gpx_desc,option_quickest?translate_xml_route_quickest:translate_xml_route_shortest);
+    fprintf(gpxroutefile,translate_gpx_desc,query->quickest?translate_xml_route_quickest:translate_xml_route_shortest);
     fprintf(gpxroutefile,"</desc>\n");
    }
 
@@ -327,6 +327,8 @@ void PrintRoute(Results **results,int nresults,Nodes *nodes,Segments *segments,W
     do
       {
        double latitude,longitude;
+       elevation_t elevation;
+       char gpxele[32]="",htmlele[16]="";
        Node *resultnodep=NULL;
        index_t realsegment=NO_SEGMENT,next_realsegment=NO_SEGMENT;
        Segment *resultsegmentp=NULL,*next_resultsegmentp=NULL;
@@ -344,12 +346,24 @@ void PrintRoute(Results **results,int nresults,Nodes *nodes,Segments *segments,W
        /* Calculate the information about this point */
 
        if(IsFakeNode(result->node))
-          GetFakeLatLong(result->node,&latitude,&longitude);
+         {
+          GetFakeLatLong(query,result->node,&latitude,&longitude);
+
+          elevation=GetFakeElevation(query,result->node);
+         }
        else
          {
           resultnodep=LookupNode(nodes,result->node,6);
 
           GetLatLong(nodes,result->node,resultnodep,&latitude,&longitude);
+
+          elevation=GetElevation(nodes,result->node);
+         }
+
+       if(elevation!=NO_ELEVATION)
+         {
+          sprintf(gpxele,"<ele>%.1f</ele>",elevation_to_metres(elevation));
+          sprintf(htmlele," %.1f",elevation_to_metres(elevation));
          }
 
        /* Calculate the next result */
@@ -371,8 +385,8 @@ void PrintRoute(Results **results,int nresults,Nodes *nodes,Segments *segments,W
          {
           if(IsFakeSegment(result->segment))
             {
-             resultsegmentp=LookupFakeSegment(result->segment);
-             realsegment=IndexRealSegment(result->segment);
+             resultsegmentp=LookupFakeSegment(query,result->segment);
+             realsegment=IndexRealSegment(query,result->segment);
             }
           else
             {
@@ -402,8 +416,8 @@ void PrintRoute(Results **results,int nresults,Nodes *nodes,Segments *segments,W
          {
           if(IsFakeSegment(next_result->segment))
             {
-             next_resultsegmentp=LookupFakeSegment(next_result->segment);
-             next_realsegment=IndexRealSegment(next_result->segment);
+             next_resultsegmentp=LookupFakeSegment(query,next_result->segment);
+             next_realsegment=IndexRealSegment(query,next_result->segment);
             }
           else
             {
@@ -516,7 +530,7 @@ void PrintRoute(Results **results,int nresults,Nodes *nodes,Segments *segments,W
           if(!*waynameraw)
              waynameraw=translate_raw_highway[HIGHWAY(resultwayp->type)];
 
-          bearing_int=(int)BearingAngle(nodes,resultsegmentp,result->node);
+          bearing_int=(int)BearingAngle(query,nodes,resultsegmentp,result->node);
 
           if (seg_speed==0) 
              seg_speed=profile->speed[HIGHWAY(resultwayp->type)];
@@ -526,7 +540,7 @@ void PrintRoute(Results **results,int nresults,Nodes *nodes,Segments *segments,W
          {
           if(resultsegmentp && (htmlfile || textfile))
             {
-             turn_int=(int)TurnAngle(nodes,resultsegmentp,next_resultsegmentp,result->node);
+             turn_int=(int)TurnAngle(query,nodes,resultsegmentp,next_resultsegmentp,result->node);
              turn=translate_xml_turn[((202+turn_int)/45)%8];
             }
 
@@ -541,7 +555,7 @@ void PrintRoute(Results **results,int nresults,Nodes *nodes,Segments *segments,W
 
           if(htmlfile || gpxroutefile || textfile)
             {
-             next_bearing_int=(int)BearingAngle(nodes,next_resultsegmentp,next_result->node);
+             next_bearing_int=(int)BearingAngle(query,nodes,next_resultsegmentp,next_result->node);
              next_bearing=translate_xml_heading[(4+(22+next_bearing_int)/45)%8];
             }
          }
@@ -574,10 +588,10 @@ void PrintRoute(Results **results,int nresults,Nodes *nodes,Segments *segments,W
                 fprintf(htmlfile,"</span>]\n");
                }
 
-             /* <tr class='c'><td class='l'>*N*:<td class='r'>*latitude* *longitude* */
-             fprintf(htmlfile,"<tr class='c'><td class='l'>%d:<td class='r'>%.6f %.6f\n",
+             /* <tr class='c'><td class='l'>*N*:<td class='r'>*latitude* *longitude* *elevation* */
+             fprintf(htmlfile,"<tr class='c'><td class='l'>%d:<td class='r'>%.6f %.6f%s\n",
                               point_count+1,
-                              radians_to_degrees(latitude),radians_to_degrees(longitude));
+                              radians_to_degrees(latitude),radians_to_degrees(longitude),htmlele);
 
              if(point_count==0) /* first point */
                {
@@ -641,14 +655,14 @@ void PrintRoute(Results **results,int nresults,Nodes *nodes,Segments *segments,W
 
              if(point_count==0) /* first point */
                {
-                fprintf(gpxroutefile,"<rtept lat=\"%.6f\" lon=\"%.6f\"><name>%s</name>\n",
-                                     radians_to_degrees(latitude),radians_to_degrees(longitude),
+                fprintf(gpxroutefile,"<rtept lat=\"%.6f\" lon=\"%.6f\">%s<name>%s</name>\n",
+                                     radians_to_degrees(latitude),radians_to_degrees(longitude),gpxele,
                                      translate_gpx_start);
                }
              else if(!next_result) /* end point */
                {
-                fprintf(gpxroutefile,"<rtept lat=\"%.6f\" lon=\"%.6f\"><name>%s</name>\n",
-                                     radians_to_degrees(latitude),radians_to_degrees(longitude),
+                fprintf(gpxroutefile,"<rtept lat=\"%.6f\" lon=\"%.6f\">%s<name>%s</name>\n",
+                                     radians_to_degrees(latitude),radians_to_degrees(longitude),gpxele,
                                      translate_gpx_finish);
                 fprintf(gpxroutefile,"<desc>");
                 fprintf(gpxroutefile,translate_gpx_final,
@@ -658,12 +672,12 @@ void PrintRoute(Results **results,int nresults,Nodes *nodes,Segments *segments,W
              else            /* middle point */
                {
                 if(important==IMP_WAYPOINT)
-                   fprintf(gpxroutefile,"<rtept lat=\"%.6f\" lon=\"%.6f\"><name>%s%d</name>\n",
-                                        radians_to_degrees(latitude),radians_to_degrees(longitude),
+                   fprintf(gpxroutefile,"<rtept lat=\"%.6f\" lon=\"%.6f\">%s<name>%s%d</name>\n",
+                                        radians_to_degrees(latitude),radians_to_degrees(longitude),gpxele,
                                         translate_gpx_inter,++segment_count);
                 else
-                   fprintf(gpxroutefile,"<rtept lat=\"%.6f\" lon=\"%.6f\"><name>%s%03d</name>\n",
-                                        radians_to_degrees(latitude),radians_to_degrees(longitude),
+                   fprintf(gpxroutefile,"<rtept lat=\"%.6f\" lon=\"%.6f\">%s<name>%s%03d</name>\n",
+                                        radians_to_degrees(latitude),radians_to_degrees(longitude),gpxele,
                                         translate_gpx_trip,++route_count);
                }
             }
@@ -734,8 +748,14 @@ void PrintRoute(Results **results,int nresults,Nodes *nodes,Segments *segments,W
        /* Print out all of the results */
 
        if(gpxtrackfile)
-          fprintf(gpxtrackfile,"<trkpt lat=\"%.6f\" lon=\"%.6f\"/>\n",
-                               radians_to_degrees(latitude),radians_to_degrees(longitude));
+         {
+          if(elevation!=NO_ELEVATION)
+             fprintf(gpxtrackfile,"<trkpt lat=\"%.6f\" lon=\"%.6f\">%s</trkpt>\n",
+                                  radians_to_degrees(latitude),radians_to_degrees(longitude),gpxele);
+          else
+             fprintf(gpxtrackfile,"<trkpt lat=\"%.6f\" lon=\"%.6f\"/>\n",
+                                  radians_to_degrees(latitude),radians_to_degrees(longitude));
+         }
 
        if(important>IMP_IGNORE)
          {
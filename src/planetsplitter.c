@@ -36,6 +36,8 @@
 #include "relationsx.h"
 #include "superx.h"
 #include "prunex.h"
+#include "contractx.h"
+#include "landmarksx.h"
 
 #include "files.h"
 #include "logging.h"
@@ -43,7 +45,10 @@
 #include "functions.h"
 #include "osmparser.h"
 #include "tagging.h"
+#include "profiles.h"
 #include "uncompress.h"
+#include "srtmHgtReader.h"
+#include "stages.h"
 
 
 /* Global variables */
@@ -57,11 +62,71 @@ size_t option_filesort_ramsize=0;
 /*+ The number of threads to use for filesorting. +*/
 int option_filesort_threads=1;
 
+/*+ The number of threads to use for calculating the ascent and descent of segments. +*/
+int option_srtm_threads=1;
+
+/*+ The number of threads to use for decoding PBF files. +*/
+int option_pbf_threads=1;
+
+/*+ The maximum number of PBF blobs in memory at the same time (when using several threads). +*/
+int option_pbf_blobs=0;
+
+/*+ The number of threads to use for uncompressing bzip2 files. +*/
+int option_bzip2_threads=1;
+
+/*+ The number of processing stages that can be run at the same time. +*/
+int option_stage_threads=1;
+
+/*+ The number of threads to use for choosing the super-nodes. +*/
+int option_super_threads=1;
+
+
+/* Local types */
+
+/*+ A data type for holding the data that is used by the processing stages. +*/
+typedef struct _stage_context
+{
+ NodesX     *nodesx;            /*+ The nodes. +*/
+ SegmentsX  *segmentsx;         /*+ The segments. +*/
+ WaysX      *waysx;             /*+ The ways. +*/
+ RelationsX *relationsx;        /*+ The relations. +*/
+
+ int         keep;              /*+ Set to 1 if the data is to be kept for later. +*/
+
+ char       *dirname;           /*+ The directory name for the database files. +*/
+ char       *prefix;            /*+ The filename prefix for the database files. +*/
+}
+ stage_context;
+
 
 /* Local functions */
 
 static void print_usage(int detail,const char *argerr,const char *err);
 
+static void stage_sort_nodes(stage_context *context);
+static void stage_sort_ways(stage_context *context);
+static void stage_sort_relations(stage_context *context);
+static void stage_remove_nonhighway_nodes(stage_context *context);
+static void stage_calculate_elevations(stage_context *context);
+static void stage_split_ways(stage_context *context);
+static void stage_sort_way_names(stage_context *context);
+static void stage_sort_segments(stage_context *context);
+static void stage_process_segments(stage_context *context);
+static void stage_index_segments(stage_context *context);
+static void stage_process_route_relations(stage_context *context);
+static void stage_process_turn_relations(stage_context *context);
+static void stage_compact_ways(stage_context *context);
+static void stage_sort_nodes_geographically(stage_context *context);
+static void stage_sort_segments_geographically(stage_context *context);
+static void stage_sort_turn_relations_geographically(stage_context *context);
+static void stage_save_nodes(stage_context *context);
+static void stage_save_segments(stage_context *context);
+static void stage_save_ways(stage_context *context);
+static void stage_save_relations(stage_context *context);
+
+/*+ A macro to give the name, function and flags of a processing stage. +*/
+#define STAGE(name,function,flags) {name,(void (*)(void*))function,flags}
+
 
 /*++++++++++++++++++++++++++++++++++++++
   The main program for the planetsplitter.
@@ -75,12 +140,45 @@ int main(int argc,char** argv)
  RelationsX *OSMRelations;
  int         iteration=0,quit=0;
  int         max_iterations=5;
- char       *dirname=NULL,*prefix=NULL,*tagging=NULL,*errorlog=NULL;
+ char       *dirname=NULL,*prefix=NULL,*tagging=NULL,*errorlog=NULL,*profiles=NULL,*srtmfile=NULL;
+ char      **contract=NULL,**landmarks=NULL;
+ int         ncontract=0,nlandmarks=0;
  int         option_parse_only=0,option_process_only=0;
  int         option_append=0,option_keep=0,option_changes=0;
  int         option_filenames=0;
  int         option_prune_isolated=500,option_prune_short=5,option_prune_straight=3;
  int         arg;
+ stage_context context;
+ Stage       process_stages[]={
+                               STAGE("Sort OSM Data"                     ,NULL                                    ,0),
+                               STAGE("SortNodeList"                      ,stage_sort_nodes                        ,STAGE_NODES|STAGE_SORTS),
+                               STAGE("SortWayList"                       ,stage_sort_ways                         ,STAGE_WAYS|STAGE_SORTS),
+                               STAGE("SortRelationList"                  ,stage_sort_relations                    ,STAGE_RELATIONS|STAGE_SORTS),
+                               STAGE("Process OSM Data"                  ,NULL                                    ,0),
+                               STAGE("RemoveNonHighwayNodes"             ,stage_remove_nonhighway_nodes           ,STAGE_NODES|STAGE_WAYS),
+                               STAGE("CalculateNodeElevations"           ,stage_calculate_elevations              ,STAGE_NODES),
+                               STAGE("SplitWays"                         ,stage_split_ways                        ,STAGE_NODES|STAGE_SEGMENTS|STAGE_WAYS|STAGE_ERRORLOG),
+                               STAGE("SortWayNames"                      ,stage_sort_way_names                    ,STAGE_WAYS|STAGE_SORTS),
+                               STAGE("SortSegmentList"                   ,stage_sort_segments                     ,STAGE_SEGMENTS|STAGE_SORTS),
+                               STAGE("ProcessSegments"                   ,stage_process_segments                  ,STAGE_NODES|STAGE_SEGMENTS|STAGE_WAYS|STAGE_ERRORLOG),
+                               STAGE("IndexSegments"                     ,stage_index_segments                    ,STAGE_NODES|STAGE_SEGMENTS|STAGE_WAYS),
+                               STAGE("ProcessRouteRelations"             ,stage_process_route_relations           ,STAGE_WAYS|STAGE_RELATIONS|STAGE_ERRORLOG),
+                               STAGE("ProcessTurnRelations"              ,stage_process_turn_relations            ,STAGE_NODES|STAGE_SEGMENTS|STAGE_WAYS|STAGE_RELATIONS|STAGE_ERRORLOG),
+                               STAGE("CompactWayList"                    ,stage_compact_ways                      ,STAGE_SEGMENTS|STAGE_WAYS|STAGE_SORTS),
+                               STAGE("IndexSegments"                     ,stage_index_segments                    ,STAGE_NODES|STAGE_SEGMENTS|STAGE_WAYS)
+                              };
+ Stage       output_stages[]={
+                              STAGE("Cross-Reference Nodes and Segments",NULL                                    ,0),
+                              STAGE("SortNodeListGeographically"        ,stage_sort_nodes_geographically         ,STAGE_NODES|STAGE_SORTS),
+                              STAGE("SortSegmentListGeographically"     ,stage_sort_segments_geographically      ,STAGE_NODES|STAGE_SEGMENTS|STAGE_SORTS),
+                              STAGE("IndexSegments"                     ,stage_index_segments                    ,STAGE_NODES|STAGE_SEGMENTS|STAGE_WAYS),
+                              STAGE("SortTurnRelationListGeographically",stage_sort_turn_relations_geographically,STAGE_NODES|STAGE_SEGMENTS|STAGE_RELATIONS|STAGE_SORTS),
+                              STAGE("Write Out Database Files"          ,NULL                                    ,0),
+                              STAGE("SaveNodeList"                      ,stage_save_nodes                        ,STAGE_NODES|STAGE_SEGMENTS),
+                              STAGE("SaveSegmentList"                   ,stage_save_segments                     ,STAGE_SEGMENTS),
+                              STAGE("SaveWayList"                       ,stage_save_ways                         ,STAGE_WAYS),
+                              STAGE("SaveRelationList"                  ,stage_save_relations                    ,STAGE_RELATIONS)
+                             };
 
  printf_program_start();
 
@@ -102,6 +200,32 @@ int main(int argc,char** argv)
 #endif
     else if(!strncmp(argv[arg],"--tmpdir=",9))
        option_tmpdirname=&argv[arg][9];
+    else if(!strcmp(argv[arg],"--tmp-compress"))
+       option_tmpcompress=1;
+    else if(!strncmp(argv[arg],"--srtm-tiles=",13))
+       srtmSetCacheSize(atoi(&argv[arg][13]));
+    else if(!strncmp(argv[arg],"--srtm-file=",12))
+       srtmfile=&argv[arg][12];
+#if defined(USE_PTHREADS) && USE_PTHREADS
+    else if(!strncmp(argv[arg],"--srtm-threads=",15))
+       option_srtm_threads=atoi(&argv[arg][15]);
+#endif
+#if defined(USE_PTHREADS) && USE_PTHREADS
+    else if(!strncmp(argv[arg],"--pbf-threads=",14))
+       option_pbf_threads=atoi(&argv[arg][14]);
+    else if(!strncmp(argv[arg],"--pbf-blobs=",12))
+       option_pbf_blobs=atoi(&argv[arg][12]);
+#endif
+#if defined(USE_BZIP2) && USE_BZIP2 && defined(USE_PTHREADS) && USE_PTHREADS
+    else if(!strncmp(argv[arg],"--bzip2-threads=",16))
+       option_bzip2_threads=atoi(&argv[arg][16]);
+#endif
+#if defined(USE_PTHREADS) && USE_PTHREADS
+    else if(!strncmp(argv[arg],"--stage-threads=",16))
+       option_stage_threads=atoi(&argv[arg][16]);
+    else if(!strncmp(argv[arg],"--super-threads=",16))
+       option_super_threads=atoi(&argv[arg][16]);
+#endif
     else if(!strncmp(argv[arg],"--tagging=",10))
        tagging=&argv[arg][10];
     else if(!strcmp(argv[arg],"--loggable"))
@@ -124,6 +248,18 @@ int main(int argc,char** argv)
        option_changes=1;
     else if(!strncmp(argv[arg],"--max-iterations=",17))
        max_iterations=atoi(&argv[arg][17]);
+    else if(!strncmp(argv[arg],"--contract=",11))
+      {
+       contract=(char**)realloc((void*)contract,(ncontract+1)*sizeof(char*));
+       contract[ncontract++]=&argv[arg][11];
+      }
+    else if(!strncmp(argv[arg],"--landmarks=",12))
+      {
+       landmarks=(char**)realloc((void*)landmarks,(nlandmarks+1)*sizeof(char*));
+       landmarks[nlandmarks++]=&argv[arg][12];
+      }
+    else if(!strncmp(argv[arg],"--profiles=",11))
+       profiles=&argv[arg][11];
     else if(!strncmp(argv[arg],"--prune",7))
       {
        if(!strcmp(&argv[arg][7],"-none"))
@@ -157,6 +293,26 @@ int main(int argc,char** argv)
  if(!option_filenames && !option_process_only)
     print_usage(0,NULL,"File names must be specified unless using '--process-only'");
 
+ if(option_srtm_threads<1)
+    print_usage(0,NULL,"The number of '--srtm-threads' must be at least one.");
+
+ if(option_pbf_threads<1)
+    print_usage(0,NULL,"The number of '--pbf-threads' must be at least one.");
+
+ if(!option_pbf_blobs)
+    option_pbf_blobs=4*option_pbf_threads;
+ else if(option_pbf_blobs<2)
+    print_usage(0,NULL,"The number of '--pbf-blobs' must be at least two.");
+
+ if(option_bzip2_threads<1)
+    print_usage(0,NULL,"The number of '--bzip2-threads' must be at least one.");
+
+ if(option_stage_threads<1)
+    print_usage(0,NULL,"The number of '--stage-threads' must be at least one.");
+
+ if(option_super_threads<1)
+    print_usage(0,NULL,"The number of '--super-threads' must be at least one.");
+
  if(!option_filesort_ramsize)
    {
 #if SLIM
@@ -176,6 +332,11 @@ int main(int argc,char** argv)
        option_tmpdirname=dirname;
    }
 
+ /* The parsed data is kept (with its size used to count the items) so it must not be compressed */
+
+ if(option_parse_only)
+    option_tmpcompress=0;
+
  if(!option_process_only)
    {
     if(tagging)
@@ -206,6 +367,36 @@ int main(int argc,char** argv)
       }
    }
 
+ if(ncontract || nlandmarks)
+   {
+    if(profiles)
+      {
+       if(!ExistsFile(profiles))
+         {
+          fprintf(stderr,"Error: The '--profiles' option specifies a file that does not exist.\n");
+          exit(EXIT_FAILURE);
+         }
+      }
+    else
+      {
+       if(ExistsFile(FileName(dirname,prefix,"profiles.xml")))
+          profiles=FileName(dirname,prefix,"profiles.xml");
+       else if(ExistsFile(FileName(DATADIR,NULL,"profiles.xml")))
+          profiles=FileName(DATADIR,NULL,"profiles.xml");
+       else
+         {
+          fprintf(stderr,"Error: The '--profiles' option was not used and the default 'profiles.xml' does not exist.\n");
+          exit(EXIT_FAILURE);
+         }
+      }
+
+    if(ParseXMLProfiles(profiles))
+      {
+       fprintf(stderr,"Error: Cannot read the profiles in the file '%s'.\n",profiles);
+       exit(EXIT_FAILURE);
+      }
+   }
+
  /* Create new node, segment, way and relation variables */
 
  OSMNodes=NewNodeList(option_append||option_changes,option_process_only);
@@ -310,56 +501,29 @@ if(!option_process_only)
     return(0);
    }
 
+ /* Use the tiled elevation file instead of the .hgt files */
 
- /* Sort the data */
-
- printf("\nSort OSM Data\n=============\n\n");
- fflush(stdout);
-
- /* Sort the nodes, ways and relations */
-
- SortNodeList(OSMNodes);
-
- SortWayList(OSMWays);
+ if(srtmfile)
+    srtmOpenFile(srtmfile);
 
- SortRelationList(OSMRelations);
 
- /* Process the data */
+ /* Sort and process the data (the stages are listed in the order that they run one at a time:
+    sort the nodes, ways and relations; remove non-highway nodes by looking through the ways;
+    calculate the node elevations; separate the segments and way names and sort them; process
+    the segments and index them; process the route relations and turn relations (must be before
+    compacting the ways); compact the ways and index the segments) */
 
- printf("\nProcess OSM Data\n================\n\n");
- fflush(stdout);
-
- /* Remove non-highway nodes by looking through the ways */
-
- RemoveNonHighwayNodes(OSMNodes,OSMWays,option_keep||option_changes);
-
- /* Separate the segments and way names and sort them. */
-
- OSMSegments=SplitWays(OSMWays,OSMNodes,option_keep||option_changes);
-
- SortWayNames(OSMWays);
-
- SortSegmentList(OSMSegments);
-
- /* Process the segments and index them */
-
- ProcessSegments(OSMSegments,OSMNodes,OSMWays);
-
- IndexSegments(OSMSegments,OSMNodes,OSMWays);
+ context.nodesx=OSMNodes;
+ context.segmentsx=NULL;
+ context.waysx=OSMWays;
+ context.relationsx=OSMRelations;
+ context.keep=option_keep||option_changes;
+ context.dirname=dirname;
+ context.prefix=prefix;
 
- /* Process the route relations and turn relations (must be before compacting the ways) */
+ RunStages(process_stages,sizeof(process_stages)/sizeof(process_stages[0]),&context);
 
- ProcessRouteRelations(OSMRelations,OSMWays,option_keep||option_changes);
-
- ProcessTurnRelations(OSMRelations,OSMNodes,OSMSegments,OSMWays,option_keep||option_changes);
-
- /* Compact the ways (must be after processing turn relations) */
-
- CompactWayList(OSMWays,OSMSegments);
-
- /* Index the segments */
-
- IndexSegments(OSMSegments,OSMNodes,OSMWays);
+ OSMSegments=context.segmentsx;
 
  /* Prune unwanted nodes/segments. */
 
@@ -466,45 +630,12 @@ if(!option_process_only)
 
  OSMSegments=MergedSegments;
 
- /* Cross reference the nodes and segments */
-
- printf("\nCross-Reference Nodes and Segments\n==================================\n\n");
- fflush(stdout);
-
- /* Sort the nodes and segments geographically */
-
- SortNodeListGeographically(OSMNodes);
+ /* Cross reference the nodes and segments (sort the nodes and segments geographically, re-index
+    the segments and sort the turn relations geographically) and write out the database files */
 
- SortSegmentListGeographically(OSMSegments,OSMNodes);
+ context.segmentsx=OSMSegments;
 
- /* Re-index the segments */
-
- IndexSegments(OSMSegments,OSMNodes,OSMWays);
-
- /* Sort the turn relations geographically */
-
- SortTurnRelationListGeographically(OSMRelations,OSMNodes,OSMSegments);
-
- /* Output the results */
-
- printf("\nWrite Out Database Files\n========================\n\n");
- fflush(stdout);
-
- /* Write out the nodes */
-
- SaveNodeList(OSMNodes,FileName(dirname,prefix,"nodes.mem"),OSMSegments);
-
- /* Write out the segments */
-
- SaveSegmentList(OSMSegments,FileName(dirname,prefix,"segments.mem"));
-
- /* Write out the ways */
-
- SaveWayList(OSMWays,FileName(dirname,prefix,"ways.mem"));
-
- /* Write out the relations */
-
- SaveRelationList(OSMRelations,FileName(dirname,prefix,"relations.mem"));
+ RunStages(output_stages,sizeof(output_stages)/sizeof(output_stages[0]),&context);
 
  /* Close the error log file and process the data */
 
@@ -539,12 +670,318 @@ if(!option_process_only)
 
  FreeSegmentList(OSMSegments);
 
+ /* Create the contraction hierarchies */
+
+ if(ncontract)
+   {
+    int i;
+
+    printf("\nContract Super-Nodes\n====================\n\n");
+    fflush(stdout);
+
+    for(i=0;i<ncontract;i++)
+      {
+       Profile *profile=GetProfile(contract[i]);
+
+       if(!profile)
+         {
+          fprintf(stderr,"Error: Cannot find a profile called '%s' in '%s'.\n",contract[i],profiles);
+          exit(EXIT_FAILURE);
+         }
+
+       ContractSuperNodes(dirname,prefix,profile);
+      }
+
+    free(contract);
+   }
+
+ /* Create the landmark distances */
+
+ if(nlandmarks)
+   {
+    int i;
+
+    printf("\nCreate Landmarks\n================\n\n");
+    fflush(stdout);
+
+    for(i=0;i<nlandmarks;i++)
+      {
+       Profile *profile=GetProfile(landmarks[i]);
+
+       if(!profile)
+         {
+          fprintf(stderr,"Error: Cannot find a profile called '%s' in '%s'.\n",landmarks[i],profiles);
+          exit(EXIT_FAILURE);
+         }
+
+       CreateLandmarks(dirname,prefix,profile);
+      }
+
+    free(landmarks);
+   }
+
+ srtmCloseFile();
+
+ /* Report the effect of compressing the temporary files */
+
+ if(option_tmpcompress)
+   {
+    uint64_t uncompressed,compressed;
+
+    CompressedFileStatistics(&uncompressed,&compressed);
+
+    printf("\nCompressed temporary files: Data=%.1f MB Disk=%.1f MB Ratio=%.2f Saved=%.1f MB\n",
+           uncompressed/1048576.0,compressed/1048576.0,compressed?(double)uncompressed/compressed:1.0,
+           ((double)uncompressed-(double)compressed)/1048576.0);
+    fflush(stdout);
+   }
+
  printf_program_end();
 
  return(0);
 }
 
 
+/*++++++++++++++++++++++++++++++++++++++
+  Sort the nodes (a processing stage).
+
+  stage_context *context The data used by the processing stages.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void stage_sort_nodes(stage_context *context)
+{
+ SortNodeList(context->nodesx);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Sort the ways (a processing stage).
+
+  stage_context *context The data used by the processing stages.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void stage_sort_ways(stage_context *context)
+{
+ SortWayList(context->waysx);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Sort the relations (a processing stage).
+
+  stage_context *context The data used by the processing stages.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void stage_sort_relations(stage_context *context)
+{
+ SortRelationList(context->relationsx);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Remove the non-highway nodes by looking through the ways (a processing stage).
+
+  stage_context *context The data used by the processing stages.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void stage_remove_nonhighway_nodes(stage_context *context)
+{
+ RemoveNonHighwayNodes(context->nodesx,context->waysx,context->keep);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Calculate the node elevations, used for the segments and stored in the database (a processing stage).
+
+  stage_context *context The data used by the processing stages.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void stage_calculate_elevations(stage_context *context)
+{
+ CalculateNodeElevations(context->nodesx);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Separate the segments from the ways (a processing stage).
+
+  stage_context *context The data used by the processing stages.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void stage_split_ways(stage_context *context)
+{
+ context->segmentsx=SplitWays(context->waysx,context->nodesx,context->keep);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Sort the way names (a processing stage).
+
+  stage_context *context The data used by the processing stages.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void stage_sort_way_names(stage_context *context)
+{
+ SortWayNames(context->waysx);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Sort the segments (a processing stage).
+
+  stage_context *context The data used by the processing stages.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void stage_sort_segments(stage_context *context)
+{
+ SortSegmentList(context->segmentsx);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Process the segments (a processing stage).
+
+  stage_context *context The data used by the processing stages.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void stage_process_segments(stage_context *context)
+{
+ ProcessSegments(context->segmentsx,context->nodesx,context->waysx);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Index the segments (a processing stage).
+
+  stage_context *context The data used by the processing stages.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void stage_index_segments(stage_context *context)
+{
+ IndexSegments(context->segmentsx,context->nodesx,context->waysx);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Process the route relations, must be before compacting the ways (a processing stage).
+
+  stage_context *context The data used by the processing stages.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void stage_process_route_relations(stage_context *context)
+{
+ ProcessRouteRelations(context->relationsx,context->waysx,context->keep);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Process the turn relations, must be before compacting the ways (a processing stage).
+
+  stage_context *context The data used by the processing stages.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void stage_process_turn_relations(stage_context *context)
+{
+ ProcessTurnRelations(context->relationsx,context->nodesx,context->segmentsx,context->waysx,context->keep);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Compact the ways, must be after processing the turn relations (a processing stage).
+
+  stage_context *context The data used by the processing stages.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void stage_compact_ways(stage_context *context)
+{
+ CompactWayList(context->waysx,context->segmentsx);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Sort the nodes geographically (a processing stage).
+
+  stage_context *context The data used by the processing stages.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void stage_sort_nodes_geographically(stage_context *context)
+{
+ SortNodeListGeographically(context->nodesx);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Sort the segments geographically (a processing stage).
+
+  stage_context *context The data used by the processing stages.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void stage_sort_segments_geographically(stage_context *context)
+{
+ SortSegmentListGeographically(context->segmentsx,context->nodesx);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Sort the turn relations geographically (a processing stage).
+
+  stage_context *context The data used by the processing stages.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void stage_sort_turn_relations_geographically(stage_context *context)
+{
+ SortTurnRelationListGeographically(context->relationsx,context->nodesx,context->segmentsx);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Write out the nodes (a processing stage).
+
+  stage_context *context The data used by the processing stages.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void stage_save_nodes(stage_context *context)
+{
+ SaveNodeList(context->nodesx,FileName(context->dirname,context->prefix,"nodes.mem"),context->segmentsx);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Write out the segments (a processing stage).
+
+  stage_context *context The data used by the processing stages.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void stage_save_segments(stage_context *context)
+{
+ SaveSegmentList(context->segmentsx,FileName(context->dirname,context->prefix,"segments.mem"));
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Write out the ways (a processing stage).
+
+  stage_context *context The data used by the processing stages.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void stage_save_ways(stage_context *context)
+{
+ SaveWayList(context->waysx,FileName(context->dirname,context->prefix,"ways.mem"));
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Write out the relations (a processing stage).
+
+  stage_context *context The data used by the processing stages.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void stage_save_relations(stage_context *context)
+{
+ SaveRelationList(context->relationsx,FileName(context->dirname,context->prefix,"relations.mem"));
+}
+
+
 /*++++++++++++++++++++++++++++++++++++++
   Print out the usage information.
 
@@ -562,10 +999,23 @@ static void print_usage(int detail,const char *argerr,const char *err)
          "                      [--dir=<dirname>] [--prefix=<name>]\n"
 #if defined(USE_PTHREADS) && USE_PTHREADS
          "                      [--sort-ram-size=<size>] [--sort-threads=<number>]\n"
+         "                      [--stage-threads=<number>] [--super-threads=<number>]\n"
 #else
          "                      [--sort-ram-size=<size>]\n"
 #endif
-         "                      [--tmpdir=<dirname>]\n"
+         "                      [--tmpdir=<dirname>] [--tmp-compress]\n"
+#if defined(USE_PTHREADS) && USE_PTHREADS
+         "                      [--srtm-tiles=<number>] [--srtm-threads=<number>]\n"
+#else
+         "                      [--srtm-tiles=<number>]\n"
+#endif
+         "                      [--srtm-file=<filename>]\n"
+#if defined(USE_PTHREADS) && USE_PTHREADS
+         "                      [--pbf-threads=<number>] [--pbf-blobs=<number>]\n"
+#endif
+#if defined(USE_BZIP2) && USE_BZIP2 && defined(USE_PTHREADS) && USE_PTHREADS
+         "                      [--bzip2-threads=<number>]\n"
+#endif
          "                      [--tagging=<filename>]\n"
          "                      [--loggable] [--logtime]\n"
          "                      [--errorlog[=<name>]]\n"
@@ -576,6 +1026,8 @@ static void print_usage(int detail,const char *argerr,const char *err)
          "                      [--prune-isolated=<len>]\n"
          "                      [--prune-short=<len>]\n"
          "                      [--prune-straight=<len>]\n"
+         "                      [--contract=<name> ...] [--landmarks=<name> ...]\n"
+         "                      [--profiles=<filename>]\n"
          "                      [<filename.osm> ... | <filename.osc> ...\n"
          "                       | <filename.pbf> ...\n"
          "                       | <filename.o5m> ... | <filename.o5c> ..."
@@ -613,10 +1065,35 @@ static void print_usage(int detail,const char *argerr,const char *err)
 #endif
 #if defined(USE_PTHREADS) && USE_PTHREADS
             "--sort-threads=<number>   The number of threads to use for data sorting.\n"
+            "--stage-threads=<number>  The number of independent processing stages to run at\n"
+            "                          the same time (defaults to 1).\n"
+            "--super-threads=<number>  The number of threads to use for choosing the\n"
+            "                          super-nodes (not used in slim mode).\n"
 #endif
             "\n"
             "--tmpdir=<dirname>        The directory name for temporary files.\n"
             "                          (defaults to the '--dir' option directory.)\n"
+            "--tmp-compress            Compress the temporary files that are only read\n"
+            "                          sequentially (less disk space and I/O, more CPU).\n"
+            "\n"
+            "--srtm-tiles=<number>     The number of SRTM elevation tiles to keep open\n"
+            "                          (defaults to %d).\n"
+#if defined(USE_PTHREADS) && USE_PTHREADS
+            "--srtm-threads=<number>   The number of threads to use for the elevation data.\n"
+#endif
+            "--srtm-file=<filename>    A tiled elevation file from srtmtiler to use instead\n"
+            "                          of the .hgt tiles in the 'srtm' directory.\n"
+#if defined(USE_PTHREADS) && USE_PTHREADS
+            "\n"
+            "--pbf-threads=<number>    The number of threads to use for decoding PBF files.\n"
+            "--pbf-blobs=<number>      The number of PBF blocks to keep in memory when using\n"
+            "                          several threads (defaults to 4 per thread).\n"
+#endif
+#if defined(USE_BZIP2) && USE_BZIP2 && defined(USE_PTHREADS) && USE_PTHREADS
+            "\n"
+            "--bzip2-threads=<number>  The number of threads to use for uncompressing bzip2\n"
+            "                          files (more than one splits the file into blocks).\n"
+#endif
             "\n"
             "--tagging=<filename>      The name of the XML file containing the tagging rules\n"
             "                          (defaults to 'tagging.xml' with '--dir' and\n"
@@ -646,6 +1123,15 @@ static void print_usage(int detail,const char *argerr,const char *err)
             "--prune-straight=<len>    Remove nodes in almost straight highways (defaults to\n"
             "                          removing nodes up to 3m offset from a straight line).\n"
             "\n"
+            "--contract=<name>         Create a contraction hierarchy of the super-nodes for\n"
+            "                          the named profile (can be used more than once).\n"
+            "--landmarks=<name>        Create the landmark distances of the super-nodes for\n"
+            "                          the named profile (can be used more than once).\n"
+            "--profiles=<filename>     The name of the XML file containing the profiles\n"
+            "                          (defaults to 'profiles.xml' with '--dir' and\n"
+            "                           '--prefix' options or the file installed in\n"
+            "                           '" DATADIR "').\n"
+            "\n"
             "<filename.osm>, <filename.osc>, <filename.pbf>, <filename.o5m>, <filename.o5c>\n"
             "                          The name(s) of the file(s) to read and parse.\n"
             "                          Filenames ending '.pbf' read as PBF, filenames ending\n"
@@ -665,7 +1151,7 @@ static void print_usage(int detail,const char *argerr,const char *err)
             "\n"
             "<property> can be selected from:\n"
             "%s",
-            TransportList(),HighwayList(),PropertyList());
+            SRTM_CACHE_TILES,TransportList(),HighwayList(),PropertyList());
 
  exit(!detail);
 }
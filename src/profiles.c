@@ -686,6 +686,23 @@ Profile *GetProfile(const char *name)
 }
 
 
+/*++++++++++++++++++++++++++++++++++++++
+  Get one of the profiles by its position in the list of loaded profiles.
+
+  Profile *GetProfileNumber Returns a pointer to the profile or NULL if there are not that many.
+
+  int number The position of the profile in the list.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+Profile *GetProfileNumber(int number)
+{
+ if(number<0 || number>=nloaded_profiles)
+    return(NULL);
+
+ return(loaded_profiles[number]);
+}
+
+
 /*++++++++++++++++++++++++++++++++++++++
   Update a profile with the highway preference scaling factors.
 
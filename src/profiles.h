@@ -64,6 +64,8 @@ int ParseXMLProfiles(const char *filename);
 
 Profile *GetProfile(const char *name);
 
+Profile *GetProfileNumber(int number);
+
 int UpdateProfile(Profile *profile,Ways *ways);
 
 void PrintProfile(const Profile *profile);
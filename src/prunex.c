@@ -1295,7 +1295,7 @@ static void modify_segment(SegmentsX *segmentsx,SegmentX *segmentx,index_t newno
     newnode1=newnode2;
     newnode2=temp;
     
-    float tmp;
+    gradient_t tmp;
     tmp=segmentx->percentascent;
     segmentx->percentascent=segmentx->percentdescent;
     segmentx->percentdescent = tmp;
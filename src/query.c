@@ -0,0 +1,63 @@
+/***************************************
+ Routing query state.
+
+ Part of the Routino routing software.
+ ******************/ /******************
+ This file Copyright 2008-2013 Andrew M. Bishop
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************/
+
+
+#include <stdlib.h>
+
+#include "types.h"
+
+#include "query.h"
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Allocate a new query (contains all of the state that is not shared between queries).
+
+  Query *NewQuery Returns the query.
+
+  int quickest Set to calculate the quickest route instead of the shortest.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+Query *NewQuery(int quickest)
+{
+ Query *query;
+
+ query=(Query*)calloc(1,sizeof(Query));
+
+ query->quickest=quickest;
+
+ query->prevpoint=0;
+
+ query->costs=NULL;
+
+ return(query);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Free a query.
+
+  Query *query The query to free.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+void FreeQuery(Query *query)
+{
+ free(query);
+}
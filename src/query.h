@@ -0,0 +1,59 @@
+/***************************************
+ Header file for the routing query state.
+
+ Part of the Routino routing software.
+ ******************/ /******************
+ This file Copyright 2008-2013 Andrew M. Bishop
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************/
+
+
+#ifndef QUERY_H
+#define QUERY_H    /*+ To stop multiple inclusions. +*/
+
+#include "types.h"
+
+#include "segments.h"
+
+
+/* Data structures */
+
+/*+ The state of a single routing query (one per thread when routing in parallel). +*/
+struct _Query
+{
+ int      quickest;                        /*+ Set to calculate the quickest route instead of the shortest. +*/
+
+ Segment  fake_segments[4*NWAYPOINTS+1];   /*+ A set of fake segments to allow start/finish in the middle of a segment. +*/
+
+ index_t  real_segments[4*NWAYPOINTS+1];   /*+ A set of pointers to the real segments underlying the fake segments. +*/
+
+ double   fake_lon[NWAYPOINTS+1];          /*+ The fake node longitudes. +*/
+ double   fake_lat[NWAYPOINTS+1];          /*+ The fake node latitudes. +*/
+ elevation_t fake_elevation[NWAYPOINTS+1]; /*+ The fake node elevations. +*/
+
+ int      prevpoint;                       /*+ The previous waypoint. +*/
+
+ SegmentCosts *costs;                      /*+ The precalculated segment scores (or NULL if not available for the profile). +*/
+};
+
+
+/* Functions in query.c */
+
+Query *NewQuery(int quickest);
+
+void FreeQuery(Query *query);
+
+
+#endif /* QUERY_H */
@@ -26,17 +26,87 @@
 #include "results.h"
 
 
+/* Constants */
+
+/*+ The number of children of each entry in the d-ary heap. +*/
+#define QUEUE_ARITY 4
+
+/*+ The number of buckets in the radix heap (one for each bit of the key plus one). +*/
+#define RADIX_BUCKETS 33
+
+/*+ The number of bits of the queued position used for the radix heap bucket number. +*/
+#define RADIX_BUCKET_BITS 6
+
+
+/* Local data types */
+
+/*+ An entry in the d-ary heap, the score is stored with the pointer to avoid reading the result when comparing. +*/
+typedef struct _QueueEntry
+{
+ score_t  score;                /*+ The score to use for sorting. +*/
+ Result  *result;               /*+ The result. +*/
+}
+ QueueEntry;
+
+/*+ An entry in the radix heap, the score is stored as an integer key. +*/
+typedef struct _RadixEntry
+{
+ uint32_t key;                  /*+ The key (the bit pattern of the non-negative floating point score). +*/
+ Result  *result;               /*+ The result. +*/
+}
+ RadixEntry;
+
 /*+ A queue of results. +*/
 struct _Queue
 {
+ int      type;                 /*+ The type of queue (QUEUE_BINARY_HEAP, QUEUE_DARY_HEAP or QUEUE_RADIX_HEAP). +*/
+
  int      nincrement;           /*+ The amount to increment the queue when full. +*/
  int      nallocated;           /*+ The number of entries allocated. +*/
  int      noccupied;            /*+ The number of entries occupied. +*/
 
- Result **results;              /*+ The queue of pointers to results. +*/
+ Result **results;              /*+ The queue of pointers to results (binary heap). +*/
+
+ QueueEntry *entries;           /*+ The queue of scores and pointers to results (d-ary heap). +*/
+
+ uint32_t    last;                          /*+ The key of the last entry removed (radix heap). +*/
+ int         nbucket[RADIX_BUCKETS];        /*+ The number of entries in each bucket (radix heap). +*/
+ int         nallocbucket[RADIX_BUCKETS];   /*+ The number of entries allocated in each bucket (radix heap). +*/
+ RadixEntry *buckets[RADIX_BUCKETS];        /*+ The entries in each bucket (radix heap). +*/
 };
 
 
+/* Local variables */
+
+/*+ The type of queue to create. +*/
+static int queue_type=QUEUE_TYPE;
+
+
+/* Local functions */
+
+static void InsertInBinaryHeap(Queue *queue,Result *result,score_t score);
+static Result *PopFromBinaryHeap(Queue *queue);
+
+static void InsertInDaryHeap(Queue *queue,Result *result,score_t score);
+static Result *PopFromDaryHeap(Queue *queue);
+
+static void InsertInRadixHeap(Queue *queue,Result *result,score_t score);
+static Result *PopFromRadixHeap(Queue *queue);
+static void AddToRadixBucket(Queue *queue,uint32_t key,Result *result);
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Select the type of queue that will be created by NewQueueList().
+
+  int type The type of queue (QUEUE_BINARY_HEAP, QUEUE_DARY_HEAP or QUEUE_RADIX_HEAP).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+void SetQueueType(int type)
+{
+ queue_type=type;
+}
+
+
 /*++++++++++++++++++++++++++++++++++++++
   Allocate a new queue.
 
@@ -49,14 +119,19 @@ Queue *NewQueueList(uint8_t log2bins)
 {
  Queue *queue;
 
- queue=(Queue*)malloc(sizeof(Queue));
+ queue=(Queue*)calloc(1,sizeof(Queue));
+
+ queue->type=queue_type;
 
  queue->nincrement=1<<log2bins;
 
  queue->nallocated=queue->nincrement;
  queue->noccupied=0;
 
- queue->results=(Result**)malloc(queue->nallocated*sizeof(Result*));
+ if(queue->type==QUEUE_DARY_HEAP)
+    queue->entries=(QueueEntry*)malloc(queue->nallocated*sizeof(QueueEntry));
+ else if(queue->type==QUEUE_BINARY_HEAP)
+    queue->results=(Result**)malloc(queue->nallocated*sizeof(Result*));
 
  return(queue);
 }
@@ -71,6 +146,16 @@ Queue *NewQueueList(uint8_t log2bins)
 void ResetQueueList(Queue *queue)
 {
  queue->noccupied=0;
+
+ if(queue->type==QUEUE_RADIX_HEAP)
+   {
+    int i;
+
+    queue->last=0;
+
+    for(i=0;i<RADIX_BUCKETS;i++)
+       queue->nbucket[i]=0;
+   }
 }
 
 
@@ -82,14 +167,64 @@ void ResetQueueList(Queue *queue)
 
 void FreeQueueList(Queue *queue)
 {
- free(queue->results);
+ int i;
+
+ if(queue->results)
+    free(queue->results);
+
+ if(queue->entries)
+    free(queue->entries);
+
+ for(i=0;i<RADIX_BUCKETS;i++)
+    if(queue->buckets[i])
+       free(queue->buckets[i]);
 
  free(queue);
 }
 
 
 /*++++++++++++++++++++++++++++++++++++++
-  Insert a new item into the queue in the right place.
+  Insert a new item into the queue in the right place (or move an item that is already in the queue).
+
+  Queue *queue The queue to insert the result into.
+
+  Result *result The result to insert into the queue.
+
+  score_t score The score to use for sorting the node.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+void InsertInQueue(Queue *queue,Result *result,score_t score)
+{
+ if(queue->type==QUEUE_DARY_HEAP)
+    InsertInDaryHeap(queue,result,score);
+ else if(queue->type==QUEUE_RADIX_HEAP)
+    InsertInRadixHeap(queue,result,score);
+ else
+    InsertInBinaryHeap(queue,result,score);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Pop an item from the front of the queue.
+
+  Result *PopFromQueue Returns the top item.
+
+  Queue *queue The queue to remove the result from.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+Result *PopFromQueue(Queue *queue)
+{
+ if(queue->type==QUEUE_DARY_HEAP)
+    return(PopFromDaryHeap(queue));
+ else if(queue->type==QUEUE_RADIX_HEAP)
+    return(PopFromRadixHeap(queue));
+ else
+    return(PopFromBinaryHeap(queue));
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Insert a new item into a binary heap queue in the right place.
 
   The data is stored in a "Binary Heap" http://en.wikipedia.org/wiki/Binary_heap
   and this operation is adding an item to the heap.
@@ -101,7 +236,7 @@ void FreeQueueList(Queue *queue)
   score_t score The score to use for sorting the node.
   ++++++++++++++++++++++++++++++++++++++*/
 
-void InsertInQueue(Queue *queue,Result *result,score_t score)
+static void InsertInBinaryHeap(Queue *queue,Result *result,score_t score)
 {
  int index;
 
@@ -149,17 +284,17 @@ void InsertInQueue(Queue *queue,Result *result,score_t score)
 
 
 /*++++++++++++++++++++++++++++++++++++++
-  Pop an item from the front of the queue.
+  Pop an item from the front of a binary heap queue.
 
   The data is stored in a "Binary Heap" http://en.wikipedia.org/wiki/Binary_heap
   and this operation is deleting the root item from the heap.
 
-  Result *PopFromQueue Returns the top item.
+  Result *PopFromBinaryHeap Returns the top item.
 
   Queue *queue The queue to remove the result from.
   ++++++++++++++++++++++++++++++++++++++*/
 
-Result *PopFromQueue(Queue *queue)
+static Result *PopFromBinaryHeap(Queue *queue)
 {
  int index;
  Result *retval;
@@ -223,3 +358,260 @@ Result *PopFromQueue(Queue *queue)
 
  return(retval);
 }
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Insert a new item into a d-ary heap queue in the right place.
+
+  The data is stored in a "d-ary Heap" http://en.wikipedia.org/wiki/D-ary_heap
+  with the scores stored next to the pointers so that the results themselves
+  are only written when they move (the position is stored in the result).
+
+  Queue *queue The queue to insert the result into.
+
+  Result *result The result to insert into the queue.
+
+  score_t score The score to use for sorting the node.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void InsertInDaryHeap(Queue *queue,Result *result,score_t score)
+{
+ int index;
+
+ if(result->queued==NOT_QUEUED)
+   {
+    index=queue->noccupied;
+
+    queue->noccupied++;
+
+    if(queue->noccupied==queue->nallocated)
+      {
+       queue->nallocated=queue->nallocated+queue->nincrement;
+       queue->entries=(QueueEntry*)realloc((void*)queue->entries,queue->nallocated*sizeof(QueueEntry));
+      }
+   }
+ else
+    index=result->queued-1;
+
+ result->sortby=score;
+
+ /* Bubble up the new value by moving the parents down into the hole */
+
+ while(index>0)
+   {
+    int newindex=(index-1)/QUEUE_ARITY;
+
+    if(score>=queue->entries[newindex].score)
+       break;
+
+    queue->entries[index]=queue->entries[newindex];
+    queue->entries[index].result->queued=index+1;
+
+    index=newindex;
+   }
+
+ queue->entries[index].score=score;
+ queue->entries[index].result=result;
+
+ result->queued=index+1;
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Pop an item from the front of a d-ary heap queue.
+
+  Result *PopFromDaryHeap Returns the top item.
+
+  Queue *queue The queue to remove the result from.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static Result *PopFromDaryHeap(Queue *queue)
+{
+ int index;
+ Result *retval;
+ QueueEntry last;
+
+ if(queue->noccupied==0)
+    return(NULL);
+
+ retval=queue->entries[0].result;
+ retval->queued=NOT_QUEUED;
+
+ queue->noccupied--;
+
+ if(queue->noccupied==0)
+    return(retval);
+
+ last=queue->entries[queue->noccupied];
+
+ /* Bubble down the hole at the top by moving the smallest child up into it */
+
+ index=0;
+
+ while(1)
+   {
+    int first=index*QUEUE_ARITY+1,end=first+QUEUE_ARITY;
+    int newindex,child;
+
+    if(first>=queue->noccupied)
+       break;
+
+    if(end>queue->noccupied)
+       end=queue->noccupied;
+
+    newindex=first;
+
+    for(child=first+1;child<end;child++)
+       if(queue->entries[child].score<queue->entries[newindex].score)
+          newindex=child;
+
+    if(last.score<=queue->entries[newindex].score)
+       break;
+
+    queue->entries[index]=queue->entries[newindex];
+    queue->entries[index].result->queued=index+1;
+
+    index=newindex;
+   }
+
+ queue->entries[index]=last;
+ last.result->queued=index+1;
+
+ return(retval);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Insert a new item into a radix heap queue (or move an item that is already in the queue).
+
+  The data is stored in a "Radix Heap" (Ahuja, Mehlhorn, Orlin & Tarjan, 1990)
+  which requires that the scores inserted are never less than the score of the
+  last item removed (as in Dijkstra's algorithm or A* with a consistent estimate).
+  A score that is smaller than this is treated as being equal to it.
+
+  Queue *queue The queue to insert the result into.
+
+  Result *result The result to insert into the queue.
+
+  score_t score The score to use for sorting the node.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void InsertInRadixHeap(Queue *queue,Result *result,score_t score)
+{
+ uint32_t key=0;
+
+ /* The bit pattern of a non-negative IEEE float sorts in the same order as the value */
+
+ if(score>0)
+    memcpy(&key,&score,sizeof(uint32_t));
+
+ if(key<queue->last)
+    key=queue->last;
+
+ result->sortby=score;
+
+ /* Remove the result from its old bucket */
+
+ if(result->queued!=NOT_QUEUED)
+   {
+    int bucket=result->queued&((1<<RADIX_BUCKET_BITS)-1);
+    int position=(result->queued>>RADIX_BUCKET_BITS)-1;
+    int lastpos=--queue->nbucket[bucket];
+
+    if(position!=lastpos)
+      {
+       queue->buckets[bucket][position]=queue->buckets[bucket][lastpos];
+       queue->buckets[bucket][position].result->queued=((position+1)<<RADIX_BUCKET_BITS)|bucket;
+      }
+
+    queue->noccupied--;
+   }
+
+ AddToRadixBucket(queue,key,result);
+
+ queue->noccupied++;
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Pop an item from the front of a radix heap queue.
+
+  Result *PopFromRadixHeap Returns the top item.
+
+  Queue *queue The queue to remove the result from.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static Result *PopFromRadixHeap(Queue *queue)
+{
+ Result *retval;
+
+ if(queue->noccupied==0)
+    return(NULL);
+
+ /* Refill bucket 0 from the first non-empty bucket, all of its entries move to lower buckets */
+
+ if(queue->nbucket[0]==0)
+   {
+    int bucket=1,i,n;
+    uint32_t minkey;
+
+    while(queue->nbucket[bucket]==0)
+       bucket++;
+
+    n=queue->nbucket[bucket];
+
+    minkey=queue->buckets[bucket][0].key;
+
+    for(i=1;i<n;i++)
+       if(queue->buckets[bucket][i].key<minkey)
+          minkey=queue->buckets[bucket][i].key;
+
+    queue->last=minkey;
+
+    queue->nbucket[bucket]=0;
+
+    for(i=0;i<n;i++)
+       AddToRadixBucket(queue,queue->buckets[bucket][i].key,queue->buckets[bucket][i].result);
+   }
+
+ retval=queue->buckets[0][--queue->nbucket[0]].result;
+ retval->queued=NOT_QUEUED;
+
+ queue->noccupied--;
+
+ return(retval);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Add an entry to the radix heap bucket selected by the highest bit that differs from the last key removed.
+
+  Queue *queue The queue to add the result to.
+
+  uint32_t key The key of the result.
+
+  Result *result The result.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void AddToRadixBucket(Queue *queue,uint32_t key,Result *result)
+{
+ int bucket,position;
+
+ if(key==queue->last)
+    bucket=0;
+ else
+    bucket=32-__builtin_clz(key^queue->last);
+
+ position=queue->nbucket[bucket]++;
+
+ if(position==queue->nallocbucket[bucket])
+   {
+    queue->nallocbucket[bucket]+=queue->nincrement;
+    queue->buckets[bucket]=(RadixEntry*)realloc((void*)queue->buckets[bucket],queue->nallocbucket[bucket]*sizeof(RadixEntry));
+   }
+
+ queue->buckets[bucket][position].key=key;
+ queue->buckets[bucket][position].result=result;
+
+ result->queued=((position+1)<<RADIX_BUCKET_BITS)|bucket;
+}
@@ -24,7 +24,6 @@
 
 #include "types.h"
 #include "relations.h"
-#include "fakes.h"
 
 #include "cache.h"
 #include "files.h"
@@ -111,6 +110,51 @@ void DestroyRelationList(Relations *relations)
 }
 
 
+/*++++++++++++++++++++++++++++++++++++++
+  Create a copy of a relation list that shares the loaded data but has its own cache so that
+  each copy can be used by a different thread.
+
+  Relations *DuplicateRelationList Returns the new relation list.
+
+  Relations *relations The relation list to copy.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+Relations *DuplicateRelationList(Relations *relations)
+{
+ Relations *newrelations;
+
+ newrelations=(Relations*)malloc(sizeof(Relations));
+
+ *newrelations=*relations;
+
+#if SLIM
+
+ newrelations->cache=NewTurnRelationCache();
+
+#endif
+
+ return(newrelations);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Destroy a copy of a relation list created by DuplicateRelationList() (the shared data is kept).
+
+  Relations *relations The relation list copy to destroy.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+void DestroyDuplicateRelationList(Relations *relations)
+{
+#if SLIM
+
+ DeleteTurnRelationCache(relations->cache);
+
+#endif
+
+ free(relations);
+}
+
+
 /*++++++++++++++++++++++++++++++++++++++
   Find the first turn relation in the file whose 'via' matches a specific node.
 
@@ -233,7 +277,7 @@ index_t FindNextTurnRelation1(Relations *relations,index_t current)
 
   index_t via The node that the route is going via.
 
-  index_t from The segment that the route is coming from.
+  index_t from The segment that the route is coming from (a real segment, not a fake one).
   ++++++++++++++++++++++++++++++++++++++*/
 
 index_t FindFirstTurnRelation2(Relations *relations,index_t via,index_t from)
@@ -244,9 +288,6 @@ index_t FindFirstTurnRelation2(Relations *relations,index_t via,index_t from)
  index_t mid;
  index_t match=NO_RELATION;
 
- if(IsFakeSegment(from))
-    from=IndexRealSegment(from);
-
  /* Binary search - search key first match is required.
   *
   *  # <- start  |  Check mid and move start or end if it doesn't match
@@ -361,21 +402,15 @@ index_t FindNextTurnRelation2(Relations *relations,index_t current)
 
   index_t via The via node.
 
-  index_t from The from segment.
+  index_t from The from segment (a real segment, not a fake one).
 
-  index_t to The to segment.
+  index_t to The to segment (a real segment, not a fake one).
 
   transports_t transport The type of transport that is being routed.
   ++++++++++++++++++++++++++++++++++++++*/
 
 int IsTurnAllowed(Relations *relations,index_t index,index_t via,index_t from,index_t to,transports_t transport)
 {
- if(IsFakeSegment(from))
-    from=IndexRealSegment(from);
-
- if(IsFakeSegment(to))
-    to=IndexRealSegment(to);
-
  while(index<relations->file.trnumber)
    {
     TurnRelation *relation=LookupTurnRelation(relations,index,1);
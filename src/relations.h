@@ -89,6 +89,10 @@ Relations *LoadRelationList(const char *filename);
 
 void DestroyRelationList(Relations *relations);
 
+Relations *DuplicateRelationList(Relations *relations);
+
+void DestroyDuplicateRelationList(Relations *relations);
+
 index_t FindFirstTurnRelation1(Relations *relations,index_t via);
 index_t FindNextTurnRelation1(Relations *relations,index_t current);
 
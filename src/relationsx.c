@@ -81,8 +81,8 @@ RelationsX *NewRelationList(int append,int readonly)
 
  /* Route Relations */
 
- relationsx->rrfilename    =(char*)malloc(strlen(option_tmpdirname)+32);
- relationsx->rrfilename_tmp=(char*)malloc(strlen(option_tmpdirname)+32);
+ relationsx->rrfilename    =(char*)malloc(strlen(option_tmpdirname)+48);
+ relationsx->rrfilename_tmp=(char*)malloc(strlen(option_tmpdirname)+48);
 
  sprintf(relationsx->rrfilename    ,"%s/relationsx.route.parsed.mem",option_tmpdirname);
  sprintf(relationsx->rrfilename_tmp,"%s/relationsx.route.%p.tmp"    ,option_tmpdirname,(void*)relationsx);
@@ -110,15 +110,15 @@ RelationsX *NewRelationList(int append,int readonly)
  if(append)
     relationsx->rrfd=OpenFileBufferedAppend(relationsx->rrfilename_tmp);
  else if(!readonly)
-    relationsx->rrfd=OpenFileBufferedNew(relationsx->rrfilename_tmp);
+    relationsx->rrfd=OpenFileBufferedNewTemporary(relationsx->rrfilename_tmp);
  else
     relationsx->rrfd=-1;
 
 
  /* Turn Restriction Relations */
 
- relationsx->trfilename    =(char*)malloc(strlen(option_tmpdirname)+32);
- relationsx->trfilename_tmp=(char*)malloc(strlen(option_tmpdirname)+32);
+ relationsx->trfilename    =(char*)malloc(strlen(option_tmpdirname)+48);
+ relationsx->trfilename_tmp=(char*)malloc(strlen(option_tmpdirname)+48);
 
  sprintf(relationsx->trfilename    ,"%s/relationsx.turn.parsed.mem",option_tmpdirname);
  sprintf(relationsx->trfilename_tmp,"%s/relationsx.turn.%p.tmp"    ,option_tmpdirname,(void*)relationsx);
@@ -138,7 +138,7 @@ RelationsX *NewRelationList(int append,int readonly)
  if(append)
     relationsx->trfd=OpenFileBufferedAppend(relationsx->trfilename_tmp);
  else if(!readonly)
-    relationsx->trfd=OpenFileBufferedNew(relationsx->trfilename_tmp);
+    relationsx->trfd=OpenFileBufferedNewTemporary(relationsx->trfilename_tmp);
  else
     relationsx->trfd=-1;
 
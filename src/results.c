@@ -28,7 +28,13 @@
 #include "logging.h"
 
 
-#define HASH_NODE_SEGMENT(node,segment) ((node)^(segment<<4))
+/*+ The hash function for a node and segment pair (mixed so that the low bits can be used with linear probing). +*/
+#define HASH_NODE_SEGMENT(node,segment) HashNodeSegment(node,segment)
+
+
+/* Local functions */
+
+static inline uint32_t HashNodeSegment(index_t node,index_t segment);
 
 
 /*++++++++++++++++++++++++++++++++++++++
@@ -47,16 +53,15 @@ Results *NewResultsList(uint8_t log2bins)
 
  results->nbins=1<<log2bins;
  results->mask=results->nbins-1;
- results->ncollisions=log2bins-4;
 
  results->number=0;
 
- results->count=(uint8_t*)calloc(results->nbins,sizeof(uint8_t));
- results->point=(Result**)calloc(results->nbins,sizeof(Result*));
+ results->keys=(ResultKey*)calloc(results->nbins,sizeof(ResultKey));
 
  results->ndata1=0;
  results->nallocdata1=0;
- results->ndata2=results->nbins>>2;
+ results->log2ndata2=log2bins-2;
+ results->ndata2=1<<results->log2ndata2;
 
  results->data=NULL;
 
@@ -78,16 +83,10 @@ Results *NewResultsList(uint8_t log2bins)
 
 void ResetResultsList(Results *results)
 {
- uint32_t i;
-
  results->number=0;
  results->ndata1=0;
 
- for(i=0;i<results->nbins;i++)
-   {
-    results->point[i]=NULL;
-    results->count[i]=0;
-   }
+ memset(results->keys,0,results->nbins*sizeof(ResultKey));
 
  results->start_node=NO_NODE;
  results->prev_segment=NO_SEGMENT;
@@ -112,9 +111,7 @@ void FreeResultsList(Results *results)
 
  free(results->data);
 
- free(results->point);
-
- free(results->count);
+ free(results->keys);
 
  free(results);
 }
@@ -135,54 +132,32 @@ void FreeResultsList(Results *results)
 Result *InsertResult(Results *results,index_t node,index_t segment)
 {
  Result *result;
- uint32_t bin=HASH_NODE_SEGMENT(node,segment)&results->mask;
+ uint32_t bin;
 
- /* Check if we have hit the limit on the number of collisions per bin */
+ /* Check if the hash table would become more than half full */
 
- if(results->count[bin]==results->ncollisions)
+ if(2*(results->number+1)>results->nbins)
    {
-    uint32_t i;
+    ResultKey *oldkeys=results->keys;
+    uint32_t i,oldnbins=results->nbins;
 
     results->nbins<<=1;
     results->mask=results->nbins-1;
-    results->ncollisions++;
 
-    results->count=(uint8_t*)realloc((void*)results->count,results->nbins*sizeof(uint8_t));
-    results->point=(Result**)realloc((void*)results->point,results->nbins*sizeof(Result*));
+    results->keys=(ResultKey*)calloc(results->nbins,sizeof(ResultKey));
 
-    for(i=0;i<results->nbins/2;i++)
-      {
-       Result *r=results->point[i];
-       Result **bin1,**bin2;
-
-       results->count[i]                 =0;
-       results->count[i+results->nbins/2]=0;
-
-       bin1=&results->point[i];
-       bin2=&results->point[i+results->nbins/2];
-
-       *bin1=NULL;
-       *bin2=NULL;
-
-       while(r)
+    for(i=0;i<oldnbins;i++)
+       if(oldkeys[i].index)
          {
-          Result *rh=r->hashnext;
-          uint32_t newbin=HASH_NODE_SEGMENT(r->node,r->segment)&results->mask;
-
-          r->hashnext=NULL;
+          bin=HASH_NODE_SEGMENT(oldkeys[i].node,oldkeys[i].segment)&results->mask;
 
-          if(newbin==i)
-            { *bin1=r; bin1=&r->hashnext; }
-          else
-            { *bin2=r; bin2=&r->hashnext; }
+          while(results->keys[bin].index)
+             bin=(bin+1)&results->mask;
 
-          results->count[newbin]++;
-
-          r=rh;
+          results->keys[bin]=oldkeys[i];
          }
-      }
 
-    bin=HASH_NODE_SEGMENT(node,segment)&results->mask;
+    free(oldkeys);
    }
 
  /* Check if we need more data space allocated */
@@ -203,14 +178,18 @@ Result *InsertResult(Results *results,index_t node,index_t segment)
 
  result=&results->data[results->ndata1-1][results->number%results->ndata2];
 
- result->hashnext=results->point[bin];
+ bin=HASH_NODE_SEGMENT(node,segment)&results->mask;
 
- results->point[bin]=result;
+ while(results->keys[bin].index)
+    bin=(bin+1)&results->mask;
 
- results->count[bin]++;
+ results->keys[bin].node=node;
+ results->keys[bin].segment=segment;
 
  results->number++;
 
+ results->keys[bin].index=results->number;
+
  /* Initialise the result */
 
  result->node=node;
@@ -244,20 +223,23 @@ Result *InsertResult(Results *results,index_t node,index_t segment)
 
 Result *FindResult(Results *results,index_t node,index_t segment)
 {
- Result *r;
  uint32_t bin=HASH_NODE_SEGMENT(node,segment)&results->mask;
 
- r=results->point[bin];
+ /* Only the compact hash table is searched, the result itself is only read when found */
 
- while(r)
+ while(results->keys[bin].index)
    {
-    if(r->segment==segment && r->node==node)
-       break;
+    if(results->keys[bin].node==node && results->keys[bin].segment==segment)
+      {
+       uint32_t index=results->keys[bin].index-1;
 
-    r=r->hashnext;
+       return(&results->data[index>>results->log2ndata2][index&(results->ndata2-1)]);
+      }
+
+    bin=(bin+1)&results->mask;
    }
 
- return(r);
+ return(NULL);
 }
 
 
@@ -271,6 +253,9 @@ Result *FindResult(Results *results,index_t node,index_t segment)
 
 Result *FirstResult(Results *results)
 {
+ if(results->number==0)
+    return(NULL);
+
  return(&results->data[0][0]);
 }
 
@@ -307,3 +292,21 @@ Result *NextResult(Results *results,Result *result)
 
  return(&results->data[i][j]);
 }
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Calculate the hash of a node and segment pair.
+
+  uint32_t HashNodeSegment Returns the hash value.
+
+  index_t node The node.
+
+  index_t segment The segment.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static inline uint32_t HashNodeSegment(index_t node,index_t segment)
+{
+ uint32_t hash=(uint32_t)node*0x9E3779B1U^(uint32_t)segment*0x85EBCA6BU;
+
+ return(hash^(hash>>16));
+}
@@ -33,6 +33,20 @@
 /*+ A result is not currently queued. +*/
 #define NOT_QUEUED (uint32_t)(0)
 
+/*+ The queue is a binary heap of pointers to results. +*/
+#define QUEUE_BINARY_HEAP 0
+
+/*+ The queue is a 4-ary heap of scores and pointers to results. +*/
+#define QUEUE_DARY_HEAP   1
+
+/*+ The queue is a radix heap (only for scores that never decrease below the last one removed). +*/
+#define QUEUE_RADIX_HEAP  2
+
+/*+ The type of queue to use unless changed at run-time. +*/
+#ifndef QUEUE_TYPE
+#define QUEUE_TYPE QUEUE_DARY_HEAP
+#endif
+
 
 /* Data structures */
 
@@ -49,30 +63,36 @@ struct _Result
 
  score_t   score;               /*+ The best actual weighted distance or duration score from the start to the node. +*/
  score_t   sortby;              /*+ The best possible weighted distance or duration score from the start to the finish. +*/
- 
- float percentascent;
- float percentdescent;
 
- uint32_t  queued;              /*+ The position of this result in the queue. +*/
+ gradient_t percentascent;      /*+ The steepest ascent gradient of the segments to this node (only for super-segments). +*/
+ gradient_t percentdescent;     /*+ The steepest descent gradient of the segments to this node (only for super-segments). +*/
 
- Result   *hashnext;            /*+ The next result in the linked list for this hash bin. +*/
+ uint32_t  queued;              /*+ The position of this result in the queue. +*/
 };
 
+/*+ An entry in the hash table of results. +*/
+typedef struct _ResultKey
+{
+ index_t   node;                /*+ The node of the result. +*/
+ index_t   segment;             /*+ The segment of the result. +*/
+
+ uint32_t  index;               /*+ The position of the result in the 'data' array plus one (or zero if unused). +*/
+}
+ ResultKey;
+
 /*+ A list of results. +*/
 typedef struct _Results
 {
- uint32_t  nbins;               /*+ The number of bins in the has table. +*/
+ uint32_t  nbins;               /*+ The number of bins in the hash table. +*/
  uint32_t  mask;                /*+ A bit mask to select the bottom log2(nbins) bits. +*/
 
  uint32_t  number;              /*+ The total number of occupied results. +*/
 
- uint8_t   ncollisions;         /*+ The number of results allowed in each hash bin. +*/
- uint8_t  *count;               /*+ An array of nbins counters of results in each hash bin. +*/
-
- Result  **point;               /*+ An array of nbins linked lists of results for one hash bin. +*/
+ ResultKey *keys;               /*+ An open-addressing (linear probing) hash table of nbins entries, never more than half full. +*/
 
  uint32_t  ndata1;              /*+ The size of the first dimension of the 'data' array. +*/
  uint32_t  ndata2;              /*+ The size of the second dimension of the 'data' array. +*/
+ uint8_t   log2ndata2;          /*+ The base 2 logarithm of ndata2. +*/
 
  uint32_t  nallocdata1;         /*+ The amount of allocated space in the first dimension of the 'data' array. +*/
 
@@ -111,6 +131,8 @@ Result *NextResult(Results *results,Result *result);
 
 /* Queue functions in queue.c */
 
+void SetQueueType(int type);
+
 Queue *NewQueueList(uint8_t log2bins);
 void ResetQueueList(Queue *queue);
 void FreeQueueList(Queue *queue);
@@ -24,6 +24,17 @@
 #include <string.h>
 #include <stdlib.h>
 #include <ctype.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#if defined(USE_PTHREADS) && USE_PTHREADS
+#include <pthread.h>
+#endif
 
 #include "types.h"
 #include "nodes.h"
@@ -35,6 +46,12 @@
 #include "logging.h"
 #include "functions.h"
 #include "fakes.h"
+#include "query.h"
+#include "matrix.h"
+#include "isochrone.h"
+#include "contract.h"
+#include "costs.h"
+#include "landmarks.h"
 #include "translations.h"
 #include "profiles.h"
 
@@ -45,6 +62,51 @@
 /*+ The maximum distance from the specified point to search for a node or segment (in km). +*/
 #define MAXSEARCH  1
 
+/*+ The number of lines of a batch file that are read and routed together. +*/
+#define BATCHBLOCK 4096
+
+/*+ The maximum number of waypoints and options on one line of a batch file. +*/
+#define BATCHTOKENS (2*NWAYPOINTS+64)
+
+
+/* Local types */
+
+/*+ The information shared by all of the threads when routing a batch file. +*/
+typedef struct _batch_info
+{
+ Profile  *profile;             /*+ The profile selected on the command line. +*/
+ Profile  *selected;            /*+ The loaded profile that was selected (NULL if none). +*/
+ Profile   rawprofile;          /*+ The selected profile before it was updated for the database. +*/
+
+ int       quickest;            /*+ Set to calculate the quickest route by default. +*/
+ double    heading;             /*+ The default starting heading (or -999). +*/
+ int       exactnodes;          /*+ Set to route from the closest nodes only. +*/
+ int       printnodes;          /*+ Set to print the nodes of each route. +*/
+
+ char    **lines;               /*+ The lines of the batch file that are being routed. +*/
+ int      *linenums;            /*+ The line numbers of the lines. +*/
+ char    **outputs;             /*+ The output for each of the lines. +*/
+ int       nlines;              /*+ The number of lines being routed. +*/
+ int       next;                /*+ The next line to route. +*/
+}
+ batch_info;
+
+/*+ The information for one of the threads when routing a batch file. +*/
+typedef struct _batch_thread
+{
+#if defined(USE_PTHREADS) && USE_PTHREADS
+ pthread_t  thread;             /*+ The thread identifier. +*/
+#endif
+
+ batch_info *info;              /*+ The shared information. +*/
+
+ Nodes     *nodes;              /*+ This thread's copy of the nodes. +*/
+ Segments  *segments;           /*+ This thread's copy of the segments. +*/
+ Ways      *ways;               /*+ This thread's copy of the ways. +*/
+ Relations *relations;          /*+ This thread's copy of the relations. +*/
+}
+ batch_thread;
+
 
 /* Global variables */
 
@@ -54,12 +116,91 @@ int option_quiet=0;
 /*+ The options to select the format of the output. +*/
 int option_html=0,option_gpx_track=0,option_gpx_route=0,option_text=0,option_text_all=0,option_none=0;
 
-/*+ The option to calculate the quickest route insted of the shortest. +*/
-int option_quickest=0;
+/*+ The option to search the super-node graph from both ends of the route at once. +*/
+int option_bidirectional=0;
+
+/*+ The option to use the contraction hierarchy of the super-nodes (if there is one for the profile). +*/
+int option_contracted=0;
+
+/*+ The option to calculate the score of every segment for the profile before routing. +*/
+int option_costtable=0;
+
+
+/* Local variables */
+
+/*+ The routing database (loaded once and shared by all requests in server mode). +*/
+static Nodes    *OSMNodes=NULL;
+static Segments *OSMSegments=NULL;
+static Ways     *OSMWays=NULL;
+static Relations*OSMRelations=NULL;
+
+/*+ The contraction hierarchy for the selected profile (if requested and available). +*/
+static Contraction *OSMContraction=NULL;
+
+/*+ The landmark distances for the selected profile (if available). +*/
+static Landmarks *OSMLandmarks=NULL;
+
+/*+ The precalculated segment scores for the selected profile (if requested). +*/
+static SegmentCosts *OSMCosts=NULL;
+
+#if defined(USE_PTHREADS) && USE_PTHREADS
+
+/*+ A mutex to protect the next line to route in batch mode. +*/
+static pthread_mutex_t batch_mutex=PTHREAD_MUTEX_INITIALIZER;
+
+#endif
+
+/*+ The profiles and translations files that have already been loaded (and the language). +*/
+static char *loaded_profiles=NULL,*loaded_translations=NULL,*loaded_language=NULL;
+
+/*+ The built-in text output copyright (used when a request does not need the translations). +*/
+static char *default_raw_copyright_creator[2],*default_raw_copyright_source[2],*default_raw_copyright_license[2];
+
+/*+ Set when running as a server (the data below has been loaded once for all requests). +*/
+static int server_loaded=0;
+
+/*+ The database directory and filename prefix from the server command line. +*/
+static const char *server_dirname=NULL,*server_prefix=NULL;
+
+/*+ The contraction hierarchies loaded by the server (shortest and quickest for each profile). +*/
+static Contraction **server_contractions=NULL;
+
+/*+ The landmark distances loaded by the server (shortest and quickest for each profile). +*/
+static Landmarks **server_landmarks=NULL;
+
+/*+ The segment scores calculated by the server (shortest and quickest for one profile). +*/
+static SegmentCosts *server_costs[2]={NULL,NULL};
 
 
 /* Local functions */
 
+static int run_router(int argc,char** argv);
+
+static int parse_routing_option(const char *arg,Profile *profile,int *quickest,double *heading);
+
+static Results *calculate_route(Query *query,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,
+                                index_t start_node,index_t prev_segment,index_t finish_node,const char **error);
+
+static void load_translations(const char *dirname,const char *prefix,char *translations,char *language);
+static void load_database(const char *dirname,const char *prefix);
+static void load_contraction(const char *dirname,const char *prefix,Profile *profile,int quickest);
+static void load_landmarks(const char *dirname,const char *prefix,Profile *profile,int quickest);
+static void load_costs(Profile *profile,int quickest);
+static void load_server_data(const char *dirname,const char *prefix,Profile *costsprofile);
+static int server_profile_number(Profile *profile);
+
+static int run_batch(const char *filename,int nthreads,batch_info *info);
+static void *batch_routes(batch_thread *thread);
+static char *batch_route(batch_thread *thread,char *line);
+
+static int run_matrix(const char *sourcesfile,const char *targetsfile,int binary,Profile *profile,int quickest,int exactnodes);
+static int read_matrix_points(const char *filename,Profile *profile,int exactnodes,MatrixPoint **points);
+
+static int run_isochrone(double lon,double lat,double heading,Profile *profile,int quickest,score_t budget,int hull,int exactnodes);
+
+static int run_server(const char *socketname);
+static int serve_request(int conn);
+
 static void print_usage(int detail,const char *argerr,const char *err);
 
 
@@ -69,10 +210,22 @@ static void print_usage(int detail,const char *argerr,const char *err);
 
 int main(int argc,char** argv)
 {
- Nodes    *OSMNodes;
- Segments *OSMSegments;
- Ways     *OSMWays;
- Relations*OSMRelations;
+ return(run_router(argc,argv));
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Process the command line arguments and calculate a route (or start the server).
+
+  int run_router Returns the exit status for the program.
+
+  int argc The number of command line arguments.
+
+  char** argv The command line arguments.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int run_router(int argc,char** argv)
+{
  Results  *results[NWAYPOINTS+1]={NULL};
  int       point_used[NWAYPOINTS+1]={0};
  double    point_lon[NWAYPOINTS+1],point_lat[NWAYPOINTS+1];
@@ -82,8 +235,17 @@ int main(int argc,char** argv)
  char     *profiles=NULL,*profilename=NULL;
  char     *translations=NULL,*language=NULL;
  int       exactnodes=0;
+ int       quickest=0;
+ char     *server=NULL;
+ char     *batch=NULL;
+ int       batchthreads=1,batchnodes=0;
+ char     *matrix=NULL,*matrixtargets=NULL;
+ int       matrixbinary=0;
+ double    isochronetime=0,isochronedistance=0;
+ int       isochronehull=0;
  Transport transport=Transport_None;
  Profile  *profile=NULL;
+ Query    *query;
  index_t   start_node=NO_NODE,finish_node=NO_NODE;
  index_t   join_segment=NO_SEGMENT;
  int       arg,point;
@@ -108,13 +270,33 @@ int main(int argc,char** argv)
     else if(!strcmp(argv[arg],"--help-profile-perl"))
        help_profile_pl=1;
     else if(!strncmp(argv[arg],"--dir=",6))
+      {
+       if(loaded_profiles)
+          print_usage(0,argv[arg],"The '--dir' option cannot be used in a request to a server.");
+
        dirname=&argv[arg][6];
+      }
     else if(!strncmp(argv[arg],"--prefix=",9))
+      {
+       if(loaded_profiles)
+          print_usage(0,argv[arg],"The '--prefix' option cannot be used in a request to a server.");
+
        prefix=&argv[arg][9];
+      }
     else if(!strncmp(argv[arg],"--profiles=",11))
+      {
+       if(loaded_profiles)
+          print_usage(0,argv[arg],"The '--profiles' option cannot be used in a request to a server.");
+
        profiles=&argv[arg][11];
+      }
     else if(!strncmp(argv[arg],"--translations=",15))
+      {
+       if(loaded_profiles)
+          print_usage(0,argv[arg],"The '--translations' option cannot be used in a request to a server.");
+
        translations=&argv[arg][15];
+      }
     else if(!strcmp(argv[arg],"--exact-nodes-only"))
        exactnodes=1;
     else if(!strcmp(argv[arg],"--quiet"))
@@ -133,6 +315,17 @@ int main(int argc,char** argv)
        option_text_all=1;
     else if(!strcmp(argv[arg],"--output-none"))
        option_none=1;
+    else if(!strcmp(argv[arg],"--bidirectional"))
+       option_bidirectional=1;
+    else if(!strcmp(argv[arg],"--contracted"))
+       option_contracted=1;
+    else if(!strcmp(argv[arg],"--cost-table"))
+      {
+       if(loaded_profiles)
+          print_usage(0,argv[arg],"The '--cost-table' option cannot be used in a request to a server (use it when starting the server).");
+
+       option_costtable=1;
+      }
     else if(!strncmp(argv[arg],"--profile=",10))
        profilename=&argv[arg][10];
     else if(!strncmp(argv[arg],"--language=",11))
@@ -144,18 +337,57 @@ int main(int argc,char** argv)
        if(transport==Transport_None)
           print_usage(0,argv[arg],NULL);
       }
+    else if(!strncmp(argv[arg],"--batch=",8))
+       batch=&argv[arg][8];
+#if defined(USE_PTHREADS) && USE_PTHREADS
+    else if(!strncmp(argv[arg],"--threads=",10))
+       batchthreads=atoi(&argv[arg][10]);
+#endif
+    else if(!strcmp(argv[arg],"--batch-nodes"))
+       batchnodes=1;
+    else if(!strncmp(argv[arg],"--matrix=",9))
+       matrix=&argv[arg][9];
+    else if(!strncmp(argv[arg],"--matrix-targets=",17))
+       matrixtargets=&argv[arg][17];
+    else if(!strcmp(argv[arg],"--matrix-binary"))
+       matrixbinary=1;
+    else if(!strncmp(argv[arg],"--isochrone-time=",17))
+      {
+       isochronetime=atof(&argv[arg][17]);
+
+       if(isochronetime<=0)
+          print_usage(0,argv[arg],NULL);
+      }
+    else if(!strncmp(argv[arg],"--isochrone-distance=",21))
+      {
+       isochronedistance=atof(&argv[arg][21]);
+
+       if(isochronedistance<=0)
+          print_usage(0,argv[arg],NULL);
+      }
+    else if(!strcmp(argv[arg],"--isochrone-hull"))
+       isochronehull=1;
+    else if(!strncmp(argv[arg],"--server=",9))
+      {
+       if(loaded_profiles)
+          print_usage(0,argv[arg],"The '--server' option cannot be used in a request to a server.");
+
+       server=&argv[arg][9];
+      }
     else
        continue;
 
     argv[arg]=NULL;
    }
 
- /* Load in the profiles */
+ /* Load in the profiles (unless a server has already done it) */
 
  if(transport==Transport_None)
     transport=Transport_Motorcar;
 
- if(profiles)
+ if(loaded_profiles)
+    profiles=loaded_profiles;
+ else if(profiles)
    {
     if(!ExistsFile(profiles))
       {
@@ -176,10 +408,46 @@ int main(int argc,char** argv)
       }
    }
 
- if(ParseXMLProfiles(profiles))
+ if(!loaded_profiles)
    {
-    fprintf(stderr,"Error: Cannot read the profiles in the file '%s'.\n",profiles);
-    exit(EXIT_FAILURE);
+    if(ParseXMLProfiles(profiles))
+      {
+       fprintf(stderr,"Error: Cannot read the profiles in the file '%s'.\n",profiles);
+       exit(EXIT_FAILURE);
+      }
+
+    loaded_profiles=profiles;
+   }
+
+ /* Load everything else and wait for requests if running as a server */
+
+ if(server)
+   {
+    memcpy(default_raw_copyright_creator,translate_raw_copyright_creator,sizeof(default_raw_copyright_creator));
+    memcpy(default_raw_copyright_source ,translate_raw_copyright_source ,sizeof(default_raw_copyright_source));
+    memcpy(default_raw_copyright_license,translate_raw_copyright_license,sizeof(default_raw_copyright_license));
+
+    load_translations(dirname,prefix,translations,language);
+
+    load_database(dirname,prefix);
+
+    if(option_costtable)
+      {
+       if(profilename)
+          profile=GetProfile(profilename);
+       else
+          profile=GetProfile(TransportName(transport));
+
+       if(!profile)
+         {
+          fprintf(stderr,"Error: Cannot find the profile to calculate the segment scores for with the '--cost-table' option.\n");
+          exit(EXIT_FAILURE);
+         }
+      }
+
+    load_server_data(dirname,prefix,profile);
+
+    return(run_server(server));
    }
 
  /* Choose the selected profile. */
@@ -209,10 +477,6 @@ int main(int argc,char** argv)
    {
     if(!argv[arg])
        continue;
-    else if(!strcmp(argv[arg],"--shortest"))
-       option_quickest=0;
-    else if(!strcmp(argv[arg],"--quickest"))
-       option_quickest=1;
     else if(isdigit(argv[arg][0]) ||
        ((argv[arg][0]=='-' || argv[arg][0]=='+') && isdigit(argv[arg][1])))
       {
@@ -260,95 +524,9 @@ int main(int argc,char** argv)
        point_lat[point]=degrees_to_radians(atof(p));
        point_used[point]+=2;
       }
-    else if(!strncmp(argv[arg],"--heading=",10))
-      {
-       double h=atof(&argv[arg][10]);
-
-       if(h>=-360 && h<=360)
-         {
-          heading=h;
-
-          if(heading<0) heading+=360;
-         }
-      }
     else if(!strncmp(argv[arg],"--transport=",12))
        ; /* Done this already */
-    else if(!strncmp(argv[arg],"--highway-",10))
-      {
-       Highway highway;
-       char *equal=strchr(argv[arg],'=');
-       char *string;
-
-       if(!equal)
-           print_usage(0,argv[arg],NULL);
-
-       string=strcpy((char*)malloc(strlen(argv[arg])),argv[arg]+10);
-       string[equal-argv[arg]-10]=0;
-
-       highway=HighwayType(string);
-
-       if(highway==Highway_None)
-          print_usage(0,argv[arg],NULL);
-
-       profile->highway[highway]=atof(equal+1);
-
-       free(string);
-      }
-    else if(!strncmp(argv[arg],"--speed-",8))
-      {
-       Highway highway;
-       char *equal=strchr(argv[arg],'=');
-       char *string;
-
-       if(!equal)
-          print_usage(0,argv[arg],NULL);
-
-       string=strcpy((char*)malloc(strlen(argv[arg])),argv[arg]+8);
-       string[equal-argv[arg]-8]=0;
-
-       highway=HighwayType(string);
-
-       if(highway==Highway_None)
-          print_usage(0,argv[arg],NULL);
-
-       profile->speed[highway]=kph_to_speed(atof(equal+1));
-
-       free(string);
-      }
-    else if(!strncmp(argv[arg],"--property-",11))
-      {
-       Property property;
-       char *equal=strchr(argv[arg],'=');
-       char *string;
-
-       if(!equal)
-          print_usage(0,argv[arg],NULL);
-
-       string=strcpy((char*)malloc(strlen(argv[arg])),argv[arg]+11);
-       string[equal-argv[arg]-11]=0;
-
-       property=PropertyType(string);
-
-       if(property==Property_None)
-          print_usage(0,argv[arg],NULL);
-
-       profile->props_yes[property]=atof(equal+1);
-
-       free(string);
-      }
-    else if(!strncmp(argv[arg],"--oneway=",9))
-       profile->oneway=!!atoi(&argv[arg][9]);
-    else if(!strncmp(argv[arg],"--turns=",8))
-       profile->turns=!!atoi(&argv[arg][8]);
-    else if(!strncmp(argv[arg],"--weight=",9))
-       profile->weight=tonnes_to_weight(atof(&argv[arg][9]));
-    else if(!strncmp(argv[arg],"--height=",9))
-       profile->height=metres_to_height(atof(&argv[arg][9]));
-    else if(!strncmp(argv[arg],"--width=",8))
-       profile->width=metres_to_width(atof(&argv[arg][8]));
-    else if(!strncmp(argv[arg],"--length=",9))
-       profile->length=metres_to_length(atof(&argv[arg][9]));
-    else
+    else if(parse_routing_option(argv[arg],profile,&quickest,&heading))
        print_usage(0,argv[arg],NULL);
    }
 
@@ -383,50 +561,150 @@ int main(int argc,char** argv)
     return(0);
    }
 
- /* Load in the translations */
+ /* Route the lines of a batch file if requested */
 
- if(option_html==0 && option_gpx_track==0 && option_gpx_route==0 && option_text==0 && option_text_all==0 && option_none==0)
-    option_html=option_gpx_track=option_gpx_route=option_text=option_text_all=1;
+ if(batch && matrix)
+    print_usage(0,NULL,"The '--batch' and '--matrix' options cannot be used together.");
 
- if(option_html || option_gpx_route || option_gpx_track)
+ if(batch)
    {
-    if(translations)
+    batch_info info;
+
+    for(point=1;point<=NWAYPOINTS;point++)
+       if(point_used[point])
+          print_usage(0,NULL,"Waypoints cannot be given on the command line with the '--batch' option.");
+
+    if(batchthreads<1)
+       print_usage(0,NULL,"The number of threads must be at least one.");
+
+    if(!OSMNodes)
+       load_database(dirname,prefix);
+
+    info.selected=profile;
+    info.rawprofile=*profile;
+
+    if(UpdateProfile(profile,OSMWays))
       {
-       if(!ExistsFile(translations))
-         {
-          fprintf(stderr,"Error: The '--translations' option specifies a file that does not exist.\n");
-          exit(EXIT_FAILURE);
-         }
+       fprintf(stderr,"Error: Profile is invalid or not compatible with database.\n");
+       exit(EXIT_FAILURE);
       }
-    else
+
+    load_contraction(dirname,prefix,profile,quickest);
+    load_landmarks(dirname,prefix,profile,quickest);
+
+    info.profile=profile;
+    info.quickest=quickest;
+    info.heading=heading;
+    info.exactnodes=exactnodes;
+    info.printnodes=batchnodes;
+
+    option_quiet=1;
+
+    load_costs(profile,quickest);
+
+    return(run_batch(batch,batchthreads,&info));
+   }
+
+ /* Calculate a matrix of routes between two sets of points if requested */
+
+ if(matrix)
+   {
+    for(point=1;point<=NWAYPOINTS;point++)
+       if(point_used[point])
+          print_usage(0,NULL,"Waypoints cannot be given on the command line with the '--matrix' option.");
+
+    if(!OSMNodes)
+       load_database(dirname,prefix);
+
+    if(UpdateProfile(profile,OSMWays))
       {
-       if(ExistsFile(FileName(dirname,prefix,"translations.xml")))
-          translations=FileName(dirname,prefix,"translations.xml");
-       else if(ExistsFile(FileName(DATADIR,NULL,"translations.xml")))
-          translations=FileName(DATADIR,NULL,"translations.xml");
-       else
-         {
-          fprintf(stderr,"Error: The '--translations' option was not used and the default 'translations.xml' does not exist.\n");
-          exit(EXIT_FAILURE);
-         }
+       fprintf(stderr,"Error: Profile is invalid or not compatible with database.\n");
+       exit(EXIT_FAILURE);
       }
 
-    if(ParseXMLTranslations(translations,language))
+    option_quiet=1;
+
+    return(run_matrix(matrix,matrixtargets,matrixbinary,profile,quickest,exactnodes));
+   }
+
+ /* Calculate the nodes that can be reached from a point within a budget if requested */
+
+ if(isochronetime>0 || isochronedistance>0)
+   {
+    score_t budget;
+
+    if(batch || matrix)
+       print_usage(0,NULL,"The '--isochrone-...' options cannot be used with the '--batch' or '--matrix' options.");
+
+    if(isochronetime>0 && isochronedistance>0)
+       print_usage(0,NULL,"The '--isochrone-time' and '--isochrone-distance' options cannot be used together.");
+
+    if(point_used[1]!=3)
+       print_usage(0,NULL,"The start point must be given as the first waypoint with the '--isochrone-...' options.");
+
+    for(point=2;point<=NWAYPOINTS;point++)
+       if(point_used[point])
+          print_usage(0,NULL,"Only one waypoint can be given with the '--isochrone-...' options.");
+
+    if(!OSMNodes)
+       load_database(dirname,prefix);
+
+    if(UpdateProfile(profile,OSMWays))
       {
-       fprintf(stderr,"Error: Cannot read the translations in the file '%s'.\n",translations);
+       fprintf(stderr,"Error: Profile is invalid or not compatible with database.\n");
        exit(EXIT_FAILURE);
       }
+
+    if(isochronetime>0)
+      {
+       quickest=1;
+       budget=(score_t)hours_to_duration(isochronetime/60);
+      }
+    else
+      {
+       quickest=0;
+       budget=(score_t)km_to_distance(isochronedistance);
+      }
+
+    option_quiet=1;
+
+    return(run_isochrone(point_lon[1],point_lat[1],heading,profile,quickest,budget,isochronehull,exactnodes));
    }
 
- /* Load in the data - Note: No error checking because Load*List() will call exit() in case of an error. */
+ /* Load in the translations */
 
- OSMNodes=LoadNodeList(FileName(dirname,prefix,"nodes.mem"));
+ if(option_html==0 && option_gpx_track==0 && option_gpx_route==0 && option_text==0 && option_text_all==0 && option_none==0)
+    option_html=option_gpx_track=option_gpx_route=option_text=option_text_all=1;
 
- OSMSegments=LoadSegmentList(FileName(dirname,prefix,"segments.mem"));
+ if(option_html || option_gpx_route || option_gpx_track)
+   {
+    if(!loaded_translations)
+       load_translations(dirname,prefix,translations,language);
+    else if(language && (!loaded_language || strcmp(language,loaded_language)))
+      {
+       if(ParseXMLTranslations(loaded_translations,language))
+         {
+          fprintf(stderr,"Error: Cannot read the translations in the file '%s'.\n",loaded_translations);
+          exit(EXIT_FAILURE);
+         }
+      }
+   }
+ else if(loaded_translations)
+   {
+    /* A server has loaded the translations but without them the text output has the built-in header */
+
+    translate_raw_copyright_creator[0]=default_raw_copyright_creator[0];
+    translate_raw_copyright_creator[1]=default_raw_copyright_creator[1];
+    translate_raw_copyright_source[0] =default_raw_copyright_source[0];
+    translate_raw_copyright_source[1] =default_raw_copyright_source[1];
+    translate_raw_copyright_license[0]=default_raw_copyright_license[0];
+    translate_raw_copyright_license[1]=default_raw_copyright_license[1];
+   }
 
- OSMWays=LoadWayList(FileName(dirname,prefix,"ways.mem"));
+ /* Load in the data (unless a server has already done it) */
 
- OSMRelations=LoadRelationList(FileName(dirname,prefix,"relations.mem"));
+ if(!OSMNodes)
+    load_database(dirname,prefix);
 
  if(UpdateProfile(profile,OSMWays))
    {
@@ -434,15 +712,23 @@ int main(int argc,char** argv)
     exit(EXIT_FAILURE);
    }
 
+ load_contraction(dirname,prefix,profile,quickest);
+ load_landmarks(dirname,prefix,profile,quickest);
+ load_costs(profile,quickest);
+
+ /* Create the query state */
+
+ query=NewQuery(quickest);
+
  /* Loop through all pairs of points */
 
  for(point=1;point<=NWAYPOINTS;point++)
    {
-    Results *begin,*end;
     distance_t distmax=km_to_distance(MAXSEARCH);
     distance_t distmin;
     index_t segment=NO_SEGMENT;
     index_t node1,node2;
+    const char *error;
 
     if(point_used[point]!=3)
        continue;
@@ -462,7 +748,7 @@ int main(int argc,char** argv)
        segment=FindClosestSegment(OSMNodes,OSMSegments,OSMWays,point_lat[point],point_lon[point],distmax,profile,&distmin,&node1,&node2,&dist1,&dist2);
 
        if(segment!=NO_SEGMENT)
-          finish_node=CreateFakes(OSMNodes,OSMSegments,point,LookupSegment(OSMSegments,segment,1),node1,node2,dist1,dist2);
+          finish_node=CreateFakes(query,OSMNodes,OSMSegments,point,LookupSegment(OSMSegments,segment,1),node1,node2,dist1,dist2);
        else
           finish_node=NO_NODE;
       }
@@ -478,7 +764,7 @@ int main(int argc,char** argv)
        double lat,lon;
 
        if(IsFakeNode(finish_node))
-          GetFakeLatLong(finish_node,&lat,&lon);
+          GetFakeLatLong(query,finish_node,&lat,&lon);
        else
           GetLatLong(OSMNodes,finish_node,NULL,&lat,&lon);
 
@@ -497,97 +783,16 @@ int main(int argc,char** argv)
        continue;
 
     if(heading!=-999 && join_segment==NO_SEGMENT)
-       join_segment=FindClosestSegmentHeading(OSMNodes,OSMSegments,OSMWays,start_node,heading,profile);
-
-    /* Calculate the beginning of the route */
-
-    begin=FindStartRoutes(OSMNodes,OSMSegments,OSMWays,OSMRelations,profile,start_node,join_segment,finish_node);
-
-    if(begin)
-      {
-       /* Check if the end of the route was reached */
+       join_segment=FindClosestSegmentHeading(query,OSMNodes,OSMSegments,OSMWays,start_node,heading,profile);
 
-       if(begin->finish_node!=NO_NODE)
-          results[point]=ExtendStartRoutes(OSMNodes,OSMSegments,OSMWays,OSMRelations,profile,begin,finish_node);
-      }
-    else
-      {
-       if(join_segment!=NO_SEGMENT)
-         {
-          /* Try again but allow a U-turn at the start waypoint -
-             this solves the problem of facing a dead-end that contains no super-nodes. */
-
-          join_segment=NO_SEGMENT;
-
-          begin=FindStartRoutes(OSMNodes,OSMSegments,OSMWays,OSMRelations,profile,start_node,join_segment,finish_node);
-         }
-
-       if(begin)
-         {
-          /* Check if the end of the route was reached */
-
-          if(begin->finish_node!=NO_NODE)
-             results[point]=ExtendStartRoutes(OSMNodes,OSMSegments,OSMWays,OSMRelations,profile,begin,finish_node);
-         }
-       else
-         {
-          fprintf(stderr,"Error: Cannot find initial section of route compatible with profile.\n");
-          exit(EXIT_FAILURE);
-         }
-      }
+    /* Calculate the route */
 
-    /* Calculate the rest of the route */
+    results[point]=calculate_route(query,OSMNodes,OSMSegments,OSMWays,OSMRelations,profile,start_node,join_segment,finish_node,&error);
 
     if(!results[point])
       {
-       Results *middle;
-
-       /* Calculate the end of the route */
-
-       end=FindFinishRoutes(OSMNodes,OSMSegments,OSMWays,OSMRelations,profile,finish_node);
-
-       if(!end)
-         {
-          fprintf(stderr,"Error: Cannot find final section of route compatible with profile.\n");
-          exit(EXIT_FAILURE);
-         }
-
-       /* Calculate the middle of the route */
-
-       middle=FindMiddleRoute(OSMNodes,OSMSegments,OSMWays,OSMRelations,profile,begin,end);
-
-       if(!middle && join_segment!=NO_SEGMENT)
-         {
-          /* Try again but allow a U-turn at the start waypoint -
-             this solves the problem of facing a dead-end that contains some super-nodes. */
-
-          FreeResultsList(begin);
-
-          begin=FindStartRoutes(OSMNodes,OSMSegments,OSMWays,OSMRelations,profile,start_node,NO_SEGMENT,finish_node);
-
-          if(begin)
-             middle=FindMiddleRoute(OSMNodes,OSMSegments,OSMWays,OSMRelations,profile,begin,end);
-         }
-
-       FreeResultsList(end);
-
-       if(!middle)
-         {
-          fprintf(stderr,"Error: Cannot find super-route compatible with profile.\n");
-          exit(EXIT_FAILURE);
-         }
-
-       results[point]=CombineRoutes(OSMNodes,OSMSegments,OSMWays,OSMRelations,profile,begin,middle);
-
-       if(!results[point])
-         {
-          fprintf(stderr,"Error: Cannot create combined route following super-route.\n");
-          exit(EXIT_FAILURE);
-         }
-
-       FreeResultsList(begin);
-
-       FreeResultsList(middle);
+       fprintf(stderr,"Error: %s.\n",error);
+       exit(EXIT_FAILURE);
       }
 
 #if DEBUG
@@ -615,7 +820,7 @@ int main(int argc,char** argv)
  /* Print out the combined route */
 
  if(!option_none)
-    PrintRoute(results,NWAYPOINTS,OSMNodes,OSMSegments,OSMWays,profile);
+    PrintRoute(query,results,NWAYPOINTS,OSMNodes,OSMSegments,OSMWays,profile);
 
  /* Destroy the remaining results lists and data structures */
 
@@ -630,6 +835,8 @@ int main(int argc,char** argv)
  DestroyWayList(OSMWays);
  DestroyRelationList(OSMRelations);
 
+ FreeQuery(query);
+
 #endif
 
  return(0);
@@ -637,11 +844,1394 @@ int main(int argc,char** argv)
 
 
 /*++++++++++++++++++++++++++++++++++++++
-  Print out the usage information.
+  Parse one of the routing options that modify the profile or the type of route.
 
-  int detail The level of detail to use - 0 = low, 1 = high.
+  int parse_routing_option Returns 0 if the option was understood or 1 otherwise.
 
-  const char *argerr The argument that gave the error (if there is one).
+  const char *arg The option to parse.
+
+  Profile *profile The profile to modify.
+
+  int *quickest Set to 1 for the quickest route or 0 for the shortest.
+
+  double *heading Set to the starting heading (if the option is for the heading).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int parse_routing_option(const char *arg,Profile *profile,int *quickest,double *heading)
+{
+ if(!strcmp(arg,"--shortest"))
+    *quickest=0;
+ else if(!strcmp(arg,"--quickest"))
+    *quickest=1;
+ else if(!strncmp(arg,"--heading=",10))
+   {
+    double h=atof(&arg[10]);
+
+    if(h>=-360 && h<=360)
+      {
+       *heading=h;
+
+       if(*heading<0) *heading+=360;
+      }
+   }
+ else if(!strncmp(arg,"--highway-",10))
+   {
+    Highway highway;
+    const char *equal=strchr(arg,'=');
+    char *string;
+
+    if(!equal)
+       return(1);
+
+    string=strcpy((char*)malloc(strlen(arg)),arg+10);
+    string[equal-arg-10]=0;
+
+    highway=HighwayType(string);
+
+    free(string);
+
+    if(highway==Highway_None)
+       return(1);
+
+    profile->highway[highway]=atof(equal+1);
+   }
+ else if(!strncmp(arg,"--speed-",8))
+   {
+    Highway highway;
+    const char *equal=strchr(arg,'=');
+    char *string;
+
+    if(!equal)
+       return(1);
+
+    string=strcpy((char*)malloc(strlen(arg)),arg+8);
+    string[equal-arg-8]=0;
+
+    highway=HighwayType(string);
+
+    free(string);
+
+    if(highway==Highway_None)
+       return(1);
+
+    profile->speed[highway]=kph_to_speed(atof(equal+1));
+   }
+ else if(!strncmp(arg,"--property-",11))
+   {
+    Property property;
+    const char *equal=strchr(arg,'=');
+    char *string;
+
+    if(!equal)
+       return(1);
+
+    string=strcpy((char*)malloc(strlen(arg)),arg+11);
+    string[equal-arg-11]=0;
+
+    property=PropertyType(string);
+
+    free(string);
+
+    if(property==Property_None)
+       return(1);
+
+    profile->props_yes[property]=atof(equal+1);
+   }
+ else if(!strncmp(arg,"--oneway=",9))
+    profile->oneway=!!atoi(&arg[9]);
+ else if(!strncmp(arg,"--turns=",8))
+    profile->turns=!!atoi(&arg[8]);
+ else if(!strncmp(arg,"--weight=",9))
+    profile->weight=tonnes_to_weight(atof(&arg[9]));
+ else if(!strncmp(arg,"--height=",9))
+    profile->height=metres_to_height(atof(&arg[9]));
+ else if(!strncmp(arg,"--width=",8))
+    profile->width=metres_to_width(atof(&arg[8]));
+ else if(!strncmp(arg,"--length=",9))
+    profile->length=metres_to_length(atof(&arg[9]));
+ else
+    return(1);
+
+ return(0);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Calculate a route between two nodes (one leg of the complete route).
+
+  Results *calculate_route Returns the route or NULL if there was an error.
+
+  Query *query The query containing the routing options and the fake nodes and segments.
+
+  Nodes *nodes The set of nodes to use.
+
+  Segments *segments The set of segments to use.
+
+  Ways *ways The set of ways to use.
+
+  Relations *relations The set of relations to use.
+
+  Profile *profile The profile containing the transport type, speeds and allowed highways.
+
+  index_t start_node The start node.
+
+  index_t prev_segment The previous segment before the start node.
+
+  index_t finish_node The finish node.
+
+  const char **error Returns the error message if there is an error.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static Results *calculate_route(Query *query,Nodes *nodes,Segments *segments,Ways *ways,Relations *relations,Profile *profile,
+                                index_t start_node,index_t prev_segment,index_t finish_node,const char **error)
+{
+ Results *results=NULL,*begin,*middle,*end;
+
+ /* Use the precalculated segment scores if they are for this profile */
+
+ if(OSMCosts && SegmentCostsMatchProfile(OSMCosts,profile,query->quickest))
+    query->costs=OSMCosts;
+ else
+    query->costs=NULL;
+
+ /* Calculate the beginning of the route */
+
+ begin=FindStartRoutes(query,nodes,segments,ways,relations,profile,start_node,prev_segment,finish_node);
+
+ if(!begin && prev_segment!=NO_SEGMENT)
+   {
+    /* Try again but allow a U-turn at the start waypoint -
+       this solves the problem of facing a dead-end that contains no super-nodes. */
+
+    prev_segment=NO_SEGMENT;
+
+    begin=FindStartRoutes(query,nodes,segments,ways,relations,profile,start_node,prev_segment,finish_node);
+   }
+
+ if(!begin)
+   {
+    *error="Cannot find initial section of route compatible with profile";
+    return(NULL);
+   }
+
+ /* Check if the end of the route was reached */
+
+ if(begin->finish_node!=NO_NODE)
+    results=ExtendStartRoutes(query,nodes,segments,ways,relations,profile,begin,finish_node);
+
+ if(results)
+    return(results);
+
+ /* Calculate the end of the route */
+
+ end=FindFinishRoutes(query,nodes,segments,ways,relations,profile,finish_node);
+
+ if(!end)
+   {
+    FreeResultsList(begin);
+
+    *error="Cannot find final section of route compatible with profile";
+    return(NULL);
+   }
+
+ /* Calculate the middle of the route */
+
+ if(OSMContraction && ContractionMatchesProfile(OSMContraction,profile,query->quickest))
+    middle=FindMiddleRouteContracted(query,nodes,segments,ways,relations,profile,OSMContraction,begin,end);
+ else if(option_bidirectional)
+    middle=FindMiddleRouteBidirectional(query,nodes,segments,ways,relations,profile,begin,end);
+ else
+    middle=FindMiddleRoute(query,nodes,segments,ways,relations,profile,OSMLandmarks,begin,end);
+
+ if(!middle && prev_segment!=NO_SEGMENT)
+   {
+    /* Try again but allow a U-turn at the start waypoint -
+       this solves the problem of facing a dead-end that contains some super-nodes. */
+
+    FreeResultsList(begin);
+
+    begin=FindStartRoutes(query,nodes,segments,ways,relations,profile,start_node,NO_SEGMENT,finish_node);
+
+    if(begin)
+      {
+       if(OSMContraction && ContractionMatchesProfile(OSMContraction,profile,query->quickest))
+          middle=FindMiddleRouteContracted(query,nodes,segments,ways,relations,profile,OSMContraction,begin,end);
+       else if(option_bidirectional)
+          middle=FindMiddleRouteBidirectional(query,nodes,segments,ways,relations,profile,begin,end);
+       else
+          middle=FindMiddleRoute(query,nodes,segments,ways,relations,profile,OSMLandmarks,begin,end);
+      }
+   }
+
+ FreeResultsList(end);
+
+ if(!middle)
+   {
+    if(begin)
+       FreeResultsList(begin);
+
+    *error="Cannot find super-route compatible with profile";
+    return(NULL);
+   }
+
+ results=CombineRoutes(query,nodes,segments,ways,relations,profile,begin,middle);
+
+ FreeResultsList(begin);
+
+ FreeResultsList(middle);
+
+ if(!results)
+    *error="Cannot create combined route following super-route";
+
+ return(results);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Route all of the lines in a batch file and print one line of output for each of them.
+
+  int run_batch Returns the exit status for the program.
+
+  const char *filename The name of the batch file ("-" for standard input).
+
+  int nthreads The number of threads to use.
+
+  batch_info *info The information shared by all of the threads.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int run_batch(const char *filename,int nthreads,batch_info *info)
+{
+ FILE *file;
+ batch_thread *threads;
+ char *line=NULL;
+ size_t length=0;
+ int linenum=0,finished=0;
+ int i;
+
+ if(!strcmp(filename,"-"))
+    file=stdin;
+ else if(!(file=fopen(filename,"r")))
+   {
+    fprintf(stderr,"Error: Cannot open batch file '%s' for reading [%s].\n",filename,strerror(errno));
+    exit(EXIT_FAILURE);
+   }
+
+ info->lines   =(char**)malloc(BATCHBLOCK*sizeof(char*));
+ info->linenums=(int*)  malloc(BATCHBLOCK*sizeof(int));
+ info->outputs =(char**)malloc(BATCHBLOCK*sizeof(char*));
+
+ /* Each thread has its own copy of the database (slim mode caches are not shared) */
+
+ threads=(batch_thread*)malloc(nthreads*sizeof(batch_thread));
+
+ for(i=0;i<nthreads;i++)
+   {
+    threads[i].info=info;
+
+    threads[i].nodes    =DuplicateNodeList(OSMNodes);
+    threads[i].segments =DuplicateSegmentList(OSMSegments);
+    threads[i].ways     =DuplicateWayList(OSMWays);
+    threads[i].relations=DuplicateRelationList(OSMRelations);
+   }
+
+ /* Read in a block of lines, route them and print the results in order */
+
+ while(!finished)
+   {
+    info->nlines=0;
+    info->next=0;
+
+    while(info->nlines<BATCHBLOCK)
+      {
+       ssize_t n=getline(&line,&length,file);
+       char *p=line;
+
+       if(n<0)
+         {
+          finished=1;
+          break;
+         }
+
+       linenum++;
+
+       while(isspace(*p))
+          p++;
+
+       if(!*p || *p=='#')
+          continue;
+
+       info->lines[info->nlines]=strcpy((char*)malloc(strlen(p)+1),p);
+       info->linenums[info->nlines]=linenum;
+       info->nlines++;
+      }
+
+#if defined(USE_PTHREADS) && USE_PTHREADS
+
+    if(nthreads>1)
+      {
+       for(i=0;i<nthreads;i++)
+          pthread_create(&threads[i].thread,NULL,(void* (*)(void*))batch_routes,&threads[i]);
+
+       for(i=0;i<nthreads;i++)
+          pthread_join(threads[i].thread,NULL);
+      }
+    else
+
+#endif
+
+       batch_routes(&threads[0]);
+
+    for(i=0;i<info->nlines;i++)
+      {
+       printf("%d\t%s\n",info->linenums[i],info->outputs[i]);
+
+       free(info->lines[i]);
+       free(info->outputs[i]);
+      }
+
+    fflush(stdout);
+   }
+
+ if(file!=stdin)
+    fclose(file);
+
+ if(line)
+    free(line);
+
+ for(i=0;i<nthreads;i++)
+   {
+    DestroyDuplicateNodeList(threads[i].nodes);
+    DestroyDuplicateSegmentList(threads[i].segments);
+    DestroyDuplicateWayList(threads[i].ways);
+    DestroyDuplicateRelationList(threads[i].relations);
+   }
+
+ free(threads);
+
+ free(info->lines);
+ free(info->linenums);
+ free(info->outputs);
+
+ return(0);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Route lines from the batch file until there are none left (runs in each thread).
+
+  void *batch_routes Returns NULL (required to be used as a thread function).
+
+  batch_thread *thread The information for this thread.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void *batch_routes(batch_thread *thread)
+{
+ batch_info *info=thread->info;
+
+ while(1)
+   {
+    int next;
+
+#if defined(USE_PTHREADS) && USE_PTHREADS
+    pthread_mutex_lock(&batch_mutex);
+#endif
+
+    next=info->next++;
+
+#if defined(USE_PTHREADS) && USE_PTHREADS
+    pthread_mutex_unlock(&batch_mutex);
+#endif
+
+    if(next>=info->nlines)
+       break;
+
+    info->outputs[next]=batch_route(thread,info->lines[next]);
+   }
+
+ return(NULL);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Route one line of a batch file; the line contains pairs of longitude and latitude
+  (in degrees) and optional routing options that apply to this line only.
+
+  char *batch_route Returns an allocated string containing the status, distance (km),
+                    duration (minutes) and optionally the list of nodes.
+
+  batch_thread *thread The information for this thread.
+
+  char *line The line to route (modified).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static char *batch_route(batch_thread *thread,char *line)
+{
+ batch_info *info=thread->info;
+ Profile lineprofile,*profile=info->profile;
+ Results *results[NWAYPOINTS+1]={NULL};
+ double point_lon[NWAYPOINTS+1],point_lat[NWAYPOINTS+1];
+ char *tokens[BATCHTOKENS],*saveptr=NULL,*token;
+ char *nodelist=NULL,*output;
+ size_t nodelistlen=0;
+ int ntokens=0,npoints=0,nvalues=0,noptions=0;
+ int quickest=info->quickest;
+ double heading=info->heading;
+ const char *status="OK";
+ index_t start_node=NO_NODE,finish_node=NO_NODE;
+ index_t join_segment=NO_SEGMENT;
+ distance_t distance=0;
+ duration_t duration=0;
+ Query *query;
+ int i,point;
+
+ /* Split the line into waypoints and options */
+
+ for(token=strtok_r(line," \t\r\n",&saveptr);token;token=strtok_r(NULL," \t\r\n",&saveptr))
+   {
+    if(ntokens==BATCHTOKENS)
+       return(strcpy((char*)malloc(16),"BAD-LINE\t-\t-"));
+
+    tokens[ntokens++]=token;
+   }
+
+ /* Select the profile and apply any options for this line */
+
+ for(i=0;i<ntokens;i++)
+    if(!strncmp(tokens[i],"--profile=",10) || !strncmp(tokens[i],"--transport=",12))
+      {
+       Profile *base;
+
+       if(tokens[i][2]=='p')
+          base=GetProfile(&tokens[i][10]);
+       else
+          base=GetProfile(TransportName(TransportType(&tokens[i][12])));
+
+       if(!base)
+          return(strcpy((char*)malloc(16),"BAD-LINE\t-\t-"));
+
+       if(base==info->selected)
+          lineprofile=info->rawprofile;
+       else
+          lineprofile=*base;
+
+       noptions++;
+      }
+
+ for(i=0;i<ntokens;i++)
+   {
+    token=tokens[i];
+
+    if(isdigit(token[0]) || ((token[0]=='-' || token[0]=='+' || token[0]=='.') && isdigit(token[1])))
+      {
+       if(nvalues==2*NWAYPOINTS)
+          return(strcpy((char*)malloc(16),"BAD-LINE\t-\t-"));
+
+       if(nvalues%2)
+          point_lat[++npoints]=degrees_to_radians(atof(token));
+       else
+          point_lon[npoints+1]=degrees_to_radians(atof(token));
+
+       nvalues++;
+      }
+    else if(!strncmp(token,"--profile=",10) || !strncmp(token,"--transport=",12))
+       ; /* Done this already */
+    else
+      {
+       if(noptions==0)
+          lineprofile=info->rawprofile;
+
+       if(parse_routing_option(token,&lineprofile,&quickest,&heading))
+          return(strcpy((char*)malloc(16),"BAD-LINE\t-\t-"));
+
+       noptions++;
+      }
+   }
+
+ if(nvalues%2 || npoints<2)
+    return(strcpy((char*)malloc(16),"BAD-LINE\t-\t-"));
+
+ if(noptions)
+   {
+    if(UpdateProfile(&lineprofile,thread->ways))
+       return(strcpy((char*)malloc(16),"BAD-LINE\t-\t-"));
+
+    profile=&lineprofile;
+   }
+
+ /* Route between each pair of points */
+
+ query=NewQuery(quickest);
+
+ for(point=1;point<=npoints;point++)
+   {
+    distance_t distmax=km_to_distance(MAXSEARCH);
+    distance_t distmin;
+    const char *error;
+
+    start_node=finish_node;
+
+    if(info->exactnodes)
+       finish_node=FindClosestNode(thread->nodes,thread->segments,thread->ways,point_lat[point],point_lon[point],distmax,profile,&distmin);
+    else
+      {
+       distance_t dist1,dist2;
+       index_t segment,node1,node2;
+
+       segment=FindClosestSegment(thread->nodes,thread->segments,thread->ways,point_lat[point],point_lon[point],distmax,profile,&distmin,&node1,&node2,&dist1,&dist2);
+
+       if(segment!=NO_SEGMENT)
+          finish_node=CreateFakes(query,thread->nodes,thread->segments,point,LookupSegment(thread->segments,segment,1),node1,node2,dist1,dist2);
+       else
+          finish_node=NO_NODE;
+      }
+
+    if(finish_node==NO_NODE)
+      {
+       status="NO-POINT";
+       break;
+      }
+
+    if(start_node==NO_NODE || start_node==finish_node)
+       continue;
+
+    if(heading!=-999 && join_segment==NO_SEGMENT)
+       join_segment=FindClosestSegmentHeading(query,thread->nodes,thread->segments,thread->ways,start_node,heading,profile);
+
+    results[point]=calculate_route(query,thread->nodes,thread->segments,thread->ways,thread->relations,profile,start_node,join_segment,finish_node,&error);
+
+    if(!results[point])
+      {
+       status="NO-ROUTE";
+       break;
+      }
+
+    join_segment=results[point]->last_segment;
+   }
+
+ /* Add up the distance and duration and make the list of nodes */
+
+ for(point=1;point<=npoints;point++)
+    if(results[point])
+      {
+       Result *result=FindResult(results[point],results[point]->start_node,results[point]->prev_segment);
+
+       if(!strcmp(status,"OK"))
+         {
+          if(info->printnodes && !nodelist && !IsFakeNode(result->node))
+            {
+             nodelist=(char*)malloc(nodelistlen+24);
+             nodelistlen=sprintf(nodelist,"\t%"Pindex_t,result->node);
+            }
+
+          for(result=result->next;result;result=result->next)
+            {
+             Segment *segmentp;
+             Way *wayp;
+             speed_t speed;
+
+             if(IsFakeSegment(result->segment))
+                segmentp=LookupFakeSegment(query,result->segment);
+             else
+                segmentp=LookupSegment(thread->segments,result->segment,1);
+
+             wayp=LookupWay(thread->ways,segmentp->way,1);
+
+             distance+=DISTANCE(segmentp->distance);
+
+             if(result->node==segmentp->node1)
+                duration+=Duration(segmentp->node2,segmentp,wayp,profile,&speed);
+             else
+                duration+=Duration(segmentp->node1,segmentp,wayp,profile,&speed);
+
+             if(info->printnodes && !IsFakeNode(result->node))
+               {
+                nodelist=(char*)realloc((void*)nodelist,nodelistlen+24);
+                nodelistlen+=sprintf(nodelist+nodelistlen,"%c%"Pindex_t,nodelistlen?',':'\t',result->node);
+               }
+            }
+         }
+
+       FreeResultsList(results[point]);
+      }
+
+ FreeQuery(query);
+
+ /* Create the output */
+
+ if(strcmp(status,"OK"))
+   {
+    if(nodelist)
+       free(nodelist);
+
+    output=(char*)malloc(strlen(status)+8);
+    sprintf(output,"%s\t-\t-",status);
+   }
+ else
+   {
+    output=(char*)malloc(64+nodelistlen);
+    sprintf(output,"%s\t%.3f\t%.1f%s",status,distance_to_km(distance),duration_to_minutes(duration),nodelist?nodelist:"");
+
+    if(nodelist)
+       free(nodelist);
+   }
+
+ return(output);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Calculate the matrix of distances and durations from a set of source points to a set of target points and print it.
+
+  int run_matrix Returns the exit status for the program.
+
+  const char *sourcesfile The name of the file containing the source points.
+
+  const char *targetsfile The name of the file containing the target points (or NULL to use the source points).
+
+  int binary Set to print the matrix in binary instead of CSV.
+
+  Profile *profile The profile containing the transport type, speeds and allowed highways.
+
+  int quickest Set to calculate the quickest routes instead of the shortest.
+
+  int exactnodes Set to route between the closest nodes instead of the closest points on segments.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int run_matrix(const char *sourcesfile,const char *targetsfile,int binary,Profile *profile,int quickest,int exactnodes)
+{
+ MatrixPoint *sources,*targets;
+ distance_t *distances;
+ duration_t *durations;
+ int nsources,ntargets;
+ int s,t;
+
+ nsources=read_matrix_points(sourcesfile,profile,exactnodes,&sources);
+
+ if(targetsfile)
+    ntargets=read_matrix_points(targetsfile,profile,exactnodes,&targets);
+ else
+   {
+    targets=sources;
+    ntargets=nsources;
+   }
+
+ distances=(distance_t*)malloc(nsources*ntargets*sizeof(distance_t));
+ durations=(duration_t*)malloc(nsources*ntargets*sizeof(duration_t));
+
+ CalculateMatrix(OSMNodes,OSMSegments,OSMWays,OSMRelations,profile,quickest,sources,nsources,targets,ntargets,distances,durations);
+
+ if(binary)
+   {
+    /* The number of sources and targets followed by the distances (km) and then the durations (minutes) as floats */
+
+    uint32_t header[2];
+    float *values=(float*)malloc(nsources*ntargets*sizeof(float));
+
+    header[0]=nsources;
+    header[1]=ntargets;
+
+    fwrite(header,sizeof(uint32_t),2,stdout);
+
+    for(s=0;s<nsources*ntargets;s++)
+       values[s]=(distances[s]==INF_DISTANCE)?-1:distance_to_km(distances[s]);
+
+    fwrite(values,sizeof(float),nsources*ntargets,stdout);
+
+    for(s=0;s<nsources*ntargets;s++)
+       values[s]=(distances[s]==INF_DISTANCE)?-1:duration_to_minutes(durations[s]);
+
+    fwrite(values,sizeof(float),nsources*ntargets,stdout);
+
+    free(values);
+   }
+ else
+   {
+    printf("source,target,distance,duration\n");
+
+    for(s=0;s<nsources;s++)
+       for(t=0;t<ntargets;t++)
+         {
+          if(distances[s*ntargets+t]==INF_DISTANCE)
+             printf("%d,%d,,\n",s+1,t+1);
+          else
+             printf("%d,%d,%.3f,%.1f\n",s+1,t+1,distance_to_km(distances[s*ntargets+t]),duration_to_minutes(durations[s*ntargets+t]));
+         }
+   }
+
+ if(targets!=sources)
+    free(targets);
+ free(sources);
+
+ free(distances);
+ free(durations);
+
+ return(0);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Read the points for the matrix from a file (one longitude and latitude pair in degrees per line) and find the
+  closest node or segment to each of them.
+
+  int read_matrix_points Returns the number of points.
+
+  const char *filename The name of the file ("-" for standard input).
+
+  Profile *profile The profile containing the transport type, speeds and allowed highways.
+
+  int exactnodes Set to find the closest nodes instead of the closest points on segments.
+
+  MatrixPoint **points Returns the allocated array of points.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int read_matrix_points(const char *filename,Profile *profile,int exactnodes,MatrixPoint **points)
+{
+ FILE *file;
+ char *line=NULL;
+ size_t length=0;
+ int linenum=0,npoints=0;
+
+ if(!strcmp(filename,"-"))
+    file=stdin;
+ else if(!(file=fopen(filename,"r")))
+   {
+    fprintf(stderr,"Error: Cannot open matrix file '%s' for reading [%s].\n",filename,strerror(errno));
+    exit(EXIT_FAILURE);
+   }
+
+ *points=NULL;
+
+ while(getline(&line,&length,file)>=0)
+   {
+    distance_t distmax=km_to_distance(MAXSEARCH);
+    distance_t distmin;
+    MatrixPoint *point;
+    double lon,lat;
+    char *p=line;
+
+    linenum++;
+
+    while(isspace(*p))
+       p++;
+
+    if(!*p || *p=='#')
+       continue;
+
+    if(sscanf(p,"%lf %lf",&lon,&lat)!=2)
+      {
+       fprintf(stderr,"Error: Cannot read longitude and latitude on line %d of '%s'.\n",linenum,filename);
+       exit(EXIT_FAILURE);
+      }
+
+    if(!(npoints%256))
+       *points=(MatrixPoint*)realloc((void*)*points,(npoints+256)*sizeof(MatrixPoint));
+
+    point=&(*points)[npoints++];
+
+    lon=degrees_to_radians(lon);
+    lat=degrees_to_radians(lat);
+
+    point->node=NO_NODE;
+    point->segment=NO_SEGMENT;
+
+    if(exactnodes)
+       point->node=FindClosestNode(OSMNodes,OSMSegments,OSMWays,lat,lon,distmax,profile,&distmin);
+    else
+       point->segment=FindClosestSegment(OSMNodes,OSMSegments,OSMWays,lat,lon,distmax,profile,&distmin,
+                                         &point->node1,&point->node2,&point->dist1,&point->dist2);
+   }
+
+ if(file!=stdin)
+    fclose(file);
+
+ if(line)
+    free(line);
+
+ return(npoints);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Find the nodes that can be reached from a point within a distance or duration budget and print them (or a hull
+  around them).
+
+  int run_isochrone Returns the exit status for the program.
+
+  double lon The longitude of the start point.
+
+  double lat The latitude of the start point.
+
+  double heading The initial heading (or -999 if there is none).
+
+  Profile *profile The profile containing the transport type, speeds and allowed highways.
+
+  int quickest Set if the budget is a duration or zero if it is a distance.
+
+  score_t budget The maximum distance or duration.
+
+  int hull Set to print a polygon around the nodes instead of the nodes.
+
+  int exactnodes Set to start from the closest node instead of the closest point on a segment.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int run_isochrone(double lon,double lat,double heading,Profile *profile,int quickest,score_t budget,int hull,int exactnodes)
+{
+ distance_t distmax=km_to_distance(MAXSEARCH);
+ distance_t distmin;
+ index_t start_node,prev_segment=NO_SEGMENT;
+ Query *query;
+ Results *results;
+ IsochroneNode *isonodes;
+ int nisonodes,i;
+
+ query=NewQuery(quickest);
+
+ /* Find the closest point */
+
+ if(exactnodes)
+    start_node=FindClosestNode(OSMNodes,OSMSegments,OSMWays,lat,lon,distmax,profile,&distmin);
+ else
+   {
+    index_t segment,node1,node2;
+    distance_t dist1,dist2;
+
+    segment=FindClosestSegment(OSMNodes,OSMSegments,OSMWays,lat,lon,distmax,profile,&distmin,&node1,&node2,&dist1,&dist2);
+
+    if(segment!=NO_SEGMENT)
+       start_node=CreateFakes(query,OSMNodes,OSMSegments,1,LookupSegment(OSMSegments,segment,1),node1,node2,dist1,dist2);
+    else
+       start_node=NO_NODE;
+   }
+
+ if(start_node==NO_NODE)
+   {
+    fprintf(stderr,"Error: Cannot find node close to specified point 1.\n");
+    exit(EXIT_FAILURE);
+   }
+
+ if(heading!=-999)
+    prev_segment=FindClosestSegmentHeading(query,OSMNodes,OSMSegments,OSMWays,start_node,heading,profile);
+
+ /* Find the nodes */
+
+ results=FindIsochrone(query,OSMNodes,OSMSegments,OSMWays,OSMRelations,profile,start_node,prev_segment,budget);
+
+ nisonodes=IsochroneNodes(results,&isonodes);
+
+ FreeResultsList(results);
+
+ /* Print the nodes or the hull */
+
+ if(hull)
+   {
+    double hull_lat[ISOCHRONE_SECTORS],hull_lon[ISOCHRONE_SECTORS];
+    int nhull=IsochroneHull(query,OSMNodes,start_node,isonodes,nisonodes,hull_lat,hull_lon);
+
+    for(i=0;i<nhull;i++)
+       printf("%.6f %.6f\n",radians_to_degrees(hull_lon[i]),radians_to_degrees(hull_lat[i]));
+
+    if(nhull>0)
+       printf("%.6f %.6f\n",radians_to_degrees(hull_lon[0]),radians_to_degrees(hull_lat[0]));
+   }
+ else
+    for(i=0;i<nisonodes;i++)
+      {
+       double node_lat,node_lon;
+
+       GetLatLong(OSMNodes,isonodes[i].node,NULL,&node_lat,&node_lon);
+
+       if(quickest)
+          printf("%"Pindex_t"\t%.6f\t%.6f\t%.2f\n",isonodes[i].node,radians_to_degrees(node_lon),radians_to_degrees(node_lat),
+                 duration_to_minutes(isonodes[i].score));
+       else
+          printf("%"Pindex_t"\t%.6f\t%.6f\t%.3f\n",isonodes[i].node,radians_to_degrees(node_lon),radians_to_degrees(node_lat),
+                 distance_to_km(isonodes[i].score));
+      }
+
+ free(isonodes);
+
+ FreeQuery(query);
+
+ return(0);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Find and load the translations file.
+
+  const char *dirname The directory name from the command line.
+
+  const char *prefix The file name prefix from the command line.
+
+  char *translations The translations file name from the command line (or NULL).
+
+  char *language The language from the command line (or NULL).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void load_translations(const char *dirname,const char *prefix,char *translations,char *language)
+{
+ if(translations)
+   {
+    if(!ExistsFile(translations))
+      {
+       fprintf(stderr,"Error: The '--translations' option specifies a file that does not exist.\n");
+       exit(EXIT_FAILURE);
+      }
+   }
+ else
+   {
+    if(ExistsFile(FileName(dirname,prefix,"translations.xml")))
+       translations=FileName(dirname,prefix,"translations.xml");
+    else if(ExistsFile(FileName(DATADIR,NULL,"translations.xml")))
+       translations=FileName(DATADIR,NULL,"translations.xml");
+    else
+      {
+       fprintf(stderr,"Error: The '--translations' option was not used and the default 'translations.xml' does not exist.\n");
+       exit(EXIT_FAILURE);
+      }
+   }
+
+ if(ParseXMLTranslations(translations,language))
+   {
+    fprintf(stderr,"Error: Cannot read the translations in the file '%s'.\n",translations);
+    exit(EXIT_FAILURE);
+   }
+
+ loaded_translations=translations;
+ loaded_language=language;
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Load in the routing database.
+
+  const char *dirname The directory name from the command line.
+
+  const char *prefix The file name prefix from the command line.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void load_database(const char *dirname,const char *prefix)
+{
+ /* Note: No error checking because Load*List() will call exit() in case of an error. */
+
+ OSMNodes=LoadNodeList(FileName(dirname,prefix,"nodes.mem"));
+
+ OSMSegments=LoadSegmentList(FileName(dirname,prefix,"segments.mem"));
+
+ OSMWays=LoadWayList(FileName(dirname,prefix,"ways.mem"));
+
+ OSMRelations=LoadRelationList(FileName(dirname,prefix,"relations.mem"));
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Load in the contraction hierarchy for the profile if requested (a warning is printed if it cannot be used).
+
+  const char *dirname The directory name from the command line.
+
+  const char *prefix The file name prefix from the command line.
+
+  Profile *profile The profile (after UpdateProfile() has been called).
+
+  int quickest Set for the quickest route.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void load_contraction(const char *dirname,const char *prefix,Profile *profile,int quickest)
+{
+ Contraction *contraction=NULL;
+ char *filename;
+
+ if(!option_contracted || OSMContraction)
+    return;
+
+ if(!profile->name)
+   {
+    fprintf(stderr,"Warning: The contraction hierarchy cannot be used without a named profile.\n");
+    return;
+   }
+
+ /* A request to a server uses the one that the server loaded from its own database directory */
+
+ if(server_loaded)
+   {
+    int number=server_profile_number(profile);
+
+    filename=ContractionFileName(server_dirname,server_prefix,profile->name,quickest);
+
+    if(number>=0)
+       contraction=server_contractions[2*number+quickest];
+   }
+ else
+   {
+    filename=ContractionFileName(dirname,prefix,profile->name,quickest);
+
+    if(ExistsFile(filename))
+       contraction=LoadContraction(filename);
+   }
+
+ if(!contraction)
+    fprintf(stderr,"Warning: The contraction hierarchy file '%s' does not exist (not using it).\n",filename);
+ else if(!ContractionMatchesProfile(contraction,profile,quickest))
+   {
+    fprintf(stderr,"Warning: The contraction hierarchy file '%s' was created with a different profile (not using it).\n",filename);
+
+    if(!server_loaded)
+       DestroyContraction(contraction);
+   }
+ else
+    OSMContraction=contraction;
+
+ free(filename);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Load in the landmark distances for the profile if they exist and were created with the same profile.
+
+  const char *dirname The directory name from the command line.
+
+  const char *prefix The file name prefix from the command line.
+
+  Profile *profile The profile (after UpdateProfile() has been called).
+
+  int quickest Set for the quickest route.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void load_landmarks(const char *dirname,const char *prefix,Profile *profile,int quickest)
+{
+ Landmarks *landmarks=NULL;
+
+ if(OSMLandmarks || !profile->name)
+    return;
+
+ /* A request to a server uses the ones that the server loaded from its own database directory */
+
+ if(server_loaded)
+   {
+    int number=server_profile_number(profile);
+
+    if(number>=0)
+       landmarks=server_landmarks[2*number+quickest];
+   }
+ else
+   {
+    char *filename=LandmarksFileName(dirname,prefix,profile->name,quickest);
+
+    if(ExistsFile(filename))
+       landmarks=LoadLandmarks(filename);
+
+    free(filename);
+   }
+
+ if(landmarks && LandmarksMatchProfile(landmarks,profile,quickest))
+    OSMLandmarks=landmarks;
+ else if(landmarks && !server_loaded)
+    DestroyLandmarks(landmarks);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Calculate the score of every segment for the profile if requested (unless they have already been
+  calculated for the same profile).
+
+  Profile *profile The profile (after UpdateProfile() has been called).
+
+  int quickest Set for the quickest route.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void load_costs(Profile *profile,int quickest)
+{
+ /* A request to a server uses the ones that the server calculated when it started */
+
+ if(server_loaded)
+   {
+    if(server_costs[quickest] && SegmentCostsMatchProfile(server_costs[quickest],profile,quickest))
+       OSMCosts=server_costs[quickest];
+
+    return;
+   }
+
+ if(!option_costtable)
+    return;
+
+ if(OSMCosts)
+   {
+    if(SegmentCostsMatchProfile(OSMCosts,profile,quickest))
+       return;
+
+    DestroySegmentCosts(OSMCosts);
+   }
+
+ OSMCosts=CreateSegmentCosts(OSMSegments,OSMWays,profile,quickest);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Load the data for all of the profiles once when starting as a server so that each request (in
+  its own process and directory) can use it.
+
+  const char *dirname The directory name from the server command line.
+
+  const char *prefix The file name prefix from the server command line.
+
+  Profile *costsprofile The profile to calculate the segment scores for or NULL if not requested.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void load_server_data(const char *dirname,const char *prefix,Profile *costsprofile)
+{
+ int nprofiles=0,number,quickest;
+
+ server_loaded=1;
+
+ server_dirname=dirname;
+ server_prefix=prefix;
+
+ while(GetProfileNumber(nprofiles))
+    nprofiles++;
+
+ server_contractions=(Contraction**)calloc(2*nprofiles+1,sizeof(Contraction*));
+
+ logassert(server_contractions,"Failed to allocate memory"); /* Check calloc() worked */
+
+ server_landmarks=(Landmarks**)calloc(2*nprofiles+1,sizeof(Landmarks*));
+
+ logassert(server_landmarks,"Failed to allocate memory"); /* Check calloc() worked */
+
+ for(number=0;number<nprofiles;number++)
+    for(quickest=0;quickest<2;quickest++)
+      {
+       Profile *profile=GetProfileNumber(number);
+       char *filename;
+
+       filename=ContractionFileName(dirname,prefix,profile->name,quickest);
+
+       if(ExistsFile(filename))
+          server_contractions[2*number+quickest]=LoadContraction(filename);
+
+       free(filename);
+
+       filename=LandmarksFileName(dirname,prefix,profile->name,quickest);
+
+       if(ExistsFile(filename))
+          server_landmarks[2*number+quickest]=LoadLandmarks(filename);
+
+       free(filename);
+      }
+
+ /* Calculate the segment scores once for all requests that use the same profile */
+
+ if(costsprofile)
+    for(quickest=0;quickest<2;quickest++)
+      {
+       Profile profile=*costsprofile;
+
+       if(!UpdateProfile(&profile,OSMWays))
+          server_costs[quickest]=CreateSegmentCosts(OSMSegments,OSMWays,&profile,quickest);
+      }
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Find the position of a profile in the list of profiles that the server loaded data for.
+
+  int server_profile_number Returns the position or -1 if it is not one of them.
+
+  Profile *profile The profile (possibly modified by the request options).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int server_profile_number(Profile *profile)
+{
+ Profile *loaded;
+ int number;
+
+ for(number=0;(loaded=GetProfileNumber(number));number++)
+    if(!strcmp(loaded->name,profile->name))
+       return(number);
+
+ return(-1);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Run as a server; listen on a UNIX socket and handle each request in a new process that
+  shares the already loaded profiles, translations and routing database.
+
+  int run_server Returns the exit status for the program (only in case of error).
+
+  const char *socketname The name of the UNIX socket to create.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int run_server(const char *socketname)
+{
+ struct sockaddr_un addr;
+ int sock;
+
+ if(strlen(socketname)>=sizeof(addr.sun_path))
+   {
+    fprintf(stderr,"Error: The '--server' socket name '%s' is too long.\n",socketname);
+    exit(EXIT_FAILURE);
+   }
+
+ memset(&addr,0,sizeof(addr));
+ addr.sun_family=AF_UNIX;
+ strcpy(addr.sun_path,socketname);
+
+ sock=socket(AF_UNIX,SOCK_STREAM,0);
+
+ if(sock<0)
+   {
+    fprintf(stderr,"Error: Cannot create socket [%s].\n",strerror(errno));
+    exit(EXIT_FAILURE);
+   }
+
+ unlink(socketname);
+
+ if(bind(sock,(struct sockaddr*)&addr,sizeof(addr)) || listen(sock,16))
+   {
+    fprintf(stderr,"Error: Cannot listen on socket '%s' [%s].\n",socketname,strerror(errno));
+    exit(EXIT_FAILURE);
+   }
+
+ /* Finished children are reaped automatically. */
+
+ signal(SIGCHLD,SIG_IGN);
+
+ if(!option_quiet)
+   {
+    printf("Listening on '%s'\n",socketname);
+    fflush(stdout);
+   }
+
+ while(1)
+   {
+    int conn=accept(sock,NULL,NULL);
+    pid_t pid;
+
+    if(conn<0)
+      {
+       if(errno==EINTR || errno==ECONNABORTED)
+          continue;
+
+       fprintf(stderr,"Error: Cannot accept connection on socket '%s' [%s].\n",socketname,strerror(errno));
+       exit(EXIT_FAILURE);
+      }
+
+    pid=fork();
+
+    if(pid==0)
+      {
+       close(sock);
+
+       signal(SIGCHLD,SIG_DFL);
+
+       exit(serve_request(conn));
+      }
+    else if(pid<0)
+       fprintf(stderr,"Warning: Cannot fork to handle a request [%s].\n",strerror(errno));
+
+    close(conn);
+   }
+
+ return(EXIT_FAILURE);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Handle a single request to the server. The request is the working directory followed by one
+  command line argument per line and terminated by an empty line. The reply is the output of the
+  router followed by a NUL character, the exit status and a newline.
+
+  int serve_request Returns the exit status for the request handling process.
+
+  int conn The connected socket.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int serve_request(int conn)
+{
+ FILE *request=fdopen(dup(conn),"r");
+ char *line=NULL,*dir=NULL;
+ size_t length=0;
+ ssize_t n;
+ char **argv;
+ int argc=1;
+ char trailer[16];
+ int status=EXIT_FAILURE;
+ pid_t pid;
+
+ argv=(char**)malloc(2*sizeof(char*));
+ argv[0]="router";
+
+ while((n=getline(&line,&length,request))>0)
+   {
+    if(line[n-1]=='\n')
+       line[--n]=0;
+
+    if(!dir)
+       dir=strcpy((char*)malloc(n+1),line);
+    else if(n==0)
+       break;
+    else
+      {
+       argv=(char**)realloc((void*)argv,(argc+2)*sizeof(char*));
+       argv[argc++]=strcpy((char*)malloc(n+1),line);
+      }
+   }
+
+ argv[argc]=NULL;
+
+ fclose(request);
+
+ if(!dir || chdir(dir))
+   {
+    dprintf(conn,"Error: Cannot change to the requested directory '%s'.\n",dir?dir:"");
+    goto finish;
+   }
+
+ /* Route in a separate process so that an exit() can be reported back to the client. */
+
+ pid=fork();
+
+ if(pid==0)
+   {
+    dup2(conn,STDOUT_FILENO);
+    dup2(conn,STDERR_FILENO);
+    close(conn);
+
+    option_quiet=option_loggable=0;
+    option_html=option_gpx_track=option_gpx_route=option_text=option_text_all=option_none=0;
+    option_bidirectional=option_contracted=option_costtable=0;
+
+    exit(run_router(argc,argv));
+   }
+ else if(pid>0)
+   {
+    int wstatus;
+
+    if(waitpid(pid,&wstatus,0)==pid && WIFEXITED(wstatus))
+       status=WEXITSTATUS(wstatus);
+   }
+ else
+    dprintf(conn,"Error: Cannot fork to calculate the route [%s].\n",strerror(errno));
+
+ finish:
+
+ n=sprintf(trailer,"%c%d\n",0,status);
+
+ if(write(conn,trailer,n)!=n)
+    status=EXIT_FAILURE;
+
+ close(conn);
+
+ return(status);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Print out the usage information.
+
+  int detail The level of detail to use - 0 = low, 1 = high.
+
+  const char *argerr The argument that gave the error (if there is one).
 
   const char *err Other error message (if there is one).
   ++++++++++++++++++++++++++++++++++++++*/
@@ -654,6 +2244,16 @@ static void print_usage(int detail,const char *argerr,const char *err)
          "              [--dir=<dirname>] [--prefix=<name>]\n"
          "              [--profiles=<filename>] [--translations=<filename>]\n"
          "              [--exact-nodes-only]\n"
+         "              [--server=<socket>]\n"
+         "              [--matrix=<filename> [--matrix-targets=<filename>]\n"
+         "                                   [--matrix-binary]]\n"
+         "              [--isochrone-time=<minutes> | --isochrone-distance=<km>\n"
+         "               [--isochrone-hull]]\n"
+         "              [--batch=<filename> [--batch-nodes]"
+#if defined(USE_PTHREADS) && USE_PTHREADS
+         " [--threads=<number>]"
+#endif
+         "]\n"
          "              [--loggable | --quiet]\n"
          "              [--language=<lang>]\n"
          "              [--output-html]\n"
@@ -663,6 +2263,7 @@ static void print_usage(int detail,const char *argerr,const char *err)
          "              [--profile=<name>]\n"
          "              [--transport=<transport>]\n"
          "              [--shortest | --quickest]\n"
+         "              [--bidirectional] [--contracted] [--cost-table]\n"
          "              --lon1=<longitude> --lat1=<latitude>\n"
          "              --lon2=<longitude> --lon2=<latitude>\n"
          "              [ ... --lon99=<longitude> --lon99=<latitude>]\n"
@@ -704,6 +2305,26 @@ static void print_usage(int detail,const char *argerr,const char *err)
             "                         '" DATADIR "').\n"
             "\n"
             "--exact-nodes-only      Only route between nodes (don't find closest segment).\n"
+            "\n"
+            "--server=<socket>       Load the data once and route requests from a socket.\n"
+            "\n"
+            "--matrix=<filename>     Print the distance and duration of the routes between\n"
+            "                        each of the points in the file (longitude latitude).\n"
+            "--matrix-targets=<file> Use the points in this file as the route targets.\n"
+            "--matrix-binary         Print the matrix in binary instead of CSV format.\n"
+            "\n"
+            "--isochrone-time=<min>  Print the nodes that can be reached from the first\n"
+            "                        waypoint within the time (in minutes).\n"
+            "--isochrone-distance=<km> Print the nodes that can be reached from the first\n"
+            "                        waypoint within the distance (in km).\n"
+            "--isochrone-hull        Print a polygon around the nodes instead of the nodes.\n"
+            "\n"
+            "--batch=<filename>      Route each line of the file (or '-' for stdin); a line\n"
+            "                        contains longitude/latitude pairs and routing options.\n"
+            "--batch-nodes           Print the list of nodes for each route in the batch.\n"
+#if defined(USE_PTHREADS) && USE_PTHREADS
+            "--threads=<number>      Route the batch file using multiple threads.\n"
+#endif
             "\n"
             "--loggable              Print progress messages suitable for logging to file.\n"
             "--quiet                 Don't print any screen output when running.\n"
@@ -723,6 +2344,11 @@ static void print_usage(int detail,const char *argerr,const char *err)
             "\n"
             "--shortest              Find the shortest route between the waypoints.\n"
             "--quickest              Find the quickest route between the waypoints.\n"
+            "--bidirectional         Search the super-nodes from both ends of the route.\n"
+            "--contracted            Use the contraction hierarchy of the super-nodes that\n"
+            "                        was created by planetsplitter for the profile.\n"
+            "--cost-table            Calculate the score of every segment for the profile\n"
+            "                        before routing (for many routes with one profile).\n"
             "\n"
             "--lon<n>=<longitude>    Specify the longitude of the n'th waypoint.\n"
             "--lat<n>=<latitude>     Specify the latitude of the n'th waypoint.\n"
@@ -20,6 +20,7 @@
  ***************************************/
 
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
 
@@ -72,6 +73,16 @@ Segments *LoadSegmentList(const char *filename)
 
 #endif
 
+ /* A file from before the version was stored has the number of segments where the version is now */
+
+ if(segments->file.version!=SEGMENTS_FILE_VERSION ||
+    SizeFile(filename)!=(off_t)sizeof(SegmentsFile)+(off_t)segments->file.number*(off_t)sizeof(Segment))
+   {
+    fprintf(stderr,"The segments file '%s' does not have format version %d (run planetsplitter again).\n",
+            filename,SEGMENTS_FILE_VERSION);
+    exit(EXIT_FAILURE);
+   }
+
  return(segments);
 }
 
@@ -100,11 +111,58 @@ void DestroySegmentList(Segments *segments)
 }
 
 
+/*++++++++++++++++++++++++++++++++++++++
+  Create a copy of a segment list that shares the loaded data but has its own cache so that
+  each copy can be used by a different thread.
+
+  Segments *DuplicateSegmentList Returns the new segment list.
+
+  Segments *segments The segment list to copy.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+Segments *DuplicateSegmentList(Segments *segments)
+{
+ Segments *newsegments;
+
+ newsegments=(Segments*)malloc(sizeof(Segments));
+
+ *newsegments=*segments;
+
+#if SLIM
+
+ newsegments->cache=NewSegmentCache();
+
+#endif
+
+ return(newsegments);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Destroy a copy of a segment list created by DuplicateSegmentList() (the shared data is kept).
+
+  Segments *segments The segment list copy to destroy.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+void DestroyDuplicateSegmentList(Segments *segments)
+{
+#if SLIM
+
+ DeleteSegmentCache(segments->cache);
+
+#endif
+
+ free(segments);
+}
+
+
 /*++++++++++++++++++++++++++++++++++++++
   Find the closest segment from a specified node heading in a particular direction and optionally profile.
 
   index_t FindClosestSegmentHeading Returns the closest heading segment index.
 
+  Query *query The query containing the fake nodes and segments.
+
   Nodes *nodes The set of nodes to use.
 
   Segments *segments The set of segments to use.
@@ -118,14 +176,14 @@ void DestroySegmentList(Segments *segments)
   Profile *profile The profile of the mode of transport (or NULL).
   ++++++++++++++++++++++++++++++++++++++*/
 
-index_t FindClosestSegmentHeading(Nodes *nodes,Segments *segments,Ways *ways,index_t node1,double heading,Profile *profile)
+index_t FindClosestSegmentHeading(Query *query,Nodes *nodes,Segments *segments,Ways *ways,index_t node1,double heading,Profile *profile)
 {
  Segment *segmentp;
  index_t best_seg=NO_SEGMENT;
  double best_difference=360;
 
  if(IsFakeNode(node1))
-    segmentp=FirstFakeSegment(node1);
+    segmentp=FirstFakeSegment(query,node1);
  else
    {
     Node *nodep=LookupNode(nodes,node1,3);
@@ -148,7 +206,7 @@ index_t FindClosestSegmentHeading(Nodes *nodes,Segments *segments,Ways *ways,ind
 //       goto endloop;
 
     if(IsFakeNode(node1) || IsFakeNode(node2))
-       seg2=IndexFakeSegment(segmentp);
+       seg2=IndexFakeSegment(query,segmentp);
     else
        seg2=IndexSegment(segments,segmentp);
 
@@ -163,14 +221,14 @@ index_t FindClosestSegmentHeading(Nodes *nodes,Segments *segments,Ways *ways,ind
         goto endloop;      
 	  if (!(wayp->props & Properties_DoubleSens))
         goto endloop;      
- #if DEBUG
+#if DEBUG
  printf("  FindClosestSegmentHeading(...,node1=%"Pindex_t",node2=%"Pindex_t") props=%d DoubleSens=%d\n",node1,node2,wayp->props,Properties_DoubleSens);
 #endif
 
 	 }
 
 	
-    bearing=BearingAngle(nodes,segmentp,node1);
+    bearing=BearingAngle(query,nodes,segmentp,node1);
 
     difference=(heading-bearing);
 
@@ -188,7 +246,7 @@ index_t FindClosestSegmentHeading(Nodes *nodes,Segments *segments,Ways *ways,ind
    endloop:
 
     if(IsFakeNode(node1))
-       segmentp=NextFakeSegment(segmentp,node1);
+       segmentp=NextFakeSegment(query,segmentp,node1);
     else if(IsFakeNode(node2))
        segmentp=NULL; /* cannot call NextSegment() with a fake segment */
     else
@@ -280,7 +338,7 @@ duration_t Duration(index_t node, Segment *segmentp,Way *wayp,Profile *profile,s
    return distance_speed_to_duration(distance,*pspeedresult);
    
 #if DEBUG
-   printf("    incline=%d  node=%"Pindex_t" seg->node1=%"Pindex_t" seg->node2=%"Pindex_t" percentascent=%f percentdescent=%f distx=%08x\n",wayp->incline,node,segmentp->node1,segmentp->node2,segmentp->percentascent,segmentp->percentdescent,segmentp->descent,segmentp->distance );
+   printf("    incline=%d  node=%"Pindex_t" seg->node1=%"Pindex_t" seg->node2=%"Pindex_t" percentascent=%.1f percentdescent=%.1f distx=%08x\n",wayp->incline,node,segmentp->node1,segmentp->node2,gradient_to_pourcent(segmentp->percentascent),gradient_to_pourcent(segmentp->percentdescent),segmentp->distance );
 #endif
  if (wayp->incline != 0)
    {
@@ -309,9 +367,9 @@ duration_t Duration(index_t node, Segment *segmentp,Way *wayp,Profile *profile,s
    {
 	float    percent=0;   
 	if (segmentp->node1 == node && segmentp->percentascent > 0) 
-      percent = segmentp->percentascent - segmentp->percentdescent;
+      percent = gradient_to_pourcent(segmentp->percentascent) - gradient_to_pourcent(segmentp->percentdescent);
 	if (segmentp->node2 == node && segmentp->percentdescent > 0) 
-      percent = segmentp->percentdescent - segmentp->percentascent;
+      percent = gradient_to_pourcent(segmentp->percentdescent) - gradient_to_pourcent(segmentp->percentascent);
 
     if(percent < 5) 
       return distance_speed_to_duration(distance,*pspeedresult);
@@ -341,6 +399,8 @@ duration_t Duration(index_t node, Segment *segmentp,Way *wayp,Profile *profile,s
 
   double TurnAngle Returns a value in the range -180 to +180 indicating the angle to turn.
 
+  Query *query The query containing the fake nodes and segments (or NULL if there are none).
+
   Nodes *nodes The set of nodes to use.
 
   Segment *segment1p The current segment.
@@ -353,7 +413,7 @@ duration_t Duration(index_t node, Segment *segmentp,Way *wayp,Profile *profile,s
   Angles are calculated using flat Cartesian lat/long grid approximation (after scaling longitude due to latitude).
   ++++++++++++++++++++++++++++++++++++++*/
 
-double TurnAngle(Nodes *nodes,Segment *segment1p,Segment *segment2p,index_t node)
+double TurnAngle(Query *query,Nodes *nodes,Segment *segment1p,Segment *segment2p,index_t node)
 {
  double lat1,latm,lat2;
  double lon1,lonm,lon2;
@@ -364,17 +424,17 @@ double TurnAngle(Nodes *nodes,Segment *segment1p,Segment *segment2p,index_t node
  node2=OtherNode(segment2p,node);
 
  if(IsFakeNode(node1))
-    GetFakeLatLong(node1,&lat1,&lon1);
+    GetFakeLatLong(query,node1,&lat1,&lon1);
  else
     GetLatLong(nodes,node1,NULL,&lat1,&lon1);
 
  if(IsFakeNode(node))
-    GetFakeLatLong(node,&latm,&lonm);
+    GetFakeLatLong(query,node,&latm,&lonm);
  else
     GetLatLong(nodes,node,NULL,&latm,&lonm);
 
  if(IsFakeNode(node2))
-    GetFakeLatLong(node2,&lat2,&lon2);
+    GetFakeLatLong(query,node2,&lat2,&lon2);
  else
     GetLatLong(nodes,node2,NULL,&lat2,&lon2);
 
@@ -397,6 +457,8 @@ double TurnAngle(Nodes *nodes,Segment *segment1p,Segment *segment2p,index_t node
 
   double BearingAngle Returns a value in the range 0 to 359 indicating the bearing.
 
+  Query *query The query containing the fake nodes and segments (or NULL if there are none).
+
   Nodes *nodes The set of nodes to use.
 
   Segment *segmentp The segment.
@@ -406,7 +468,7 @@ double TurnAngle(Nodes *nodes,Segment *segment1p,Segment *segment2p,index_t node
   Angles are calculated using flat Cartesian lat/long grid approximation (after scaling longitude due to latitude).
   ++++++++++++++++++++++++++++++++++++++*/
 
-double BearingAngle(Nodes *nodes,Segment *segmentp,index_t node)
+double BearingAngle(Query *query,Nodes *nodes,Segment *segmentp,index_t node)
 {
  double lat1,lat2;
  double lon1,lon2;
@@ -417,12 +479,12 @@ double BearingAngle(Nodes *nodes,Segment *segmentp,index_t node)
  node2=OtherNode(segmentp,node);
 
  if(IsFakeNode(node1))
-    GetFakeLatLong(node1,&lat1,&lon1);
+    GetFakeLatLong(query,node1,&lat1,&lon1);
  else
     GetLatLong(nodes,node1,NULL,&lat1,&lon1);
 
  if(IsFakeNode(node2))
-    GetFakeLatLong(node2,&lat2,&lon2);
+    GetFakeLatLong(query,node2,&lat2,&lon2);
  else
     GetLatLong(nodes,node2,NULL,&lat2,&lon2);
 
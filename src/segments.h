@@ -34,6 +34,12 @@
 #include "profiles.h"
 
 
+/* Constants */
+
+/*+ The version of the segments file format (changed when the Segment structure changes). +*/
+#define SEGMENTS_FILE_VERSION 2
+
+
 /* Data structures */
 
 
@@ -48,15 +54,17 @@ struct _Segment
  index_t    way;                /*+ The index of the way associated with the segment. +*/
 
  distance_t distance;           /*+ The distance between the nodes. +*/
- 
- float percentascent;
- float percentdescent;
+
+ gradient_t percentascent;      /*+ The average gradient of the ascents from node1 to node2. +*/
+ gradient_t percentdescent;     /*+ The average gradient of the descents from node1 to node2. +*/
 };
 
 
 /*+ A structure containing the header from the file. +*/
 typedef struct _SegmentsFile
 {
+ uint32_t  version;             /*+ The version of the file format. +*/
+
  index_t   number;              /*+ The number of segments in total. +*/
  index_t   snumber;             /*+ The number of super-segments. +*/
  index_t   nnumber;             /*+ The number of normal segments. +*/
@@ -94,14 +102,18 @@ Segments *LoadSegmentList(const char *filename);
 
 void DestroySegmentList(Segments *segments);
 
-index_t FindClosestSegmentHeading(Nodes *nodes,Segments *segments,Ways *ways,index_t node1,double heading,Profile *profile);
+Segments *DuplicateSegmentList(Segments *segments);
+
+void DestroyDuplicateSegmentList(Segments *segments);
+
+index_t FindClosestSegmentHeading(Query *query,Nodes *nodes,Segments *segments,Ways *ways,index_t node1,double heading,Profile *profile);
 
 distance_t Distance(double lat1,double lon1,double lat2,double lon2);
 
 duration_t Duration(index_t node,Segment *segmentp,Way *wayp,Profile *profile,speed_t *pspeedresult);
 
-double TurnAngle(Nodes *nodes,Segment *segment1p,Segment *segment2p,index_t node);
-double BearingAngle(Nodes *nodes,Segment *segmentp,index_t node);
+double TurnAngle(Query *query,Nodes *nodes,Segment *segment1p,Segment *segment2p,index_t node);
+double BearingAngle(Query *query,Nodes *nodes,Segment *segmentp,index_t node);
 
 
 static inline Segment *NextSegment(Segments *segments,Segment *segmentp,index_t node);
@@ -24,6 +24,10 @@
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(USE_PTHREADS) && USE_PTHREADS
+#include <pthread.h>
+#endif
+
 #include "types.h"
 #include "segments.h"
 #include "ways.h"
@@ -40,11 +44,48 @@
 #include "srtmHgtReader.h"
 
 
+/* Constants */
+
+/*+ The number of segments that have their ascent and descent calculated together. +*/
+#define ELEVATION_BATCH 16384
+
+
+/* Local types */
+
+/*+ A segment and the location of its nodes for calculating the ascent and descent. +*/
+typedef struct _ElevationX
+{
+ SegmentX segmentx;             /*+ The segment. +*/
+
+ float    lat1,lon1,ele1;       /*+ The location (in degrees) and elevation (in metres) of the first node. +*/
+ float    lat2,lon2,ele2;       /*+ The location (in degrees) and elevation (in metres) of the second node. +*/
+}
+ ElevationX;
+
+/*+ The information for one of the threads calculating the ascent and descent. +*/
+typedef struct _elevation_thread
+{
+#if defined(USE_PTHREADS) && USE_PTHREADS
+ pthread_t   thread;            /*+ The thread identifier. +*/
+#endif
+
+ TSrtmCache *cache;             /*+ This thread's cache of elevation tiles. +*/
+
+ ElevationX *elevationx;        /*+ The batch of segments. +*/
+ index_t     first;             /*+ The first segment in the batch for this thread. +*/
+ index_t     last;              /*+ The segment after the last one for this thread. +*/
+}
+ elevation_thread;
+
+
 /* Global variables */
 
 /*+ The command line '--tmpdir' option or its default value. +*/
 extern char *option_tmpdirname;
 
+/*+ The number of threads to use for calculating the ascent and descent. +*/
+extern int option_srtm_threads;
+
 /* Local variables */
 
 /*+ Temporary file-local variables for use by the sort functions. +*/
@@ -55,6 +96,7 @@ static WaysX *sortwaysx;
 /* Local functions */
 
 static int sort_by_id(SegmentX *a,SegmentX *b);
+static uint64_t key_by_id(SegmentX *segmentx);
 
 static int delete_pruned(SegmentX *segmentx,index_t index);
 
@@ -64,6 +106,9 @@ static int geographically_index(SegmentX *segmentx,index_t index);
 
 static distance_t DistanceX(NodeX *nodex1,NodeX *nodex2);
 
+static void CalculateElevations(elevation_thread *threads,ElevationX *elevationx,index_t number,int fd);
+static void *elevation_thread_function(elevation_thread *thread);
+
 
 /*++++++++++++++++++++++++++++++++++++++
   Allocate a new segment list (create a new file or open an existing one).
@@ -79,11 +124,11 @@ SegmentsX *NewSegmentList(void)
 
  logassert(segmentsx,"Failed to allocate memory (try using slim mode?)"); /* Check calloc() worked */
 
- segmentsx->filename_tmp=(char*)malloc(strlen(option_tmpdirname)+32);
+ segmentsx->filename_tmp=(char*)malloc(strlen(option_tmpdirname)+48);
 
  sprintf(segmentsx->filename_tmp,"%s/segmentsx.%p.tmp",option_tmpdirname,(void*)segmentsx);
 
- segmentsx->fd=OpenFileBufferedNew(segmentsx->filename_tmp);
+ segmentsx->fd=OpenFileBufferedNewTemporary(segmentsx->filename_tmp);
 
 #if SLIM
  segmentsx->cache=NewSegmentXCache();
@@ -133,7 +178,7 @@ void FreeSegmentList(SegmentsX *segmentsx)
   distance_t distance The distance between the nodes (or just the flags).
   ++++++++++++++++++++++++++++++++++++++*/
 
-void AppendSegmentList(SegmentsX *segmentsx,index_t way,index_t node1,index_t node2,distance_t distance, float percentascent, float percentdescent)
+void AppendSegmentList(SegmentsX *segmentsx,index_t way,index_t node1,index_t node2,distance_t distance,gradient_t percentascent,gradient_t percentdescent)
 {
  SegmentX segmentx;
 
@@ -150,7 +195,7 @@ void AppendSegmentList(SegmentsX *segmentsx,index_t way,index_t node1,index_t no
     if(distance&(INCLINEUP_2TO1|INCLINEUP_1TO2))
        distance^=INCLINEUP_2TO1|INCLINEUP_1TO2;
        
-    float tmp;
+    gradient_t tmp;
     tmp=percentascent;
     percentascent=percentdescent;
     percentdescent = tmp;
@@ -301,9 +346,10 @@ void SortSegmentList(SegmentsX *segmentsx)
 
  /* Sort by node indexes */
 
- segmentsx->number=filesort_fixed(segmentsx->fd,fd,sizeof(SegmentX),NULL,
-                                                                    (int (*)(const void*,const void*))sort_by_id,
-                                                                    NULL);
+ segmentsx->number=filesort_fixed_key(segmentsx->fd,fd,sizeof(SegmentX),NULL,
+                                                                        (uint64_t (*)(const void*))key_by_id,
+                                                                        (int (*)(const void*,const void*))sort_by_id,
+                                                                        NULL);
 
  /* Close the files */
 
@@ -370,6 +416,20 @@ static int sort_by_id(SegmentX *a,SegmentX *b)
 }
 
 
+/*++++++++++++++++++++++++++++++++++++++
+  Calculate the key for sorting the segments into id order (the distance is left to sort_by_id()).
+
+  uint64_t key_by_id Returns the sort key (node1 and node2).
+
+  SegmentX *segmentx The segment.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static uint64_t key_by_id(SegmentX *segmentx)
+{
+ return(((uint64_t)segmentx->node1<<32)|segmentx->node2);
+}
+
+
 /*++++++++++++++++++++++++++++++++++++++
   Process segments (non-trivial duplicates).
 
@@ -388,6 +448,11 @@ void ProcessSegments(SegmentsX *segmentsx,NodesX *nodesx,WaysX *waysx)
  distance_t prevdist=0;
  SegmentX segmentx;
  int fd;
+ elevation_thread *threads;
+ ElevationX *elevationx;
+ index_t nelevationx=0;
+ int srtmloads=0,srtmevictions=0;
+ int i;
 
  /* Print the start message */
 
@@ -420,6 +485,19 @@ void ProcessSegments(SegmentsX *segmentsx,NodesX *nodesx,WaysX *waysx)
 
  fd=OpenFileBufferedNew(segmentsx->filename_tmp);
 
+ /* Allocate the batch of segments and the elevation tile caches for the threads */
+
+ elevationx=(ElevationX*)malloc(ELEVATION_BATCH*sizeof(ElevationX));
+
+ logassert(elevationx,"Failed to allocate memory (try using slim mode?)"); /* Check malloc() worked */
+
+ threads=(elevation_thread*)malloc(option_srtm_threads*sizeof(elevation_thread));
+
+ logassert(threads,"Failed to allocate memory (try using slim mode?)"); /* Check malloc() worked */
+
+ for(i=0;i<option_srtm_threads;i++)
+    threads[i].cache=srtmNewCache();
+
  /* Modify the on-disk image */
 
  while(!ReadFileBuffered(segmentsx->fd,&segmentx,sizeof(SegmentX)))
@@ -468,24 +546,24 @@ void ProcessSegments(SegmentsX *segmentsx,NodesX *nodesx,WaysX *waysx)
        segmentx.distance=DISTANCE(DistanceX(nodex1,nodex2))|DISTFLAG(segmentx.distance);
        segmentx.distance&=~SEGMENT_AREA;
        
-       /* Compute the ascent descent */
-       TSrtmAscentDescent ad;
-       ad = srtmGetAscentDescent(
-            radians_to_degrees(latlong_to_radians(nodex1->latitude)), radians_to_degrees(latlong_to_radians(nodex1->longitude)),
-            radians_to_degrees(latlong_to_radians(nodex2->latitude)), radians_to_degrees(latlong_to_radians(nodex2->longitude)),
-            (int)DISTANCE(segmentx.distance));
-       if (ad.ascentOn != 0) 
-          segmentx.percentascent = ad.ascent/ad.ascentOn*100;
-       else 
-          segmentx.percentascent = 0; 
-       if (ad.descentOn != 0) 
-          segmentx.percentdescent = ad.descent/ad.descentOn*100;
-       else 
-          segmentx.percentdescent = 0; 
-
-       /* Write the modified segment */
-
-       WriteFileBuffered(fd,&segmentx,sizeof(SegmentX));
+       /* Store the segment until the ascent and descent of a batch of them are calculated */
+
+       elevationx[nelevationx].segmentx=segmentx;
+
+       elevationx[nelevationx].lat1=radians_to_degrees(latlong_to_radians(nodex1->latitude));
+       elevationx[nelevationx].lon1=radians_to_degrees(latlong_to_radians(nodex1->longitude));
+       elevationx[nelevationx].lat2=radians_to_degrees(latlong_to_radians(nodex2->latitude));
+       elevationx[nelevationx].lon2=radians_to_degrees(latlong_to_radians(nodex2->longitude));
+
+       elevationx[nelevationx].ele1=nodex1->elevation==NO_ELEVATION?SRTM_VOID:elevation_to_metres(nodex1->elevation);
+       elevationx[nelevationx].ele2=nodex2->elevation==NO_ELEVATION?SRTM_VOID:elevation_to_metres(nodex2->elevation);
+
+       if(++nelevationx==ELEVATION_BATCH)
+         {
+          CalculateElevations(threads,elevationx,nelevationx,fd);
+
+          nelevationx=0;
+         }
 
        good++;
       }
@@ -498,6 +576,12 @@ void ProcessSegments(SegmentsX *segmentsx,NodesX *nodesx,WaysX *waysx)
 
  segmentsx->number=good;
 
+ /* Calculate the ascent and descent of the final batch and write the segments */
+
+ CalculateElevations(threads,elevationx,nelevationx,fd);
+
+ free(elevationx);
+
  /* Close the files */
 
  segmentsx->fd=CloseFileBuffered(segmentsx->fd);
@@ -513,9 +597,25 @@ void ProcessSegments(SegmentsX *segmentsx,NodesX *nodesx,WaysX *waysx)
  waysx->fd=SlimUnmapFile(waysx->fd);
 #endif
 
+ /* Release the elevation data */
+
+ for(i=0;i<option_srtm_threads;i++)
+   {
+    int loads,evictions;
+
+    srtmGetStatistics(threads[i].cache,&loads,&evictions);
+
+    srtmloads+=loads;
+    srtmevictions+=evictions;
+
+    srtmClose(threads[i].cache);
+   }
+
+ free(threads);
+
  /* Print the final message */
 
- printf_last("Processed Segments: Segments=%"Pindex_t" Duplicates=%"Pindex_t,total,duplicate);
+ printf_last("Processed Segments: Segments=%"Pindex_t" Duplicates=%"Pindex_t" SRTM Tiles Loaded=%d Evicted=%d",total,duplicate,srtmloads,srtmevictions);
 }
 
 
@@ -680,9 +780,10 @@ void RemovePrunedSegments(SegmentsX *segmentsx,WaysX *waysx)
 
  sortsegmentsx=segmentsx;
 
- segmentsx->number=filesort_fixed(segmentsx->fd,fd,sizeof(SegmentX),(int (*)(void*,index_t))delete_pruned,
-                                                                    (int (*)(const void*,const void*))sort_by_id,
-                                                                    NULL);
+ segmentsx->number=filesort_fixed_key(segmentsx->fd,fd,sizeof(SegmentX),(int (*)(void*,index_t))delete_pruned,
+                                                                        (uint64_t (*)(const void*))key_by_id,
+                                                                        (int (*)(const void*,const void*))sort_by_id,
+                                                                        NULL);
 
  /* Close the files */
 
@@ -761,9 +862,10 @@ void DeduplicateSuperSegments(SegmentsX *segmentsx,WaysX *waysx)
  sortsegmentsx=segmentsx;
  sortwaysx=waysx;
 
- segmentsx->number=filesort_fixed(segmentsx->fd,fd,sizeof(SegmentX),NULL,
-                                                                    (int (*)(const void*,const void*))sort_by_id,
-                                                                    (int (*)(void*,index_t))deduplicate_super);
+ segmentsx->number=filesort_fixed_key(segmentsx->fd,fd,sizeof(SegmentX),NULL,
+                                                                        (uint64_t (*)(const void*))key_by_id,
+                                                                        (int (*)(const void*,const void*))sort_by_id,
+                                                                        (int (*)(void*,index_t))deduplicate_super);
 
  /* Close the files */
 
@@ -882,9 +984,10 @@ void SortSegmentListGeographically(SegmentsX *segmentsx,NodesX *nodesx)
 
  sortnodesx=nodesx;
 
- filesort_fixed(segmentsx->fd,fd,sizeof(SegmentX),(int (*)(void*,index_t))geographically_index,
-                                                  (int (*)(const void*,const void*))sort_by_id,
-                                                  NULL);
+ filesort_fixed_key(segmentsx->fd,fd,sizeof(SegmentX),(int (*)(void*,index_t))geographically_index,
+                                                      (uint64_t (*)(const void*))key_by_id,
+                                                      (int (*)(const void*,const void*))sort_by_id,
+                                                      NULL);
  /* Close the files */
 
  segmentsx->fd=CloseFileBuffered(segmentsx->fd);
@@ -924,7 +1027,7 @@ static int geographically_index(SegmentX *segmentx,index_t index)
     if(segmentx->distance&(INCLINEUP_2TO1|INCLINEUP_1TO2))
        segmentx->distance^=INCLINEUP_2TO1|INCLINEUP_1TO2;
     
-    float tmp;
+    gradient_t tmp;
     tmp=segmentx->percentascent;
     segmentx->percentascent=segmentx->percentdescent;
     segmentx->percentdescent = tmp;
@@ -992,6 +1095,7 @@ void SaveSegmentList(SegmentsX *segmentsx,const char *filename)
 
  /* Write out the header structure */
 
+ segmentsfile.version=SEGMENTS_FILE_VERSION;
  segmentsfile.number=segmentsx->number;
  segmentsfile.snumber=super_number;
  segmentsfile.nnumber=normal_number;
@@ -1045,3 +1149,89 @@ static distance_t DistanceX(NodeX *nodex1,NodeX *nodex2)
 
  return km_to_distance(d);
 }
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Calculate the ascent and descent of a batch of segments (using several threads) and write them to a file.
+
+  elevation_thread *threads The information for each of the threads.
+
+  ElevationX *elevationx The batch of segments.
+
+  index_t number The number of segments in the batch.
+
+  int fd The file to write the segments to (in the same order as the batch).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void CalculateElevations(elevation_thread *threads,ElevationX *elevationx,index_t number,int fd)
+{
+ index_t j;
+ int i;
+
+ /* Each thread processes a contiguous part of the batch (nearby segments are likely to use the same tiles) */
+
+ for(i=0;i<option_srtm_threads;i++)
+   {
+    threads[i].elevationx=elevationx;
+    threads[i].first=(index_t)(((size_t)number*i)/option_srtm_threads);
+    threads[i].last =(index_t)(((size_t)number*(i+1))/option_srtm_threads);
+   }
+
+#if defined(USE_PTHREADS) && USE_PTHREADS
+
+ for(i=1;i<option_srtm_threads;i++)
+    pthread_create(&threads[i].thread,NULL,(void* (*)(void*))elevation_thread_function,&threads[i]);
+
+ elevation_thread_function(&threads[0]);
+
+ for(i=1;i<option_srtm_threads;i++)
+    pthread_join(threads[i].thread,NULL);
+
+#else
+
+ elevation_thread_function(&threads[0]);
+
+#endif
+
+ /* Write the modified segments */
+
+ for(j=0;j<number;j++)
+    WriteFileBuffered(fd,&elevationx[j].segmentx,sizeof(SegmentX));
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Calculate the ascent and descent of part of a batch of segments (runs in each thread).
+
+  void *elevation_thread_function Returns NULL (required to be used as a thread function).
+
+  elevation_thread *thread The information for this thread.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void *elevation_thread_function(elevation_thread *thread)
+{
+ index_t j;
+
+ for(j=thread->first;j<thread->last;j++)
+   {
+    ElevationX *elevationx=&thread->elevationx[j];
+    TSrtmAscentDescent ad;
+
+    ad=srtmGetAscentDescent(thread->cache,
+                            elevationx->lat1,elevationx->lon1,elevationx->ele1,
+                            elevationx->lat2,elevationx->lon2,elevationx->ele2,
+                            (int)DISTANCE(elevationx->segmentx.distance));
+
+    if(ad.ascentOn!=0)
+       elevationx->segmentx.percentascent=pourcent_to_gradient(ad.ascent/ad.ascentOn*100);
+    else
+       elevationx->segmentx.percentascent=0;
+
+    if(ad.descentOn!=0)
+       elevationx->segmentx.percentdescent=pourcent_to_gradient(ad.descent/ad.descentOn*100);
+    else
+       elevationx->segmentx.percentdescent=0;
+   }
+
+ return(NULL);
+}
@@ -47,9 +47,9 @@ struct _SegmentX
  index_t    way;                /*+ The WayX index of the way. +*/
 
  distance_t distance;           /*+ The distance between the nodes. +*/
- 
- float      percentascent;
- float      percentdescent;
+
+ gradient_t percentascent;      /*+ The average gradient of the ascents from node1 to node2. +*/
+ gradient_t percentdescent;     /*+ The average gradient of the descents from node1 to node2. +*/
 };
 
 
@@ -88,7 +88,7 @@ struct _SegmentsX
 SegmentsX *NewSegmentList(void);
 void FreeSegmentList(SegmentsX *segmentsx);
 
-void AppendSegmentList(SegmentsX *segmentsx,index_t way,index_t node1,index_t node2,distance_t distance, float percentascent, float percentdescent);
+void AppendSegmentList(SegmentsX *segmentsx,index_t way,index_t node1,index_t node2,distance_t distance,gradient_t percentascent,gradient_t percentdescent);
 void FinishSegmentList(SegmentsX *segmentsx);
 
 SegmentX *FirstSegmentX(SegmentsX *segmentsx,index_t nodeindex,int position);
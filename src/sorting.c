@@ -23,6 +23,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/time.h>
 
 #if defined(USE_PTHREADS) && USE_PTHREADS
 #include <pthread.h>
@@ -60,13 +63,77 @@ typedef struct _thread_data
   void    **datap;              /*+ An array of pointers to the data objects. +*/
   size_t    n;                  /*+ The number of pointers. +*/
 
+  void     *tmp;                /*+ A second data array (for the radix sort). +*/
+  uint64_t *keys;               /*+ The sort keys of the data objects (for the radix sort). +*/
+  uint64_t *tmpkeys;            /*+ A second array of sort keys (for the radix sort). +*/
+
   char    *filename;            /*+ The name of the file to write the results to. +*/
 
   size_t   itemsize;            /*+ The size of each item. +*/
   int    (*compare)(const void*,const void*); /*+ The comparison function. +*/
+  uint64_t (*key)(const void*); /*+ The sort key function (for the radix sort). +*/
  }
  thread_data;
 
+/*+ A data type for holding data for one part of a radix sort pass in a thread. +*/
+typedef struct _radix_data
+ {
+  pthread_t thread;             /*+ The thread identifier. +*/
+
+  thread_data *sort;            /*+ The data being sorted. +*/
+
+  size_t    first;              /*+ The first data object in this part. +*/
+  size_t    last;               /*+ The last data object in this part (plus one). +*/
+
+  int       shift;              /*+ The bit shift of the digit being sorted on (or -1 to calculate the keys). +*/
+
+  size_t    counts[8][256];     /*+ The number of each value of each digit (or the output position of each value). +*/
+ }
+ radix_data;
+
+/*+ A data type for holding one of the temporary files being merged. +*/
+typedef struct _merge_run
+ {
+  int       fd;                 /*+ The file descriptor (opened in simple mode). +*/
+
+  char     *buffer[2];          /*+ The two buffers, one being consumed while the other is refilled. +*/
+  size_t    length[2];          /*+ The amount of data in each buffer. +*/
+  int       full[2];            /*+ A flag indicating that the buffer has been filled (possibly with nothing). +*/
+
+  int       current;            /*+ The buffer that is being consumed. +*/
+  size_t    position;           /*+ The position in the buffer that is being consumed. +*/
+
+  int       eof;                /*+ A flag indicating that the end of the file has been read (an empty buffer). +*/
+  int       finished;           /*+ A flag indicating that all of the data has been merged. +*/
+ }
+ merge_run;
+
+/*+ A data type for holding the state of the merge and the prefetch thread. +*/
+typedef struct _merge_data
+ {
+  pthread_t thread;             /*+ The prefetch thread identifier. +*/
+  pthread_mutex_t mutex;        /*+ The mutex to protect the buffers and flags shared with the prefetch thread. +*/
+  pthread_cond_t  cond;         /*+ The condition to signal changes to the buffers and flags. +*/
+
+  int       stop;               /*+ A flag to tell the prefetch thread to stop. +*/
+  int       wanted;             /*+ The run that the merge is waiting for (or -1). +*/
+  int       next;               /*+ The next run for the prefetch thread to check. +*/
+
+  int       nruns;              /*+ The number of temporary files. +*/
+  merge_run *runs;              /*+ The temporary files. +*/
+
+  size_t    buffersize;         /*+ The size of each read buffer. +*/
+  size_t    itemsize;           /*+ The size of each item (or 0 for variable length items). +*/
+
+  void    **datap;              /*+ The current item from each of the temporary files. +*/
+  int      *tree;               /*+ The loser tree (the overall winner is at index 0). +*/
+
+  uint64_t  bytes;              /*+ The amount of data read from the temporary files. +*/
+
+  int     (*compare)(const void*,const void*); /*+ The comparison function. +*/
+ }
+ merge_data;
+
 /* Thread variables */
 
 #if defined(USE_PTHREADS) && USE_PTHREADS
@@ -74,13 +141,37 @@ typedef struct _thread_data
 static pthread_mutex_t running_mutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t running_cond = PTHREAD_COND_INITIALIZER;
 
+/*+ The amount of RAM to use for filesorting in this thread (if set when several threads are sorting at once). +*/
+static __thread size_t thread_ramsize=0;
+
 #endif
 
+/*+ The number of sorts that have been started (used to give each one unique temporary filenames). +*/
+static int nsorts=0;
+
 /* Thread helper functions */
 
 static void *filesort_fixed_heapsort_thread(thread_data *thread);
 static void *filesort_vary_heapsort_thread(thread_data *thread);
 
+static void filesort_radixsort(thread_data *thread,int nthreads);
+static void *filesort_radix_count_thread(radix_data *radix);
+static void *filesort_radix_scatter_thread(radix_data *radix);
+
+static size_t filesort_ramsize(void);
+
+static index_t filesort_merge(int fd_out,int sortid,int nfiles,size_t itemsize,size_t slotsize,
+                              int (*compare_function)(const void*,const void*),
+                              int (*post_sort_function)(void*,index_t));
+static int filesort_merge_less(merge_data *merge,int run1,int run2);
+static int filesort_merge_read_item(merge_data *merge,int run);
+static int filesort_merge_read(merge_data *merge,int run,void *address,size_t length);
+static int filesort_merge_next_buffer(merge_data *merge,int run);
+static size_t filesort_merge_fill_buffer(int fd,char *buffer,size_t length);
+#if defined(USE_PTHREADS) && USE_PTHREADS
+static void *filesort_merge_prefetch_thread(merge_data *merge);
+#endif
+
 
 /*++++++++++++++++++++++++++++++++++++++
   A function to sort the contents of a file of fixed length objects using a
@@ -88,9 +179,10 @@ static void *filesort_vary_heapsort_thread(thread_data *thread);
 
   The data is sorted using a "Merge sort" http://en.wikipedia.org/wiki/Merge_sort
   and in particular an "external sort" http://en.wikipedia.org/wiki/External_sorting.
-  The individual sort steps and the merge step both use a "Heap sort"
-  http://en.wikipedia.org/wiki/Heapsort.  The combination of the two should work well
-  if the data is already partially sorted.
+  The individual sort steps use a "Heap sort" http://en.wikipedia.org/wiki/Heapsort
+  which should work well if the data is already partially sorted.  The merge step uses a
+  "Loser tree" http://en.wikipedia.org/wiki/K-way_merge_algorithm with large buffers for
+  each temporary file that are refilled in the background.
 
   index_t filesort_fixed Returns the number of objects kept.
 
@@ -118,19 +210,62 @@ index_t filesort_fixed(int fd_in,int fd_out,size_t itemsize,int (*pre_sort_funct
                                                             int (*compare_function)(const void*,const void*),
                                                             int (*post_sort_function)(void*,index_t))
 {
- int *fds=NULL,*heap=NULL;
- int nfiles=0,ndata=0;
+ return(filesort_fixed_key(fd_in,fd_out,itemsize,pre_sort_function,NULL,compare_function,post_sort_function));
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  A function to sort the contents of a file of fixed length objects using a
+  limited amount of RAM and an integer sort key.
+
+  The data is sorted in the same way as filesort_fixed() except that the individual
+  sort steps use an "LSD Radix sort" http://en.wikipedia.org/wiki/Radix_sort of the
+  objects themselves on the key and then the comparison function to order objects with
+  the same key.  If the data fits in RAM the radix sort uses all of the threads.
+
+  index_t filesort_fixed_key Returns the number of objects kept.
+
+  int fd_in The file descriptor of the input file (opened for reading and at the beginning).
+
+  int fd_out The file descriptor of the output file (opened for writing and empty).
+
+  size_t itemsize The size of each item in the file that needs sorting.
+
+  int (*pre_sort_function)(void *,index_t) If non-NULL then this function is called for
+     each item before they have been sorted (as for filesort_fixed()).
+
+  uint64_t (*key_function)(const void*) If non-NULL then this function returns the sort key
+     of an item.  An item with a smaller key must compare as less than one with a larger key.
+
+  int (*compare_function)(const void*, const void*) The comparison function (used for items
+     with the same key and for merging the sorted temporary files).
+
+  int (*post_sort_function)(void *,index_t) If non-NULL then this function is called for
+     each item after they have been sorted (as for filesort_fixed()).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+index_t filesort_fixed_key(int fd_in,int fd_out,size_t itemsize,int (*pre_sort_function)(void*,index_t),
+                                                                uint64_t (*key_function)(const void*),
+                                                                int (*compare_function)(const void*,const void*),
+                                                                int (*post_sort_function)(void*,index_t))
+{
+ int nfiles=0;
  index_t count_out=0,count_in=0,total=0;
- size_t nitems=option_filesort_ramsize/(option_filesort_threads*(itemsize+sizeof(void*)));
- void *data,**datap;
+ size_t nitems;
  thread_data *threads;
  size_t item;
  int i,more=1;
+ int sortid=__atomic_add_fetch(&nsorts,1,__ATOMIC_RELAXED);
 #if defined(USE_PTHREADS) && USE_PTHREADS
  int nthreads=0;
 #endif
 
- /* Allocate the RAM buffer and other bits */
+ /* Allocate the RAM buffer and other bits (the radix sort needs two copies of the data and keys) */
+
+ if(key_function)
+    nitems=filesort_ramsize()/(option_filesort_threads*2*(itemsize+sizeof(uint64_t)));
+ else
+    nitems=filesort_ramsize()/(option_filesort_threads*(itemsize+sizeof(void*)));
 
  threads=(thread_data*)malloc(option_filesort_threads*sizeof(thread_data));
 
@@ -139,12 +274,31 @@ index_t filesort_fixed(int fd_in,int fd_out,size_t itemsize,int (*pre_sort_funct
     threads[i].running=0;
 
     threads[i].data=malloc(nitems*itemsize);
-    threads[i].datap=malloc(nitems*sizeof(void*));
 
-    threads[i].filename=(char*)malloc(strlen(option_tmpdirname)+24);
+    if(key_function)
+      {
+       threads[i].datap=NULL;
+
+       threads[i].tmp=malloc(nitems*itemsize);
+       threads[i].keys=(uint64_t*)malloc(nitems*sizeof(uint64_t));
+       threads[i].tmpkeys=(uint64_t*)malloc(nitems*sizeof(uint64_t));
+
+       logassert(threads[i].tmp && threads[i].keys && threads[i].tmpkeys,"Failed to allocate memory (try using less sorting memory?)"); /* Check malloc() worked */
+      }
+    else
+      {
+       threads[i].datap=malloc(nitems*sizeof(void*));
+
+       threads[i].tmp=NULL;
+       threads[i].keys=NULL;
+       threads[i].tmpkeys=NULL;
+      }
+
+    threads[i].filename=(char*)malloc(strlen(option_tmpdirname)+40);
 
     threads[i].itemsize=itemsize;
     threads[i].compare=compare_function;
+    threads[i].key=key_function;
    }
 
  /* Loop around, fill the buffer, sort the data and write a temporary file */
@@ -174,15 +328,18 @@ index_t filesort_fixed(int fd_in,int fd_out,size_t itemsize,int (*pre_sort_funct
 
     for(item=0;item<nitems;)
       {
-       threads[thread].datap[item]=threads[thread].data+item*itemsize;
+       void *itemp=threads[thread].data+item*itemsize;
 
-       if(ReadFileBuffered(fd_in,threads[thread].datap[item],itemsize))
+       if(threads[thread].datap)
+          threads[thread].datap[item]=itemp;
+
+       if(ReadFileBuffered(fd_in,itemp,itemsize))
          {
           more=0;
           break;
          }
 
-       if(!pre_sort_function || pre_sort_function(threads[thread].datap[item],count_in))
+       if(!pre_sort_function || pre_sort_function(itemp,count_in))
          {
           item++;
           total++;
@@ -205,13 +362,15 @@ index_t filesort_fixed(int fd_in,int fd_out,size_t itemsize,int (*pre_sort_funct
 
     /* Sort the data pointers using a heap sort (potentially in a thread) */
 
-    sprintf(threads[thread].filename,"%s/filesort.%d.tmp",option_tmpdirname,nfiles);
+    sprintf(threads[thread].filename,"%s/filesort.%d.%d.tmp",option_tmpdirname,sortid,nfiles);
 
 #if defined(USE_PTHREADS) && USE_PTHREADS
 
     /* Shortcut if only one file, don't write to disk */
 
-    if(more==0 && nfiles==0)
+    if(more==0 && nfiles==0 && key_function)
+       filesort_radixsort(&threads[thread],option_filesort_threads);
+    else if(more==0 && nfiles==0)
        filesort_heapsort(threads[thread].datap,threads[thread].n,threads[thread].compare);
     else if(option_filesort_threads>1)
       {
@@ -246,7 +405,9 @@ index_t filesort_fixed(int fd_in,int fd_out,size_t itemsize,int (*pre_sort_funct
 
     /* Shortcut if only one file, don't write to disk */
 
-    if(more==0 && nfiles==0)
+    if(more==0 && nfiles==0 && key_function)
+       filesort_radixsort(&threads[thread],1);
+    else if(more==0 && nfiles==0)
        filesort_heapsort(threads[thread].datap,threads[thread].n,threads[thread].compare);
     else
        filesort_fixed_heapsort_thread(&threads[thread]);
@@ -261,19 +422,23 @@ index_t filesort_fixed(int fd_in,int fd_out,size_t itemsize,int (*pre_sort_funct
 
 #if defined(USE_PTHREADS) && USE_PTHREADS
 
- while(option_filesort_threads>1 && nthreads)
+ if(option_filesort_threads>1)
    {
     pthread_mutex_lock(&running_mutex);
 
-    pthread_cond_wait(&running_cond,&running_mutex);
-
-    for(i=0;i<option_filesort_threads;i++)
-       if(threads[i].running==2)
-         {
-          pthread_join(threads[i].thread,NULL);
-          threads[i].running=0;
-          nthreads--;
-         }
+    while(nthreads)
+      {
+       for(i=0;i<option_filesort_threads;i++)
+          if(threads[i].running==2)
+            {
+             pthread_join(threads[i].thread,NULL);
+             threads[i].running=0;
+             nthreads--;
+            }
+
+       if(nthreads)
+          pthread_cond_wait(&running_cond,&running_mutex);
+      }
 
     pthread_mutex_unlock(&running_mutex);
    }
@@ -286,9 +451,16 @@ index_t filesort_fixed(int fd_in,int fd_out,size_t itemsize,int (*pre_sort_funct
    {
     for(item=0;item<threads[0].n;item++)
       {
-       if(!post_sort_function || post_sort_function(threads[0].datap[item],count_out))
+       void *itemp;
+
+       if(key_function)
+          itemp=threads[0].data+item*itemsize;
+       else
+          itemp=threads[0].datap[item];
+
+       if(!post_sort_function || post_sort_function(itemp,count_out))
          {
-          WriteFileBuffered(fd_out,threads[0].datap[item],itemsize);
+          WriteFileBuffered(fd_out,itemp,itemsize);
           count_out++;
          }
       }
@@ -298,146 +470,46 @@ index_t filesort_fixed(int fd_in,int fd_out,size_t itemsize,int (*pre_sort_funct
     goto tidy_and_exit;
    }
 
- /* Check that number of files is less than file size */
-
- logassert((unsigned)nfiles<nitems,"Too many temporary files (use more sorting memory?)");
-
- /* Open all of the temporary files */
-
- fds=(int*)malloc(nfiles*sizeof(int));
-
- for(i=0;i<nfiles;i++)
-   {
-    char *filename=threads[0].filename;
-
-    sprintf(filename,"%s/filesort.%d.tmp",option_tmpdirname,i);
-
-    fds[i]=ReOpenFileBuffered(filename);
-
-    DeleteFile(filename);
-   }
-
- /* Perform an n-way merge using a binary heap */
-
- heap=(int*)malloc((1+nfiles)*sizeof(int));
-
- data =threads[0].data;
- datap=threads[0].datap;
-
- /* Fill the heap to start with */
+ /* Free the sorting buffers, the merge allocates its own */
 
- for(i=0;i<nfiles;i++)
+ for(i=0;i<option_filesort_threads;i++)
    {
-    int index;
-
-    datap[i]=data+i*itemsize;
-
-    ReadFileBuffered(fds[i],datap[i],itemsize);
-
-    index=i+1;
-
-    heap[index]=i;
+    free(threads[i].data);
+    free(threads[i].datap);
 
-    /* Bubble up the new value */
+    threads[i].data=NULL;
+    threads[i].datap=NULL;
 
-    while(index>1)
+    if(threads[i].tmp)
       {
-       int newindex;
-       int temp;
-
-       newindex=index/2;
-
-       if(compare_function(datap[heap[index]],datap[heap[newindex]])>=0)
-          break;
-
-       temp=heap[index];
-       heap[index]=heap[newindex];
-       heap[newindex]=temp;
+       free(threads[i].tmp);
+       free(threads[i].keys);
+       free(threads[i].tmpkeys);
 
-       index=newindex;
+       threads[i].tmp=NULL;
       }
    }
 
- /* Repeatedly pull out the root of the heap and refill from the same file */
-
- ndata=nfiles;
-
- do
-   {
-    int index=1;
-
-    if(!post_sort_function || post_sort_function(datap[heap[index]],count_out))
-      {
-       WriteFileBuffered(fd_out,datap[heap[index]],itemsize);
-       count_out++;
-      }
-
-    if(ReadFileBuffered(fds[heap[index]],datap[heap[index]],itemsize))
-      {
-       heap[index]=heap[ndata];
-       ndata--;
-      }
-
-    /* Bubble down the new value */
-
-    while((2*index)<ndata)
-      {
-       int newindex;
-       int temp;
-
-       newindex=2*index;
-
-       if(compare_function(datap[heap[newindex]],datap[heap[newindex+1]])>=0)
-          newindex=newindex+1;
-
-       if(compare_function(datap[heap[index]],datap[heap[newindex]])<=0)
-          break;
-
-       temp=heap[newindex];
-       heap[newindex]=heap[index];
-       heap[index]=temp;
-
-       index=newindex;
-      }
-
-    if((2*index)==ndata)
-      {
-       int newindex;
-       int temp;
-
-       newindex=2*index;
+ /* Perform an n-way merge of the temporary files */
 
-       if(compare_function(datap[heap[index]],datap[heap[newindex]])<=0)
-          ; /* break */
-       else
-         {
-          temp=heap[newindex];
-          heap[newindex]=heap[index];
-          heap[index]=temp;
-         }
-      }
-   }
- while(ndata>0);
+ count_out=filesort_merge(fd_out,sortid,nfiles,itemsize,itemsize,compare_function,post_sort_function);
 
  /* Tidy up */
 
  tidy_and_exit:
 
- if(fds)
-   {
-    for(i=0;i<nfiles;i++)
-       CloseFileBuffered(fds[i]);
-    free(fds);
-   }
-
- if(heap)
-    free(heap);
-
  for(i=0;i<option_filesort_threads;i++)
    {
     free(threads[i].data);
     free(threads[i].datap);
 
+    if(threads[i].tmp)
+      {
+       free(threads[i].tmp);
+       free(threads[i].keys);
+       free(threads[i].tmpkeys);
+      }
+
     free(threads[i].filename);
    }
 
@@ -453,9 +525,10 @@ index_t filesort_fixed(int fd_in,int fd_out,size_t itemsize,int (*pre_sort_funct
 
   The data is sorted using a "Merge sort" http://en.wikipedia.org/wiki/Merge_sort
   and in particular an "external sort" http://en.wikipedia.org/wiki/External_sorting.
-  The individual sort steps and the merge step both use a "Heap sort"
-  http://en.wikipedia.org/wiki/Heapsort.  The combination of the two should work well
-  if the data is already partially sorted.
+  The individual sort steps use a "Heap sort" http://en.wikipedia.org/wiki/Heapsort
+  which should work well if the data is already partially sorted.  The merge step uses a
+  "Loser tree" http://en.wikipedia.org/wiki/K-way_merge_algorithm with large buffers for
+  each temporary file that are refilled in the background.
 
   index_t filesort_vary Returns the number of objects kept.
 
@@ -481,15 +554,14 @@ index_t filesort_vary(int fd_in,int fd_out,int (*pre_sort_function)(void*,index_
                                            int (*compare_function)(const void*,const void*),
                                            int (*post_sort_function)(void*,index_t))
 {
- int *fds=NULL,*heap=NULL;
- int nfiles=0,ndata=0;
+ int nfiles=0;
  index_t count_out=0,count_in=0,total=0;
- size_t datasize=option_filesort_ramsize/option_filesort_threads;
+ size_t datasize=filesort_ramsize()/option_filesort_threads;
  FILESORT_VARINT nextitemsize,largestitemsize=0;
- void *data,**datap;
  thread_data *threads;
  size_t item;
  int i,more=1;
+ int sortid=__atomic_add_fetch(&nsorts,1,__ATOMIC_RELAXED);
 #if defined(USE_PTHREADS) && USE_PTHREADS
  int nthreads=0;
 #endif
@@ -505,7 +577,7 @@ index_t filesort_vary(int fd_in,int fd_out,int (*pre_sort_function)(void*,index_
     threads[i].data=malloc(datasize);
     threads[i].datap=NULL;
 
-    threads[i].filename=(char*)malloc(strlen(option_tmpdirname)+24);
+    threads[i].filename=(char*)malloc(strlen(option_tmpdirname)+40);
 
     threads[i].compare=compare_function;
    }
@@ -590,7 +662,7 @@ index_t filesort_vary(int fd_in,int fd_out,int (*pre_sort_function)(void*,index_
     if(more==0 && nfiles==0)
        threads[thread].filename[0]=0;
     else
-       sprintf(threads[thread].filename,"%s/filesort.%d.tmp",option_tmpdirname,nfiles);
+       sprintf(threads[thread].filename,"%s/filesort.%d.%d.tmp",option_tmpdirname,sortid,nfiles);
 
 #if defined(USE_PTHREADS) && USE_PTHREADS
 
@@ -646,19 +718,23 @@ index_t filesort_vary(int fd_in,int fd_out,int (*pre_sort_function)(void*,index_
 
 #if defined(USE_PTHREADS) && USE_PTHREADS
 
- while(option_filesort_threads>1 && nthreads)
+ if(option_filesort_threads>1)
    {
     pthread_mutex_lock(&running_mutex);
 
-    pthread_cond_wait(&running_cond,&running_mutex);
-
-    for(i=0;i<option_filesort_threads;i++)
-       if(threads[i].running==2)
-         {
-          pthread_join(threads[i].thread,NULL);
-          threads[i].running=0;
-          nthreads--;
-         }
+    while(nthreads)
+      {
+       for(i=0;i<option_filesort_threads;i++)
+          if(threads[i].running==2)
+            {
+             pthread_join(threads[i].thread,NULL);
+             threads[i].running=0;
+             nthreads--;
+            }
+
+       if(nthreads)
+          pthread_cond_wait(&running_cond,&running_mutex);
+      }
 
     pthread_mutex_unlock(&running_mutex);
    }
@@ -685,193 +761,612 @@ index_t filesort_vary(int fd_in,int fd_out,int (*pre_sort_function)(void*,index_
     goto tidy_and_exit;
    }
 
- /* Check that number of files is less than file size */
+ /* Free the sorting buffers, the merge allocates its own */
 
- largestitemsize=FILESORT_VARALIGN*(1+(largestitemsize+FILESORT_VARALIGN-FILESORT_VARSIZE)/FILESORT_VARALIGN);
+ for(i=0;i<option_filesort_threads;i++)
+   {
+    free(threads[i].data);
 
- logassert((unsigned)nfiles<((datasize-nfiles*sizeof(void*))/largestitemsize),"Too many temporary files (use more sorting memory?)");
+    threads[i].data=NULL;
+   }
 
- /* Open all of the temporary files */
+ /* Perform an n-way merge of the temporary files */
 
- fds=(int*)malloc(nfiles*sizeof(int));
+ count_out=filesort_merge(fd_out,sortid,nfiles,0,FILESORT_VARALIGN*(1+(largestitemsize+FILESORT_VARALIGN-FILESORT_VARSIZE)/FILESORT_VARALIGN),
+                          compare_function,post_sort_function);
 
- for(i=0;i<nfiles;i++)
-   {
-    char *filename=threads[0].filename;
+ /* Tidy up */
 
-    sprintf(filename,"%s/filesort.%d.tmp",option_tmpdirname,i);
+ tidy_and_exit:
 
-    fds[i]=ReOpenFileBuffered(filename);
+ for(i=0;i<option_filesort_threads;i++)
+   {
+    free(threads[i].data);
 
-    DeleteFile(filename);
+    free(threads[i].filename);
    }
 
- /* Perform an n-way merge using a binary heap */
+ free(threads);
 
- heap=(int*)malloc((1+nfiles)*sizeof(int));
+ return(count_out);
+}
 
- data=threads[0].data;
- datap=data+datasize-nfiles*sizeof(void*);
 
- /* Fill the heap to start with */
+/*++++++++++++++++++++++++++++++++++++++
+  Set the amount of RAM to use for the sorts in the current thread (when several threads are
+  sorting at once and each one is given a part of the RAM set by the '--sort-ram-size' option).
 
- for(i=0;i<nfiles;i++)
-   {
-    int index;
-    FILESORT_VARINT itemsize;
+  size_t ramsize The amount of RAM or 0 to use the whole amount set by the option.
+  ++++++++++++++++++++++++++++++++++++++*/
 
-    datap[i]=data+FILESORT_VARALIGN-FILESORT_VARSIZE+i*largestitemsize;
+void filesort_thread_ramsize(size_t ramsize)
+{
+#if defined(USE_PTHREADS) && USE_PTHREADS
+ thread_ramsize=ramsize;
+#endif
+}
 
-    ReadFileBuffered(fds[i],&itemsize,FILESORT_VARSIZE);
 
-    *(FILESORT_VARINT*)(datap[i]-FILESORT_VARSIZE)=itemsize;
+/*++++++++++++++++++++++++++++++++++++++
+  Get the amount of RAM to use for a sort in the current thread.
 
-    ReadFileBuffered(fds[i],datap[i],itemsize);
+  size_t filesort_ramsize Returns the amount of RAM.
+  ++++++++++++++++++++++++++++++++++++++*/
 
-    index=i+1;
+static size_t filesort_ramsize(void)
+{
+#if defined(USE_PTHREADS) && USE_PTHREADS
+ if(thread_ramsize)
+    return(thread_ramsize);
+#endif
 
-    heap[index]=i;
+ return(option_filesort_ramsize);
+}
 
-    /* Bubble up the new value */
 
-    while(index>1)
-      {
-       int newindex;
-       int temp;
+/*++++++++++++++++++++++++++++++++++++++
+  Merge the temporary files that have been written by the sorting functions.
 
-       newindex=index/2;
+  The merge uses a "Loser tree" so that only one comparison per level of the tree is
+  needed for each item.  Each temporary file is read in large blocks using a buffer size
+  that is calculated from the amount of sorting RAM, while one buffer is being used the
+  other one is refilled by a background thread.
 
-       if(compare_function(datap[heap[index]],datap[heap[newindex]])>=0)
-          break;
+  index_t filesort_merge Returns the number of objects kept.
 
-       temp=heap[index];
-       heap[index]=heap[newindex];
-       heap[newindex]=temp;
+  int fd_out The file descriptor of the output file (opened for writing and empty).
 
-       index=newindex;
-      }
-   }
+  int sortid The number of the sort (used in the temporary filenames).
 
- /* Repeatedly pull out the root of the heap and refill from the same file */
+  int nfiles The number of temporary files.
 
- ndata=nfiles;
+  size_t itemsize The size of each item or 0 for variable length items (each preceded by its
+     length in FILESORT_VARSIZE bytes).
 
- do
-   {
-    int index=1;
-    FILESORT_VARINT itemsize;
+  size_t slotsize The amount of memory to allocate for the current item from each file.
 
-    if(!post_sort_function || post_sort_function(datap[heap[index]],count_out))
-      {
-       itemsize=*(FILESORT_VARINT*)(datap[heap[index]]-FILESORT_VARSIZE);
+  int (*compare_function)(const void*, const void*) The comparison function.
 
-       WriteFileBuffered(fd_out,datap[heap[index]]-FILESORT_VARSIZE,itemsize+FILESORT_VARSIZE);
-       count_out++;
-      }
+  int (*post_sort_function)(void *,index_t) If non-NULL then this function is called for
+     each item after they have been sorted.
+  ++++++++++++++++++++++++++++++++++++++*/
 
-    if(ReadFileBuffered(fds[heap[index]],&itemsize,FILESORT_VARSIZE))
-      {
-       heap[index]=heap[ndata];
-       ndata--;
-      }
-    else
-      {
-       *(FILESORT_VARINT*)(datap[heap[index]]-FILESORT_VARSIZE)=itemsize;
+static index_t filesort_merge(int fd_out,int sortid,int nfiles,size_t itemsize,size_t slotsize,
+                              int (*compare_function)(const void*,const void*),
+                              int (*post_sort_function)(void*,index_t))
+{
+ merge_data merge;
+ char *filename,*slots,*buffers;
+ index_t count_out=0;
+ struct timeval start_time;
+ int nbuffers=1;
+ int i,j,node;
 
-       ReadFileBuffered(fds[heap[index]],datap[heap[index]],itemsize);
-      }
+ if(option_logtime)
+    gettimeofday(&start_time,NULL);
 
-    /* Bubble down the new value */
+#if defined(USE_PTHREADS) && USE_PTHREADS
+ nbuffers=2;
+#endif
 
-    while((2*index)<ndata)
-      {
-       int newindex;
-       int temp;
+ /* Allocate the buffers (at least 64 kB each, ideally using all of the sorting RAM) */
 
-       newindex=2*index;
+ merge.buffersize=filesort_ramsize()/(nbuffers*nfiles);
+ merge.buffersize&=~(size_t)4095;
 
-       if(compare_function(datap[heap[newindex]],datap[heap[newindex+1]])>=0)
-          newindex=newindex+1;
+ if(merge.buffersize<65536)
+    merge.buffersize=65536;
 
-       if(compare_function(datap[heap[index]],datap[heap[newindex]])<=0)
-          break;
+ merge.nruns=nfiles;
+ merge.itemsize=itemsize;
+ merge.compare=compare_function;
+ merge.bytes=0;
 
-       temp=heap[newindex];
-       heap[newindex]=heap[index];
-       heap[index]=temp;
+ merge.runs=(merge_run*)malloc(nfiles*sizeof(merge_run));
+ merge.datap=(void**)malloc(nfiles*sizeof(void*));
+ merge.tree=(int*)malloc(nfiles*sizeof(int));
 
-       index=newindex;
-      }
+ slots=(char*)malloc(nfiles*slotsize+FILESORT_VARALIGN);
+ buffers=(char*)malloc(nbuffers*nfiles*merge.buffersize);
 
-    if((2*index)==ndata)
-      {
-       int newindex;
-       int temp;
+ logassert(merge.runs && merge.datap && merge.tree && slots && buffers,"Failed to allocate memory (try using less sorting memory?)"); /* Check malloc() worked */
 
-       newindex=2*index;
+ /* Open all of the temporary files and read the first item from each */
 
-       if(compare_function(datap[heap[index]],datap[heap[newindex]])<=0)
-          ; /* break */
-       else
-         {
-          temp=heap[newindex];
-          heap[newindex]=heap[index];
-          heap[index]=temp;
-         }
-      }
-   }
- while(ndata>0);
+ filename=(char*)malloc(strlen(option_tmpdirname)+40);
 
- /* Tidy up */
+ for(i=0;i<nfiles;i++)
+   {
+    merge_run *run=&merge.runs[i];
 
- tidy_and_exit:
+    sprintf(filename,"%s/filesort.%d.%d.tmp",option_tmpdirname,sortid,i);
 
- if(fds)
-   {
-    for(i=0;i<nfiles;i++)
-       CloseFileBuffered(fds[i]);
-    free(fds);
-   }
+    if(option_tmpcompress)
+       run->fd=ReOpenFileBuffered(filename);
+    else
+       run->fd=OpenFile(filename);
 
- if(heap)
-    free(heap);
+    DeleteFile(filename);
 
- for(i=0;i<option_filesort_threads;i++)
-   {
-    free(threads[i].data);
+    for(j=0;j<nbuffers;j++)
+      {
+       run->buffer[j]=buffers+(nbuffers*i+j)*merge.buffersize;
+       run->length[j]=0;
+       run->full[j]=0;
+      }
 
-    free(threads[i].filename);
+    run->length[0]=filesort_merge_fill_buffer(run->fd,run->buffer[0],merge.buffersize);
+    run->full[0]=1;
+
+    run->current=0;
+    run->position=0;
+
+    run->eof=0;
    }
 
- free(threads);
+ free(filename);
 
- return(count_out);
-}
+ /* Start the thread that refills the buffers */
 
+#if defined(USE_PTHREADS) && USE_PTHREADS
 
-/*++++++++++++++++++++++++++++++++++++++
-  A wrapper function that can be run in a thread for fixed data.
+ merge.stop=0;
+ merge.wanted=-1;
+ merge.next=0;
 
-  void *filesort_fixed_heapsort_thread Returns NULL (required to return void*).
+ pthread_mutex_init(&merge.mutex,NULL);
+ pthread_cond_init(&merge.cond,NULL);
 
-  thread_data *thread The data to be processed in this thread.
-  ++++++++++++++++++++++++++++++++++++++*/
+ pthread_create(&merge.thread,NULL,(void* (*)(void*))filesort_merge_prefetch_thread,&merge);
 
-static void *filesort_fixed_heapsort_thread(thread_data *thread)
-{
+#endif
+
+ for(i=0;i<nfiles;i++)
+   {
+    if(itemsize)
+       merge.datap[i]=slots+i*slotsize;
+    else
+       merge.datap[i]=slots+FILESORT_VARALIGN-FILESORT_VARSIZE+i*slotsize;
+
+    merge.runs[i].finished=filesort_merge_read_item(&merge,i);
+   }
+
+ /* Build the loser tree by playing each run up from its leaf, the first to arrive at a node waits there */
+
+ for(node=0;node<nfiles;node++)
+    merge.tree[node]=-1;
+
+ for(i=0;i<nfiles;i++)
+   {
+    int winner=i;
+
+    for(node=(i+nfiles)/2;node>0;node/=2)
+      {
+       if(merge.tree[node]==-1)
+          break;
+
+       if(filesort_merge_less(&merge,merge.tree[node],winner))
+         {
+          int temp=winner;
+          winner=merge.tree[node];
+          merge.tree[node]=temp;
+         }
+      }
+
+    if(node>0)
+       merge.tree[node]=winner;
+    else
+       merge.tree[0]=winner;
+   }
+
+ /* Repeatedly output the winner, refill from the same file and replay its path up the tree */
+
+ while(!merge.runs[merge.tree[0]].finished)
+   {
+    int winner=merge.tree[0];
+    void *itemp=merge.datap[winner];
+
+    if(!post_sort_function || post_sort_function(itemp,count_out))
+      {
+       if(itemsize)
+          WriteFileBuffered(fd_out,itemp,itemsize);
+       else
+          WriteFileBuffered(fd_out,itemp-FILESORT_VARSIZE,*(FILESORT_VARINT*)(itemp-FILESORT_VARSIZE)+FILESORT_VARSIZE);
+
+       count_out++;
+      }
+
+    merge.runs[winner].finished=filesort_merge_read_item(&merge,winner);
+
+    for(node=(winner+nfiles)/2;node>0;node/=2)
+       if(filesort_merge_less(&merge,merge.tree[node],winner))
+         {
+          int temp=winner;
+          winner=merge.tree[node];
+          merge.tree[node]=temp;
+         }
+
+    merge.tree[0]=winner;
+   }
+
+ /* Stop the prefetch thread */
+
+#if defined(USE_PTHREADS) && USE_PTHREADS
+
+ pthread_mutex_lock(&merge.mutex);
+
+ merge.stop=1;
+
+ pthread_cond_broadcast(&merge.cond);
+
+ pthread_mutex_unlock(&merge.mutex);
+
+ pthread_join(merge.thread,NULL);
+
+ pthread_mutex_destroy(&merge.mutex);
+ pthread_cond_destroy(&merge.cond);
+
+#endif
+
+ /* Report the merge throughput */
+
+ if(option_logtime)
+   {
+    struct timeval finish_time;
+    double seconds,megabytes=(double)merge.bytes/(1024*1024);
+
+    gettimeofday(&finish_time,NULL);
+
+    seconds=(finish_time.tv_sec-start_time.tv_sec)+(finish_time.tv_usec-start_time.tv_usec)/1.0E6;
+
+    if(seconds<1.0E-3)
+       seconds=1.0E-3;
+
+    printf_last_extra(" [Merged %d files: %.1f MB at %.1f MB/s]",nfiles,megabytes,megabytes/seconds);
+   }
+
+ /* Tidy up */
+
+ for(i=0;i<nfiles;i++)
+    if(option_tmpcompress)
+       CloseFileBuffered(merge.runs[i].fd);
+    else
+       CloseFile(merge.runs[i].fd);
+
+ free(merge.runs);
+ free(merge.datap);
+ free(merge.tree);
+ free(slots);
+ free(buffers);
+
+ return(count_out);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Decide whether the current item from one temporary file comes before that from another.
+
+  int filesort_merge_less Returns 1 if the item from the first file comes first.
+
+  merge_data *merge The merge state.
+
+  int run1 The first temporary file.
+
+  int run2 The second temporary file.
+
+  Files that are finished come last and items that compare equally are taken in file order
+  (the same as the order of their addresses for FILESORT_PRESERVE_ORDER).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int filesort_merge_less(merge_data *merge,int run1,int run2)
+{
+ int result;
+
+ if(merge->runs[run1].finished)
+    return(0);
+
+ if(merge->runs[run2].finished)
+    return(1);
+
+ result=merge->compare(merge->datap[run1],merge->datap[run2]);
+
+ if(result)
+    return(result<0);
+
+ return(run1<run2);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Read the next item from one of the temporary files into its slot.
+
+  int filesort_merge_read_item Returns 1 if there are no more items in the file.
+
+  merge_data *merge The merge state.
+
+  int run The temporary file to read from.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int filesort_merge_read_item(merge_data *merge,int run)
+{
+ void *itemp=merge->datap[run];
+
+ if(merge->itemsize)
+    return(filesort_merge_read(merge,run,itemp,merge->itemsize));
+
+ if(filesort_merge_read(merge,run,itemp-FILESORT_VARSIZE,FILESORT_VARSIZE))
+    return(1);
+
+ return(filesort_merge_read(merge,run,itemp,*(FILESORT_VARINT*)(itemp-FILESORT_VARSIZE)));
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Copy data out of the buffers of one of the temporary files.
+
+  int filesort_merge_read Returns 1 if the end of the file was reached.
+
+  merge_data *merge The merge state.
+
+  int run The temporary file to read from.
+
+  void *address The address the data is to be copied into.
+
+  size_t length The length of data to copy.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int filesort_merge_read(merge_data *merge,int run,void *address,size_t length)
+{
+ merge_run *runp=&merge->runs[run];
+
+ while(length>0)
+   {
+    size_t available=runp->length[runp->current]-runp->position;
+
+    if(available==0)
+      {
+       if(filesort_merge_next_buffer(merge,run))
+          return(1);
+
+       continue;
+      }
+
+    if(available>length)
+       available=length;
+
+    memcpy(address,runp->buffer[runp->current]+runp->position,available);
+
+    address+=available;
+    length-=available;
+
+    runp->position+=available;
+
+    merge->bytes+=available;
+   }
+
+ return(0);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Switch to the next buffer of data for one of the temporary files.
+
+  int filesort_merge_next_buffer Returns 1 if there is no more data in the file.
+
+  merge_data *merge The merge state.
+
+  int run The temporary file.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int filesort_merge_next_buffer(merge_data *merge,int run)
+{
+ merge_run *runp=&merge->runs[run];
+
+#if defined(USE_PTHREADS) && USE_PTHREADS
+
+ int other=1-runp->current;
+
+ /* Wait for the prefetch thread to fill the other buffer then hand back this one */
+
+ pthread_mutex_lock(&merge->mutex);
+
+ if(!runp->full[other])
+   {
+    merge->wanted=run;
+
+    pthread_cond_broadcast(&merge->cond);
+
+    while(!runp->full[other])
+       pthread_cond_wait(&merge->cond,&merge->mutex);
+   }
+
+ merge->wanted=-1;
+
+ runp->full[runp->current]=0;
+ runp->current=other;
+ runp->position=0;
+
+ pthread_cond_broadcast(&merge->cond);
+
+ pthread_mutex_unlock(&merge->mutex);
+
+#else
+
+ /* Refill the only buffer */
+
+ runp->length[0]=filesort_merge_fill_buffer(runp->fd,runp->buffer[0],merge->buffersize);
+ runp->position=0;
+
+#endif
+
+ return(runp->length[runp->current]==0);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Fill a buffer with data from a temporary file.
+
+  size_t filesort_merge_fill_buffer Returns the amount of data read (less than requested at the end of the file).
+
+  int fd The file descriptor to read from.
+
+  char *buffer The buffer to fill.
+
+  size_t length The size of the buffer.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static size_t filesort_merge_fill_buffer(int fd,char *buffer,size_t length)
+{
+ size_t total=0;
+
+ /* Compressed temporary files are decompressed as they are read */
+
+ if(option_tmpcompress)
+    return(ReadFileBufferedPartial(fd,buffer,length));
+
+ while(total<length)
+   {
+    ssize_t len=read(fd,buffer+total,length-total);
+
+    if(len<0)
+      {
+       fprintf(stderr,"Cannot read temporary file for merging [%s].\n",strerror(errno));
+       exit(EXIT_FAILURE);
+      }
+
+    if(len==0)
+       break;
+
+    total+=len;
+   }
+
+ return(total);
+}
+
+
+#if defined(USE_PTHREADS) && USE_PTHREADS
+
+/*++++++++++++++++++++++++++++++++++++++
+  The thread that refills the spare buffer of each temporary file while the merge uses the other one.
+
+  void *filesort_merge_prefetch_thread Returns NULL (required to return void*).
+
+  merge_data *merge The merge state.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void *filesort_merge_prefetch_thread(merge_data *merge)
+{
+ pthread_mutex_lock(&merge->mutex);
+
+ while(!merge->stop)
+   {
+    merge_run *run=NULL;
+    int other=0,i;
+
+    /* Choose the file that the merge is waiting for or else the next one that needs a refill */
+
+    if(merge->wanted>=0)
+      {
+       run=&merge->runs[merge->wanted];
+       other=1-run->current;
+
+       if(run->full[other] || run->eof)
+          run=NULL;
+      }
+
+    for(i=0;!run && i<merge->nruns;i++)
+      {
+       merge_run *check=&merge->runs[(merge->next+i)%merge->nruns];
+
+       other=1-check->current;
+
+       if(!check->full[other] && !check->eof)
+         {
+          run=check;
+          merge->next=(merge->next+i+1)%merge->nruns;
+         }
+      }
+
+    if(!run)
+      {
+       pthread_cond_wait(&merge->cond,&merge->mutex);
+       continue;
+      }
+
+    /* Read the data without holding the lock, the merge cannot use this buffer until it is full */
+
+    pthread_mutex_unlock(&merge->mutex);
+
+    run->length[other]=filesort_merge_fill_buffer(run->fd,run->buffer[other],merge->buffersize);
+
+    pthread_mutex_lock(&merge->mutex);
+
+    if(run->length[other]==0)
+       run->eof=1;
+
+    run->full[other]=1;
+
+    pthread_cond_broadcast(&merge->cond);
+   }
+
+ pthread_mutex_unlock(&merge->mutex);
+
+ return(NULL);
+}
+
+#endif
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  A wrapper function that can be run in a thread for fixed data.
+
+  void *filesort_fixed_heapsort_thread Returns NULL (required to return void*).
+
+  thread_data *thread The data to be processed in this thread.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void *filesort_fixed_heapsort_thread(thread_data *thread)
+{
  int fd;
  size_t item;
 
- /* Sort the data pointers using a heap sort */
+ /* Sort the data pointers using a heap sort (or the data using a radix sort) */
 
- filesort_heapsort(thread->datap,thread->n,thread->compare);
+ if(thread->key)
+    filesort_radixsort(thread,1);
+ else
+    filesort_heapsort(thread->datap,thread->n,thread->compare);
 
  /* Create a temporary file and write the result */
 
- fd=OpenFileBufferedNew(thread->filename);
+ fd=OpenFileBufferedNewTemporary(thread->filename);
 
- for(item=0;item<thread->n;item++)
-    WriteFileBuffered(fd,thread->datap[item],thread->itemsize);
+ if(thread->key)
+    for(item=0;item<thread->n;item++)
+       WriteFileBuffered(fd,thread->data+item*thread->itemsize,thread->itemsize);
+ else
+    for(item=0;item<thread->n;item++)
+       WriteFileBuffered(fd,thread->datap[item],thread->itemsize);
 
  CloseFileBuffered(fd);
 
@@ -883,7 +1378,7 @@ static void *filesort_fixed_heapsort_thread(thread_data *thread)
 
     thread->running=2;
 
-    pthread_cond_signal(&running_cond);
+    pthread_cond_broadcast(&running_cond);
 
     pthread_mutex_unlock(&running_mutex);
    }
@@ -913,7 +1408,7 @@ static void *filesort_vary_heapsort_thread(thread_data *thread)
 
  /* Create a temporary file and write the result */
 
- fd=OpenFileBufferedNew(thread->filename);
+ fd=OpenFileBufferedNewTemporary(thread->filename);
 
  for(item=0;item<thread->n;item++)
    {
@@ -932,7 +1427,7 @@ static void *filesort_vary_heapsort_thread(thread_data *thread)
 
     thread->running=2;
 
-    pthread_cond_signal(&running_cond);
+    pthread_cond_broadcast(&running_cond);
 
     pthread_mutex_unlock(&running_mutex);
    }
@@ -943,6 +1438,258 @@ static void *filesort_vary_heapsort_thread(thread_data *thread)
 }
 
 
+/*++++++++++++++++++++++++++++++++++++++
+  A function to sort an array of fixed length objects on their keys efficiently.
+
+  The data is sorted using an "LSD Radix sort" http://en.wikipedia.org/wiki/Radix_sort
+  one byte of the key at a time (skipping bytes that are the same for all objects) by
+  moving the objects and keys between the two arrays.  Objects with the same key are
+  then sorted with the comparison function using an insertion sort; since the radix
+  sort is stable they are still in their original order at that point.
+
+  thread_data *thread The data to be sorted (the data and tmp arrays are swapped if needed).
+
+  int nthreads The number of threads to use.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void filesort_radixsort(thread_data *thread,int nthreads)
+{
+ radix_data *radix;
+ size_t n=thread->n,itemsize=thread->itemsize;
+ size_t item,first;
+ int i,digit,value;
+
+ if(n<2)
+    return;
+
+#if defined(USE_PTHREADS) && USE_PTHREADS
+
+ if(n<(size_t)nthreads*65536)
+    nthreads=1+n/65536;
+
+#else
+
+ nthreads=1;
+
+#endif
+
+ radix=(radix_data*)calloc(nthreads,sizeof(radix_data));
+
+ logassert(radix,"Failed to allocate memory"); /* Check calloc() worked */
+
+ for(i=0;i<nthreads;i++)
+   {
+    radix[i].sort=thread;
+    radix[i].first=(n*i)/nthreads;
+    radix[i].last =(n*(i+1))/nthreads;
+   }
+
+ /* Calculate the keys and count the values of every digit */
+
+ for(i=0;i<nthreads;i++)
+    radix[i].shift=-1;
+
+#if defined(USE_PTHREADS) && USE_PTHREADS
+
+ for(i=1;i<nthreads;i++)
+    pthread_create(&radix[i].thread,NULL,(void* (*)(void*))filesort_radix_count_thread,&radix[i]);
+
+#endif
+
+ filesort_radix_count_thread(&radix[0]);
+
+#if defined(USE_PTHREADS) && USE_PTHREADS
+
+ for(i=1;i<nthreads;i++)
+    pthread_join(radix[i].thread,NULL);
+
+#endif
+
+ /* Sort on each digit in turn from the least significant */
+
+ for(digit=0;digit<8;digit++)
+   {
+    size_t total=0;
+    void *tmp;
+    uint64_t *tmpkeys;
+
+    /* Skip the digit if every object has the same value */
+
+    for(value=0;value<256;value++)
+      {
+       size_t count=0;
+
+       for(i=0;i<nthreads;i++)
+          count+=radix[i].counts[digit][value];
+
+       if(count==n)
+          break;
+      }
+
+    if(value<256)
+       continue;
+
+    /* Count the values of the digit in each part (already known for the first digit) */
+
+    if(nthreads>1)
+      {
+       for(i=0;i<nthreads;i++)
+          radix[i].shift=8*digit;
+
+#if defined(USE_PTHREADS) && USE_PTHREADS
+
+       for(i=1;i<nthreads;i++)
+          pthread_create(&radix[i].thread,NULL,(void* (*)(void*))filesort_radix_count_thread,&radix[i]);
+
+       filesort_radix_count_thread(&radix[0]);
+
+       for(i=1;i<nthreads;i++)
+          pthread_join(radix[i].thread,NULL);
+
+#endif
+      }
+
+    /* Convert the counts into output positions (by value and then by part) */
+
+    for(value=0;value<256;value++)
+       for(i=0;i<nthreads;i++)
+         {
+          size_t count=radix[i].counts[digit][value];
+
+          radix[i].counts[digit][value]=total;
+
+          total+=count;
+         }
+
+    /* Move the objects and keys */
+
+    for(i=0;i<nthreads;i++)
+       radix[i].shift=8*digit;
+
+#if defined(USE_PTHREADS) && USE_PTHREADS
+
+    for(i=1;i<nthreads;i++)
+       pthread_create(&radix[i].thread,NULL,(void* (*)(void*))filesort_radix_scatter_thread,&radix[i]);
+
+#endif
+
+    filesort_radix_scatter_thread(&radix[0]);
+
+#if defined(USE_PTHREADS) && USE_PTHREADS
+
+    for(i=1;i<nthreads;i++)
+       pthread_join(radix[i].thread,NULL);
+
+#endif
+
+    tmp=thread->tmp;
+    thread->tmp=thread->data;
+    thread->data=tmp;
+
+    tmpkeys=thread->tmpkeys;
+    thread->tmpkeys=thread->keys;
+    thread->keys=tmpkeys;
+   }
+
+ free(radix);
+
+ /* Sort the objects with the same key using the comparison function */
+
+ for(first=0,item=1;item<=n;item++)
+    if(item==n || thread->keys[item]!=thread->keys[first])
+      {
+       size_t this,that;
+
+       for(this=first+1;this<item;this++)
+          for(that=this;that>first;that--)
+            {
+             void *a=thread->data+(that-1)*itemsize;
+             void *b=thread->data+that*itemsize;
+
+             if(thread->compare(a,b)<=0)
+                break;
+
+             memcpy(thread->tmp,a,itemsize);
+             memcpy(a,b,itemsize);
+             memcpy(b,thread->tmp,itemsize);
+            }
+
+       first=item;
+      }
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  A function that can be run in a thread to calculate the keys or count the values of a digit
+  for one part of the data being radix sorted.
+
+  void *filesort_radix_count_thread Returns NULL (required to return void*).
+
+  radix_data *radix The part of the data to process.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void *filesort_radix_count_thread(radix_data *radix)
+{
+ thread_data *thread=radix->sort;
+ size_t item;
+ int digit;
+
+ if(radix->shift<0)
+   {
+    for(item=radix->first;item<radix->last;item++)
+      {
+       uint64_t key=thread->key(thread->data+item*thread->itemsize);
+
+       thread->keys[item]=key;
+
+       for(digit=0;digit<8;digit++)
+          radix->counts[digit][(key>>(8*digit))&0xff]++;
+      }
+   }
+ else
+   {
+    digit=radix->shift/8;
+
+    memset(radix->counts[digit],0,sizeof(radix->counts[digit]));
+
+    for(item=radix->first;item<radix->last;item++)
+       radix->counts[digit][(thread->keys[item]>>radix->shift)&0xff]++;
+   }
+
+ return(NULL);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  A function that can be run in a thread to move one part of the data being radix sorted
+  into its positions for one digit.
+
+  void *filesort_radix_scatter_thread Returns NULL (required to return void*).
+
+  radix_data *radix The part of the data to process.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void *filesort_radix_scatter_thread(radix_data *radix)
+{
+ thread_data *thread=radix->sort;
+ size_t *positions=radix->counts[radix->shift/8];
+ size_t itemsize=thread->itemsize;
+ size_t item;
+
+ for(item=radix->first;item<radix->last;item++)
+   {
+    uint64_t key=thread->keys[item];
+    size_t position=positions[(key>>radix->shift)&0xff]++;
+
+    thread->tmpkeys[position]=key;
+
+    memcpy(thread->tmp+position*itemsize,thread->data+item*itemsize,itemsize);
+   }
+
+ return(NULL);
+}
+
+
 /*++++++++++++++++++++++++++++++++++++++
   A function to sort an array of pointers efficiently.
 
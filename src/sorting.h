@@ -49,11 +49,18 @@ index_t filesort_fixed(int fd_in,int fd_out,size_t itemsize,int (*pre_sort_funct
                                                             int (*compare_function)(const void*,const void*),
                                                             int (*post_sort_function)(void*,index_t));
 
+index_t filesort_fixed_key(int fd_in,int fd_out,size_t itemsize,int (*pre_sort_function)(void*,index_t),
+                                                                uint64_t (*key_function)(const void*),
+                                                                int (*compare_function)(const void*,const void*),
+                                                                int (*post_sort_function)(void*,index_t));
+
 index_t filesort_vary(int fd_in,int fd_out,int (*pre_sort_function)(void*,index_t),
                                            int (*compare_function)(const void*,const void*),
                                            int (*post_sort_function)(void*,index_t));
 
 void filesort_heapsort(void **datap,size_t nitems,int(*compare)(const void*, const void*));
 
+void filesort_thread_ramsize(size_t ramsize);
+
 
 #endif /* SORTING_H */
@@ -5,225 +5,685 @@
  * Created on April 28, 2013, 12:01 AM
  */
 
-//#define SRTMSLIM 1
-
 #include <stdio.h> 
 #include <stdlib.h> //exit
 #include <stdint.h> //int16_t
+#include <string.h> //memcpy
 #include <math.h>
 
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
 #include "srtmHgtReader.h" //fmod
 
 //const int secondsPerPx = 1;  //arc seconds per pixel (3 equals cca 90m)
 //const int totalPx = 3601;
 //const char* folder = "aster";
 
-const int secondsPerPx = 3;  //arc seconds per pixel (3 equals cca 90m)
-const int totalPx = 1201;
+//the resolution of the .hgt files, or of the tiled elevation file once it is opened
+static int secondsPerPx = 3;  //arc seconds per pixel (3 equals cca 90m)
+static int totalPx = 1201;
 const char* folder = "srtm";
 
-FILE* srtmFd = NULL;
+static int srtmMaxTiles = SRTM_CACHE_TILES;
+
+//the tiled elevation file (shared by all caches) or NULL to use the .hgt files
+static unsigned char* srtmFile = NULL;
+static size_t srtmFileSize = 0;
+
+
+/** Sets the maximum number of tiles kept open by each cache (before any are created) */
+
+void srtmSetCacheSize(int ntiles){
+
+    if(ntiles < 1) ntiles = 1;
+
+    srtmMaxTiles = ntiles;
+}
+
+
+/** Maps a tiled elevation file written by srtmtiler, used instead of the .hgt files by all caches */
+
+void srtmOpenFile(const char* filename){
+
+    int fd = open(filename, O_RDONLY);
+
+    if(fd < 0) {
+        printf("Error opening %s\n", filename);
+        exit(1);
+    }
+
+    struct stat buf;
+
+    if(fstat(fd, &buf) || buf.st_size < (off_t)sizeof(TSrtmFileHeader)) {
+        printf("Error: %s is not a tiled elevation file\n", filename);
+        exit(1);
+    }
+
+    srtmFileSize = buf.st_size;
+    srtmFile = mmap(NULL, srtmFileSize, PROT_READ, MAP_SHARED, fd, 0);
+
+    close(fd);
+
+    if(srtmFile == MAP_FAILED) {
+        printf("Error mapping %s\n", filename);
+        exit(1);
+    }
+
+    const TSrtmFileHeader* header = (const TSrtmFileHeader*) srtmFile;
+    size_t tileSize = 2 * (size_t)header->totalPx * header->totalPx;
+
+    if(memcmp(header->magic, SRTM_FILE_MAGIC, 8) || header->version != SRTM_FILE_VERSION) {
+        printf("Error: %s is not a tiled elevation file (or is an old version)\n", filename);
+        exit(1);
+    }
+
+    if(header->byteOrder != SRTM_FILE_BYTEORDER) {
+        printf("Error: %s was created on a computer with a different byte order\n", filename);
+        exit(1);
+    }
+
+    if((header->totalPx - 1) * header->secondsPerPx != 3600 ||
+       srtmFileSize < SRTM_FILE_ALIGN * ((sizeof(TSrtmFileHeader) + SRTM_FILE_ALIGN - 1) / SRTM_FILE_ALIGN) + header->nTiles * tileSize) {
+        printf("Error: %s is truncated or has an invalid resolution\n", filename);
+        exit(1);
+    }
+
+    secondsPerPx = header->secondsPerPx;
+    totalPx = header->totalPx;
+}
+
+
+/** Unmaps the tiled elevation file (after all of the caches are closed) */
+
+void srtmCloseFile(void){
+
+    if(srtmFile != NULL) {
+        munmap(srtmFile, srtmFileSize);
+        srtmFile = NULL;
+    }
+}
+
+
+/** Returns the tile from the tiled elevation file (no system calls, just the index lookup) or NULL for a hole */
+
+static inline unsigned char* srtmFileTile(int latDec, int lonDec){
+
+    const TSrtmFileHeader* header = (const TSrtmFileHeader*) srtmFile;
+    size_t tileSize = 2 * (size_t)totalPx * totalPx;
+    size_t offset = SRTM_FILE_ALIGN * ((sizeof(TSrtmFileHeader) + SRTM_FILE_ALIGN - 1) / SRTM_FILE_ALIGN);
+    uint32_t tile;
+
+    if(latDec < -90 || latDec >= 90 || lonDec < -180 || lonDec >= 180) {
+        return NULL;
+    }
+
+    tile = header->index[(latDec + 90) * SRTM_FILE_LONS + (lonDec + 180)];
+
+    if(tile == 0 || tile > header->nTiles) {
+        return NULL;
+    }
+
+    return srtmFile + offset + (tile - 1) * tileSize;
+}
+
+
+/** Creates an empty tile cache (one for each thread, the mapped tiles are shared by the OS) */
 
-int srtmLat = 255; //default never valid
-int srtmLon = 255;
+TSrtmCache* srtmNewCache(void){
 
-unsigned char * srtmTile = NULL;
+    TSrtmCache* cache = (TSrtmCache*) calloc(1, sizeof(TSrtmCache));
+
+    if(cache != NULL){
+        cache->maxTiles = srtmMaxTiles;
+        cache->tiles = (TSrtmTile*) malloc(cache->maxTiles * sizeof(TSrtmTile));
+    }
+
+    if(cache == NULL || cache->tiles == NULL) {
+        printf("Error allocating SRTM tile cache\n");
+        exit(1);
+    }
+
+    return cache;
+}
 
 
 /** Prepares corresponding file if not opened */
 
-void srtmLoadTile(int latDec, int lonDec){
+void srtmLoadTile(TSrtmCache* cache, int latDec, int lonDec){
+
+    TSrtmTile* tile = cache->tile;
+    int i;
+
+    //most lookups are in the same tile as the previous one
+
+    if(tile != NULL && tile->latDec == latDec && tile->lonDec == lonDec) {
+        return;
+    }
+
+    //the tiled elevation file needs no cache
+
+    if(srtmFile != NULL) {
+        tile = &cache->tiles[0];
+        tile->latDec = latDec;
+        tile->lonDec = lonDec;
+        tile->data = srtmFileTile(latDec, lonDec);
+        tile->size = 0;
+        tile->bigEndian = 0;
 
-    if(srtmLat != latDec || srtmLon != lonDec) {
-        srtmLat = latDec;
-        srtmLon = lonDec;
+        cache->nTiles = 1;
+        cache->tile = tile;
+        return;
+    }
+
+    cache->clock++;
 
-        if(srtmFd != NULL){
-            fclose(srtmFd);
+    for(i=0; i<cache->nTiles; ++i){
+        if(cache->tiles[i].latDec == latDec && cache->tiles[i].lonDec == lonDec) {
+            cache->tile = &cache->tiles[i];
+            cache->tile->lastUsed = cache->clock;
+            return;
         }
+    }
 
-        char filename[20];
-        sprintf(filename, "%s/N%dE0%02d.hgt", folder, latDec, lonDec);
-        printf("Opening %s\n", filename);
+    //not in the cache, use a free slot or evict the least recently used tile
 
-        srtmFd = fopen(filename, "r");
+    if(cache->nTiles < cache->maxTiles){
+        tile = &cache->tiles[cache->nTiles++];
+    }
+    else{
+        tile = &cache->tiles[0];
 
-        if(srtmFd == NULL) {
-            printf("Error opening %s\n",  filename);
-            exit(1);
+        for(i=1; i<cache->nTiles; ++i){
+            if(cache->tiles[i].lastUsed < tile->lastUsed){
+                tile = &cache->tiles[i];
+            }
         }
 
-#if !SRTMSLIM
+        if(tile->size > 0) {
+            munmap(tile->data, tile->size);
+        }
+        cache->evictions++;
+    }
 
-        if(srtmTile == NULL){
-            srtmTile = (unsigned char*) malloc(totalPx * totalPx * 2); //allocate only once
-        }        
+    //tiles are named after their south-west corner, e.g. N50E014, S23W044
 
-        //read the whole tile
-        fread(srtmTile, 1, (2 * totalPx * totalPx), srtmFd);
-#endif
+    char filename[32];
+    sprintf(filename, "%s/%c%02d%c%03d.hgt", folder,
+            latDec < 0 ? 'S' : 'N', abs(latDec),
+            lonDec < 0 ? 'W' : 'E', abs(lonDec));
+
+    tile->latDec = latDec;
+    tile->lonDec = lonDec;
+    tile->lastUsed = cache->clock;
+    tile->data = NULL;
+    tile->size = 0;
+    tile->bigEndian = 1;
+
+    cache->tile = tile;
+
+    int fd = open(filename, O_RDONLY);
+
+    //a missing tile is a hole (the sea or outside of the SRTM coverage) with void pixels
+    if(fd < 0) {
+        return;
+    }
+
+    struct stat buf;
+
+    if(fstat(fd, &buf) || buf.st_size != 2 * totalPx * totalPx) {
+        printf("Error: %s is not a %dx%d pixel tile\n", filename, totalPx, totalPx);
+        exit(1);
     }
+
+    tile->size = buf.st_size;
+    tile->data = mmap(NULL, tile->size, PROT_READ, MAP_SHARED, fd, 0);
+
+    close(fd);
+
+    if(tile->data == MAP_FAILED) {
+        printf("Error mapping %s\n",  filename);
+        exit(1);
+    }
+
+    cache->loads++;
 }
 
 
+/** Returns how many tiles were loaded and evicted from the cache */
+
+void srtmGetStatistics(TSrtmCache* cache, int* loads, int* evictions){
+    *loads = cache->loads;
+    *evictions = cache->evictions;
+}
+
+
+/** Unmaps all tiles and frees the cache */
+
+void srtmClose(TSrtmCache* cache){
+
+    int i;
 
-void srtmClose(){
-    if(srtmFd != NULL){
-        fclose(srtmFd);
+    for(i=0; i<cache->nTiles; ++i){
+        if(cache->tiles[i].size > 0) {
+            munmap(cache->tiles[i].data, cache->tiles[i].size);
+        }
     }
 
-#if !SRTMSLIM
-    if(srtmTile != NULL){
-        free(srtmTile);
+    free(cache->tiles);
+    free(cache);
+}
+
+/** Fixed point pixel coordinates have 16 fractional bits (1/65536 pixel) */
+
+#define SRTM_FIXED_BITS 16
+#define SRTM_FIXED_ONE  (1 << SRTM_FIXED_BITS)
+
+//number of steps of a segment that are sampled together
+#define SRTM_BATCH 64
+
+
+/** Converts degrees to a fixed point pixel coordinate from 0,0 */
+
+static inline int64_t srtmFixed(double deg){
+    return (int64_t)floor(deg * (3600 / secondsPerPx) * SRTM_FIXED_ONE + 0.5);
+}
+
+
+/** Divides rounding towards minus infinity (for south/west coordinates) */
+
+static inline int64_t srtmFloorDiv(int64_t a, int64_t b){
+    int64_t q = a / b;
+
+    if((a % b) != 0 && ((a < 0) != (b < 0))) q--;
+
+    return q;
+}
+
+
+/** Splits a fixed point pixel coordinate into tile and position within the tile */
+
+static inline void srtmSplit(int64_t pos, int* tileDec, int32_t* posInTile){
+    int64_t pxPerTile = (int64_t)(totalPx - 1) * SRTM_FIXED_ONE;
+
+    *tileDec = (int)srtmFloorDiv(pos, pxPerTile);
+    *posInTile = (int32_t)(pos - *tileDec * pxPerTile);
+}
+
+
+/** Scalar kernel: bilinear interpolation of n positions within one tile.
+ *
+ *  fy/fx are fixed point pixel positions from left bottom corner (0-1200).
+ *  The pixels are big endian in .hgt files and native endian in the tiled elevation file.
+ *  Void pixels get no weight, if all four are void the result is SRTM_VOID.
+ *
+ *  h10------------h11
+ *  |
+ *  |--dx-- .
+ *  |       |
+ *  |      dy
+ *  |       |
+ *  h00------------h01
+ */
+
+static void srtmSampleScalar(const unsigned char* data, int bigEndian, const int32_t* fy, const int32_t* fx, int n, float* height){
+
+    const float scale = 1.0f / SRTM_FIXED_ONE;
+    int i;
+
+    for(i=0; i<n; ++i){
+        int y = fy[i] >> SRTM_FIXED_BITS;
+        int x = fx[i] >> SRTM_FIXED_BITS;
+        float dy = (fy[i] & (SRTM_FIXED_ONE - 1)) * scale;
+        float dx = (fx[i] & (SRTM_FIXED_ONE - 1)) * scale;
+
+        //rows are stored from the north
+        const unsigned char* p0 = data + (((totalPx - 1) - y) * totalPx + x) * 2;
+        const unsigned char* p1 = p0 - totalPx * 2;
+        int h00, h01, h10, h11;
+
+        if(bigEndian){
+            h00 = (int16_t)((p0[0] << 8) | p0[1]);
+            h01 = (int16_t)((p0[2] << 8) | p0[3]);
+            h10 = (int16_t)((p1[0] << 8) | p1[1]);
+            h11 = (int16_t)((p1[2] << 8) | p1[3]);
+        }
+        else{
+            int16_t px[2];
+
+            memcpy(px, p0, 4); h00 = px[0]; h01 = px[1];
+            memcpy(px, p1, 4); h10 = px[0]; h11 = px[1];
+        }
+
+        float w00 = h00 == SRTM_VOID ? 0 : (1 - dx) * (1 - dy);
+        float w01 = h01 == SRTM_VOID ? 0 : dx * (1 - dy);
+        float w10 = h10 == SRTM_VOID ? 0 : (1 - dx) * dy;
+        float w11 = h11 == SRTM_VOID ? 0 : dx * dy;
+
+        float sum = w00 + w01 + w10 + w11;
+
+        if(sum > 0)
+            height[i] = (w00 * h00 + w01 * h01 + w10 * h10 + w11 * h11) / sum;
+        else
+            height[i] = SRTM_VOID;
     }
+}
+
+
+#if defined(__AVX2__) || defined(__SSE2__)
+
+#include <immintrin.h>
+
 #endif
 
+#if defined(__AVX2__)
+
+/** AVX2 kernel: 8 positions at a time, gathering both pixels of a row with one 32 bit load */
+
+static void srtmSampleTile(const unsigned char* data, int bigEndian, const int32_t* fy, const int32_t* fx, int n, float* height){
+
+    const __m256i fracMask = _mm256_set1_epi32(SRTM_FIXED_ONE - 1);
+    const __m256i voidPx = _mm256_set1_epi32(SRTM_VOID);
+    const __m256i lastRow = _mm256_set1_epi32(totalPx - 1);
+    const __m256i rowBytes = _mm256_set1_epi32(totalPx * 2);
+    const __m256 scale = _mm256_set1_ps(1.0f / SRTM_FIXED_ONE);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 voidHeight = _mm256_set1_ps(SRTM_VOID);
+    int i;
+
+    for(i=0; i+8<=n; i+=8){
+        __m256i vy = _mm256_loadu_si256((const __m256i*)(fy + i));
+        __m256i vx = _mm256_loadu_si256((const __m256i*)(fx + i));
+
+        __m256 dy = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(vy, fracMask)), scale);
+        __m256 dx = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(vx, fracMask)), scale);
+
+        __m256i row = _mm256_sub_epi32(lastRow, _mm256_srli_epi32(vy, SRTM_FIXED_BITS));
+        __m256i off0 = _mm256_slli_epi32(_mm256_add_epi32(_mm256_mullo_epi32(row, _mm256_set1_epi32(totalPx)), _mm256_srli_epi32(vx, SRTM_FIXED_BITS)), 1);
+        __m256i off1 = _mm256_sub_epi32(off0, rowBytes);
+
+        __m256i g0 = _mm256_i32gather_epi32((const int*)data, off0, 1);
+        __m256i g1 = _mm256_i32gather_epi32((const int*)data, off1, 1);
+
+        //swap the bytes of each 16 bit pixel (.hgt files), then sign extend the left and right pixel
+        if(bigEndian){
+            g0 = _mm256_or_si256(_mm256_slli_epi16(g0, 8), _mm256_srli_epi16(g0, 8));
+            g1 = _mm256_or_si256(_mm256_slli_epi16(g1, 8), _mm256_srli_epi16(g1, 8));
+        }
+
+        __m256i h00 = _mm256_srai_epi32(_mm256_slli_epi32(g0, 16), 16);
+        __m256i h01 = _mm256_srai_epi32(g0, 16);
+        __m256i h10 = _mm256_srai_epi32(_mm256_slli_epi32(g1, 16), 16);
+        __m256i h11 = _mm256_srai_epi32(g1, 16);
+
+        __m256 ex = _mm256_sub_ps(one, dx);
+        __m256 ey = _mm256_sub_ps(one, dy);
+
+        __m256 w00 = _mm256_andnot_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(h00, voidPx)), _mm256_mul_ps(ex, ey));
+        __m256 w01 = _mm256_andnot_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(h01, voidPx)), _mm256_mul_ps(dx, ey));
+        __m256 w10 = _mm256_andnot_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(h10, voidPx)), _mm256_mul_ps(ex, dy));
+        __m256 w11 = _mm256_andnot_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(h11, voidPx)), _mm256_mul_ps(dx, dy));
+
+        __m256 sum = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(w00, w01), w10), w11);
+        __m256 hgt = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(w00, _mm256_cvtepi32_ps(h00)),
+                                                               _mm256_mul_ps(w01, _mm256_cvtepi32_ps(h01))),
+                                                 _mm256_mul_ps(w10, _mm256_cvtepi32_ps(h10))),
+                                   _mm256_mul_ps(w11, _mm256_cvtepi32_ps(h11)));
+
+        __m256 valid = _mm256_cmp_ps(sum, zero, _CMP_GT_OQ);
+
+        hgt = _mm256_div_ps(hgt, _mm256_blendv_ps(one, sum, valid));
+
+        _mm256_storeu_ps(height + i, _mm256_blendv_ps(voidHeight, hgt, valid));
+    }
+
+    srtmSampleScalar(data, bigEndian, fy + i, fx + i, n - i, height + i);
 }
 
-/** Pixel idx from left bottom corner (0-1200) */
+#elif defined(__SSE2__)
+
+/** SSE2 kernel: 4 positions at a time (no gather, so the pixels are loaded one lane at a time) */
+
+static void srtmSampleTile(const unsigned char* data, int bigEndian, const int32_t* fy, const int32_t* fx, int n, float* height){
+
+    const __m128i fracMask = _mm_set1_epi32(SRTM_FIXED_ONE - 1);
+    const __m128i voidPx = _mm_set1_epi32(SRTM_VOID);
+    const __m128 scale = _mm_set1_ps(1.0f / SRTM_FIXED_ONE);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 voidHeight = _mm_set1_ps(SRTM_VOID);
+    int i, k;
 
-void srtmReadPx(int y, int x, int* height){
+    for(i=0; i+4<=n; i+=4){
+        int32_t p0[4], p1[4];
 
-    int row = (totalPx-1) - y;
-    int col = x;
-    int pos = (row * totalPx + col) * 2;
+        for(k=0; k<4; ++k){
+            const unsigned char* p = data + (((totalPx - 1) - (fy[i+k] >> SRTM_FIXED_BITS)) * totalPx + (fx[i+k] >> SRTM_FIXED_BITS)) * 2;
+
+            memcpy(&p0[k], p, 4);
+            memcpy(&p1[k], p - totalPx * 2, 4);
+        }
+
+        __m128i vy = _mm_loadu_si128((const __m128i*)(fy + i));
+        __m128i vx = _mm_loadu_si128((const __m128i*)(fx + i));
+
+        __m128 dy = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(vy, fracMask)), scale);
+        __m128 dx = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(vx, fracMask)), scale);
+
+        __m128i g0 = _mm_loadu_si128((const __m128i*)p0);
+        __m128i g1 = _mm_loadu_si128((const __m128i*)p1);
+
+        //swap the bytes of each 16 bit pixel (.hgt files), then sign extend the left and right pixel
+        if(bigEndian){
+            g0 = _mm_or_si128(_mm_slli_epi16(g0, 8), _mm_srli_epi16(g0, 8));
+            g1 = _mm_or_si128(_mm_slli_epi16(g1, 8), _mm_srli_epi16(g1, 8));
+        }
 
-#if SRTMSLIM
-    //seek and read 2 bytes short
+        __m128i h00 = _mm_srai_epi32(_mm_slli_epi32(g0, 16), 16);
+        __m128i h01 = _mm_srai_epi32(g0, 16);
+        __m128i h10 = _mm_srai_epi32(_mm_slli_epi32(g1, 16), 16);
+        __m128i h11 = _mm_srai_epi32(g1, 16);
+
+        __m128 ex = _mm_sub_ps(one, dx);
+        __m128 ey = _mm_sub_ps(one, dy);
+
+        __m128 w00 = _mm_andnot_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(h00, voidPx)), _mm_mul_ps(ex, ey));
+        __m128 w01 = _mm_andnot_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(h01, voidPx)), _mm_mul_ps(dx, ey));
+        __m128 w10 = _mm_andnot_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(h10, voidPx)), _mm_mul_ps(ex, dy));
+        __m128 w11 = _mm_andnot_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(h11, voidPx)), _mm_mul_ps(dx, dy));
+
+        __m128 sum = _mm_add_ps(_mm_add_ps(_mm_add_ps(w00, w01), w10), w11);
+        __m128 hgt = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(w00, _mm_cvtepi32_ps(h00)),
+                                                      _mm_mul_ps(w01, _mm_cvtepi32_ps(h01))),
+                                           _mm_mul_ps(w10, _mm_cvtepi32_ps(h10))),
+                                _mm_mul_ps(w11, _mm_cvtepi32_ps(h11)));
+
+        __m128 valid = _mm_cmpgt_ps(sum, zero);
+
+        hgt = _mm_div_ps(hgt, _mm_or_ps(_mm_and_ps(valid, sum), _mm_andnot_ps(valid, one)));
+
+        _mm_storeu_ps(height + i, _mm_or_ps(_mm_and_ps(valid, hgt), _mm_andnot_ps(valid, voidHeight)));
+    }
+
+    srtmSampleScalar(data, bigEndian, fy + i, fx + i, n - i, height + i);
+}
 
-    unsigned char buff[2];// = {0xFF, 0xFB}; //-5 (bigendian)
-    fseek(srtmFd, pos, SEEK_SET);
-    fread(&buff, 2, 1, srtmFd);
 #else
-    //set correct buff pointer
-    unsigned char * buff = & srtmTile[pos];
+
+#define srtmSampleTile srtmSampleScalar
+
 #endif
 
-   //solve endianity (using int16_t)
-    int16_t hgt = 0 | (buff[0] << 8) | (buff[1] << 0);
 
-    if(hgt == -32768) {
-        printf("ERROR: Void pixel found on xy(%d,%d) in latlon(%d,%d) tile.\n", x,y, srtmLat, srtmLon);
-        exit(1);
-    }
+/** Name of the sampling kernel that was compiled in */
 
-    *height = (int) hgt;
-}       
+const char* srtmKernelName(void){
+#if defined(__AVX2__)
+    return "AVX2";
+#elif defined(__SSE2__)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
 
 
-/** Returns interpolated height from four nearest points */
+/** Samples n positions within one tile (all void for a missing tile) */
 
-float srtmGetElevation(float lat, float lon){
+static void srtmSampleLoaded(TSrtmCache* cache, int latDec, int lonDec, const int32_t* fy, const int32_t* fx, int n, float* height){
 
-    int latDec = (int)lat;
-    int lonDec = (int)lon;
+    int i;
 
-    float secondsLat = (lat-latDec) * 60 * 60;
-    float secondsLon = (lon-lonDec) * 60 * 60;
+    srtmLoadTile(cache, latDec, lonDec);
 
-    srtmLoadTile(latDec, lonDec);
+    if(cache->tile->data == NULL){
+        for(i=0; i<n; ++i) height[i] = SRTM_VOID;
+    }
+    else{
+        srtmSampleTile(cache->tile->data, cache->tile->bigEndian, fy, fx, n, height);
+    }
+}
 
-    //X coresponds to x/y values,
-    //everything easter/norhter (< S) is rounded to X.
-    //
-    //  y   ^
-    //  3   |       |   S
-    //      +-------+-------
-    //  0   |   X   |
-    //      +-------+-------->
-    // (sec)    0        3   x  (lon)
 
-    //both values are 0-1199 (1200 reserved for interpolating)
+/** Samples n steps (first to first+n-1) of a line split in steps, tile by tile
+ *
+ *  Step k is at y1 + floor(dy * k / steps), this is kept as a quotient and remainder
+ *  so that there are no divisions per step and no drift along the line.
+ */
 
-    int y = secondsLat/secondsPerPx;
-    int x = secondsLon/secondsPerPx;
+static void srtmSampleSteps(TSrtmCache* cache, int64_t y1, int64_t x1, int64_t dy, int64_t dx, int steps,
+                            int first, int n, float* height){
 
-    //get norther and easter points
+    const int64_t pxPerTile = (int64_t)(totalPx - 1) * SRTM_FIXED_ONE;
+    int32_t fy[SRTM_BATCH], fx[SRTM_BATCH];
+    int latDec, lonDec, tileLat, tileLon;
+    int32_t posY32, posX32;
+    int start = 0;
+    int j;
 
-    int height[4];
-    srtmReadPx(y,   x, &height[2]);
-    srtmReadPx(y+1, x, &height[0]);
-    srtmReadPx(y,   x+1, &height[3]);
-    srtmReadPx(y+1, x+1, &height[1]);
+    int64_t qy = srtmFloorDiv(dy, steps), ry = dy - qy * steps;
+    int64_t qx = srtmFloorDiv(dx, steps), rx = dx - qx * steps;
 
-    //ratio where X lays
-    float dy = fmod(secondsLat, secondsPerPx) / secondsPerPx;
-    float dx = fmod(secondsLon, secondsPerPx) / secondsPerPx;
+    int64_t offY = srtmFloorDiv(dy * first, steps), remY = dy * first - offY * steps;
+    int64_t offX = srtmFloorDiv(dx * first, steps), remX = dx * first - offX * steps;
 
-    // Bilinear interpolation
-    // h0------------h1
-    // |
-    // |--dx-- .
-    // |       |
-    // |      dy
-    // |       |
-    // h2------------h3   
+    srtmSplit(y1 + offY, &tileLat, &posY32);
+    srtmSplit(x1 + offX, &tileLon, &posX32);
 
-    return  height[0] * dy * (1 - dx) +
-            height[1] * dy * (dx) +
-            height[2] * (1 - dy) * (1 - dx) +
-            height[3] * (1 - dy) * dx;
+    int64_t posY = posY32, posX = posX32;
 
-}
+    latDec = tileLat;
+    lonDec = tileLon;
 
+    for(j=0; j<n; ++j){
 
-/** Returns amount of ascent and descent between points */
+        //a step is less than one pixel so it can only move into the next tile
+        if(posY >= pxPerTile){ posY -= pxPerTile; tileLat++; }
+        else if(posY < 0){ posY += pxPerTile; tileLat--; }
 
-TSrtmAscentDescent srtmGetAscentDescent(float lat1, float lon1, float lat2, float lon2, float dist){
+        if(posX >= pxPerTile){ posX -= pxPerTile; tileLon++; }
+        else if(posX < 0){ posX += pxPerTile; tileLon--; }
 
-    TSrtmAscentDescent ret = {0};
+        //sample all of the previous steps that are in the same tile together
+        if(j > start && (tileLat != latDec || tileLon != lonDec)){
+            srtmSampleLoaded(cache, latDec, lonDec, fy + start, fx + start, j - start, height + start);
+            start = j;
+            latDec = tileLat;
+            lonDec = tileLon;
+        }
 
-    //segment we need to devide in "pixels"
-    double latDiff = lat2 - lat1;
-    double lonDiff = lon2 - lon1;
+        fy[j] = (int32_t)posY;
+        fx[j] = (int32_t)posX;
 
-    //how many pixels there are both in y and x axis
-    double latSteps = latDiff * (3600 / 3); // 1/pixelDistance = cca 0.00083
-    double lonSteps = lonDiff * (3600 / 3);
+        posY += qy; remY += ry;
+        if(remY >= steps){ remY -= steps; posY++; }
 
-    //we use the max of both
-    int steps = fmax(fabs(latSteps), fabs(lonSteps));
+        posX += qx; remX += rx;
+        if(remX >= steps){ remX -= steps; posX++; }
+    }
 
-    //just in case both points are inside one pixel (we need interpolation!)
-    if(steps == 0) steps = 1;
+    srtmSampleLoaded(cache, latDec, lonDec, fy + start, fx + start, n - start, height + start);
+}
 
-    //set the delta of each step
-    double latStep = latDiff / steps;
-    double lonStep = lonDiff / steps;
-    double distStep = dist/steps;
 
-      //printf("steps %d: %f %f %f\n", steps, latStep, lonStep, distStep);
+/** Returns interpolated height from four nearest points (or SRTM_VOID) */
+
+float srtmGetElevation(TSrtmCache* cache, float lat, float lon){
+
+    float height;
+
+    srtmSampleSteps(cache, srtmFixed(lat), srtmFixed(lon), 0, 0, 1, 0, 1, &height);
+
+    return height;
+}
 
-    int i;
-    double lat = lat1, lon = lon1;
-    float height, lastHeight, eleDiff;
 
-    //get first elevation -> we need eleDiff then
-    height = srtmGetElevation(lat, lon);
+/** Adds the change in height since the last valid step (void steps are skipped) */
 
-      //printf("first: %f %f hgt:%f\n", lat, lon, height);
+static inline void srtmAddStep(TSrtmAscentDescent* ret, float height, int step, float* lastHeight, int* lastStep, double distStep){
 
-    for(i=0; i<steps; ++i){
-        lat += latStep;
-        lon += lonStep;
-        lastHeight = height;
+    if(height == SRTM_VOID) return;
 
-        height = srtmGetElevation(lat, lon);
-        eleDiff = height - lastHeight;
+    if(*lastHeight != SRTM_VOID){
+        float eleDiff = height - *lastHeight;
 
         if(eleDiff > 0){
-            ret.ascent += eleDiff;
-            ret.ascentOn += distStep;
+            ret->ascent += eleDiff;
+            ret->ascentOn += distStep * (step - *lastStep);
         }
         else{
-            ret.descent += -eleDiff;
-            ret.descentOn += distStep;
+            ret->descent += -eleDiff;
+            ret->descentOn += distStep * (step - *lastStep);
         }
+    }
+
+    *lastHeight = height;
+    *lastStep = step;
+}
+
 
-        //printf("LL(%d): %f %f hgt: %0.1f, diff %0.1f\n", i, lat, lon, height, eleDiff);
+/** Returns amount of ascent and descent between points (ele1/ele2 are the already known end point elevations) */
+
+TSrtmAscentDescent srtmGetAscentDescent(TSrtmCache* cache, float lat1, float lon1, float ele1, float lat2, float lon2, float ele2, float dist){
+
+    TSrtmAscentDescent ret = {0};
+
+    //segment we need to devide in "pixels" (fixed point, so there is no drift along the segment)
+    int64_t y1 = srtmFixed(lat1), x1 = srtmFixed(lon1);
+    int64_t dy = srtmFixed(lat2) - y1, dx = srtmFixed(lon2) - x1;
+
+    //how many pixels there are both in y and x axis, we use the max of both
+    int64_t maxDiff = dy < 0 ? -dy : dy;
+    if((dx < 0 ? -dx : dx) > maxDiff) maxDiff = dx < 0 ? -dx : dx;
+
+    int steps = (int)(maxDiff >> SRTM_FIXED_BITS);
+
+    //just in case both points are inside one pixel
+    if(steps == 0) steps = 1;
+
+    double distStep = dist/steps;
+
+    float height[SRTM_BATCH];
+    float lastHeight = ele1;
+    int lastStep = 0;
+    int first, j;
+
+    //the intermediate steps are interpolated, the end points are known
+
+    for(first=1; first<steps; first+=SRTM_BATCH){
+        int n = steps - first < SRTM_BATCH ? steps - first : SRTM_BATCH;
+
+        srtmSampleSteps(cache, y1, x1, dy, dx, steps, first, n, height);
+
+        for(j=0; j<n; ++j){
+            srtmAddStep(&ret, height[j], first + j, &lastHeight, &lastStep, distStep);
+        }
     }
 
-    // printf("last: %f %f\n", i, lat, lon); ==   printf("ll2: %f %f\n", i, lat2, lon2);
+    srtmAddStep(&ret, ele2, steps, &lastHeight, &lastStep, distStep);
 
     return ret;
 
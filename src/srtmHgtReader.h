@@ -9,13 +9,79 @@
 
 #define  SRTMHGTREADER_H
 
-void srtmLoadTile(int latDec, int lonDec);
+#include <stddef.h> //size_t
+#include <stdint.h> //uint32_t
 
-void srtmReadPx(int y, int x, int* height);
+//default number of tiles kept memory mapped at the same time
+#define SRTM_CACHE_TILES 16
 
-float srtmGetElevation(float lat, float lon);
+//value of void pixels in the tiles (and of heights that cannot be interpolated)
+#define SRTM_VOID -32768
 
-void srtmClose();
+//identification of a tiled elevation file written by srtmtiler
+#define SRTM_FILE_MAGIC "SRTMTILE"
+#define SRTM_FILE_VERSION 1
+#define SRTM_FILE_BYTEORDER 0x01020304
+
+//the tiled elevation file has an index entry for every 1x1 degree tile of the world
+#define SRTM_FILE_LATS 180
+#define SRTM_FILE_LONS 360
+
+//the tile data starts at this alignment after the header
+#define SRTM_FILE_ALIGN 4096
+
+/** Header of a tiled elevation file, followed by the native endian tiles in the order of the index */
+
+typedef struct _SrtmFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;         //SRTM_FILE_BYTEORDER as written by the host that created the file
+    int32_t secondsPerPx;       //3 or 1 arc seconds
+    int32_t totalPx;            //1201 or 3601 pixels along each side of a tile
+    uint32_t nTiles;            //number of tiles stored in the file
+    uint32_t index[SRTM_FILE_LATS * SRTM_FILE_LONS]; //tile number + 1 from -90,-180 (row by row), 0 for holes
+} TSrtmFileHeader;
+
+/** One memory mapped tile in a cache */
+
+typedef struct _SrtmTile {
+    int latDec;                 //south-west corner of the tile
+    int lonDec;
+    unsigned char * data;       //memory mapped contents of the .hgt file (NULL for a missing tile)
+    size_t size;                //size of the mapping (0 if it is part of the tiled elevation file)
+    int bigEndian;              //set for .hgt files, the tiled elevation file is native endian
+    unsigned long lastUsed;     //value of the cache clock when last used (for LRU)
+} TSrtmTile;
+
+/** A cache of tiles, each thread needs its own */
+
+typedef struct _SrtmCache {
+    TSrtmTile * tiles;
+    int nTiles;                 //number of tiles in the cache
+    int maxTiles;
+    TSrtmTile * tile;           //the most recently used tile
+    unsigned long clock;
+    int loads;                  //statistics for srtmGetStatistics()
+    int evictions;
+} TSrtmCache;
+
+void srtmSetCacheSize(int ntiles);
+
+void srtmOpenFile(const char* filename);
+
+void srtmCloseFile(void);
+
+TSrtmCache* srtmNewCache(void);
+
+void srtmLoadTile(TSrtmCache* cache, int latDec, int lonDec);
+
+float srtmGetElevation(TSrtmCache* cache, float lat, float lon);
+
+void srtmGetStatistics(TSrtmCache* cache, int* loads, int* evictions);
+
+void srtmClose(TSrtmCache* cache);
+
+const char* srtmKernelName(void);
 
 struct _SrtmAscentDescent {
     float ascent;
@@ -26,7 +92,7 @@ struct _SrtmAscentDescent {
 
 typedef struct _SrtmAscentDescent TSrtmAscentDescent;
 
-TSrtmAscentDescent srtmGetAscentDescent(float lat1, float lon1, float lat2, float lon2, float dist);
+TSrtmAscentDescent srtmGetAscentDescent(TSrtmCache* cache, float lat1, float lon1, float ele1, float lat2, float lon2, float ele2, float dist);
 
 #endif  /* SRTMHGTREADER_H */
 
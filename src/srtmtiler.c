@@ -0,0 +1,284 @@
+/***************************************
+ Converts a directory of SRTM .hgt tiles into a single tiled elevation file.
+
+ Part of the Routino routing software.
+ ******************/ /******************
+ This file Copyright 2008-2013 Andrew M. Bishop
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <math.h>
+
+#include "srtmHgtReader.h"
+
+#include "files.h"
+#include "logging.h"
+
+
+/* Local functions */
+
+static void convert_tile(const unsigned char *hgt,int inPx,int16_t *tile,int outPx);
+
+static void print_usage(int detail,const char *argerr,const char *err);
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  The main program for the SRTM tiler.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+int main(int argc,char** argv)
+{
+ int   arg;
+ char *srtmdirname="srtm",*filename=NULL;
+ int   option_resolution=3;
+ TSrtmFileHeader *header;
+ unsigned char *hgt;
+ int16_t *tile;
+ int outPx,lat,lon,fd;
+ size_t offset,tilesize;
+ uint32_t holes=0;
+
+ /* Parse the command line arguments */
+
+ for(arg=1;arg<argc;arg++)
+   {
+    if(!strcmp(argv[arg],"--help"))
+       print_usage(1,NULL,NULL);
+    else if(!strncmp(argv[arg],"--srtm-dir=",11))
+       srtmdirname=&argv[arg][11];
+    else if(!strncmp(argv[arg],"--resolution=",13))
+       option_resolution=atoi(&argv[arg][13]);
+    else if(!strcmp(argv[arg],"--loggable"))
+       option_loggable=1;
+    else if(argv[arg][0]=='-' && argv[arg][1]=='-')
+       print_usage(0,argv[arg],NULL);
+    else if(!filename)
+       filename=argv[arg];
+    else
+       print_usage(0,argv[arg],NULL);
+   }
+
+ if(!filename)
+    print_usage(0,NULL,"The name of the tiled elevation file must be given.");
+
+ if(option_resolution!=1 && option_resolution!=3)
+    print_usage(0,NULL,"The '--resolution' must be 1 or 3 arc seconds.");
+
+ outPx=3600/option_resolution+1;
+
+ tilesize=2*(size_t)outPx*outPx;
+
+ /* Allocate the header (with the tile index) and a buffer for one tile */
+
+ header=(TSrtmFileHeader*)calloc(1,sizeof(TSrtmFileHeader));
+
+ hgt=(unsigned char*)malloc(2*3601*3601);
+
+ tile=(int16_t*)malloc(tilesize);
+
+ logassert(header && hgt && tile,"Failed to allocate memory"); /* Check malloc() worked */
+
+ memcpy(header->magic,SRTM_FILE_MAGIC,8);
+ header->version=SRTM_FILE_VERSION;
+ header->byteOrder=SRTM_FILE_BYTEORDER;
+ header->secondsPerPx=option_resolution;
+ header->totalPx=outPx;
+
+ /* Write a blank header and index, the tiles follow it aligned to a page */
+
+ fd=OpenFileBufferedNew(filename);
+
+ offset=SRTM_FILE_ALIGN*((sizeof(TSrtmFileHeader)+SRTM_FILE_ALIGN-1)/SRTM_FILE_ALIGN);
+
+ SeekFileBuffered(fd,offset);
+
+ /* Convert each tile that exists, the others are holes in the index */
+
+ printf_first("Converting SRTM Tiles: Tiles=0 Holes=0");
+
+ for(lat=-SRTM_FILE_LATS/2;lat<SRTM_FILE_LATS/2;lat++)
+   {
+    for(lon=-SRTM_FILE_LONS/2;lon<SRTM_FILE_LONS/2;lon++)
+      {
+       char hgtname[32];
+       char *pathname;
+       off_t size;
+       int inPx,hgtfd;
+
+       sprintf(hgtname,"%c%02d%c%03d.hgt",lat<0?'S':'N',abs(lat),lon<0?'W':'E',abs(lon));
+
+       pathname=FileName(srtmdirname,NULL,hgtname);
+
+       if(!ExistsFile(pathname))
+         {
+          free(pathname);
+          holes++;
+          continue;
+         }
+
+       size=SizeFile(pathname);
+
+       if(size==2*1201*1201)
+          inPx=1201;
+       else if(size==2*3601*3601)
+          inPx=3601;
+       else
+         {
+          fprintf(stderr,"Error: The file '%s' is not a 1201x1201 or 3601x3601 pixel tile.\n",pathname);
+          exit(EXIT_FAILURE);
+         }
+
+       hgtfd=ReOpenFileBuffered(pathname);
+
+       ReadFileBuffered(hgtfd,hgt,size);
+
+       CloseFileBuffered(hgtfd);
+
+       convert_tile(hgt,inPx,tile,outPx);
+
+       WriteFileBuffered(fd,tile,tilesize);
+
+       header->index[(lat+SRTM_FILE_LATS/2)*SRTM_FILE_LONS+(lon+SRTM_FILE_LONS/2)]=++header->nTiles;
+
+       printf_middle("Converting SRTM Tiles: Tiles=%"PRIu32" Holes=%"PRIu32,header->nTiles,holes);
+
+       free(pathname);
+      }
+   }
+
+ /* Write the completed header and index */
+
+ SeekFileBuffered(fd,0);
+
+ WriteFileBuffered(fd,header,sizeof(TSrtmFileHeader));
+
+ CloseFileBuffered(fd);
+
+ printf_last("Converted SRTM Tiles: Tiles=%"PRIu32" Holes=%"PRIu32,header->nTiles,holes);
+
+ free(header);
+ free(hgt);
+ free(tile);
+
+ return(0);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Convert one big-endian .hgt tile into native-endian pixels at the output resolution.
+
+  const unsigned char *hgt The contents of the .hgt file.
+
+  int inPx The number of pixels along each side of the .hgt tile.
+
+  int16_t *tile Returns the converted tile.
+
+  int outPx The number of pixels along each side of the converted tile.
+
+  Rows are kept in the .hgt order (from the north). A 1 arc second tile is reduced to 3 arc seconds
+  by taking every third pixel, a 3 arc second tile is expanded to 1 arc second by bilinear
+  interpolation with void pixels given no weight (as when the elevations are sampled).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void convert_tile(const unsigned char *hgt,int inPx,int16_t *tile,int outPx)
+{
+ int y,x;
+
+ for(y=0;y<outPx;y++)
+    for(x=0;x<outPx;x++)
+      {
+       int iy=(int)(((int64_t)y*(inPx-1))/(outPx-1));
+       int ix=(int)(((int64_t)x*(inPx-1))/(outPx-1));
+       int ry=(int)(((int64_t)y*(inPx-1))%(outPx-1));
+       int rx=(int)(((int64_t)x*(inPx-1))%(outPx-1));
+       const unsigned char *p=hgt+2*((size_t)iy*inPx+ix);
+       int h00=(int16_t)((p[0]<<8)|p[1]);
+
+       if(ry==0 && rx==0)
+          tile[(size_t)y*outPx+x]=h00;
+       else
+         {
+          const unsigned char *pr=p+(rx?2:0),*pd=p+(ry?2*inPx:0),*pdr=pd+(rx?2:0);
+          int h01=(int16_t)((pr [0]<<8)|pr [1]);
+          int h10=(int16_t)((pd [0]<<8)|pd [1]);
+          int h11=(int16_t)((pdr[0]<<8)|pdr[1]);
+          double dy=(double)ry/(outPx-1),dx=(double)rx/(outPx-1);
+          double w00=h00==SRTM_VOID?0:(1-dx)*(1-dy);
+          double w01=h01==SRTM_VOID?0:dx*(1-dy);
+          double w10=h10==SRTM_VOID?0:(1-dx)*dy;
+          double w11=h11==SRTM_VOID?0:dx*dy;
+          double sum=w00+w01+w10+w11;
+
+          if(sum>0)
+             tile[(size_t)y*outPx+x]=(int16_t)floor((w00*h00+w01*h01+w10*h10+w11*h11)/sum+0.5);
+          else
+             tile[(size_t)y*outPx+x]=SRTM_VOID;
+         }
+      }
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Print out the usage information.
+
+  int detail The level of detail to use: 0 = low, 1 = high.
+
+  const char *argerr The argument that gave the error (if there is one).
+
+  const char *err Other error message (if there is one).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void print_usage(int detail,const char *argerr,const char *err)
+{
+ fprintf(stderr,
+         "Usage: srtmtiler [--help]\n"
+         "                 [--srtm-dir=<dirname>]\n"
+         "                 [--resolution=<seconds>]\n"
+         "                 [--loggable]\n"
+         "                 <filename>\n");
+
+ if(argerr)
+    fprintf(stderr,
+            "\n"
+            "Error with command line parameter: %s\n",argerr);
+
+ if(err)
+    fprintf(stderr,
+            "\n"
+            "Error: %s\n",err);
+
+ if(detail)
+    fprintf(stderr,
+            "\n"
+            "--help                    Prints this information.\n"
+            "\n"
+            "--srtm-dir=<dirname>      The directory containing the SRTM .hgt tiles\n"
+            "                          (defaults to 'srtm').\n"
+            "--resolution=<seconds>    The resolution of the tiled elevation file, 1 or 3\n"
+            "                          arc seconds (defaults to 3).\n"
+            "\n"
+            "--loggable                Print progress messages suitable for logging to file.\n"
+            "\n"
+            "<filename>                The tiled elevation file to create (for the\n"
+            "                          planetsplitter '--srtm-file' option).\n");
+
+ exit(!detail);
+}
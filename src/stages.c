@@ -0,0 +1,388 @@
+/***************************************
+ Processing stage scheduler functions (run the independent stages at the same time).
+
+ Part of the Routino routing software.
+ ******************/ /******************
+ This file Copyright 2008-2013 Andrew M. Bishop
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#if defined(USE_PTHREADS) && USE_PTHREADS
+#include <pthread.h>
+#endif
+
+#include "stages.h"
+#include "sorting.h"
+#include "logging.h"
+
+
+/* Global variables */
+
+/*+ The number of processing stages that can be run at the same time. +*/
+extern int option_stage_threads;
+
+/*+ The amount of RAM to use for filesorting. +*/
+extern size_t option_filesort_ramsize;
+
+
+/* Constants */
+
+/*+ The flags that select the data used by a stage. +*/
+#define STAGE_DATA (STAGE_NODES|STAGE_SEGMENTS|STAGE_WAYS|STAGE_RELATIONS|STAGE_ERRORLOG)
+
+/*+ The width of the bars in the timeline that is printed at the end. +*/
+#define TIMELINE_WIDTH 40
+
+
+#if defined(USE_PTHREADS) && USE_PTHREADS
+
+/* Local types */
+
+/*+ A data type for holding the state of a stage while the stages are running. +*/
+typedef struct _stage_data
+{
+ pthread_t thread;              /*+ The thread identifier. +*/
+
+ int       state;               /*+ The state of the stage: 0 = waiting, 1 = running, 2 = finished. +*/
+
+ Stage    *stage;               /*+ The stage to run. +*/
+ void     *data;                /*+ The data to pass to the stage function. +*/
+
+ size_t    ramsize;             /*+ The amount of sorting RAM given to the stage. +*/
+
+ double    start;               /*+ The time that the stage started (seconds since the first one). +*/
+ double    finish;              /*+ The time that the stage finished (seconds since the first one). +*/
+}
+ stage_data;
+
+
+/* Local variables */
+
+/*+ The mutex and condition to protect the state of the stages. +*/
+static pthread_mutex_t stages_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t stages_cond = PTHREAD_COND_INITIALIZER;
+
+/*+ The time that the stages were started. +*/
+static struct timeval stages_start_time;
+
+/*+ The number of stages running. +*/
+static int stages_running=0;
+
+/*+ The amount of sorting RAM given to the running stages. +*/
+static size_t stages_ramsize=0;
+
+
+/* Local functions */
+
+static void run_stages_concurrently(Stage *stages,int nstages,void *data);
+static int stage_is_ready(stage_data *states,int nstages,int j);
+static void *stage_thread(stage_data *state);
+static double stage_time(void);
+
+#endif
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Run a list of processing stages, either one after another in the order given or with the
+  independent ones running at the same time (if the '--stage-threads' option allows).
+
+  Stage *stages The list of stages (those without a function are section headings).
+
+  int nstages The number of stages in the list.
+
+  void *data The data to pass to each of the stage functions.
+
+  A stage always waits for all of the earlier stages in the list that use any of the same data
+  to finish so the data is processed in the same order as when running them one at a time.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+void RunStages(Stage *stages,int nstages,void *data)
+{
+ int i;
+
+#if defined(USE_PTHREADS) && USE_PTHREADS
+
+ if(option_stage_threads>1)
+   {
+    run_stages_concurrently(stages,nstages,data);
+    return;
+   }
+
+#endif
+
+ for(i=0;i<nstages;i++)
+   {
+    if(stages[i].function)
+       stages[i].function(data);
+    else
+      {
+       size_t length=strlen(stages[i].name);
+
+       printf("\n%s\n",stages[i].name);
+       while(length--)
+          putchar('=');
+       printf("\n\n");
+       fflush(stdout);
+      }
+   }
+}
+
+
+#if defined(USE_PTHREADS) && USE_PTHREADS
+
+/*++++++++++++++++++++++++++++++++++++++
+  Run a list of processing stages with the independent ones running at the same time.
+
+  Stage *stages The list of stages (those without a function are section headings).
+
+  int nstages The number of stages in the list.
+
+  void *data The data to pass to each of the stage functions.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void run_stages_concurrently(Stage *stages,int nstages,void *data)
+{
+ stage_data *states;
+ size_t length=0;
+ int i,j,nfinished=0,nfunctions=0;
+ double total;
+
+ states=(stage_data*)calloc(nstages,sizeof(stage_data));
+
+ logassert(states,"Failed to allocate memory (try using slim mode?)"); /* Check calloc() worked */
+
+ /* Print a single heading for all of the sections */
+
+ printf("\n");
+
+ for(i=0;i<nstages;i++)
+   {
+    states[i].stage=&stages[i];
+    states[i].data=data;
+
+    if(stages[i].function)
+       nfunctions++;
+    else
+      {
+       if(length)
+          length+=printf(" and ");
+
+       length+=printf("%s",stages[i].name);
+
+       states[i].state=2;
+      }
+   }
+
+ printf("\n");
+ while(length--)
+    putchar('=');
+ printf("\n\n");
+ fflush(stdout);
+
+ /* Start the stages as they become ready and wait for them to finish */
+
+ printf_concurrent(1);
+
+ gettimeofday(&stages_start_time,NULL);
+
+ pthread_mutex_lock(&stages_mutex);
+
+ while(nfinished<nfunctions)
+   {
+    int nsorting=0,free_threads=option_stage_threads-stages_running;
+
+    /* Count the sorting stages that could start now and share the free RAM between them */
+
+    for(j=0;j<nstages;j++)
+       if(states[j].state==0 && (stages[j].flags&STAGE_SORTS) && stage_is_ready(states,nstages,j))
+          nsorting++;
+
+    if(nsorting>free_threads)
+       nsorting=free_threads;
+
+    for(j=0;j<nstages && stages_running<option_stage_threads;j++)
+      {
+       if(states[j].state!=0 || !stage_is_ready(states,nstages,j))
+          continue;
+
+       if(stages[j].flags&STAGE_SORTS)
+         {
+          size_t minimum=option_filesort_ramsize/option_stage_threads;
+          size_t available=option_filesort_ramsize-stages_ramsize;
+
+          if(available<minimum)
+             continue;
+
+          states[j].ramsize=available/nsorting;
+
+          if(states[j].ramsize<minimum)
+             states[j].ramsize=minimum;
+
+          if(nsorting>1)
+             nsorting--;
+
+          stages_ramsize+=states[j].ramsize;
+         }
+
+       states[j].state=1;
+       states[j].start=stage_time();
+
+       stages_running++;
+
+       if(states[j].ramsize)
+          printf("Started %s [Time=%.2fs Running=%d RAM=%.1fMB]\n",stages[j].name,states[j].start,stages_running,(double)states[j].ramsize/(1024*1024));
+       else
+          printf("Started %s [Time=%.2fs Running=%d]\n",stages[j].name,states[j].start,stages_running);
+       fflush(stdout);
+
+       if(pthread_create(&states[j].thread,NULL,(void* (*)(void*))stage_thread,&states[j]))
+         {
+          fprintf(stderr,"Failed to create a thread for the '%s' stage.\n",stages[j].name);
+          exit(EXIT_FAILURE);
+         }
+      }
+
+    pthread_cond_wait(&stages_cond,&stages_mutex);
+
+    for(nfinished=0,j=0;j<nstages;j++)
+       if(stages[j].function && states[j].state==2)
+          nfinished++;
+   }
+
+ pthread_mutex_unlock(&stages_mutex);
+
+ for(j=0;j<nstages;j++)
+    if(stages[j].function)
+       pthread_join(states[j].thread,NULL);
+
+ printf_concurrent(0);
+
+ /* Print a timeline of the stages */
+
+ total=stage_time();
+
+ printf("\nStage Timeline [Total=%.2fs]\n",total);
+
+ for(j=0;j<nstages;j++)
+    if(stages[j].function)
+      {
+       char bar[TIMELINE_WIDTH+1];
+       int start=0,finish=0;
+
+       if(total>0)
+         {
+          start =(int)(TIMELINE_WIDTH*states[j].start /total);
+          finish=(int)(TIMELINE_WIDTH*states[j].finish/total+0.999);
+         }
+
+       if(finish<=start)
+          finish=start+1;
+
+       if(finish>TIMELINE_WIDTH)
+          finish=TIMELINE_WIDTH;
+
+       for(i=0;i<TIMELINE_WIDTH;i++)
+          bar[i]=(i>=start && i<finish)?'#':'.';
+
+       bar[TIMELINE_WIDTH]=0;
+
+       printf("  %-36s |%s| %7.2fs - %7.2fs\n",stages[j].name,bar,states[j].start,states[j].finish);
+      }
+
+ fflush(stdout);
+
+ free(states);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Check whether a stage is ready to start (all earlier stages that use the same data are finished).
+
+  int stage_is_ready Returns 1 if the stage can start or 0 if it must wait.
+
+  stage_data *states The state of the stages.
+
+  int nstages The number of stages in the list.
+
+  int j The stage to check.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int stage_is_ready(stage_data *states,int nstages,int j)
+{
+ int i;
+
+ for(i=0;i<j;i++)
+    if(states[i].state!=2 && (states[i].stage->flags&states[j].stage->flags&STAGE_DATA))
+       return(0);
+
+ return(1);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Run one stage in a thread.
+
+  void *stage_thread Returns NULL (required to return void*).
+
+  stage_data *state The state of the stage to run.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void *stage_thread(stage_data *state)
+{
+ filesort_thread_ramsize(state->ramsize);
+
+ state->stage->function(state->data);
+
+ pthread_mutex_lock(&stages_mutex);
+
+ state->state=2;
+ state->finish=stage_time();
+
+ stages_running--;
+ stages_ramsize-=state->ramsize;
+
+ printf("Finished %s [Time=%.2fs Duration=%.2fs]\n",state->stage->name,state->finish,state->finish-state->start);
+ fflush(stdout);
+
+ pthread_cond_signal(&stages_cond);
+
+ pthread_mutex_unlock(&stages_mutex);
+
+ return(NULL);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Get the time since the stages were started.
+
+  double stage_time Returns the time in seconds.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static double stage_time(void)
+{
+ struct timeval now;
+
+ gettimeofday(&now,NULL);
+
+ return((now.tv_sec-stages_start_time.tv_sec)+(now.tv_usec-stages_start_time.tv_usec)/1000000.0);
+}
+
+#endif
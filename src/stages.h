@@ -0,0 +1,59 @@
+/***************************************
+ Header file for the processing stage scheduler function prototypes
+
+ Part of the Routino routing software.
+ ******************/ /******************
+ This file Copyright 2008-2013 Andrew M. Bishop
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************/
+
+
+#ifndef STAGES_H
+#define STAGES_H    /*+ To stop multiple inclusions. +*/
+
+
+/* Constants */
+
+/*+ The data used by a stage, a stage waits for the earlier stages that use any of the same data. +*/
+#define STAGE_NODES      1      /*+ The stage uses the nodes. +*/
+#define STAGE_SEGMENTS   2      /*+ The stage uses the segments. +*/
+#define STAGE_WAYS       4      /*+ The stage uses the ways. +*/
+#define STAGE_RELATIONS  8      /*+ The stage uses the relations. +*/
+#define STAGE_ERRORLOG  16      /*+ The stage writes to the error log. +*/
+
+/*+ A flag to indicate that a stage sorts data (and needs part of the sorting RAM). +*/
+#define STAGE_SORTS    256
+
+
+/* Data structures */
+
+/*+ A data structure to describe one processing stage. +*/
+typedef struct _Stage
+{
+ const char *name;              /*+ The name of the stage (or the section heading if there is no function). +*/
+
+ void      (*function)(void*);  /*+ The function to call for the stage. +*/
+
+ int         flags;             /*+ The data used by the stage and whether it sorts data. +*/
+}
+ Stage;
+
+
+/* Functions in stages.c */
+
+void RunStages(Stage *stages,int nstages,void *data);
+
+
+#endif /* STAGES_H */
@@ -22,6 +22,10 @@
 
 #include <stdlib.h>
 
+#if defined(USE_PTHREADS) && USE_PTHREADS
+#include <pthread.h>
+#endif
+
 #include "types.h"
 #include "segments.h"
 #include "ways.h"
@@ -37,8 +41,67 @@
 #include "results.h"
 
 
+/* Constants */
+
+/*+ The number of nodes that are checked together when choosing super-nodes (a multiple of the bits in a BitMask). +*/
+#define SUPER_BATCH 65536
+
+
+/* Local types */
+
+/*+ The batch of nodes being checked by the threads choosing super-nodes. +*/
+typedef struct _super_batch
+{
+#if defined(USE_PTHREADS) && USE_PTHREADS
+ pthread_mutex_t mutex;         /*+ The mutex to protect the batch number and flags. +*/
+ pthread_cond_t  cond;          /*+ The condition to signal a new batch or a finished thread. +*/
+
+ int        generation;         /*+ The number of batches that have been started. +*/
+ int        running;            /*+ The number of threads still checking the current batch. +*/
+ int        stop;               /*+ A flag to tell the threads to stop. +*/
+#endif
+
+ NodesX    *nodesx;             /*+ The set of nodes to use. +*/
+ SegmentsX *segmentsx;          /*+ The set of segments to use. +*/
+ WaysX     *waysx;              /*+ The set of ways to use. +*/
+
+ NodeX     *nodex;              /*+ The batch of nodes. +*/
+ index_t    offset;             /*+ The index of the first node in the batch. +*/
+ index_t    number;             /*+ The number of nodes in the batch. +*/
+}
+ super_batch;
+
+/*+ The information for one of the threads choosing super-nodes. +*/
+typedef struct _super_thread
+{
+#if defined(USE_PTHREADS) && USE_PTHREADS
+ pthread_t    thread;           /*+ The thread identifier. +*/
+#endif
+
+ super_batch *batch;            /*+ The batch of nodes shared by the threads. +*/
+
+ int          part;             /*+ The part of each batch that this thread checks. +*/
+ int          nparts;           /*+ The number of parts that each batch is divided into. +*/
+
+ index_t      nnodes;           /*+ The number of super-nodes found by this thread. +*/
+}
+ super_thread;
+
+
+/* Global variables */
+
+/*+ The number of threads to use for choosing the super-nodes. +*/
+extern int option_super_threads;
+
+
 /* Local functions */
 
+static index_t ChooseSuperNodesPart(super_batch *batch,int part,int nparts);
+#if defined(USE_PTHREADS) && USE_PTHREADS
+static void *super_thread_function(super_thread *thread);
+#endif
+static int CheckSuperNode(NodeX *nodex,index_t index,SegmentsX *segmentsx,WaysX *waysx);
+
 static Results *FindSuperRoutes(NodesX *nodesx,SegmentsX *segmentsx,WaysX *waysx,node_t start,Way *match);
 
 
@@ -56,10 +119,21 @@ void ChooseSuperNodes(NodesX *nodesx,SegmentsX *segmentsx,WaysX *waysx)
 {
  index_t i;
  index_t nnodes=0;
+ NodeX *nodex[2];
+ super_batch batch;
+ super_thread *threads;
+ int nthreads=option_super_threads;
+ int current=0,j;
 
  if(nodesx->number==0 || segmentsx->number==0 || waysx->number==0)
     return;
 
+ /* The cached segments and ways used in slim mode can only be used by one thread */
+
+#if SLIM
+ nthreads=1;
+#endif
+
  /* Print the start message */
 
  printf_first("Finding Super-Nodes: Nodes=0 Super-Nodes=0");
@@ -90,95 +164,136 @@ void ChooseSuperNodes(NodesX *nodesx,SegmentsX *segmentsx,WaysX *waysx)
  InvalidateWayXCache(waysx->cache);
 #endif
 
- /* Find super-nodes */
+ /* Allocate two batches of nodes (one is read while the other is checked) and the threads */
 
- for(i=0;i<nodesx->number;i++)
+ nodex[0]=(NodeX*)malloc(SUPER_BATCH*sizeof(NodeX));
+ nodex[1]=(NodeX*)malloc(SUPER_BATCH*sizeof(NodeX));
+
+ logassert(nodex[0] && nodex[1],"Failed to allocate memory (try using slim mode?)"); /* Check malloc() worked */
+
+ threads=(super_thread*)calloc(nthreads,sizeof(super_thread));
+
+ logassert(threads,"Failed to allocate memory (try using slim mode?)"); /* Check calloc() worked */
+
+ batch.nodesx=nodesx;
+ batch.segmentsx=segmentsx;
+ batch.waysx=waysx;
+
+ for(j=0;j<nthreads;j++)
    {
-    NodeX nodex;
+    threads[j].batch=&batch;
+    threads[j].part=j;
+    threads[j].nparts=nthreads;
+   }
 
-    ReadFileBuffered(nodesx->fd,&nodex,sizeof(NodeX));
+ /* Start the threads, they wait for each batch and are kept for all of them */
 
-    if(IsBitSet(nodesx->super,i))
-      {
-       int issuper=0;
+#if defined(USE_PTHREADS) && USE_PTHREADS
 
-       if(nodex.flags&(NODE_TURNRSTRCT|NODE_TURNRSTRCT2))
-          issuper=1;
-       else
-         {
-          int count=0,j;
-          Way segmentway[MAX_SEG_PER_NODE];
-          int segmentweight[MAX_SEG_PER_NODE];
-          SegmentX *segmentx=FirstSegmentX(segmentsx,i,1);
+ batch.generation=0;
+ batch.running=0;
+ batch.stop=0;
 
-          while(segmentx)
-            {
-             WayX *wayx=LookupWayX(waysx,segmentx->way,1);
-             int nsegments;
+ if(nthreads>1)
+   {
+    pthread_mutex_init(&batch.mutex,NULL);
+    pthread_cond_init(&batch.cond,NULL);
 
-             /* Segments that are loops count twice */
+    for(j=0;j<nthreads;j++)
+       pthread_create(&threads[j].thread,NULL,(void* (*)(void*))super_thread_function,&threads[j]);
+   }
 
-             logassert(count<MAX_SEG_PER_NODE,"Too many segments for one node (increase MAX_SEG_PER_NODE?)"); /* Only a limited amount of information stored. */
+#endif
 
-             if(segmentx->node1==segmentx->node2)
-                segmentweight[count]=2;
-             else
-                segmentweight[count]=1;
+ /* Find super-nodes (in batches, the nodes must be read in order from the file) */
 
-             segmentway[count]=wayx->way;
+ ReadFileBuffered(nodesx->fd,nodex[0],(nodesx->number<SUPER_BATCH?nodesx->number:SUPER_BATCH)*sizeof(NodeX));
 
-             /* If the node allows less traffic types than any connecting way then it is super if it allows anything */
+ for(i=0;i<nodesx->number;i+=SUPER_BATCH,current=!current)
+   {
+    index_t number=SUPER_BATCH,nextnumber=0;
 
-             if((wayx->way.allow&nodex.allow)!=wayx->way.allow && nodex.allow!=Transports_None)
-               {
-                issuper=1;
-                break;
-               }
+    if(number>(nodesx->number-i))
+       number=nodesx->number-i;
 
-             nsegments=segmentweight[count];
+    if((nodesx->number-i)>number)
+       nextnumber=nodesx->number-i-number;
 
-             for(j=0;j<count;j++)
-                if(wayx->way.allow & segmentway[j].allow)
-                  {
-                   /* If two ways are different in any attribute and there is a type of traffic that can use both then it is super */
+    if(nextnumber>SUPER_BATCH)
+       nextnumber=SUPER_BATCH;
 
-                   if(WaysCompare(&segmentway[j],&wayx->way))
-                     {
-                      issuper=1;
-                      break;
-                     }
+    batch.nodex=nodex[current];
+    batch.offset=i;
+    batch.number=number;
 
-                   /* If there are two other segments that can be used by the same types of traffic as this one then it is super */
+#if defined(USE_PTHREADS) && USE_PTHREADS
 
-                   nsegments+=segmentweight[j];
-                   if(nsegments>2)
-                     {
-                      issuper=1;
-                      break;
-                     }
-                  }
+    if(nthreads>1)
+      {
+       /* Start the threads checking this batch, read the next one and then wait for them to finish */
 
-             if(issuper)
-                break;
+       pthread_mutex_lock(&batch.mutex);
 
-             segmentx=NextSegmentX(segmentsx,segmentx,i);
+       batch.generation++;
+       batch.running=nthreads;
 
-             count++;
-            }
-         }
+       pthread_cond_broadcast(&batch.cond);
 
-       /* Mark the node as super if it is. */
+       pthread_mutex_unlock(&batch.mutex);
 
-       if(issuper)
-          nnodes++;
-       else
-          ClearBit(nodesx->super,i);
+       if(nextnumber)
+          ReadFileBuffered(nodesx->fd,nodex[!current],nextnumber*sizeof(NodeX));
+
+       pthread_mutex_lock(&batch.mutex);
+
+       while(batch.running)
+          pthread_cond_wait(&batch.cond,&batch.mutex);
+
+       pthread_mutex_unlock(&batch.mutex);
+
+       for(nnodes=0,j=0;j<nthreads;j++)
+          nnodes+=threads[j].nnodes;
       }
+    else
 
-    if(!((i+1)%10000))
-       printf_middle("Finding Super-Nodes: Nodes=%"Pindex_t" Super-Nodes=%"Pindex_t,i+1,nnodes);
+#endif
+      {
+       nnodes+=ChooseSuperNodesPart(&batch,0,1);
+
+       if(nextnumber)
+          ReadFileBuffered(nodesx->fd,nodex[!current],nextnumber*sizeof(NodeX));
+      }
+
+    printf_middle("Finding Super-Nodes: Nodes=%"Pindex_t" Super-Nodes=%"Pindex_t,i+number,nnodes);
    }
 
+ /* Stop the threads */
+
+#if defined(USE_PTHREADS) && USE_PTHREADS
+
+ if(nthreads>1)
+   {
+    pthread_mutex_lock(&batch.mutex);
+
+    batch.stop=1;
+
+    pthread_cond_broadcast(&batch.cond);
+
+    pthread_mutex_unlock(&batch.mutex);
+
+    for(j=0;j<nthreads;j++)
+       pthread_join(threads[j].thread,NULL);
+
+    pthread_mutex_destroy(&batch.mutex);
+    pthread_cond_destroy(&batch.cond);
+   }
+
+#endif
+
+ free(nodex[0]);
+ free(nodex[1]);
+ free(threads);
+
  /* Unmap from memory / close the files */
 
 #if !SLIM
@@ -197,6 +312,170 @@ void ChooseSuperNodes(NodesX *nodesx,SegmentsX *segmentsx,WaysX *waysx)
 }
 
 
+/*++++++++++++++++++++++++++++++++++++++
+  Choose the super-nodes from one part of a batch of nodes.
+
+  index_t ChooseSuperNodesPart Returns the number of super-nodes found.
+
+  super_batch *batch The batch of nodes.
+
+  int part The part of the batch to check.
+
+  int nparts The number of parts that the batch is divided into.
+
+  Each part starts on a BitMask word boundary so that no two threads modify the same word of the
+  super-node markers (the batch offset is a multiple of the bits in a BitMask).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static index_t ChooseSuperNodesPart(super_batch *batch,int part,int nparts)
+{
+ index_t i,first,last;
+ index_t nnodes=0;
+
+ first=(index_t)(((size_t)batch->number*part)/nparts)&~(index_t)31;
+
+ if(part==nparts-1)
+    last=batch->number;
+ else
+    last=(index_t)(((size_t)batch->number*(part+1))/nparts)&~(index_t)31;
+
+ for(i=first;i<last;i++)
+   {
+    index_t index=batch->offset+i;
+
+    if(IsBitSet(batch->nodesx->super,index))
+      {
+       /* Mark the node as super if it is. */
+
+       if(CheckSuperNode(&batch->nodex[i],index,batch->segmentsx,batch->waysx))
+          nnodes++;
+       else
+          ClearBit(batch->nodesx->super,index);
+      }
+   }
+
+ return(nnodes);
+}
+
+
+#if defined(USE_PTHREADS) && USE_PTHREADS
+
+/*++++++++++++++++++++++++++++++++++++++
+  Choose the super-nodes from this thread's part of each batch of nodes until told to stop.
+
+  void *super_thread_function Returns NULL (required to return void*).
+
+  super_thread *thread The information for this thread.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void *super_thread_function(super_thread *thread)
+{
+ super_batch *batch=thread->batch;
+ int generation=0;
+
+ pthread_mutex_lock(&batch->mutex);
+
+ while(1)
+   {
+    while(batch->generation==generation && !batch->stop)
+       pthread_cond_wait(&batch->cond,&batch->mutex);
+
+    if(batch->generation==generation)
+       break;
+
+    generation=batch->generation;
+
+    pthread_mutex_unlock(&batch->mutex);
+
+    thread->nnodes+=ChooseSuperNodesPart(batch,thread->part,thread->nparts);
+
+    pthread_mutex_lock(&batch->mutex);
+
+    if(--batch->running==0)
+       pthread_cond_broadcast(&batch->cond);
+   }
+
+ pthread_mutex_unlock(&batch->mutex);
+
+ return(NULL);
+}
+
+#endif
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Decide whether a node is a super-node by looking at the segments and ways connected to it.
+
+  int CheckSuperNode Returns 1 if the node is a super-node or 0 if not.
+
+  NodeX *nodex The node to check.
+
+  index_t index The index of the node.
+
+  SegmentsX *segmentsx The set of segments to use.
+
+  WaysX *waysx The set of ways to use.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int CheckSuperNode(NodeX *nodex,index_t index,SegmentsX *segmentsx,WaysX *waysx)
+{
+ int count=0,j;
+ Way segmentway[MAX_SEG_PER_NODE];
+ int segmentweight[MAX_SEG_PER_NODE];
+ SegmentX *segmentx;
+
+ if(nodex->flags&(NODE_TURNRSTRCT|NODE_TURNRSTRCT2))
+    return(1);
+
+ segmentx=FirstSegmentX(segmentsx,index,1);
+
+ while(segmentx)
+   {
+    WayX *wayx=LookupWayX(waysx,segmentx->way,1);
+    int nsegments;
+
+    /* Segments that are loops count twice */
+
+    logassert(count<MAX_SEG_PER_NODE,"Too many segments for one node (increase MAX_SEG_PER_NODE?)"); /* Only a limited amount of information stored. */
+
+    if(segmentx->node1==segmentx->node2)
+       segmentweight[count]=2;
+    else
+       segmentweight[count]=1;
+
+    segmentway[count]=wayx->way;
+
+    /* If the node allows less traffic types than any connecting way then it is super if it allows anything */
+
+    if((wayx->way.allow&nodex->allow)!=wayx->way.allow && nodex->allow!=Transports_None)
+       return(1);
+
+    nsegments=segmentweight[count];
+
+    for(j=0;j<count;j++)
+       if(wayx->way.allow & segmentway[j].allow)
+         {
+          /* If two ways are different in any attribute and there is a type of traffic that can use both then it is super */
+
+          if(WaysCompare(&segmentway[j],&wayx->way))
+             return(1);
+
+          /* If there are two other segments that can be used by the same types of traffic as this one then it is super */
+
+          nsegments+=segmentweight[j];
+          if(nsegments>2)
+             return(1);
+         }
+
+    segmentx=NextSegmentX(segmentsx,segmentx,index);
+
+    count++;
+   }
+
+ return(0);
+}
+
+
 /*++++++++++++++++++++++++++++++++++++++
   Create the super-segments from the existing segments.
 
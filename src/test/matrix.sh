@@ -0,0 +1,131 @@
+#!/bin/sh
+
+# Exit on error
+
+set -e
+
+# Test name
+
+name=`basename $0 .sh`
+
+# Slim or non-slim
+
+if [ "$1" = "slim" ]; then
+    slim="-slim"
+    dir="slim"
+else
+    slim=""
+    dir="fat"
+fi
+
+# Pruned or non-pruned
+
+if [ "$2" = "prune" ]; then
+    prune=""
+    pruned="-pruned"
+else
+    prune="--prune-none"
+    pruned=""
+fi
+
+# Create the output directory
+
+dir="$dir$pruned"
+
+[ -d $dir ] || mkdir $dir
+
+# Run the programs under a run-time debugger
+
+debugger=valgrind
+debugger=
+
+# Name related options
+
+osm=$name.osm
+log=$name$slim$pruned.log
+
+option_prefix="--prefix=$name"
+option_dir="--dir=$dir"
+
+# Generic program options
+
+option_srtmtiler="--loggable --srtm-dir=$dir/$name-srtm"
+option_planetsplitter="--loggable --tagging=../../xml/routino-tagging.xml --errorlog --srtm-file=$dir/$name-srtm.mem $prune"
+option_filedumper="--dump-osm"
+option_router="--loggable --transport=bicycle --profiles=../../xml/routino-profiles.xml --translations=copyright.xml"
+
+# Create an SRTM tile with hills across the test area so that the gradients matter
+
+[ -d $dir/$name-srtm ] || mkdir $dir/$name-srtm
+
+perl -e '
+$n=1201;
+for($r=0;$r<$n;$r++)
+  {
+   @row=();
+   for($c=0;$c<$n;$c++)
+     {
+      $lat=-$r/($n-1);
+      $lon=-1+$c/($n-1);
+      push(@row,int(200+100*sin(6.2832*$lat/0.012)+100*cos(6.2832*$lon/0.010)));
+     }
+   print pack("n*",@row);
+  }
+' > $dir/$name-srtm/S01W001.hgt
+
+# Run srtmtiler
+
+echo "Running srtmtiler"
+
+echo ../srtmtiler $option_srtmtiler $dir/$name-srtm.mem > $log
+$debugger ../srtmtiler $option_srtmtiler $dir/$name-srtm.mem >> $log
+
+# Run planetsplitter
+
+echo "Running planetsplitter"
+
+echo ../planetsplitter$slim $option_dir $option_prefix $option_planetsplitter $osm >> $log
+$debugger ../planetsplitter$slim $option_dir $option_prefix $option_planetsplitter $osm >> $log
+
+rm -rf $dir/$name-srtm $dir/$name-srtm.mem
+
+# Run filedumper
+
+echo "Running filedumper"
+
+echo ../filedumper$slim $option_dir $option_prefix $option_filedumper >> $log
+$debugger ../filedumper$slim $option_dir $option_prefix $option_filedumper > $dir/$osm
+
+# Waypoints (longitude and latitude for the matrix and batch files)
+
+waypoints=`perl waypoints.pl $osm list`
+
+for waypoint in $waypoints; do
+    perl waypoints.pl $osm $waypoint 1 | sed -e 's%--lat1=\([^ ]*\) --lon1=\([^ ]*\)%\2 \1%'
+done > $dir/$name-points.txt
+
+while read point_a; do
+    while read point_b; do
+        echo "$point_a $point_b"
+    done < $dir/$name-points.txt
+done < $dir/$name-points.txt > $dir/$name-pairs.txt
+
+# Run the router for the matrix and for each pair of waypoints and compare them
+
+for type in shortest quickest; do
+
+    echo "Running router : $type"
+
+    echo ../router$slim $option_dir $option_prefix $option_router --$type --matrix=$dir/$name-points.txt >> $log
+    $debugger ../router$slim $option_dir $option_prefix $option_router --$type --matrix=$dir/$name-points.txt > $dir/$name-$type-matrix.csv 2>> $log
+
+    echo ../router$slim $option_dir $option_prefix $option_router --$type --batch=$dir/$name-pairs.txt >> $log
+    $debugger ../router$slim $option_dir $option_prefix $option_router --$type --batch=$dir/$name-pairs.txt 2>> $log | \
+        awk -v n=`echo $waypoints | wc -w` 'BEGIN {print "source,target,distance,duration"}
+                                            {printf "%d,%d,%s,%s\n",int(($1-1)/n)+1,($1-1)%n+1,$3,$4}' > $dir/$name-$type-batch.csv
+
+    echo diff -u $dir/$name-$type-batch.csv $dir/$name-$type-matrix.csv >> $log
+
+    diff -u $dir/$name-$type-batch.csv $dir/$name-$type-matrix.csv >> $log
+
+done
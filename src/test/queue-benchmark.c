@@ -0,0 +1,197 @@
+/***************************************
+ Benchmark for the different types of priority queue.
+
+ Part of the Routino routing software.
+ ******************/ /******************
+ This file Copyright 2008-2013 Andrew M. Bishop
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "results.h"
+
+
+/* Local functions */
+
+static double dijkstra(int size,int type,double *total);
+static double elapsed(struct timespec *start);
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Run Dijkstra's algorithm on a grid of nodes with random segment lengths using each type of queue.
+
+  A grid of size x size nodes is used (default 1000) with each node connected to the nodes on each side
+  and diagonally (so the queue sees the insertions and decreases that the router produces).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+int main(int argc,char **argv)
+{
+ const char *names[3]={"binary heap","4-ary heap","radix heap"};
+ int size=1000,repeat=3;
+ int type,i;
+ double check[3];
+
+ if(argc>1)
+    size=atoi(argv[1]);
+ if(argc>2)
+    repeat=atoi(argv[2]);
+
+ if(size<2 || repeat<1)
+   {
+    fprintf(stderr,"Usage: queue-benchmark [<size> [<repeat>]]\n");
+    return(1);
+   }
+
+ printf("Dijkstra on a %dx%d grid (best of %d runs)\n",size,size,repeat);
+
+ for(type=QUEUE_BINARY_HEAP;type<=QUEUE_RADIX_HEAP;type++)
+   {
+    double best=0;
+
+    for(i=0;i<repeat;i++)
+      {
+       double t=dijkstra(size,type,&check[type]);
+
+       if(i==0 || t<best)
+          best=t;
+      }
+
+    printf("  %-12s %8.3f s  (checksum %.6g)\n",names[type],best,check[type]);
+   }
+
+ for(type=QUEUE_DARY_HEAP;type<=QUEUE_RADIX_HEAP;type++)
+    if(check[type]!=check[QUEUE_BINARY_HEAP])
+      {
+       printf("Error: The %s gives different results to the %s.\n",names[type],names[QUEUE_BINARY_HEAP]);
+       return(1);
+      }
+
+ return(0);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Run Dijkstra's algorithm from the corner of a grid using one type of queue.
+
+  double dijkstra Returns the time taken in seconds.
+
+  int size The number of nodes along each side of the grid.
+
+  int type The type of queue to use.
+
+  double *total Returns the sum of the scores of all nodes.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static double dijkstra(int size,int type,double *total)
+{
+ static const int dx[8]={-1,0,1,-1,1,-1,0,1},dy[8]={-1,-1,-1,0,0,1,1,1};
+ int nnodes=size*size,n;
+ Result *results=(Result*)calloc(nnodes,sizeof(Result));
+ unsigned char *lengths=(unsigned char*)malloc(nnodes);
+ unsigned int seed=12345;
+ struct timespec start;
+ Queue *queue;
+ Result *result1;
+ double t;
+
+ /* The same random lengths for each queue type */
+
+ for(n=0;n<nnodes;n++)
+   {
+    seed=seed*1103515245+12345;
+    lengths[n]=1+((seed>>16)%100);
+
+    results[n].node=n;
+    results[n].score=INF_SCORE;
+    results[n].queued=NOT_QUEUED;
+   }
+
+ SetQueueType(type);
+
+ clock_gettime(CLOCK_MONOTONIC,&start);
+
+ queue=NewQueueList(8);
+
+ results[0].score=0;
+
+ InsertInQueue(queue,&results[0],0);
+
+ while((result1=PopFromQueue(queue)))
+   {
+    int x=result1->node%size,y=result1->node/size;
+    int i;
+
+    for(i=0;i<8;i++)
+      {
+       int x2=x+dx[i],y2=y+dy[i];
+       Result *result2;
+       score_t score;
+
+       if(x2<0 || x2>=size || y2<0 || y2>=size)
+          continue;
+
+       result2=&results[x2+y2*size];
+
+       /* The length of a segment is the average of the node weights (longer if diagonal) */
+
+       score=(score_t)(lengths[result1->node]+lengths[result2->node])*((dx[i] && dy[i])?0.7071f:0.5f);
+
+       score+=result1->score;
+
+       if(score<result2->score)
+         {
+          result2->score=score;
+
+          InsertInQueue(queue,result2,score);
+         }
+      }
+   }
+
+ FreeQueueList(queue);
+
+ t=elapsed(&start);
+
+ *total=0;
+
+ for(n=0;n<nnodes;n++)
+    *total+=results[n].score;
+
+ free(results);
+ free(lengths);
+
+ return(t);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Calculate the elapsed time since a given start time.
+
+  double elapsed Returns the elapsed time in seconds.
+
+  struct timespec *start The start time.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static double elapsed(struct timespec *start)
+{
+ struct timespec finish;
+
+ clock_gettime(CLOCK_MONOTONIC,&finish);
+
+ return((finish.tv_sec-start->tv_sec)+(finish.tv_nsec-start->tv_nsec)/1.0E9);
+}
@@ -0,0 +1,144 @@
+/***************************************
+ Benchmark for the results hash table.
+
+ Part of the Routino routing software.
+ ******************/ /******************
+ This file Copyright 2008-2013 Andrew M. Bishop
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "results.h"
+
+
+/* Local functions */
+
+static double elapsed(struct timespec *start);
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Insert and look up results with the pattern used by FindMiddleRoute() (each new node/segment
+  pair is looked up several times for the neighbouring super-segments before being inserted).
+
+  The number of results inserted can be given on the command line (default 2000000).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+int main(int argc,char **argv)
+{
+ int nresults=2000000,nlookups=4;
+ index_t *nodes,*segments;
+ unsigned int seed=12345;
+ struct timespec start;
+ double tinsert,tfind,tnext;
+ Results *results;
+ Result *result;
+ int i,j,found=0,iterated=0;
+
+ if(argc>1)
+    nresults=atoi(argv[1]);
+
+ if(nresults<1)
+   {
+    fprintf(stderr,"Usage: results-benchmark [<number>]\n");
+    return(1);
+   }
+
+ /* Random super-nodes and super-segments from a large database */
+
+ nodes=(index_t*)malloc(nresults*sizeof(index_t));
+ segments=(index_t*)malloc(nresults*sizeof(index_t));
+
+ for(i=0;i<nresults;i++)
+   {
+    seed=seed*1103515245+12345;
+    nodes[i]=(seed>>4)%(16*nresults);
+    seed=seed*1103515245+12345;
+    segments[i]=(seed>>4)%(40*nresults);
+   }
+
+ results=NewResultsList(20);
+
+ /* Insert with the look-ups for the new pair first (all miss) */
+
+ clock_gettime(CLOCK_MONOTONIC,&start);
+
+ for(i=0;i<nresults;i++)
+   {
+    for(j=0;j<nlookups;j++)
+       if(FindResult(results,nodes[i],segments[i]+j))
+          found++;
+
+    result=InsertResult(results,nodes[i],segments[i]);
+    result->score=i;
+   }
+
+ tinsert=elapsed(&start);
+
+ /* Look up the pairs again in a different order (all hit) */
+
+ clock_gettime(CLOCK_MONOTONIC,&start);
+
+ for(j=0;j<nlookups;j++)
+    for(i=j;i<nresults;i+=nlookups)
+      {
+       result=FindResult(results,nodes[i],segments[i]);
+
+       if(result && result->node==nodes[i])
+          found++;
+      }
+
+ tfind=elapsed(&start);
+
+ /* Iterate through them all */
+
+ clock_gettime(CLOCK_MONOTONIC,&start);
+
+ for(result=FirstResult(results);result;result=NextResult(results,result))
+    iterated++;
+
+ tnext=elapsed(&start);
+
+ printf("Results: %d inserted (with %d misses each) in %.3f s, %d found in %.3f s, %d iterated in %.3f s\n",
+        nresults,nlookups,tinsert,found,tfind,iterated,tnext);
+
+ FreeResultsList(results);
+
+ free(nodes);
+ free(segments);
+
+ return(0);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Calculate the elapsed time since a given start time.
+
+  double elapsed Returns the elapsed time in seconds.
+
+  struct timespec *start The start time.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static double elapsed(struct timespec *start)
+{
+ struct timespec finish;
+
+ clock_gettime(CLOCK_MONOTONIC,&finish);
+
+ return((finish.tv_sec-start->tv_sec)+(finish.tv_nsec-start->tv_nsec)/1.0E9);
+}
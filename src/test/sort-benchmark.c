@@ -0,0 +1,457 @@
+/***************************************
+ Benchmark for the fixed length file sorting.
+
+ Part of the Routino routing software.
+ ******************/ /******************
+ This file Copyright 2008-2013 Andrew M. Bishop
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "types.h"
+#include "nodesx.h"
+#include "segmentsx.h"
+
+#include "files.h"
+#include "sorting.h"
+
+
+/* Global variables (used by sorting.c) */
+
+char *option_tmpdirname=NULL;
+
+size_t option_filesort_ramsize=256*1024*1024;
+
+int option_filesort_threads=1;
+
+
+/* Local functions */
+
+static void benchmark(const char *name,const char *filename,int nitems,size_t itemsize,
+                      uint64_t (*key_function)(const void*),int (*compare_function)(const void*,const void*));
+
+static int node_sort_by_id(NodeX *a,NodeX *b);
+static uint64_t node_key_by_id(NodeX *nodex);
+static int node_sort_by_lat_long(NodeX *a,NodeX *b);
+static uint64_t node_key_by_lat_long(NodeX *nodex);
+static int segment_sort_by_id(SegmentX *a,SegmentX *b);
+static uint64_t segment_key_by_id(SegmentX *segmentx);
+
+static unsigned int random_number(void);
+
+static double elapsed(struct timespec *start);
+
+
+/*+ The random number seed. +*/
+static unsigned int seed=12345;
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Sort files of random nodes and segments with the heap sort (filesort_fixed) and the
+  radix sort (filesort_fixed_key) and check that the results are identical.
+
+  The number of records, the number of threads and the amount of RAM in MB can be given
+  on the command line (default 2000000, 1 and 256).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+int main(int argc,char **argv)
+{
+ int nitems=2000000;
+ char dirname[]="/tmp/sort-benchmark.XXXXXX";
+ char filename[64];
+ int fd,i;
+
+ if(argc>1)
+    nitems=atoi(argv[1]);
+ if(argc>2)
+    option_filesort_threads=atoi(argv[2]);
+ if(argc>3)
+    option_filesort_ramsize=(size_t)atoi(argv[3])*1024*1024;
+
+ if(nitems<1 || option_filesort_threads<1 || option_filesort_ramsize<1)
+   {
+    fprintf(stderr,"Usage: sort-benchmark [<number> [<threads> [<ramsize>]]]\n");
+    return(1);
+   }
+
+ if(!mkdtemp(dirname))
+   {
+    fprintf(stderr,"Cannot create the temporary directory.\n");
+    return(1);
+   }
+
+ option_tmpdirname=dirname;
+
+ /* Nodes with random ids (some repeated) and positions within a few degrees */
+
+ sprintf(filename,"%s/nodes.in",dirname);
+
+ fd=OpenFileBufferedNew(filename);
+
+ for(i=0;i<nitems;i++)
+   {
+    NodeX nodex={0};
+
+    nodex.id=random_number()%(nitems+nitems/20);
+    nodex.latitude =radians_to_latlong(degrees_to_radians(50.0+4.0*(random_number()%1000000)/1000000.0));
+    nodex.longitude=radians_to_latlong(degrees_to_radians(-4.0+6.0*(random_number()%1000000)/1000000.0));
+
+    WriteFileBuffered(fd,&nodex,sizeof(NodeX));
+   }
+
+ CloseFileBuffered(fd);
+
+ benchmark("NodeX by id",filename,nitems,sizeof(NodeX),
+           (uint64_t (*)(const void*))node_key_by_id,(int (*)(const void*,const void*))node_sort_by_id);
+
+ benchmark("NodeX by lat/long",filename,nitems,sizeof(NodeX),
+           (uint64_t (*)(const void*))node_key_by_lat_long,(int (*)(const void*,const void*))node_sort_by_lat_long);
+
+ DeleteFile(filename);
+
+ /* Segments between random nodes (some repeated with different distances) */
+
+ sprintf(filename,"%s/segments.in",dirname);
+
+ fd=OpenFileBufferedNew(filename);
+
+ for(i=0;i<nitems;i++)
+   {
+    SegmentX segmentx={0};
+
+    segmentx.node1=random_number()%(nitems/2);
+    segmentx.node2=segmentx.node1+random_number()%4;
+    segmentx.way=i;
+    segmentx.distance=random_number()%4;
+
+    if(random_number()%2)
+       segmentx.distance|=ONEWAY_1TO2;
+
+    WriteFileBuffered(fd,&segmentx,sizeof(SegmentX));
+   }
+
+ CloseFileBuffered(fd);
+
+ benchmark("SegmentX by id",filename,nitems,sizeof(SegmentX),
+           (uint64_t (*)(const void*))segment_key_by_id,(int (*)(const void*,const void*))segment_sort_by_id);
+
+ DeleteFile(filename);
+
+ rmdir(dirname);
+
+ return(0);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Sort a file with and without the key function and compare the results.
+
+  const char *name The name of the test.
+
+  const char *filename The name of the file to sort.
+
+  int nitems The number of items in the file.
+
+  size_t itemsize The size of each item.
+
+  uint64_t (*key_function)(const void*) The key function.
+
+  int (*compare_function)(const void*,const void*) The comparison function.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void benchmark(const char *name,const char *filename,int nitems,size_t itemsize,
+                      uint64_t (*key_function)(const void*),int (*compare_function)(const void*,const void*))
+{
+ char heapname[64],radixname[64];
+ struct timespec start;
+ double theap,tradix;
+ char *heapdata,*radixdata;
+ int fd_in,fd_out,i,same=1;
+
+ sprintf(heapname,"%s.heap",filename);
+ sprintf(radixname,"%s.radix",filename);
+
+ /* The heap sort */
+
+ fd_in=ReOpenFileBuffered(filename);
+ fd_out=OpenFileBufferedNew(heapname);
+
+ clock_gettime(CLOCK_MONOTONIC,&start);
+
+ filesort_fixed(fd_in,fd_out,itemsize,NULL,compare_function,NULL);
+
+ theap=elapsed(&start);
+
+ CloseFileBuffered(fd_in);
+ CloseFileBuffered(fd_out);
+
+ /* The radix sort */
+
+ fd_in=ReOpenFileBuffered(filename);
+ fd_out=OpenFileBufferedNew(radixname);
+
+ clock_gettime(CLOCK_MONOTONIC,&start);
+
+ filesort_fixed_key(fd_in,fd_out,itemsize,NULL,key_function,compare_function,NULL);
+
+ tradix=elapsed(&start);
+
+ CloseFileBuffered(fd_in);
+ CloseFileBuffered(fd_out);
+
+ /* Compare the results */
+
+ heapdata=malloc(itemsize);
+ radixdata=malloc(itemsize);
+
+ fd_in=ReOpenFileBuffered(heapname);
+ fd_out=ReOpenFileBuffered(radixname);
+
+ for(i=0;i<nitems;i++)
+   {
+    if(ReadFileBuffered(fd_in,heapdata,itemsize) || ReadFileBuffered(fd_out,radixdata,itemsize) ||
+       memcmp(heapdata,radixdata,itemsize))
+      {
+       same=0;
+       break;
+      }
+   }
+
+ CloseFileBuffered(fd_in);
+ CloseFileBuffered(fd_out);
+
+ DeleteFile(heapname);
+ DeleteFile(radixname);
+
+ free(heapdata);
+ free(radixdata);
+
+ printf("Sort %s: %d items, %d threads, heap sort %.3f s, radix sort %.3f s, results %s\n",
+        name,nitems,option_filesort_threads,theap,tradix,same?"identical":"DIFFERENT");
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Sort the nodes into id order (from nodesx.c).
+
+  int node_sort_by_id Returns the comparison of the id fields.
+
+  NodeX *a The first extended node.
+
+  NodeX *b The second extended node.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int node_sort_by_id(NodeX *a,NodeX *b)
+{
+ node_t a_id=a->id;
+ node_t b_id=b->id;
+
+ if(a_id<b_id)
+    return(-1);
+ else if(a_id>b_id)
+    return(1);
+ else
+    return(-FILESORT_PRESERVE_ORDER(a,b)); /* latest version first */
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Calculate the key for sorting the nodes into id order (from nodesx.c).
+
+  uint64_t node_key_by_id Returns the sort key.
+
+  NodeX *nodex The extended node.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static uint64_t node_key_by_id(NodeX *nodex)
+{
+ return(nodex->id);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Sort the nodes into latitude and longitude order (from nodesx.c).
+
+  int node_sort_by_lat_long Returns the comparison of the latitude and longitude fields.
+
+  NodeX *a The first extended node.
+
+  NodeX *b The second extended node.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int node_sort_by_lat_long(NodeX *a,NodeX *b)
+{
+ ll_bin_t a_lon=latlong_to_bin(a->longitude);
+ ll_bin_t b_lon=latlong_to_bin(b->longitude);
+
+ if(a_lon<b_lon)
+    return(-1);
+ else if(a_lon>b_lon)
+    return(1);
+ else
+   {
+    ll_bin_t a_lat=latlong_to_bin(a->latitude);
+    ll_bin_t b_lat=latlong_to_bin(b->latitude);
+
+    if(a_lat<b_lat)
+       return(-1);
+    else if(a_lat>b_lat)
+       return(1);
+    else
+      {
+       if(a->longitude<b->longitude)
+          return(-1);
+       else if(a->longitude>b->longitude)
+          return(1);
+       else
+         {
+          if(a->latitude<b->latitude)
+             return(-1);
+          else if(a->latitude>b->latitude)
+             return(1);
+         }
+
+       return(FILESORT_PRESERVE_ORDER(a,b));
+      }
+   }
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Calculate the key for sorting the nodes geographically (from nodesx.c).
+
+  uint64_t node_key_by_lat_long Returns the sort key.
+
+  NodeX *nodex The extended node.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static uint64_t node_key_by_lat_long(NodeX *nodex)
+{
+ ll_bin_t lon_bin=latlong_to_bin(nodex->longitude);
+ ll_bin_t lat_bin=latlong_to_bin(nodex->latitude);
+ ll_off_t lon_off=latlong_to_off(nodex->longitude);
+ ll_off_t lat_off=latlong_to_off(nodex->latitude);
+
+ return(((uint64_t)(uint16_t)(lon_bin^0x8000)<<48)|((uint64_t)(uint16_t)(lat_bin^0x8000)<<32)|
+        ((uint64_t)lon_off<<16)|lat_off);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Sort the segments into id order (from segmentsx.c).
+
+  int segment_sort_by_id Returns the comparison of the node fields.
+
+  SegmentX *a The first segment.
+
+  SegmentX *b The second segment.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int segment_sort_by_id(SegmentX *a,SegmentX *b)
+{
+ index_t a_id1=a->node1;
+ index_t b_id1=b->node1;
+
+ if(a_id1<b_id1)
+    return(-1);
+ else if(a_id1>b_id1)
+    return(1);
+ else /* if(a_id1==b_id1) */
+   {
+    index_t a_id2=a->node2;
+    index_t b_id2=b->node2;
+
+    if(a_id2<b_id2)
+       return(-1);
+    else if(a_id2>b_id2)
+       return(1);
+    else
+      {
+       distance_t a_distance=DISTANCE(a->distance);
+       distance_t b_distance=DISTANCE(b->distance);
+
+       if(a_distance<b_distance)
+          return(-1);
+       else if(a_distance>b_distance)
+          return(1);
+       else
+         {
+          distance_t a_distflag=DISTFLAG(a->distance);
+          distance_t b_distflag=DISTFLAG(b->distance);
+
+          if(a_distflag<b_distflag)
+             return(-1);
+          else if(a_distflag>b_distflag)
+             return(1);
+          else
+             return(FILESORT_PRESERVE_ORDER(a,b)); /* preserve order */
+         }
+      }
+   }
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Calculate the key for sorting the segments into id order (from segmentsx.c).
+
+  uint64_t segment_key_by_id Returns the sort key.
+
+  SegmentX *segmentx The segment.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static uint64_t segment_key_by_id(SegmentX *segmentx)
+{
+ return(((uint64_t)segmentx->node1<<32)|segmentx->node2);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Generate a pseudo-random number.
+
+  unsigned int random_number Returns the number.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static unsigned int random_number(void)
+{
+ seed=seed*1103515245+12345;
+
+ return(seed>>8);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Calculate the elapsed time since a given start time.
+
+  double elapsed Returns the elapsed time in seconds.
+
+  struct timespec *start The start time.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static double elapsed(struct timespec *start)
+{
+ struct timespec finish;
+
+ clock_gettime(CLOCK_MONOTONIC,&finish);
+
+ return((finish.tv_sec-start->tv_sec)+(finish.tv_nsec-start->tv_nsec)/1.0E9);
+}
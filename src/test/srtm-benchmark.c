@@ -0,0 +1,338 @@
+/***************************************
+ Benchmark for the SRTM elevation sampling.
+
+ Part of the Routino routing software.
+ ******************/ /******************
+ This file Copyright 2008-2013 Andrew M. Bishop
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "srtmHgtReader.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+
+/* Local functions */
+
+static void write_tile(const char *filename,int voids);
+
+static float old_elevation(const unsigned char *tile,float lat,float lon);
+static TSrtmAscentDescent old_ascent_descent(const unsigned char *tile,float lat1,float lon1,float lat2,float lon2,float dist);
+
+static double elapsed(struct timespec *start);
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Calculate the ascent and descent of random segments with the previous scalar code (one
+  floating point interpolation per step) and with the batch sampling kernel.
+
+  The number of segments can be given on the command line (default 1000000).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+int main(int argc,char **argv)
+{
+ int nsegments=1000000;
+ float *lat1,*lon1,*lat2,*lon2,*dist,*ele1,*ele2;
+ unsigned int seed=12345;
+ char dirname[]="/tmp/srtm-benchmark.XXXXXX";
+ struct timespec start;
+ double told,tnew,old_ascent=0,new_ascent=0,old_descent=0,new_descent=0;
+ TSrtmCache *cache;
+ TSrtmAscentDescent ad;
+ double void_ascent=0;
+ int i;
+
+ if(argc>1)
+    nsegments=atoi(argv[1]);
+
+ if(nsegments<1)
+   {
+    fprintf(stderr,"Usage: srtm-benchmark [<number>]\n");
+    return(1);
+   }
+
+ /* Create a tile with hills and one with some void pixels */
+
+ if(!mkdtemp(dirname) || chdir(dirname) || mkdir("srtm",0755))
+   {
+    fprintf(stderr,"Cannot create the temporary tiles directory.\n");
+    return(1);
+   }
+
+ write_tile("srtm/N00E000.hgt",0);
+ write_tile("srtm/N00E001.hgt",1);
+
+ /* Random segments between 10 m and 2 km long within the first tile */
+
+ lat1=(float*)malloc(nsegments*sizeof(float));
+ lon1=(float*)malloc(nsegments*sizeof(float));
+ lat2=(float*)malloc(nsegments*sizeof(float));
+ lon2=(float*)malloc(nsegments*sizeof(float));
+ dist=(float*)malloc(nsegments*sizeof(float));
+ ele1=(float*)malloc(nsegments*sizeof(float));
+ ele2=(float*)malloc(nsegments*sizeof(float));
+
+ for(i=0;i<nsegments;i++)
+   {
+    double length,angle;
+
+    seed=seed*1103515245+12345;
+    lat1[i]=0.02+0.96*(seed>>8)/16777216.0;
+    seed=seed*1103515245+12345;
+    lon1[i]=0.02+0.96*(seed>>8)/16777216.0;
+    seed=seed*1103515245+12345;
+    length=10+1990*(seed>>8)/16777216.0;
+    seed=seed*1103515245+12345;
+    angle=2*M_PI*(seed>>8)/16777216.0;
+
+    lat2[i]=lat1[i]+length*sin(angle)/111320.0;
+    lon2[i]=lon1[i]+length*cos(angle)/111320.0;
+    dist[i]=length;
+   }
+
+ cache=srtmNewCache();
+
+ srtmLoadTile(cache,0,0);
+
+ /* The node elevations are calculated before the segments when the database is created */
+
+ for(i=0;i<nsegments;i++)
+   {
+    ele1[i]=srtmGetElevation(cache,lat1[i],lon1[i]);
+    ele2[i]=srtmGetElevation(cache,lat2[i],lon2[i]);
+   }
+
+ /* The previous scalar code */
+
+ clock_gettime(CLOCK_MONOTONIC,&start);
+
+ for(i=0;i<nsegments;i++)
+   {
+    ad=old_ascent_descent(cache->tile->data,lat1[i],lon1[i],lat2[i],lon2[i],dist[i]);
+
+    old_ascent+=ad.ascent;
+    old_descent+=ad.descent;
+   }
+
+ told=elapsed(&start);
+
+ /* The batch sampling kernel */
+
+ clock_gettime(CLOCK_MONOTONIC,&start);
+
+ for(i=0;i<nsegments;i++)
+   {
+    ad=srtmGetAscentDescent(cache,lat1[i],lon1[i],ele1[i],lat2[i],lon2[i],ele2[i],dist[i]);
+
+    new_ascent+=ad.ascent;
+    new_descent+=ad.descent;
+   }
+
+ tnew=elapsed(&start);
+
+ printf("SRTM: %d segments, scalar %.3f s (ascent %.0f m descent %.0f m), %s kernel %.3f s (ascent %.0f m descent %.0f m)\n",
+        nsegments,told,old_ascent,old_descent,srtmKernelName(),tnew,new_ascent,new_descent);
+
+ /* Void pixels are skipped (the previous code stopped) */
+
+ for(i=0;i<nsegments && i<10000;i++)
+   {
+    ad=srtmGetAscentDescent(cache,lat1[i],lon1[i]+1,srtmGetElevation(cache,lat1[i],lon1[i]+1),
+                                  lat2[i],lon2[i]+1,srtmGetElevation(cache,lat2[i],lon2[i]+1),dist[i]);
+
+    void_ascent+=ad.ascent;
+   }
+
+ printf("SRTM: %d segments with void pixels (ascent %.0f m)\n",i,void_ascent);
+
+ srtmClose(cache);
+
+ unlink("srtm/N00E000.hgt");
+ unlink("srtm/N00E001.hgt");
+ rmdir("srtm");
+ if(chdir("/")==0)
+    rmdir(dirname);
+
+ free(lat1);
+ free(lon1);
+ free(lat2);
+ free(lon2);
+ free(dist);
+ free(ele1);
+ free(ele2);
+
+ return(0);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Write a synthetic tile of rolling hills.
+
+  const char *filename The name of the tile file.
+
+  int voids Set to add some void pixels.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void write_tile(const char *filename,int voids)
+{
+ FILE *file=fopen(filename,"w");
+ int x,y;
+
+ for(y=0;y<1201;y++)
+    for(x=0;x<1201;x++)
+      {
+       int h=(int)(400+300*sin(y*0.013)*cos(x*0.011)+20*sin(x*0.37+y*0.29));
+
+       if(voids && (x*7+y*13)%101==0)
+          h=SRTM_VOID;
+
+       fputc((h>>8)&0xff,file);
+       fputc(h&0xff,file);
+      }
+
+ fclose(file);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  The previous interpolation (from srtmGetElevation() using fmod() and four srtmReadPx() calls).
+
+  float old_elevation Returns the elevation.
+
+  const unsigned char *tile The tile data (for the 0,0 tile).
+
+  float lat The latitude.
+
+  float lon The longitude.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static float old_elevation(const unsigned char *tile,float lat,float lon)
+{
+ int latDec=(int)lat;
+ int lonDec=(int)lon;
+ float secondsLat=(lat-latDec)*60*60;
+ float secondsLon=(lon-lonDec)*60*60;
+ int y=secondsLat/3;
+ int x=secondsLon/3;
+ int height[4],i;
+ int px[4][2]={{y+1,x},{y+1,x+1},{y,x},{y,x+1}};
+ float dy,dx;
+
+ for(i=0;i<4;i++)
+   {
+    int pos=((1200-px[i][0])*1201+px[i][1])*2;
+    int16_t hgt=0|(tile[pos]<<8)|(tile[pos+1]<<0);
+
+    if(hgt==-32768)
+       exit(1);
+
+    height[i]=hgt;
+   }
+
+ dy=fmod(secondsLat,3)/3;
+ dx=fmod(secondsLon,3)/3;
+
+ return(height[0]*dy*(1-dx)+height[1]*dy*dx+height[2]*(1-dy)*(1-dx)+height[3]*(1-dy)*dx);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  The previous ascent and descent calculation (one interpolation per step including the end points).
+
+  TSrtmAscentDescent old_ascent_descent Returns the ascent and descent.
+
+  const unsigned char *tile The tile data (for the 0,0 tile).
+
+  float lat1 The latitude of the start.
+
+  float lon1 The longitude of the start.
+
+  float lat2 The latitude of the end.
+
+  float lon2 The longitude of the end.
+
+  float dist The length of the segment.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static TSrtmAscentDescent old_ascent_descent(const unsigned char *tile,float lat1,float lon1,float lat2,float lon2,float dist)
+{
+ TSrtmAscentDescent ret={0};
+ double latDiff=lat2-lat1,lonDiff=lon2-lon1;
+ int steps=fmax(fabs(latDiff*1200),fabs(lonDiff*1200));
+ double latStep,lonStep,distStep,lat=lat1,lon=lon1;
+ float height,lastHeight,eleDiff;
+ int i;
+
+ if(steps==0) steps=1;
+
+ latStep=latDiff/steps;
+ lonStep=lonDiff/steps;
+ distStep=dist/steps;
+
+ height=old_elevation(tile,lat,lon);
+
+ for(i=0;i<steps;i++)
+   {
+    lat+=latStep;
+    lon+=lonStep;
+    lastHeight=height;
+
+    height=old_elevation(tile,lat,lon);
+    eleDiff=height-lastHeight;
+
+    if(eleDiff>0)
+      {
+       ret.ascent+=eleDiff;
+       ret.ascentOn+=distStep;
+      }
+    else
+      {
+       ret.descent+=-eleDiff;
+       ret.descentOn+=distStep;
+      }
+   }
+
+ return(ret);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Calculate the elapsed time since a given start time.
+
+  double elapsed Returns the elapsed time in seconds.
+
+  struct timespec *start The start time.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static double elapsed(struct timespec *start)
+{
+ struct timespec finish;
+
+ clock_gettime(CLOCK_MONOTONIC,&finish);
+
+ return((finish.tv_sec-start->tv_sec)+(finish.tv_nsec-start->tv_nsec)/1.0E9);
+}
@@ -54,6 +54,12 @@
 /*+ An undefined location. +*/
 #define NO_LATLONG     ((latlong_t)0x80000000)
 
+/*+ An undefined elevation. +*/
+#define NO_ELEVATION   ((elevation_t)0x8000)
+
+/*+ The largest gradient that can be stored. +*/
+#define MAX_GRADIENT   ((gradient_t)0xffff)
+
 
 /*+ The lowest number allowed for a fake node. +*/
 #define NODE_FAKE      ((index_t)0xffff0000)
@@ -383,6 +389,12 @@ typedef uint8_t length_t;
 /*+ The maximum inclination of a way, measured in multiples of 0.1 %. +*/
 typedef int16_t incline_t;
 
+/*+ The elevation of a node, measured in multiples of 0.1 metres relative to 2700 metres (covers -576.7 to 6276.7 metres). +*/
+typedef int16_t elevation_t;
+
+/*+ The average gradient of the ascent or descent along a segment, measured in multiples of 0.1 %. +*/
+typedef uint16_t gradient_t;
+
 
 /*+ Conversion of km/hr to speed_t. +*/
 #define kph_to_speed(xxx)      (speed_t)(xxx)
@@ -420,6 +432,18 @@ typedef int16_t incline_t;
 /*+ Conversion of incline_t to % . +*/
 #define incline_to_pourcent(xxx)  ((double)(xxx)/10.0)
 
+/*+ Conversion of metres to elevation_t (must be within the range of elevation_t). +*/
+#define metres_to_elevation(xxx)  (elevation_t)floor((xxx)*10-27000+0.5)
+
+/*+ Conversion of elevation_t to metres. +*/
+#define elevation_to_metres(xxx)  ((double)(xxx)/10.0+2700.0)
+
+/*+ Conversion of % to gradient_t (limited to the range of gradient_t). +*/
+#define pourcent_to_gradient(xxx) ((xxx)>=MAX_GRADIENT/10.0?MAX_GRADIENT:(gradient_t)((xxx)*10+0.5))
+
+/*+ Conversion of gradient_t to %. +*/
+#define gradient_to_pourcent(xxx) ((float)(xxx)/10.0f)
+
 /* Data structures */
 
 typedef struct _Node Node;
@@ -438,6 +462,10 @@ typedef struct _TurnRelation TurnRelation;
 
 typedef struct _Relations Relations;
 
+typedef struct _Query Query;
+
+typedef struct _SegmentCosts SegmentCosts;
+
 
 /* Functions in types.c */
 
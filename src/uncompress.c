@@ -20,7 +20,10 @@
  ***************************************/
 
 
+#include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
 #include <unistd.h>
 #include <signal.h>
 
@@ -29,6 +32,10 @@
 #include <bzlib.h>
 #endif
 
+#if defined(USE_PTHREADS) && USE_PTHREADS
+#include <pthread.h>
+#endif
+
 #if defined(USE_GZIP) && USE_GZIP
 #include <zlib.h>
 #endif
@@ -37,6 +44,80 @@
 #include "uncompress.h"
 
 
+#if defined(USE_BZIP2) && USE_BZIP2 && defined(USE_PTHREADS) && USE_PTHREADS
+
+/* Constants */
+
+#define BZIP2_BLOCK_MAGIC  0x314159265359ULL  /*+ The 48-bit pattern at the start of each bzip2 block. +*/
+#define BZIP2_STREAM_MAGIC 0x177245385090ULL  /*+ The 48-bit pattern at the end of each bzip2 stream. +*/
+
+#define BZIP2_HEADER 0          /*+ A segment of the file that is the stream header. +*/
+#define BZIP2_BLOCK  1          /*+ A segment of the file that is a compressed block. +*/
+#define BZIP2_END    2          /*+ A segment of the file that is a stream end (and the next stream header). +*/
+
+#define BZIP2_EMPTY   0         /*+ A segment slot that is not in use. +*/
+#define BZIP2_READ    1         /*+ A segment slot that has been read but not decompressed. +*/
+#define BZIP2_DECODED 2         /*+ A segment slot that is ready to be written. +*/
+
+#define BZIP2_READ_SIZE (1024*1024) /*+ The amount of compressed data to read at a time. +*/
+
+
+/* Data types */
+
+/*+ A segment of a bzip2 file between two of the 48-bit patterns. +*/
+typedef struct _bzip2_segment
+{
+ int            state;          /*+ The state of the segment slot (empty, read or decoded). +*/
+ int            type;           /*+ The type of the segment (header, block or end). +*/
+
+ unsigned char *bits;           /*+ The bits of the segment (starting at the first bit of the first byte). +*/
+ uint64_t       nbits;          /*+ The number of bits in the segment. +*/
+ size_t         bits_allocated; /*+ The allocated size of the bits. +*/
+
+ char          *data;           /*+ The uncompressed data of a block. +*/
+ size_t         length;         /*+ The length of the uncompressed data. +*/
+ size_t         data_allocated; /*+ The allocated size of the uncompressed data. +*/
+
+ int            error;          /*+ Set if the block could not be uncompressed on its own. +*/
+}
+ bzip2_segment;
+
+/*+ The state of a multi-threaded bzip2 decompressor for one file. +*/
+typedef struct _bzip2_threads
+{
+ int              filefd;       /*+ The file descriptor of the compressed file. +*/
+ int              pipefd;       /*+ The file descriptor of the writing end of the pipe. +*/
+
+ pthread_mutex_t  mutex;        /*+ The mutex that protects the counters and segment states. +*/
+ pthread_cond_t   cond;         /*+ The condition that is signalled when anything changes. +*/
+
+ pthread_t        scanner;      /*+ The thread that reads the file and splits it into segments. +*/
+ pthread_t       *decoders;     /*+ The threads that uncompress the blocks. +*/
+ int              ndecoders;    /*+ The number of threads that uncompress the blocks. +*/
+
+ bzip2_segment   *segments;     /*+ The ring of segment slots. +*/
+ int              nsegments;    /*+ The number of segment slots. +*/
+
+ uint64_t         nread;        /*+ The number of segments that have been read. +*/
+ uint64_t         ndecoding;    /*+ The number of segments that have been taken for uncompressing. +*/
+ uint64_t         nwritten;     /*+ The number of segments that have been written. +*/
+
+ int              scanned;      /*+ Set when the whole file has been read. +*/
+ int              stopped;      /*+ Set when the uncompressed data can no longer be written. +*/
+
+ unsigned char    shifts[256];  /*+ For each byte the bit offsets at which a pattern can start in the previous byte. +*/
+}
+ bzip2_threads;
+
+#endif /* USE_BZIP2 && USE_PTHREADS */
+
+
+/* Global variables */
+
+/*+ The number of threads to use for uncompressing bzip2 files. +*/
+extern int option_bzip2_threads;
+
+
 /* Local functions */
 
 static int pipe_and_fork(int filefd,int *pipefd);
@@ -45,13 +126,29 @@ static int pipe_and_fork(int filefd,int *pipefd);
 static void uncompress_bzip2_pipe(int filefd,int pipefd);
 #endif
 
+#if defined(USE_BZIP2) && USE_BZIP2 && defined(USE_PTHREADS) && USE_PTHREADS
+static int uncompress_bzip2_threads(int filefd);
+
+static void *bzip2_scan_thread(bzip2_threads *bz);
+static void *bzip2_decode_thread(bzip2_threads *bz);
+static void *bzip2_write_thread(bzip2_threads *bz);
+
+static void bzip2_add_segment(bzip2_threads *bz,int type,const unsigned char *buffer,uint64_t startbit,uint64_t endbit);
+static void bzip2_release_segment(bzip2_threads *bz);
+static int bzip2_write_data(bzip2_threads *bz,const char *data,size_t length);
+
+static int bzip2_decode_block(const unsigned char *bits,uint64_t nbits,char **data,size_t *length,size_t *allocated);
+static void bzip2_append_bits(unsigned char *dst,uint64_t dstbit,const unsigned char *src,uint64_t nbits);
+#endif
+
 #if defined(USE_GZIP) && USE_GZIP
 static void uncompress_gzip_pipe(int filefd,int pipefd);
 #endif
 
 
 /*++++++++++++++++++++++++++++++++++++++
-  Create a child process to uncompress data on a file descriptor as if it were a pipe.
+  Create a child process (or several threads if --bzip2-threads is more than one) to uncompress
+  data on a file descriptor as if it were a pipe.
 
   int Uncompress_Bzip2 Returns the file descriptor of the uncompressed end of the pipe.
 
@@ -64,6 +161,13 @@ int Uncompress_Bzip2(int filefd)
 
  int pipefd=-1;
 
+#if defined(USE_PTHREADS) && USE_PTHREADS
+
+ if(option_bzip2_threads>1)
+    return(uncompress_bzip2_threads(filefd));
+
+#endif
+
  if(pipe_and_fork(filefd,&pipefd))
     return(pipefd);
 
@@ -259,6 +363,621 @@ static void uncompress_bzip2_pipe(int filefd,int pipefd)
 
 #endif /* USE_BZIP2 */
 
+#if defined(USE_BZIP2) && USE_BZIP2 && defined(USE_PTHREADS) && USE_PTHREADS
+
+/*++++++++++++++++++++++++++++++++++++++
+  Create threads to uncompress a bzip2 file in parallel and write it to a pipe in order.
+
+  int uncompress_bzip2_threads Returns the file descriptor of the uncompressed end of the pipe.
+
+  int filefd The file descriptor of the compressed file.
+
+  The file is split at the 48-bit patterns that start each block and end each stream (they are
+  not byte aligned) and each block is uncompressed by one of the threads as a stream of its own.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int uncompress_bzip2_threads(int filefd)
+{
+ int pipe_fd[2]={-1,-1};
+ bzip2_threads *bz;
+ struct sigaction action;
+ pthread_t writer;
+ int i,s;
+
+ if(pipe(pipe_fd))
+   {
+    logassert(0,"Cannot create pipe for uncompressor (try without using a compressed file)");
+    return(-1);
+   }
+
+ /* Ignore pipe signals (the writing thread stops if the pipe is closed) */
+
+ action.sa_handler=SIG_IGN;
+ sigemptyset(&action.sa_mask);
+ action.sa_flags=0;
+ sigaction(SIGPIPE,&action,NULL);
+
+ bz=(bzip2_threads*)calloc(1,sizeof(bzip2_threads));
+
+ logassert(bz,"Failed to allocate memory"); /* Check calloc() worked */
+
+ bz->filefd=filefd;
+ bz->pipefd=pipe_fd[1];
+
+ pthread_mutex_init(&bz->mutex,NULL);
+ pthread_cond_init(&bz->cond,NULL);
+
+ bz->ndecoders=option_bzip2_threads;
+ bz->nsegments=4*option_bzip2_threads;
+
+ bz->decoders=(pthread_t*)malloc(bz->ndecoders*sizeof(pthread_t));
+ bz->segments=(bzip2_segment*)calloc(bz->nsegments,sizeof(bzip2_segment));
+
+ logassert(bz->decoders && bz->segments,"Failed to allocate memory"); /* Check malloc() worked */
+
+ /* The second byte of a pattern starting at bit s of a byte is bits 32+s to 39+s of the pattern */
+
+ for(s=0;s<8;s++)
+   {
+    bz->shifts[(BZIP2_BLOCK_MAGIC >>(32+s))&0xff]|=1<<s;
+    bz->shifts[(BZIP2_STREAM_MAGIC>>(32+s))&0xff]|=1<<s;
+   }
+
+ pthread_create(&bz->scanner,NULL,(void* (*)(void*))bzip2_scan_thread,bz);
+
+ for(i=0;i<bz->ndecoders;i++)
+    pthread_create(&bz->decoders[i],NULL,(void* (*)(void*))bzip2_decode_thread,bz);
+
+ pthread_create(&writer,NULL,(void* (*)(void*))bzip2_write_thread,bz);
+
+ pthread_detach(writer);
+
+ return(pipe_fd[0]);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  The thread that reads the compressed file and splits it into segments.
+
+  void *bzip2_scan_thread Returns NULL.
+
+  bzip2_threads *bz The state of the decompressor.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void *bzip2_scan_thread(bzip2_threads *bz)
+{
+ unsigned char *buffer;
+ size_t allocated=2*BZIP2_READ_SIZE+8,length=0,scanpos=0;
+ uint64_t segbit=0;
+ int segtype=BZIP2_HEADER,eof=0;
+
+ buffer=(unsigned char*)malloc(allocated);
+
+ logassert(buffer,"Failed to allocate memory"); /* Check malloc() worked */
+
+ do
+   {
+    size_t limit;
+
+    /* Discard the data before the current segment and read some more */
+
+    if(segbit>=8)
+      {
+       size_t skip=segbit/8;
+
+       memmove(buffer,buffer+skip,length-skip);
+
+       length-=skip;
+       scanpos-=skip;
+       segbit-=8*skip;
+      }
+
+    while(!eof && length<scanpos+BZIP2_READ_SIZE/2)
+      {
+       ssize_t n;
+
+       if(length+BZIP2_READ_SIZE+8>allocated)
+         {
+          allocated=length+BZIP2_READ_SIZE+8;
+          buffer=(unsigned char*)realloc(buffer,allocated);
+
+          logassert(buffer,"Failed to allocate memory"); /* Check realloc() worked */
+         }
+
+       n=read(bz->filefd,buffer+length,BZIP2_READ_SIZE);
+
+       if(n<0)
+         {
+          fprintf(stderr,"Error: Cannot read the bzip2 compressed file.\n");
+          exit(EXIT_FAILURE);
+         }
+       else if(n==0)
+          eof=1;
+       else
+          length+=n;
+      }
+
+    memset(buffer+length,0,8);
+
+    if(segtype==BZIP2_HEADER && (length<4 || memcmp(buffer,"BZh",3) || buffer[3]<'1' || buffer[3]>'9'))
+      {
+       fprintf(stderr,"Error: The file is not bzip2 compressed.\n");
+       exit(EXIT_FAILURE);
+      }
+
+    /* Search for the patterns (checking the second byte first), leaving 8 bytes for next time */
+
+    if(eof)
+       limit=length;
+    else
+       limit=length-8;
+
+    for(;scanpos<limit;scanpos++)
+       if(bz->shifts[buffer[scanpos+1]])
+         {
+          uint64_t window=0;
+          int i,s;
+
+          for(i=0;i<8;i++)
+             window=(window<<8)|buffer[scanpos+i];
+
+          for(s=0;s<8;s++)
+             if(bz->shifts[buffer[scanpos+1]]&(1<<s))
+               {
+                uint64_t pattern=(window>>(16-s))&0xffffffffffffULL;
+                uint64_t bit=8*(uint64_t)scanpos+s;
+
+                if(bit>segbit && bit+48<=8*(uint64_t)length && (pattern==BZIP2_BLOCK_MAGIC || pattern==BZIP2_STREAM_MAGIC))
+                  {
+                   bzip2_add_segment(bz,segtype,buffer,segbit,bit);
+
+                   segtype=(pattern==BZIP2_BLOCK_MAGIC)?BZIP2_BLOCK:BZIP2_END;
+                   segbit=bit;
+                  }
+               }
+         }
+   }
+ while(!eof && !bz->stopped);
+
+ if(eof)
+    bzip2_add_segment(bz,segtype,buffer,segbit,8*(uint64_t)length);
+
+ close(bz->filefd);
+
+ free(buffer);
+
+ pthread_mutex_lock(&bz->mutex);
+
+ bz->scanned=1;
+
+ pthread_cond_broadcast(&bz->cond);
+
+ pthread_mutex_unlock(&bz->mutex);
+
+ return(NULL);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Copy a segment of the file into the next free segment slot (waiting for one to be free).
+
+  bzip2_threads *bz The state of the decompressor.
+
+  int type The type of the segment.
+
+  const unsigned char *buffer The buffer containing the compressed data.
+
+  uint64_t startbit The bit offset of the start of the segment in the buffer.
+
+  uint64_t endbit The bit offset of the end of the segment in the buffer.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void bzip2_add_segment(bzip2_threads *bz,int type,const unsigned char *buffer,uint64_t startbit,uint64_t endbit)
+{
+ bzip2_segment *segment;
+ size_t i,nbytes;
+ int shift=startbit%8;
+
+ pthread_mutex_lock(&bz->mutex);
+
+ while(!bz->stopped && bz->nread==bz->nwritten+bz->nsegments)
+    pthread_cond_wait(&bz->cond,&bz->mutex);
+
+ pthread_mutex_unlock(&bz->mutex);
+
+ if(bz->stopped)
+    return;
+
+ segment=&bz->segments[bz->nread%bz->nsegments];
+
+ nbytes=(endbit-startbit+7)/8;
+
+ if(segment->bits_allocated<nbytes+1)
+   {
+    segment->bits_allocated=nbytes+1;
+    segment->bits=(unsigned char*)realloc(segment->bits,segment->bits_allocated);
+
+    logassert(segment->bits,"Failed to allocate memory"); /* Check realloc() worked */
+   }
+
+ /* Shift the bits so that the segment starts on a byte boundary (the buffer is padded) */
+
+ buffer+=startbit/8;
+
+ if(shift)
+    for(i=0;i<nbytes;i++)
+       segment->bits[i]=(buffer[i]<<shift)|(buffer[i+1]>>(8-shift));
+ else
+    memcpy(segment->bits,buffer,nbytes);
+
+ if((endbit-startbit)%8)
+    segment->bits[nbytes-1]&=0xff<<(8-(endbit-startbit)%8);
+
+ segment->type=type;
+ segment->nbits=endbit-startbit;
+ segment->error=0;
+
+ pthread_mutex_lock(&bz->mutex);
+
+ segment->state=BZIP2_READ;
+
+ bz->nread++;
+
+ pthread_cond_broadcast(&bz->cond);
+
+ pthread_mutex_unlock(&bz->mutex);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  A thread that uncompresses the blocks in the order that they were read.
+
+  void *bzip2_decode_thread Returns NULL.
+
+  bzip2_threads *bz The state of the decompressor.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void *bzip2_decode_thread(bzip2_threads *bz)
+{
+ while(1)
+   {
+    bzip2_segment *segment;
+
+    pthread_mutex_lock(&bz->mutex);
+
+    while(!bz->stopped && !bz->scanned && bz->ndecoding==bz->nread)
+       pthread_cond_wait(&bz->cond,&bz->mutex);
+
+    if(bz->stopped || bz->ndecoding==bz->nread)
+      {
+       pthread_mutex_unlock(&bz->mutex);
+       break;
+      }
+
+    segment=&bz->segments[bz->ndecoding%bz->nsegments];
+
+    bz->ndecoding++;
+
+    pthread_mutex_unlock(&bz->mutex);
+
+    if(segment->type==BZIP2_BLOCK)
+       segment->error=bzip2_decode_block(segment->bits,segment->nbits,&segment->data,&segment->length,&segment->data_allocated);
+    else
+       segment->length=0;
+
+    pthread_mutex_lock(&bz->mutex);
+
+    segment->state=BZIP2_DECODED;
+
+    pthread_cond_broadcast(&bz->cond);
+
+    pthread_mutex_unlock(&bz->mutex);
+   }
+
+ return(NULL);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  The thread that writes the uncompressed blocks to the pipe in order and then tidies up.
+
+  void *bzip2_write_thread Returns NULL.
+
+  bzip2_threads *bz The state of the decompressor.
+
+  A block that cannot be uncompressed on its own was split by a pattern that occurred by chance
+  within the compressed data, it is joined to the following segments until it can be.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void *bzip2_write_thread(bzip2_threads *bz)
+{
+ int i;
+
+ while(1)
+   {
+    bzip2_segment *segment=&bz->segments[bz->nwritten%bz->nsegments];
+
+    int finished;
+
+    pthread_mutex_lock(&bz->mutex);
+
+    while(!(bz->scanned && bz->nwritten==bz->nread) && !(bz->nwritten<bz->nread && segment->state==BZIP2_DECODED))
+       pthread_cond_wait(&bz->cond,&bz->mutex);
+
+    finished=(bz->nwritten==bz->nread);
+
+    pthread_mutex_unlock(&bz->mutex);
+
+    if(finished)
+       break;
+
+    if(segment->type!=BZIP2_BLOCK)
+       bzip2_release_segment(bz);
+    else if(!segment->error)
+      {
+       if(bzip2_write_data(bz,segment->data,segment->length))
+          break;
+
+       bzip2_release_segment(bz);
+      }
+    else
+      {
+       unsigned char *bits;
+       uint64_t nbits=segment->nbits;
+       char *data=NULL;
+       size_t length=0,allocated=0;
+
+       bits=(unsigned char*)calloc((nbits+7)/8+1,1);
+
+       logassert(bits,"Failed to allocate memory"); /* Check calloc() worked */
+
+       memcpy(bits,segment->bits,(nbits+7)/8);
+
+       bzip2_release_segment(bz);
+
+       do
+         {
+          segment=&bz->segments[bz->nwritten%bz->nsegments];
+
+          pthread_mutex_lock(&bz->mutex);
+
+          while(!(bz->scanned && bz->nwritten==bz->nread) && !(bz->nwritten<bz->nread && segment->state==BZIP2_DECODED))
+             pthread_cond_wait(&bz->cond,&bz->mutex);
+
+          finished=(bz->nwritten==bz->nread);
+
+          pthread_mutex_unlock(&bz->mutex);
+
+          if(finished)
+            {
+             fprintf(stderr,"Error: Cannot uncompress the bzip2 compressed file (corrupted data?).\n");
+             exit(EXIT_FAILURE);
+            }
+
+          bits=(unsigned char*)realloc(bits,(nbits+segment->nbits+7)/8+1);
+
+          logassert(bits,"Failed to allocate memory"); /* Check realloc() worked */
+
+          memset(bits+(nbits+7)/8,0,(nbits+segment->nbits+7)/8+1-(nbits+7)/8);
+
+          bzip2_append_bits(bits,nbits,segment->bits,segment->nbits);
+
+          nbits+=segment->nbits;
+
+          bzip2_release_segment(bz);
+         }
+       while(bzip2_decode_block(bits,nbits,&data,&length,&allocated));
+
+       free(bits);
+
+       i=bzip2_write_data(bz,data,length);
+
+       free(data);
+
+       if(i)
+          break;
+      }
+   }
+
+ /* Stop the other threads (if they are still running) and tidy up */
+
+ pthread_mutex_lock(&bz->mutex);
+
+ bz->stopped=1;
+
+ pthread_cond_broadcast(&bz->cond);
+
+ pthread_mutex_unlock(&bz->mutex);
+
+ close(bz->pipefd);
+
+ pthread_join(bz->scanner,NULL);
+
+ for(i=0;i<bz->ndecoders;i++)
+    pthread_join(bz->decoders[i],NULL);
+
+ for(i=0;i<bz->nsegments;i++)
+   {
+    if(bz->segments[i].bits)
+       free(bz->segments[i].bits);
+    if(bz->segments[i].data)
+       free(bz->segments[i].data);
+   }
+
+ pthread_mutex_destroy(&bz->mutex);
+ pthread_cond_destroy(&bz->cond);
+
+ free(bz->segments);
+ free(bz->decoders);
+ free(bz);
+
+ return(NULL);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Mark the oldest segment slot as free for the next segment.
+
+  bzip2_threads *bz The state of the decompressor.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void bzip2_release_segment(bzip2_threads *bz)
+{
+ pthread_mutex_lock(&bz->mutex);
+
+ bz->segments[bz->nwritten%bz->nsegments].state=BZIP2_EMPTY;
+
+ bz->nwritten++;
+
+ pthread_cond_broadcast(&bz->cond);
+
+ pthread_mutex_unlock(&bz->mutex);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Write uncompressed data to the pipe.
+
+  int bzip2_write_data Returns 0 if the data was written or 1 if the pipe has been closed.
+
+  bzip2_threads *bz The state of the decompressor.
+
+  const char *data The uncompressed data.
+
+  size_t length The length of the uncompressed data.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int bzip2_write_data(bzip2_threads *bz,const char *data,size_t length)
+{
+ while(length>0)
+   {
+    ssize_t m=write(bz->pipefd,data,length);
+
+    if(m<=0)
+       return(1);
+
+    data+=m;
+    length-=m;
+   }
+
+ return(0);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Uncompress a single bzip2 block by making it into a complete stream.
+
+  int bzip2_decode_block Returns 0 if the block was uncompressed or 1 if it was not valid.
+
+  const unsigned char *bits The block (starting with the block pattern on a byte boundary).
+
+  uint64_t nbits The number of bits in the block.
+
+  char **data Returns the uncompressed data (reallocated as required).
+
+  size_t *length Returns the length of the uncompressed data.
+
+  size_t *allocated The allocated size of the uncompressed data (updated as required).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int bzip2_decode_block(const unsigned char *bits,uint64_t nbits,char **data,size_t *length,size_t *allocated)
+{
+ bz_stream bzs={0};
+ unsigned char *stream,trailer[10];
+ size_t nbytes;
+ int state,i;
+
+ if(nbits<80)
+    return(1);
+
+ /* A stream header (for the largest block size), the block and a stream end with the block CRC */
+
+ nbytes=4+(nbits+80+7)/8;
+
+ stream=(unsigned char*)calloc(nbytes,1);
+
+ logassert(stream,"Failed to allocate memory"); /* Check calloc() worked */
+
+ memcpy(stream,"BZh9",4);
+ memcpy(stream+4,bits,(nbits+7)/8);
+
+ for(i=0;i<6;i++)
+    trailer[i]=(BZIP2_STREAM_MAGIC>>(40-8*i))&0xff;
+
+ memcpy(trailer+6,bits+6,4);
+
+ bzip2_append_bits(stream+4,nbits,trailer,80);
+
+ if(BZ2_bzDecompressInit(&bzs,0,0)!=BZ_OK)
+   {
+    free(stream);
+    return(1);
+   }
+
+ bzs.next_in=(char*)stream;
+ bzs.avail_in=nbytes;
+
+ *length=0;
+
+ do
+   {
+    if(*allocated-*length<BZIP2_READ_SIZE)
+      {
+       *allocated+=BZIP2_READ_SIZE;
+       *data=(char*)realloc(*data,*allocated);
+
+       logassert(*data,"Failed to allocate memory"); /* Check realloc() worked */
+      }
+
+    bzs.next_out=*data+*length;
+    bzs.avail_out=*allocated-*length;
+
+    state=BZ2_bzDecompress(&bzs);
+
+    *length=*allocated-bzs.avail_out;
+   }
+ while(state==BZ_OK && (bzs.avail_in>0 || bzs.avail_out==0));
+
+ BZ2_bzDecompressEnd(&bzs);
+
+ free(stream);
+
+ return(state!=BZ_STREAM_END);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Append some bits (starting on a byte boundary) to a buffer of bits (that is zero after the end).
+
+  unsigned char *dst The buffer to append the bits to.
+
+  uint64_t dstbit The number of bits already in the buffer.
+
+  const unsigned char *src The bits to append.
+
+  uint64_t nbits The number of bits to append.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static void bzip2_append_bits(unsigned char *dst,uint64_t dstbit,const unsigned char *src,uint64_t nbits)
+{
+ int shift=dstbit%8;
+ uint64_t i;
+
+ dst+=dstbit/8;
+
+ if(shift==0)
+    memcpy(dst,src,(nbits+7)/8);
+ else
+    for(i=0;i<(nbits+7)/8;i++)
+      {
+       dst[i]  |=src[i]>>shift;
+       dst[i+1]|=src[i]<<(8-shift);
+      }
+}
+
+#endif /* USE_BZIP2 && USE_PTHREADS */
+
+
 
 #if defined(USE_GZIP) && USE_GZIP
 
@@ -67,6 +67,8 @@ Ways *LoadWayList(const char *filename)
 
  ways->cache=NewWayCache();
 
+ ways->ncached[0]=ways->ncached[1]=ways->ncached[2]=NULL;
+
 #endif
 
  return(ways);
@@ -97,6 +99,57 @@ void DestroyWayList(Ways *ways)
 }
 
 
+/*++++++++++++++++++++++++++++++++++++++
+  Create a copy of a way list that shares the loaded data but has its own cache so that
+  each copy can be used by a different thread.
+
+  Ways *DuplicateWayList Returns the new way list.
+
+  Ways *ways The way list to copy.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+Ways *DuplicateWayList(Ways *ways)
+{
+ Ways *newways;
+
+ newways=(Ways*)malloc(sizeof(Ways));
+
+ *newways=*ways;
+
+#if SLIM
+
+ newways->cache=NewWayCache();
+
+ newways->ncached[0]=newways->ncached[1]=newways->ncached[2]=NULL;
+
+#endif
+
+ return(newways);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  Destroy a copy of a way list created by DuplicateWayList() (the shared data is kept).
+
+  Ways *ways The way list copy to destroy.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+void DestroyDuplicateWayList(Ways *ways)
+{
+#if SLIM
+
+ DeleteWayCache(ways->cache);
+
+ if(ways->ncached[0]) free(ways->ncached[0]);
+ if(ways->ncached[1]) free(ways->ncached[1]);
+ if(ways->ncached[2]) free(ways->ncached[2]);
+
+#endif
+
+ free(ways);
+}
+
+
 /*++++++++++++++++++++++++++++++++++++++
   Return 0 if the two ways are the same (in respect of their types and limits),
            otherwise return positive or negative to allow sorting.
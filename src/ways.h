@@ -101,6 +101,10 @@ Ways *LoadWayList(const char *filename);
 
 void DestroyWayList(Ways *ways);
 
+Ways *DuplicateWayList(Ways *ways);
+
+void DestroyDuplicateWayList(Ways *ways);
+
 int WaysCompare(Way *way1p,Way *way2p);
 
 
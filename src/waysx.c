@@ -77,8 +77,8 @@ WaysX *NewWayList(int append,int readonly)
 
  logassert(waysx,"Failed to allocate memory (try using slim mode?)"); /* Check calloc() worked */
 
- waysx->filename    =(char*)malloc(strlen(option_tmpdirname)+32);
- waysx->filename_tmp=(char*)malloc(strlen(option_tmpdirname)+32);
+ waysx->filename    =(char*)malloc(strlen(option_tmpdirname)+48);
+ waysx->filename_tmp=(char*)malloc(strlen(option_tmpdirname)+48);
 
  sprintf(waysx->filename    ,"%s/waysx.parsed.mem",option_tmpdirname);
  sprintf(waysx->filename_tmp,"%s/waysx.%p.tmp"    ,option_tmpdirname,(void*)waysx);
@@ -106,7 +106,7 @@ WaysX *NewWayList(int append,int readonly)
  if(append)
     waysx->fd=OpenFileBufferedAppend(waysx->filename_tmp);
  else if(!readonly)
-    waysx->fd=OpenFileBufferedNew(waysx->filename_tmp);
+    waysx->fd=OpenFileBufferedNewTemporary(waysx->filename_tmp);
  else
     waysx->fd=-1;
 
@@ -115,7 +115,7 @@ WaysX *NewWayList(int append,int readonly)
 #endif
 
 
- waysx->nfilename_tmp=(char*)malloc(strlen(option_tmpdirname)+32);
+ waysx->nfilename_tmp=(char*)malloc(strlen(option_tmpdirname)+48);
 
  sprintf(waysx->nfilename_tmp,"%s/waynames.%p.tmp",option_tmpdirname,(void*)waysx);
 
@@ -420,7 +420,7 @@ SegmentsX *SplitWays(WaysX *waysx,NodesX *nodesx,int keep)
 
  fd=OpenFileBufferedNew(waysx->filename_tmp);
 
- nfd=OpenFileBufferedNew(waysx->nfilename_tmp);
+ nfd=OpenFileBufferedNewTemporary(waysx->nfilename_tmp);
 
  /* Loop through the ways and create the segments and way names */
 
@@ -551,7 +551,7 @@ void SortWayNames(WaysX *waysx)
 
  DeleteFile(waysx->nfilename_tmp);
 
- nfd=OpenFileBufferedNew(waysx->nfilename_tmp);
+ nfd=OpenFileBufferedNewTemporary(waysx->nfilename_tmp);
 
  /* Sort the way names */
 
@@ -589,7 +589,7 @@ void SortWayNames(WaysX *waysx)
 
  DeleteFile(waysx->nfilename_tmp);
 
- nfd=OpenFileBufferedNew(waysx->nfilename_tmp);
+ nfd=OpenFileBufferedNewTemporary(waysx->nfilename_tmp);
 
  /* Update the ways and de-duplicate the names */
 
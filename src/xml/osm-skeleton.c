@@ -0,0 +1,497 @@
+/***************************************
+ An automatically generated skeleton XML parser.
+
+ Automatically generated by xsd-to-xmlparser.
+ ***************************************/
+
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "xmlparse.h"
+
+
+/* The XML tag processing function prototypes */
+
+static int xmlDeclaration_function(const char *_tag_,int _type_,const char *version,const char *encoding);
+static int osmType_function(const char *_tag_,int _type_,const char *version,const char *generator);
+static int boundsType_function(const char *_tag_,int _type_,const char *minlat,const char *minlon,const char *maxlat,const char *maxlon,const char *origin);
+static int boundType_function(const char *_tag_,int _type_,const char *box,const char *origin);
+static int changesetType_function(const char *_tag_,int _type_,const char *id,const char *min_lat,const char *min_lon,const char *max_lat,const char *max_lon,const char *created_at,const char *closed_at,const char *open,const char *uid,const char *user);
+static int nodeType_function(const char *_tag_,int _type_,const char *id,const char *lat,const char *lon,const char *timestamp,const char *uid,const char *user,const char *visible,const char *version,const char *changeset,const char *action);
+static int wayType_function(const char *_tag_,int _type_,const char *id,const char *timestamp,const char *uid,const char *user,const char *visible,const char *version,const char *changeset,const char *action);
+static int relationType_function(const char *_tag_,int _type_,const char *id,const char *timestamp,const char *uid,const char *user,const char *visible,const char *version,const char *changeset,const char *action);
+static int tagType_function(const char *_tag_,int _type_,const char *k,const char *v);
+static int ndType_function(const char *_tag_,int _type_,const char *ref);
+static int memberType_function(const char *_tag_,int _type_,const char *type,const char *ref,const char *role);
+
+
+/* The XML tag definitions (forward declarations) */
+
+static xmltag xmlDeclaration_tag;
+static xmltag osmType_tag;
+static xmltag boundsType_tag;
+static xmltag boundType_tag;
+static xmltag changesetType_tag;
+static xmltag nodeType_tag;
+static xmltag wayType_tag;
+static xmltag relationType_tag;
+static xmltag tagType_tag;
+static xmltag ndType_tag;
+static xmltag memberType_tag;
+
+
+/* The XML tag definition values */
+
+/*+ The complete set of tags at the top level. +*/
+static xmltag *xml_toplevel_tags[]={&xmlDeclaration_tag,&osmType_tag,NULL};
+
+/*+ The xmlDeclaration type tag. +*/
+static xmltag xmlDeclaration_tag=
+              {"xml",
+               2, {"version","encoding"},
+               xmlDeclaration_function,
+               {NULL}};
+
+/*+ The osmType type tag. +*/
+static xmltag osmType_tag=
+              {"osm",
+               2, {"version","generator"},
+               osmType_function,
+               {&boundsType_tag,&boundType_tag,&changesetType_tag,&nodeType_tag,&wayType_tag,&relationType_tag,NULL}};
+
+/*+ The boundsType type tag. +*/
+static xmltag boundsType_tag=
+              {"bounds",
+               5, {"minlat","minlon","maxlat","maxlon","origin"},
+               boundsType_function,
+               {NULL}};
+
+/*+ The boundType type tag. +*/
+static xmltag boundType_tag=
+              {"bound",
+               2, {"box","origin"},
+               boundType_function,
+               {NULL}};
+
+/*+ The changesetType type tag. +*/
+static xmltag changesetType_tag=
+              {"changeset",
+               10, {"id","min_lat","min_lon","max_lat","max_lon","created_at","closed_at","open","uid","user"},
+               changesetType_function,
+               {&tagType_tag,NULL}};
+
+/*+ The nodeType type tag. +*/
+static xmltag nodeType_tag=
+              {"node",
+               10, {"id","lat","lon","timestamp","uid","user","visible","version","changeset","action"},
+               nodeType_function,
+               {&tagType_tag,NULL}};
+
+/*+ The wayType type tag. +*/
+static xmltag wayType_tag=
+              {"way",
+               8, {"id","timestamp","uid","user","visible","version","changeset","action"},
+               wayType_function,
+               {&ndType_tag,&tagType_tag,NULL}};
+
+/*+ The relationType type tag. +*/
+static xmltag relationType_tag=
+              {"relation",
+               8, {"id","timestamp","uid","user","visible","version","changeset","action"},
+               relationType_function,
+               {&memberType_tag,&tagType_tag,NULL}};
+
+/*+ The tagType type tag. +*/
+static xmltag tagType_tag=
+              {"tag",
+               2, {"k","v"},
+               tagType_function,
+               {NULL}};
+
+/*+ The ndType type tag. +*/
+static xmltag ndType_tag=
+              {"nd",
+               1, {"ref"},
+               ndType_function,
+               {NULL}};
+
+/*+ The memberType type tag. +*/
+static xmltag memberType_tag=
+              {"member",
+               3, {"type","ref","role"},
+               memberType_function,
+               {NULL}};
+
+
+/* The XML tag processing functions */
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  The function that is called when the XML declaration is seen
+
+  int xmlDeclaration_function Returns 0 if no error occured or something else otherwise.
+
+  const char *_tag_ Set to the name of the element tag that triggered this function call.
+
+  int _type_ Set to XMLPARSE_TAG_START at the start of a tag and/or XMLPARSE_TAG_END at the end of a tag.
+
+  const char *version The contents of the 'version' attribute (or NULL if not defined).
+
+  const char *encoding The contents of the 'encoding' attribute (or NULL if not defined).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int xmlDeclaration_function(const char *_tag_,int _type_,const char *version,const char *encoding)
+{
+ printf("<%s%s",(_type_==XMLPARSE_TAG_END)?"/":"",_tag_);
+ if(version) printf(" version=\"%s\"",ParseXML_Encode_Safe_XML(version));
+ if(encoding) printf(" encoding=\"%s\"",ParseXML_Encode_Safe_XML(encoding));
+ printf("%s>\n",(_type_==(XMLPARSE_TAG_START|XMLPARSE_TAG_END))?" /":"");
+ return(0);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  The function that is called when the osmType XSD type is seen
+
+  int osmType_function Returns 0 if no error occured or something else otherwise.
+
+  const char *_tag_ Set to the name of the element tag that triggered this function call.
+
+  int _type_ Set to XMLPARSE_TAG_START at the start of a tag and/or XMLPARSE_TAG_END at the end of a tag.
+
+  const char *version The contents of the 'version' attribute (or NULL if not defined).
+
+  const char *generator The contents of the 'generator' attribute (or NULL if not defined).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int osmType_function(const char *_tag_,int _type_,const char *version,const char *generator)
+{
+ printf("<%s%s",(_type_==XMLPARSE_TAG_END)?"/":"",_tag_);
+ if(version) printf(" version=\"%s\"",ParseXML_Encode_Safe_XML(version));
+ if(generator) printf(" generator=\"%s\"",ParseXML_Encode_Safe_XML(generator));
+ printf("%s>\n",(_type_==(XMLPARSE_TAG_START|XMLPARSE_TAG_END))?" /":"");
+ return(0);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  The function that is called when the boundsType XSD type is seen
+
+  int boundsType_function Returns 0 if no error occured or something else otherwise.
+
+  const char *_tag_ Set to the name of the element tag that triggered this function call.
+
+  int _type_ Set to XMLPARSE_TAG_START at the start of a tag and/or XMLPARSE_TAG_END at the end of a tag.
+
+  const char *minlat The contents of the 'minlat' attribute (or NULL if not defined).
+
+  const char *minlon The contents of the 'minlon' attribute (or NULL if not defined).
+
+  const char *maxlat The contents of the 'maxlat' attribute (or NULL if not defined).
+
+  const char *maxlon The contents of the 'maxlon' attribute (or NULL if not defined).
+
+  const char *origin The contents of the 'origin' attribute (or NULL if not defined).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int boundsType_function(const char *_tag_,int _type_,const char *minlat,const char *minlon,const char *maxlat,const char *maxlon,const char *origin)
+{
+ printf("<%s%s",(_type_==XMLPARSE_TAG_END)?"/":"",_tag_);
+ if(minlat) printf(" minlat=\"%s\"",ParseXML_Encode_Safe_XML(minlat));
+ if(minlon) printf(" minlon=\"%s\"",ParseXML_Encode_Safe_XML(minlon));
+ if(maxlat) printf(" maxlat=\"%s\"",ParseXML_Encode_Safe_XML(maxlat));
+ if(maxlon) printf(" maxlon=\"%s\"",ParseXML_Encode_Safe_XML(maxlon));
+ if(origin) printf(" origin=\"%s\"",ParseXML_Encode_Safe_XML(origin));
+ printf("%s>\n",(_type_==(XMLPARSE_TAG_START|XMLPARSE_TAG_END))?" /":"");
+ return(0);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  The function that is called when the boundType XSD type is seen
+
+  int boundType_function Returns 0 if no error occured or something else otherwise.
+
+  const char *_tag_ Set to the name of the element tag that triggered this function call.
+
+  int _type_ Set to XMLPARSE_TAG_START at the start of a tag and/or XMLPARSE_TAG_END at the end of a tag.
+
+  const char *box The contents of the 'box' attribute (or NULL if not defined).
+
+  const char *origin The contents of the 'origin' attribute (or NULL if not defined).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int boundType_function(const char *_tag_,int _type_,const char *box,const char *origin)
+{
+ printf("<%s%s",(_type_==XMLPARSE_TAG_END)?"/":"",_tag_);
+ if(box) printf(" box=\"%s\"",ParseXML_Encode_Safe_XML(box));
+ if(origin) printf(" origin=\"%s\"",ParseXML_Encode_Safe_XML(origin));
+ printf("%s>\n",(_type_==(XMLPARSE_TAG_START|XMLPARSE_TAG_END))?" /":"");
+ return(0);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  The function that is called when the changesetType XSD type is seen
+
+  int changesetType_function Returns 0 if no error occured or something else otherwise.
+
+  const char *_tag_ Set to the name of the element tag that triggered this function call.
+
+  int _type_ Set to XMLPARSE_TAG_START at the start of a tag and/or XMLPARSE_TAG_END at the end of a tag.
+
+  const char *id The contents of the 'id' attribute (or NULL if not defined).
+
+  const char *min_lat The contents of the 'min_lat' attribute (or NULL if not defined).
+
+  const char *min_lon The contents of the 'min_lon' attribute (or NULL if not defined).
+
+  const char *max_lat The contents of the 'max_lat' attribute (or NULL if not defined).
+
+  const char *max_lon The contents of the 'max_lon' attribute (or NULL if not defined).
+
+  const char *created_at The contents of the 'created_at' attribute (or NULL if not defined).
+
+  const char *closed_at The contents of the 'closed_at' attribute (or NULL if not defined).
+
+  const char *open The contents of the 'open' attribute (or NULL if not defined).
+
+  const char *uid The contents of the 'uid' attribute (or NULL if not defined).
+
+  const char *user The contents of the 'user' attribute (or NULL if not defined).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int changesetType_function(const char *_tag_,int _type_,const char *id,const char *min_lat,const char *min_lon,const char *max_lat,const char *max_lon,const char *created_at,const char *closed_at,const char *open,const char *uid,const char *user)
+{
+ printf("<%s%s",(_type_==XMLPARSE_TAG_END)?"/":"",_tag_);
+ if(id) printf(" id=\"%s\"",ParseXML_Encode_Safe_XML(id));
+ if(min_lat) printf(" min_lat=\"%s\"",ParseXML_Encode_Safe_XML(min_lat));
+ if(min_lon) printf(" min_lon=\"%s\"",ParseXML_Encode_Safe_XML(min_lon));
+ if(max_lat) printf(" max_lat=\"%s\"",ParseXML_Encode_Safe_XML(max_lat));
+ if(max_lon) printf(" max_lon=\"%s\"",ParseXML_Encode_Safe_XML(max_lon));
+ if(created_at) printf(" created_at=\"%s\"",ParseXML_Encode_Safe_XML(created_at));
+ if(closed_at) printf(" closed_at=\"%s\"",ParseXML_Encode_Safe_XML(closed_at));
+ if(open) printf(" open=\"%s\"",ParseXML_Encode_Safe_XML(open));
+ if(uid) printf(" uid=\"%s\"",ParseXML_Encode_Safe_XML(uid));
+ if(user) printf(" user=\"%s\"",ParseXML_Encode_Safe_XML(user));
+ printf("%s>\n",(_type_==(XMLPARSE_TAG_START|XMLPARSE_TAG_END))?" /":"");
+ return(0);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  The function that is called when the nodeType XSD type is seen
+
+  int nodeType_function Returns 0 if no error occured or something else otherwise.
+
+  const char *_tag_ Set to the name of the element tag that triggered this function call.
+
+  int _type_ Set to XMLPARSE_TAG_START at the start of a tag and/or XMLPARSE_TAG_END at the end of a tag.
+
+  const char *id The contents of the 'id' attribute (or NULL if not defined).
+
+  const char *lat The contents of the 'lat' attribute (or NULL if not defined).
+
+  const char *lon The contents of the 'lon' attribute (or NULL if not defined).
+
+  const char *timestamp The contents of the 'timestamp' attribute (or NULL if not defined).
+
+  const char *uid The contents of the 'uid' attribute (or NULL if not defined).
+
+  const char *user The contents of the 'user' attribute (or NULL if not defined).
+
+  const char *visible The contents of the 'visible' attribute (or NULL if not defined).
+
+  const char *version The contents of the 'version' attribute (or NULL if not defined).
+
+  const char *changeset The contents of the 'changeset' attribute (or NULL if not defined).
+
+  const char *action The contents of the 'action' attribute (or NULL if not defined).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int nodeType_function(const char *_tag_,int _type_,const char *id,const char *lat,const char *lon,const char *timestamp,const char *uid,const char *user,const char *visible,const char *version,const char *changeset,const char *action)
+{
+ printf("<%s%s",(_type_==XMLPARSE_TAG_END)?"/":"",_tag_);
+ if(id) printf(" id=\"%s\"",ParseXML_Encode_Safe_XML(id));
+ if(lat) printf(" lat=\"%s\"",ParseXML_Encode_Safe_XML(lat));
+ if(lon) printf(" lon=\"%s\"",ParseXML_Encode_Safe_XML(lon));
+ if(timestamp) printf(" timestamp=\"%s\"",ParseXML_Encode_Safe_XML(timestamp));
+ if(uid) printf(" uid=\"%s\"",ParseXML_Encode_Safe_XML(uid));
+ if(user) printf(" user=\"%s\"",ParseXML_Encode_Safe_XML(user));
+ if(visible) printf(" visible=\"%s\"",ParseXML_Encode_Safe_XML(visible));
+ if(version) printf(" version=\"%s\"",ParseXML_Encode_Safe_XML(version));
+ if(changeset) printf(" changeset=\"%s\"",ParseXML_Encode_Safe_XML(changeset));
+ if(action) printf(" action=\"%s\"",ParseXML_Encode_Safe_XML(action));
+ printf("%s>\n",(_type_==(XMLPARSE_TAG_START|XMLPARSE_TAG_END))?" /":"");
+ return(0);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  The function that is called when the wayType XSD type is seen
+
+  int wayType_function Returns 0 if no error occured or something else otherwise.
+
+  const char *_tag_ Set to the name of the element tag that triggered this function call.
+
+  int _type_ Set to XMLPARSE_TAG_START at the start of a tag and/or XMLPARSE_TAG_END at the end of a tag.
+
+  const char *id The contents of the 'id' attribute (or NULL if not defined).
+
+  const char *timestamp The contents of the 'timestamp' attribute (or NULL if not defined).
+
+  const char *uid The contents of the 'uid' attribute (or NULL if not defined).
+
+  const char *user The contents of the 'user' attribute (or NULL if not defined).
+
+  const char *visible The contents of the 'visible' attribute (or NULL if not defined).
+
+  const char *version The contents of the 'version' attribute (or NULL if not defined).
+
+  const char *changeset The contents of the 'changeset' attribute (or NULL if not defined).
+
+  const char *action The contents of the 'action' attribute (or NULL if not defined).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int wayType_function(const char *_tag_,int _type_,const char *id,const char *timestamp,const char *uid,const char *user,const char *visible,const char *version,const char *changeset,const char *action)
+{
+ printf("<%s%s",(_type_==XMLPARSE_TAG_END)?"/":"",_tag_);
+ if(id) printf(" id=\"%s\"",ParseXML_Encode_Safe_XML(id));
+ if(timestamp) printf(" timestamp=\"%s\"",ParseXML_Encode_Safe_XML(timestamp));
+ if(uid) printf(" uid=\"%s\"",ParseXML_Encode_Safe_XML(uid));
+ if(user) printf(" user=\"%s\"",ParseXML_Encode_Safe_XML(user));
+ if(visible) printf(" visible=\"%s\"",ParseXML_Encode_Safe_XML(visible));
+ if(version) printf(" version=\"%s\"",ParseXML_Encode_Safe_XML(version));
+ if(changeset) printf(" changeset=\"%s\"",ParseXML_Encode_Safe_XML(changeset));
+ if(action) printf(" action=\"%s\"",ParseXML_Encode_Safe_XML(action));
+ printf("%s>\n",(_type_==(XMLPARSE_TAG_START|XMLPARSE_TAG_END))?" /":"");
+ return(0);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  The function that is called when the relationType XSD type is seen
+
+  int relationType_function Returns 0 if no error occured or something else otherwise.
+
+  const char *_tag_ Set to the name of the element tag that triggered this function call.
+
+  int _type_ Set to XMLPARSE_TAG_START at the start of a tag and/or XMLPARSE_TAG_END at the end of a tag.
+
+  const char *id The contents of the 'id' attribute (or NULL if not defined).
+
+  const char *timestamp The contents of the 'timestamp' attribute (or NULL if not defined).
+
+  const char *uid The contents of the 'uid' attribute (or NULL if not defined).
+
+  const char *user The contents of the 'user' attribute (or NULL if not defined).
+
+  const char *visible The contents of the 'visible' attribute (or NULL if not defined).
+
+  const char *version The contents of the 'version' attribute (or NULL if not defined).
+
+  const char *changeset The contents of the 'changeset' attribute (or NULL if not defined).
+
+  const char *action The contents of the 'action' attribute (or NULL if not defined).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int relationType_function(const char *_tag_,int _type_,const char *id,const char *timestamp,const char *uid,const char *user,const char *visible,const char *version,const char *changeset,const char *action)
+{
+ printf("<%s%s",(_type_==XMLPARSE_TAG_END)?"/":"",_tag_);
+ if(id) printf(" id=\"%s\"",ParseXML_Encode_Safe_XML(id));
+ if(timestamp) printf(" timestamp=\"%s\"",ParseXML_Encode_Safe_XML(timestamp));
+ if(uid) printf(" uid=\"%s\"",ParseXML_Encode_Safe_XML(uid));
+ if(user) printf(" user=\"%s\"",ParseXML_Encode_Safe_XML(user));
+ if(visible) printf(" visible=\"%s\"",ParseXML_Encode_Safe_XML(visible));
+ if(version) printf(" version=\"%s\"",ParseXML_Encode_Safe_XML(version));
+ if(changeset) printf(" changeset=\"%s\"",ParseXML_Encode_Safe_XML(changeset));
+ if(action) printf(" action=\"%s\"",ParseXML_Encode_Safe_XML(action));
+ printf("%s>\n",(_type_==(XMLPARSE_TAG_START|XMLPARSE_TAG_END))?" /":"");
+ return(0);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  The function that is called when the tagType XSD type is seen
+
+  int tagType_function Returns 0 if no error occured or something else otherwise.
+
+  const char *_tag_ Set to the name of the element tag that triggered this function call.
+
+  int _type_ Set to XMLPARSE_TAG_START at the start of a tag and/or XMLPARSE_TAG_END at the end of a tag.
+
+  const char *k The contents of the 'k' attribute (or NULL if not defined).
+
+  const char *v The contents of the 'v' attribute (or NULL if not defined).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int tagType_function(const char *_tag_,int _type_,const char *k,const char *v)
+{
+ printf("<%s%s",(_type_==XMLPARSE_TAG_END)?"/":"",_tag_);
+ if(k) printf(" k=\"%s\"",ParseXML_Encode_Safe_XML(k));
+ if(v) printf(" v=\"%s\"",ParseXML_Encode_Safe_XML(v));
+ printf("%s>\n",(_type_==(XMLPARSE_TAG_START|XMLPARSE_TAG_END))?" /":"");
+ return(0);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  The function that is called when the ndType XSD type is seen
+
+  int ndType_function Returns 0 if no error occured or something else otherwise.
+
+  const char *_tag_ Set to the name of the element tag that triggered this function call.
+
+  int _type_ Set to XMLPARSE_TAG_START at the start of a tag and/or XMLPARSE_TAG_END at the end of a tag.
+
+  const char *ref The contents of the 'ref' attribute (or NULL if not defined).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int ndType_function(const char *_tag_,int _type_,const char *ref)
+{
+ printf("<%s%s",(_type_==XMLPARSE_TAG_END)?"/":"",_tag_);
+ if(ref) printf(" ref=\"%s\"",ParseXML_Encode_Safe_XML(ref));
+ printf("%s>\n",(_type_==(XMLPARSE_TAG_START|XMLPARSE_TAG_END))?" /":"");
+ return(0);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  The function that is called when the memberType XSD type is seen
+
+  int memberType_function Returns 0 if no error occured or something else otherwise.
+
+  const char *_tag_ Set to the name of the element tag that triggered this function call.
+
+  int _type_ Set to XMLPARSE_TAG_START at the start of a tag and/or XMLPARSE_TAG_END at the end of a tag.
+
+  const char *type The contents of the 'type' attribute (or NULL if not defined).
+
+  const char *ref The contents of the 'ref' attribute (or NULL if not defined).
+
+  const char *role The contents of the 'role' attribute (or NULL if not defined).
+  ++++++++++++++++++++++++++++++++++++++*/
+
+static int memberType_function(const char *_tag_,int _type_,const char *type,const char *ref,const char *role)
+{
+ printf("<?%s",_tag_);
+ if(type) printf(" type=\"%s\"",ParseXML_Encode_Safe_XML(type));
+ if(ref) printf(" ref=\"%s\"",ParseXML_Encode_Safe_XML(ref));
+ if(role) printf(" role=\"%s\"",ParseXML_Encode_Safe_XML(role));
+ printf(" ?>\n");
+ return(0);
+}
+
+
+/*++++++++++++++++++++++++++++++++++++++
+  A skeleton XML parser.
+  ++++++++++++++++++++++++++++++++++++++*/
+
+int main(int argc,char **argv)
+{
+ if(ParseXML(STDIN_FILENO,xml_toplevel_tags,XMLPARSE_UNKNOWN_ATTR_WARN))
+    return(1);
+ else
+    return(0);
+}
@@ -36,6 +36,10 @@ $data_prefix="";
 $router_exe="router";
 $filedumper_exe="filedumper";
 
+# EDIT THIS to send the routing requests to a router server (started with
+# 'router --server=<socket>') instead of running the router for each one.
+$router_socket="";
+
 # EDIT THIS to change the search type and base URL (must be a type recognised by search.pl).
 $search_type="nominatim";
 $search_baseurl="http://nominatim.openstreetmap.org/search";
@@ -28,6 +28,10 @@ require "profiles.pl";
 # Use the perl Time::HiRes module
 use Time::HiRes qw(gettimeofday tv_interval);
 
+# Use the perl modules for talking to a router server
+use IO::Socket::UNIX;
+use Cwd;
+
 $t0 = [gettimeofday];
 
 
@@ -88,13 +92,15 @@ sub RunRouter
 
    # Combine all of the parameters together
 
-   my $params="--$optimise";
+   my @params=("--$optimise");
 
    foreach my $key (keys %params)
      {
-      $params.=" --$key=$params{$key}";
+      push(@params,"--$key=$params{$key}");
      }
 
+   my $params=join(" ",@params);
+
    # Change directory
 
    mkdir $results_dir,0755 if(! -d $results_dir);
@@ -133,14 +139,26 @@ sub RunRouter
    print LOG "$router_exe $params$safe_params\n\n"; # Don't put the full pathnames in the logfile.
    close(LOG);
 
-   $params.=" --dir=$data_dir" if($data_dir);
-   $params.=" --prefix=$data_prefix" if($data_prefix);
-   $params.=" --loggable";
+   my $status="OK";
 
-   system "$bin_dir/$router_exe $params >> router.log 2>&1";
+   my $server_status=-1;
 
-   my $status="OK";
-   $status="ERROR" if($? != 0);
+   $server_status=RunRouterServer(@params,"--loggable") if($router_socket);
+
+   if($server_status<0)
+     {
+      $params.=" --dir=$data_dir" if($data_dir);
+      $params.=" --prefix=$data_prefix" if($data_prefix);
+      $params.=" --loggable";
+
+      system "$bin_dir/$router_exe $params >> router.log 2>&1";
+
+      $status="ERROR" if($? != 0);
+     }
+   elsif($server_status != 0)
+     {
+      $status="ERROR";
+     }
 
    my(undef,undef,$cuser,$csystem) = times;
 
@@ -154,6 +172,41 @@ sub RunRouter
   }
 
 
+#
+# Send the request to a router server (started with 'router --server=<socket>')
+# and append its output to the log file, returns -1 if the server is not running.
+#
+
+sub RunRouterServer
+  {
+   my(@params)=@_;
+
+   my $socket=IO::Socket::UNIX->new(Type => SOCK_STREAM, Peer => $router_socket);
+
+   return(-1) if(!$socket);
+
+   print $socket getcwd()."\n";
+   print $socket join("\n",@params)."\n\n";
+
+   my $reply;
+   {
+    local $/;
+    $reply=<$socket>;
+   }
+
+   close($socket);
+
+   my $status=1;
+   $status=$1 if($reply =~ s/\0(\d+)\n$//);
+
+   open(LOG,">>router.log");
+   print LOG $reply;
+   close(LOG);
+
+   return($status);
+  }
+
+
 #
 # Return the output file
 #